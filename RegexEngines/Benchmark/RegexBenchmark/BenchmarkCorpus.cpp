@@ -0,0 +1,216 @@
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+#include "../../NativeInfrastructure/Utf8Text.h"
+#include "BenchmarkCorpus.h"
+
+
+using namespace NativeInfrastructure;
+
+
+namespace RegexBenchmark
+{
+	namespace
+	{
+		template<size_t N>
+		const char16_t* Pick( Random& random, const char16_t* const ( &words )[N] )
+		{
+			return words[random.Next( N )];
+		}
+
+
+		const char16_t* const Words[] =
+		{
+			u"the", u"of", u"and", u"to", u"in", u"was", u"that", u"his", u"with", u"had",
+			u"for", u"upon", u"which", u"been", u"from", u"there", u"very", u"little", u"door", u"room",
+			u"night", u"street", u"letter", u"matter", u"morning", u"evening", u"nothing", u"something", u"looking", u"standing",
+			u"waiting", u"returned", u"remarked", u"answered", u"observed", u"suddenly", u"quietly", u"certainly", u"window", u"client",
+		};
+
+		const char16_t* const Names[] =
+		{
+			u"Sherlock", u"Holmes", u"Watson", u"Adler", u"Lestrade", u"Hudson", u"Baker", u"London",
+		};
+
+		const char16_t* const Domains[] =
+		{
+			u"example.com", u"mail.org", u"post.net", u"london.com",
+		};
+
+		const char16_t* const UnicodeWords[] =
+		{
+			u"\u03B1\u03BB\u03C6\u03B1", u"\u03BB\u03CC\u03B3\u03BF\u03C2", u"\u03BA\u03CC\u03C3\u03BC\u03BF\u03C2", // (Greek)
+			u"\u0434\u043E\u043C", u"\u0443\u043B\u0438\u0446\u0430", u"\u043F\u0438\u0441\u044C\u043C\u043E", // (Cyrillic)
+			u"\u6771\u4EAC", u"\u624B\u7D19", u"\u591C", // (CJK)
+			u"\xD83D\xDE00", u"\xD83D\xDD0D", // (emoji, outside of BMP)
+			u"caf\u00E9", u"na\u00EFve", u"stra\u00DFe", // (Latin-1)
+		};
+
+
+		void AppendNumber( std::u16string* text, uint32_t value, int digits )
+		{
+			char16_t buffer[16];
+
+			for( int i = digits - 1; i >= 0; --i, value /= 10 ) buffer[i] = static_cast<char16_t>( u'0' + value % 10 );
+
+			text->append( buffer, digits );
+		}
+
+
+		void AppendLine( std::u16string* text, Random& random, bool unicode )
+		{
+			int const word_count = 6 + random.Next( 9 );
+			const char16_t* previous = nullptr;
+
+			for( int i = 0; i < word_count; ++i )
+			{
+				if( i > 0 ) text->push_back( u' ' );
+
+				const char16_t* word;
+
+				if( previous != nullptr && random.Next( 25 ) == 0 )
+				{
+					word = previous; // (repeated word; see the backreference case)
+				}
+				else if( random.Next( 12 ) == 0 )
+				{
+					word = Pick( random, Names );
+				}
+				else if( unicode && random.Next( 3 ) == 0 )
+				{
+					word = Pick( random, UnicodeWords );
+				}
+				else
+				{
+					word = Pick( random, Words );
+				}
+
+				text->append( word );
+				previous = word;
+			}
+
+			if( random.Next( 5 ) == 0 )
+			{
+				// ISO 8601 date and time
+
+				text->append( u" on " );
+				AppendNumber( text, 1880 + random.Next( 140 ), 4 );
+				text->push_back( u'-' );
+				AppendNumber( text, 1 + random.Next( 12 ), 2 );
+				text->push_back( u'-' );
+				AppendNumber( text, 1 + random.Next( 28 ), 2 );
+				text->push_back( u'T' );
+				AppendNumber( text, random.Next( 24 ), 2 );
+				text->push_back( u':' );
+				AppendNumber( text, random.Next( 60 ), 2 );
+				text->push_back( u':' );
+				AppendNumber( text, random.Next( 60 ), 2 );
+			}
+
+			if( random.Next( 6 ) == 0 )
+			{
+				// e-mail address
+
+				text->append( u" to " );
+				text->append( Pick( random, Words ) );
+				text->push_back( u'.' );
+				text->append( Pick( random, Words ) );
+				text->push_back( u'@' );
+				text->append( Pick( random, Domains ) );
+			}
+
+			text->append( u".\n" );
+		}
+
+
+		// A blocklist: "\b(?:Sherlock|Holmes|...|w1|w2|...)\b", with 'count' words; the names occur in the text,
+		// the generated lowercase words (5 to 10 letters) do not.
+		std::u16string MakeKeywordPattern( size_t count )
+		{
+			Random random( 0x4B455957ULL + count );
+			std::u16string pattern = u"\\b(?:";
+
+			for( size_t i = 0; i < count; ++i )
+			{
+				if( i > 0 ) pattern.push_back( u'|' );
+
+				if( i < sizeof( Names ) / sizeof( Names[0] ) )
+				{
+					pattern.append( Names[i] );
+
+					continue;
+				}
+
+				uint32_t const length = 5 + random.Next( 6 );
+
+				for( uint32_t k = 0; k < length; ++k ) pattern.push_back( static_cast<char16_t>( u'a' + random.Next( 26 ) ) );
+			}
+
+			pattern.append( u")\\b" );
+
+			return pattern;
+		}
+	}
+
+
+	std::vector<BenchmarkCase> GetBenchmarkCases( const std::u16string& rfc822Pattern )
+	{
+		std::vector<BenchmarkCase> cases
+		{
+			{ "literal", "Literal that occurs often", u"Holmes", BenchmarkSubject::Ascii },
+			{ "literal-absent", "Literal that does not occur (pure scan)", u"Moriarty", BenchmarkSubject::Ascii },
+			{ "alternation", "Alternation of literals", u"Sherlock|Holmes|Watson|Adler|Lestrade|Hudson", BenchmarkSubject::Ascii },
+			{ "keywords-50", "Word-bounded alternation of 50 literals", MakeKeywordPattern( 50 ), BenchmarkSubject::Ascii },
+			{ "keywords-5000", "Word-bounded alternation of 5000 literals (blocklist)", MakeKeywordPattern( 5000 ), BenchmarkSubject::Ascii },
+			{ "word-suffix", "Words that end with 'ing'", u"[a-z]+ing\\b", BenchmarkSubject::Ascii },
+			{ "unicode-property", "Unicode letters by property", u"\\p{L}+", BenchmarkSubject::Unicode },
+			{ "unicode-class", "Range of Greek letters", u"[\u03B1-\u03C9]+", BenchmarkSubject::Unicode },
+			{ "captures-datetime", "Date and time with six groups", u"(\\d{4})-(\\d{2})-(\\d{2})T(\\d{2}):(\\d{2}):(\\d{2})", BenchmarkSubject::Ascii },
+			{ "captures-email", "E-mail addresses with four groups", u"([a-z]+)\\.([a-z]+)@([a-z]+)\\.(com|org|net)", BenchmarkSubject::Ascii },
+			{ "backtrack-backreference", "Repeated words (backreference)", u"\\b(\\w+)\\s+\\1\\b", BenchmarkSubject::Ascii },
+			{ "backtrack-nested", "Nested quantifiers that never match", u"(?:[a-z]+[a-z]+)+X", BenchmarkSubject::Ascii },
+		};
+
+		if( !rfc822Pattern.empty( ) )
+		{
+			cases.push_back( { "rfc822", "RFC 822 addresses (Misc/Sample Regex - RFC822.txt)", rfc822Pattern, BenchmarkSubject::Ascii } );
+		}
+
+		return cases;
+	}
+
+
+	std::u16string GenerateSubject( BenchmarkSubject subject, size_t length )
+	{
+		Random random( 0x5EED5EED12345678ULL );
+		std::u16string text;
+
+		text.reserve( length + 256 );
+
+		while( text.length( ) < length )
+		{
+			AppendLine( &text, random, subject == BenchmarkSubject::Unicode );
+		}
+
+		return text;
+	}
+
+
+	bool ReadUtf8File( const char* path, std::u16string* text )
+	{
+		std::ifstream file( path, std::ios::binary );
+		if( !file ) return false;
+
+		std::string bytes( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>( ) );
+
+		if( file.bad( ) ) return false;
+
+		size_t start = bytes.compare( 0, 3, "\xEF\xBB\xBF" ) == 0 ? 3 : 0;
+
+		text->clear( );
+		AppendUtf16( text, bytes.data( ) + start, bytes.size( ) - start );
+
+		return true;
+	}
+}
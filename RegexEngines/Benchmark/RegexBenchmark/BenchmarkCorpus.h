@@ -0,0 +1,63 @@
+#pragma once
+
+// The curated patterns and the generated texts of the benchmark.
+//
+// The texts are generated by a fixed pseudo-random sequence, therefore the runs on different machines
+// and at different times measure the same work. The patterns use the syntax that is common to most
+// of the engines; an engine that rejects a pattern is reported as unsupported for that case.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace RegexBenchmark
+{
+	// xorshift64*; the same sequence on all platforms
+	class Random
+	{
+	public:
+
+		explicit Random( uint64_t seed ) : mState( seed != 0 ? seed : 1 ) {}
+
+		// Returns a number in [0, n).
+		uint32_t Next( uint32_t n )
+		{
+			mState ^= mState >> 12;
+			mState ^= mState << 25;
+			mState ^= mState >> 27;
+
+			return static_cast<uint32_t>( ( mState * 0x2545F4914F6CDD1DULL ) >> 32 ) % n;
+		}
+
+	private:
+
+		uint64_t mState;
+	};
+
+
+	enum class BenchmarkSubject
+	{
+		Ascii, // English-like lines with names, dates, e-mail addresses and repeated words
+		Unicode, // the same lines mixed with Greek, Cyrillic, CJK words and emoji (surrogate pairs)
+	};
+
+
+	struct BenchmarkCase
+	{
+		std::string Id; // (used in the command line and in JSON)
+		std::string Description;
+		std::u16string Pattern;
+		BenchmarkSubject Subject;
+	};
+
+
+	// The cases in the order of measurement. If 'rfc822Pattern' is empty, the case of RFC 822 addresses is omitted.
+	std::vector<BenchmarkCase> GetBenchmarkCases( const std::u16string& rfc822Pattern );
+
+	// Generates at least 'length' UTF-16 units; the text ends with a complete line.
+	std::u16string GenerateSubject( BenchmarkSubject subject, size_t length );
+
+	// Reads a UTF-8 file (with or without BOM); returns false if the file cannot be read.
+	bool ReadUtf8File( const char* path, std::u16string* text );
+}
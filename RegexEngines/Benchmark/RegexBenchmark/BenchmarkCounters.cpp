@@ -0,0 +1,156 @@
+#include "BenchmarkCounters.h"
+
+#ifdef __linux__
+#	include <cerrno>
+#	include <cstring>
+#	include <linux/perf_event.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+
+namespace RegexBenchmark
+{
+#ifdef __linux__
+
+	namespace
+	{
+		int OpenCounter( uint32_t type, uint64_t config )
+		{
+			perf_event_attr attr{};
+
+			attr.size = sizeof( attr );
+			attr.type = type;
+			attr.config = config;
+			attr.disabled = 1;
+			attr.inherit = 1; // (the threads of Boost and std scans)
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			return static_cast<int>( syscall( __NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC ) );
+		}
+	}
+
+
+	HardwareCounters::HardwareCounters( )
+	{
+		for( int& d : mDescriptors ) d = -1;
+	}
+
+
+	HardwareCounters::~HardwareCounters( )
+	{
+		for( int d : mDescriptors )
+		{
+			if( d >= 0 ) close( d );
+		}
+	}
+
+
+	bool HardwareCounters::Open( std::string* error )
+	{
+		uint64_t const l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+
+		mDescriptors[COUNTER_CYCLES] = OpenCounter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+		int const first_errno = errno;
+		mDescriptors[COUNTER_INSTRUCTIONS] = OpenCounter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+		mDescriptors[COUNTER_BRANCH_MISSES] = OpenCounter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES );
+		mDescriptors[COUNTER_L1D_MISSES] = OpenCounter( PERF_TYPE_HW_CACHE, l1d_read_miss );
+		mDescriptors[COUNTER_LLC_MISSES] = OpenCounter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+
+		for( int d : mDescriptors )
+		{
+			if( d >= 0 ) return true;
+		}
+
+		*error = std::string( "perf_event_open: " ) + strerror( first_errno );
+		if( first_errno == EACCES || first_errno == EPERM ) *error += " (see /proc/sys/kernel/perf_event_paranoid)";
+
+		return false;
+	}
+
+
+	void HardwareCounters::Start( )
+	{
+		for( int d : mDescriptors )
+		{
+			if( d < 0 ) continue;
+
+			ioctl( d, PERF_EVENT_IOC_RESET, 0 );
+			ioctl( d, PERF_EVENT_IOC_ENABLE, 0 );
+		}
+	}
+
+
+	CounterValues HardwareCounters::Stop( )
+	{
+		CounterValues values;
+
+		for( int d : mDescriptors )
+		{
+			if( d >= 0 ) ioctl( d, PERF_EVENT_IOC_DISABLE, 0 );
+		}
+
+		for( int i = 0; i < COUNTER_COUNT; ++i )
+		{
+			uint64_t data[3]; // (value, time enabled, time running)
+
+			if( mDescriptors[i] < 0 || read( mDescriptors[i], data, sizeof( data ) ) != static_cast<ssize_t>( sizeof( data ) ) ) continue;
+			if( data[2] == 0 ) continue; // (never scheduled)
+
+			values.Available[i] = true;
+			values.Values[i] = data[2] < data[1] ? static_cast<double>( data[0] ) * data[1] / data[2] : static_cast<double>( data[0] );
+		}
+
+		return values;
+	}
+
+#else
+
+	HardwareCounters::HardwareCounters( )
+	{
+		for( int& d : mDescriptors ) d = -1;
+	}
+
+
+	HardwareCounters::~HardwareCounters( )
+	{
+	}
+
+
+	bool HardwareCounters::Open( std::string* error )
+	{
+		*error = "The hardware counters are only supported on Linux.";
+
+		return false;
+	}
+
+
+	void HardwareCounters::Start( )
+	{
+	}
+
+
+	CounterValues HardwareCounters::Stop( )
+	{
+		return CounterValues{ };
+	}
+
+#endif
+
+
+	const char* HardwareCounters::GetName( int counter )
+	{
+		switch( counter )
+		{
+		case COUNTER_CYCLES: return "cycles";
+		case COUNTER_INSTRUCTIONS: return "instructions";
+		case COUNTER_BRANCH_MISSES: return "branch_misses";
+		case COUNTER_L1D_MISSES: return "l1d_misses";
+		case COUNTER_LLC_MISSES: return "llc_misses";
+		default: return "";
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// The hardware performance counters of the benchmark ('--counters').
+//
+// Linux: 'perf_event_open' for the calling thread and the threads that it creates later ('inherit'; the counts
+//   of a thread are added when it exits), in user space only, therefore no privileges are needed while
+//   "/proc/sys/kernel/perf_event_paranoid" is 2 or less. The values are scaled if the kernel multiplexes
+//   the counters. The counters that cannot be opened (for example, in virtual machines and containers)
+//   are reported as unavailable.
+//   The Linux build is "RegexEngines/CMakeLists.txt".
+// Other systems, including the Windows build of the solution: all the counters are unavailable.
+
+#include <cstdint>
+#include <string>
+
+
+namespace RegexBenchmark
+{
+	enum
+	{
+		COUNTER_CYCLES,
+		COUNTER_INSTRUCTIONS,
+		COUNTER_BRANCH_MISSES,
+		COUNTER_L1D_MISSES, // (reads)
+		COUNTER_LLC_MISSES,
+
+		COUNTER_COUNT
+	};
+
+
+	struct CounterValues
+	{
+		bool Available[COUNTER_COUNT] = { };
+		double Values[COUNTER_COUNT] = { };
+	};
+
+
+	class HardwareCounters
+	{
+	public:
+
+		HardwareCounters( );
+		~HardwareCounters( );
+
+		HardwareCounters( const HardwareCounters& ) = delete;
+		HardwareCounters& operator=( const HardwareCounters& ) = delete;
+
+		// Returns false and the reason if none of the counters is available.
+		bool Open( std::string* error );
+
+		void Start( );
+		CounterValues Stop( );
+
+		// The name that is used in JSON: "cycles", "instructions", "branch_misses", "l1d_misses" or "llc_misses".
+		static const char* GetName( int counter );
+
+	private:
+
+		int mDescriptors[COUNTER_COUNT];
+	};
+}
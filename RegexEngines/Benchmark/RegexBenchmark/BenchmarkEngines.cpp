@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <regex> // (for the flags only)
+#include <string>
+
+#include "../../Boost/BoostRegexInterop/pch-boost.h"
+#include <boost/regex.hpp> // (for the flags only)
+
+#define PCRE2_CODE_UNIT_WIDTH 16
+#define PCRE2_STATIC
+#include "../../Pcre2/Pcre2RegexInterop/PCRE2-min/src/pcre2.h"
+
+#include "../../Pcre2/Pcre2RegexInterop/Pcre2Core.h"
+#include "../../Re2/Re2RegexInterop/Re2Core.h"
+#include "../../Boost/BoostRegexInterop/BoostCore.h"
+#include "../../Std/StdRegexInterop/StdCore.h"
+#include "../../Oniguruma/OnigurumaRegexInterop/OnigurumaCore.h"
+#include "../../SubReg/SubRegRegexInterop/SubRegCore.h"
+
+#include "BenchmarkEngines.h"
+
+
+namespace RegexBenchmark
+{
+	namespace
+	{
+		// PCRE2
+
+		template<int32_t algorithm>
+		void* Pcre2CompileWithStepLimit( const char16_t* pattern, size_t length, uint32_t limit, RegexCoreError* error )
+		{
+			Pcre2CoreOptions options{};
+
+			options.CompileOptions = PCRE2_UTF;
+			options.Algorithm = algorithm;
+			options.MatchLimit = limit; // (the number of internal 'match' calls)
+
+			return Pcre2CoreCompile( pattern, length, &options, error );
+		}
+
+
+		template<int32_t algorithm>
+		void* Pcre2Compile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			return Pcre2CompileWithStepLimit<algorithm>( pattern, length, 0, error );
+		}
+
+
+		int32_t Pcre2Scan( const void* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+			RegexCoreResults* results, RegexCoreError* error )
+		{
+			return Pcre2CoreScan( static_cast<const Pcre2CoreRegex*>( regex ), text, length, cancellation, results, error );
+		}
+
+
+		void Pcre2Free( void* regex )
+		{
+			Pcre2CoreFree( static_cast<Pcre2CoreRegex*>( regex ) );
+		}
+
+
+		// RE2
+
+		void* Re2Compile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			Re2CoreOptions options{};
+
+			options.Flags = RE2_CORE_CASE_SENSITIVE;
+			options.Anchor = RE2_CORE_UNANCHORED;
+
+			return Re2CoreCompile( pattern, length, &options, error );
+		}
+
+
+		int32_t Re2Scan( const void* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+			RegexCoreResults* results, RegexCoreError* error )
+		{
+			return Re2CoreScan( static_cast<const Re2CoreRegex*>( regex ), text, length, cancellation, results, error );
+		}
+
+
+		void Re2Free( void* regex )
+		{
+			Re2CoreFree( static_cast<Re2CoreRegex*>( regex ) );
+		}
+
+
+		// Boost.Regex ('perl' syntax, 'match_default')
+
+		void* BoostCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			BoostCoreOptions options{};
+
+			return BoostCoreCompile( pattern, length, &options, error );
+		}
+
+
+		int32_t BoostScan( const void* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+			RegexCoreResults* results, RegexCoreError* error )
+		{
+			return BoostCoreScan( static_cast<const BoostCoreRegex*>( regex ), text, length, cancellation, results, error );
+		}
+
+
+		void BoostFree( void* regex )
+		{
+			BoostCoreFree( static_cast<BoostCoreRegex*>( regex ) );
+		}
+
+
+		// std::regex
+
+		void* StdCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			StdCoreOptions options;
+
+			StdCoreGetDefaultOptions( &options );
+			options.SyntaxFlags = static_cast<uint32_t>( std::regex_constants::ECMAScript );
+
+			return StdCoreCompile( pattern, length, &options, error );
+		}
+
+
+#ifdef _MSC_VER
+		void* StdCompileWithStepLimit( const char16_t* pattern, size_t length, uint32_t limit, RegexCoreError* error )
+		{
+			StdCoreOptions options;
+
+			StdCoreGetDefaultOptions( &options );
+			options.SyntaxFlags = static_cast<uint32_t>( std::regex_constants::ECMAScript );
+			options.MaxComplexityCount = static_cast<int32_t>( std::min<uint32_t>( limit, INT32_MAX ) ); // ('_REGEX_MAX_COMPLEXITY_COUNT')
+
+			return StdCoreCompile( pattern, length, &options, error );
+		}
+
+		auto const StdCompileWithStepLimitProc = &StdCompileWithStepLimit;
+#else
+		// (other libraries do not count the steps)
+		void* ( * const StdCompileWithStepLimitProc )( const char16_t*, size_t, uint32_t, RegexCoreError* ) = nullptr;
+#endif
+
+
+		int32_t StdScan( const void* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+			RegexCoreResults* results, RegexCoreError* error )
+		{
+			return StdCoreScan( static_cast<const StdCoreRegex*>( regex ), text, length, cancellation, results, error );
+		}
+
+
+		void StdFree( void* regex )
+		{
+			StdCoreFree( static_cast<StdCoreRegex*>( regex ) );
+		}
+
+
+		// Oniguruma (Ruby syntax, UTF-16LE)
+
+		void* OnigurumaCompileWithStepLimit( const char16_t* pattern, size_t length, uint32_t limit, RegexCoreError* error )
+		{
+			OnigurumaCoreOptions options{};
+
+			options.CompileOptions = ONIG_OPTION_NONE;
+			options.SearchOptions = ONIG_OPTION_NONE;
+			options.RetryLimitInSearch = limit; // (the number of retries of all the positions of a search)
+
+			return OnigurumaCoreCompile( pattern, length, &options, error );
+		}
+
+
+		void* OnigurumaCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			void* regex = OnigurumaCompileWithStepLimit( pattern, length, 0, error );
+
+			if( regex == nullptr )
+			{
+				// (for example, "\000-\031" of the RFC 822 pattern; "\o{...}" and "\x{...}" are the code points)
+				char s[ONIG_MAX_ERROR_MESSAGE_LEN];
+				onig_error_code_to_str( (OnigUChar*)s, ONIGERR_TOO_SHORT_MULTI_BYTE_STRING );
+
+				if( strncmp( error->Text, s, strlen( s ) ) == 0 )
+				{
+					std::string const text = std::string( s ) + ": in UTF-16, Oniguruma takes the octal and '\\xHH' escapes for single bytes, "
+						"which are incomplete characters.";
+
+					NativeInfrastructure::SetRegexCoreError( error, text.c_str( ) );
+				}
+			}
+
+			return regex;
+		}
+
+
+		int32_t OnigurumaScan( const void* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+			RegexCoreResults* results, RegexCoreError* error )
+		{
+			return OnigurumaCoreScan( static_cast<const OnigurumaCoreRegex*>( regex ), text, length, cancellation, results, error );
+		}
+
+
+		void OnigurumaFree( void* regex )
+		{
+			OnigurumaCoreFree( static_cast<OnigurumaCoreRegex*>( regex ) );
+		}
+
+
+		// SubReg (all matches)
+
+		// Returns the construct of other engines that SubReg takes differently, without an error, or null.
+		// The cases that use them would find nothing, which is not a measurement.
+		const char* FindSubRegMisreadConstruct( const char16_t* pattern, size_t length )
+		{
+			for( size_t i = 0; i < length; ++i )
+			{
+				switch( pattern[i] )
+				{
+				case u'[': return "character classes ('[' is a literal)";
+				case u'{': return "counted repetitions ('{' is a literal)";
+				case u'\\':
+					if( i + 1 >= length ) break;
+
+					++i;
+
+					if( pattern[i] == u'b' ) return "word boundaries ('\\b' is the backspace)";
+					if( pattern[i] >= u'1' && pattern[i] <= u'9' ) return "backreferences";
+
+					break;
+				}
+			}
+
+			return nullptr;
+		}
+
+
+		void* SubRegCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			if( const char* construct = FindSubRegMisreadConstruct( pattern, length ) )
+			{
+				std::string const text = std::string( "SubReg does not support " ) + construct + ".";
+
+				NativeInfrastructure::SetRegexCoreError( error, text.c_str( ) );
+
+				return nullptr;
+			}
+
+			SubRegCoreOptions options{};
+
+			options.MaximumDepth = 8;
+			options.AllMatches = 1;
+
+			return SubRegCoreCompile( pattern, length, &options, error );
+		}
+
+
+		int32_t SubRegScan( const void* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+			RegexCoreResults* results, RegexCoreError* error )
+		{
+			return SubRegCoreScan( static_cast<const SubRegCoreRegex*>( regex ), text, length, cancellation, results, error );
+		}
+
+
+		void SubRegFree( void* regex )
+		{
+			SubRegCoreFree( static_cast<SubRegCoreRegex*>( regex ) );
+		}
+
+
+		// The variants of the fast paths (no limits; see 'GetFastPathVariants')
+
+		template<uint32_t compileOptions, int32_t algorithm = PCRE2_CORE_STANDARD>
+		void* Pcre2VariantCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			Pcre2CoreOptions options{};
+
+			options.CompileOptions = compileOptions;
+			options.Algorithm = algorithm;
+
+			return Pcre2CoreCompile( pattern, length, &options, error );
+		}
+
+
+		template<uint32_t flags>
+		void* Re2VariantCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			Re2CoreOptions options{};
+
+			options.Flags = flags;
+			options.Anchor = RE2_CORE_UNANCHORED;
+
+			return Re2CoreCompile( pattern, length, &options, error );
+		}
+
+
+		template<uint32_t syntaxFlags, uint32_t matchFlags>
+		void* BoostVariantCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			BoostCoreOptions options{};
+
+			options.SyntaxFlags = syntaxFlags;
+			options.MatchFlags = matchFlags;
+
+			return BoostCoreCompile( pattern, length, &options, error );
+		}
+
+
+		template<uint32_t syntaxFlags>
+		void* StdVariantCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			StdCoreOptions options;
+
+			StdCoreGetDefaultOptions( &options );
+			options.SyntaxFlags = syntaxFlags;
+
+			return StdCoreCompile( pattern, length, &options, error );
+		}
+
+
+		template<OnigOptionType compileOptions, OnigSyntaxType* syntax = nullptr>
+		void* OnigurumaVariantCompile( const char16_t* pattern, size_t length, RegexCoreError* error )
+		{
+			OnigurumaCoreOptions options{};
+
+			options.CompileOptions = compileOptions;
+			options.SearchOptions = ONIG_OPTION_NONE;
+			options.Syntax = syntax;
+
+			return OnigurumaCoreCompile( pattern, length, &options, error );
+		}
+
+
+		namespace src = std::regex_constants;
+		namespace brc = boost::regex_constants;
+
+		uint32_t const StdEcmaScript = static_cast<uint32_t>( src::ECMAScript );
+		uint32_t const StdEcmaScriptIcase = static_cast<uint32_t>( src::ECMAScript | src::icase );
+		uint32_t const StdEcmaScriptNosubs = static_cast<uint32_t>( src::ECMAScript | src::nosubs );
+		uint32_t const StdExtended = static_cast<uint32_t>( src::extended );
+	}
+
+
+	const std::vector<BenchmarkEngine>& GetBenchmarkEngines( )
+	{
+		static const std::vector<BenchmarkEngine> engines
+		{
+			{ "pcre2", "PCRE2, interpreter (pcre2_match)", &Pcre2Compile<PCRE2_CORE_STANDARD>, &Pcre2Scan, &Pcre2Free,
+				&Pcre2CompileWithStepLimit<PCRE2_CORE_STANDARD>, false, true },
+			{ "pcre2-jit", "PCRE2, JIT (pcre2_jit_compile)", &Pcre2Compile<PCRE2_CORE_JIT>, &Pcre2Scan, &Pcre2Free,
+				&Pcre2CompileWithStepLimit<PCRE2_CORE_JIT>, false, true },
+			{ "pcre2-dfa", "PCRE2, DFA (pcre2_dfa_match)", &Pcre2Compile<PCRE2_CORE_DFA>, &Pcre2Scan, &Pcre2Free,
+				&Pcre2CompileWithStepLimit<PCRE2_CORE_DFA>, false, false },
+			{ "re2", "RE2", &Re2Compile, &Re2Scan, &Re2Free,
+				nullptr, false, false },
+			{ "boost", "Boost.Regex", &BoostCompile, &BoostScan, &BoostFree,
+				nullptr, false, true },
+			{ "std", "std::wregex (ECMAScript)", &StdCompile, &StdScan, &StdFree,
+				StdCompileWithStepLimitProc, false, true },
+			{ "oniguruma", "Oniguruma", &OnigurumaCompile, &OnigurumaScan, &OnigurumaFree,
+				&OnigurumaCompileWithStepLimit, false, true },
+			{ "subreg", "SubReg", &SubRegCompile, &SubRegScan, &SubRegFree,
+				nullptr, true, true },
+		};
+
+		return engines;
+	}
+
+
+	const std::vector<BenchmarkEngine>& GetFastPathVariants( )
+	{
+		static const std::vector<BenchmarkEngine> variants
+		{
+			{ "pcre2/utf", "PCRE2, UTF", &Pcre2VariantCompile<PCRE2_UTF>, &Pcre2Scan, &Pcre2Free,
+				nullptr, false, true },
+			{ "pcre2/utf-caseless", "PCRE2, UTF, caseless", &Pcre2VariantCompile<PCRE2_UTF | PCRE2_CASELESS>, &Pcre2Scan, &Pcre2Free,
+				nullptr, false, true },
+			{ "pcre2/non-utf", "PCRE2, without UTF", &Pcre2VariantCompile<0>, &Pcre2Scan, &Pcre2Free,
+				nullptr, false, true },
+			{ "pcre2/non-utf-caseless", "PCRE2, without UTF, caseless", &Pcre2VariantCompile<PCRE2_CASELESS>, &Pcre2Scan, &Pcre2Free,
+				nullptr, false, true },
+			{ "pcre2/literal-utf-caseless", "PCRE2, PCRE2_LITERAL, UTF, caseless", &Pcre2VariantCompile<PCRE2_LITERAL | PCRE2_UTF | PCRE2_CASELESS>,
+				&Pcre2Scan, &Pcre2Free, nullptr, false, true },
+			{ "pcre2/literal-non-utf", "PCRE2, PCRE2_LITERAL, without UTF", &Pcre2VariantCompile<PCRE2_LITERAL>, &Pcre2Scan, &Pcre2Free,
+				nullptr, false, true },
+			{ "pcre2-dfa/utf-caseless", "PCRE2, DFA, UTF, caseless", &Pcre2VariantCompile<PCRE2_UTF | PCRE2_CASELESS, PCRE2_CORE_DFA>,
+				&Pcre2Scan, &Pcre2Free, nullptr, false, false },
+			{ "re2/case-sensitive", "RE2", &Re2VariantCompile<RE2_CORE_CASE_SENSITIVE>, &Re2Scan, &Re2Free,
+				nullptr, false, false },
+			{ "re2/caseless", "RE2, case-insensitive", &Re2VariantCompile<0>, &Re2Scan, &Re2Free,
+				nullptr, false, false },
+			{ "re2/literal", "RE2, literal", &Re2VariantCompile<RE2_CORE_LITERAL | RE2_CORE_CASE_SENSITIVE>, &Re2Scan, &Re2Free,
+				nullptr, false, false },
+			{ "re2/literal-caseless", "RE2, literal, case-insensitive", &Re2VariantCompile<RE2_CORE_LITERAL>, &Re2Scan, &Re2Free,
+				nullptr, false, false },
+			{ "re2/posix", "RE2, POSIX syntax", &Re2VariantCompile<RE2_CORE_POSIX_SYNTAX | RE2_CORE_CASE_SENSITIVE>, &Re2Scan, &Re2Free,
+				nullptr, false, false },
+			{ "re2/posix-longest-caseless", "RE2, POSIX syntax, longest match, case-insensitive",
+				&Re2VariantCompile<RE2_CORE_POSIX_SYNTAX | RE2_CORE_LONGEST_MATCH>, &Re2Scan, &Re2Free, nullptr, false, false },
+			{ "boost/perl", "Boost.Regex, perl", &BoostVariantCompile<brc::perl, brc::match_default>, &BoostScan, &BoostFree,
+				nullptr, false, true },
+			{ "boost/icase", "Boost.Regex, perl, icase", &BoostVariantCompile<brc::perl | brc::icase, brc::match_default>, &BoostScan, &BoostFree,
+				nullptr, false, true },
+			{ "boost/literal", "Boost.Regex, literal", &BoostVariantCompile<brc::literal, brc::match_default>, &BoostScan, &BoostFree,
+				nullptr, false, true },
+			{ "boost/posix", "Boost.Regex, perl, match_posix", &BoostVariantCompile<brc::perl, brc::match_posix>, &BoostScan, &BoostFree,
+				nullptr, false, true },
+			{ "boost/nosubs", "Boost.Regex, perl, nosubs", &BoostVariantCompile<brc::perl | brc::nosubs, brc::match_default>, &BoostScan, &BoostFree,
+				nullptr, false, true },
+			{ "std/ecmascript", "std::wregex, ECMAScript", &StdVariantCompile<StdEcmaScript>, &StdScan, &StdFree,
+				nullptr, false, true },
+			{ "std/ecmascript-icase", "std::wregex, ECMAScript, icase", &StdVariantCompile<StdEcmaScriptIcase>, &StdScan, &StdFree,
+				nullptr, false, true },
+			{ "std/ecmascript-nosubs", "std::wregex, ECMAScript, nosubs", &StdVariantCompile<StdEcmaScriptNosubs>, &StdScan, &StdFree,
+				nullptr, false, true },
+			{ "std/extended", "std::wregex, extended", &StdVariantCompile<StdExtended>, &StdScan, &StdFree,
+				nullptr, false, true },
+			{ "oniguruma/default", "Oniguruma", &OnigurumaVariantCompile<ONIG_OPTION_NONE>, &OnigurumaScan, &OnigurumaFree,
+				nullptr, false, true },
+			{ "oniguruma/ignorecase", "Oniguruma, ONIG_OPTION_IGNORECASE", &OnigurumaVariantCompile<ONIG_OPTION_IGNORECASE>, &OnigurumaScan, &OnigurumaFree,
+				nullptr, false, true },
+			{ "oniguruma/perl", "Oniguruma, ONIG_SYNTAX_PERL", &OnigurumaVariantCompile<ONIG_OPTION_NONE, &OnigSyntaxPerl>, &OnigurumaScan, &OnigurumaFree,
+				nullptr, false, true },
+			{ "oniguruma/find-longest", "Oniguruma, ONIG_OPTION_FIND_LONGEST", &OnigurumaVariantCompile<ONIG_OPTION_FIND_LONGEST>, &OnigurumaScan,
+				&OnigurumaFree, nullptr, false, true },
+		};
+
+		return variants;
+	}
+}
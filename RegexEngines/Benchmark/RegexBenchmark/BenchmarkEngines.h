@@ -0,0 +1,41 @@
+#pragma once
+
+// The engines that are measured by the benchmark. Each one is a portable core (see "RegexCore.h")
+// with fixed options that are close to the defaults of the corresponding engine in RegExpress.
+
+#include <vector>
+
+#include "../../NativeInfrastructure/RegexCore.h"
+
+
+namespace RegexBenchmark
+{
+	struct BenchmarkEngine
+	{
+		const char* Id; // (used in the command line and in JSON)
+		const char* Description;
+
+		// The same as '<Engine>CoreCompile', '<Engine>CoreScan' and '<Engine>CoreFree', with the options bound.
+		void* ( *Compile )( const char16_t* pattern, size_t length, RegexCoreError* error );
+		int32_t( *Scan )( const void* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+			RegexCoreResults* results, RegexCoreError* error );
+		void ( *Free )( void* regex );
+
+		// Compiles with a limit of backtracking steps of a single search; when it is exceeded, the scan returns 'REGEX_CORE_LIMIT'.
+		// Null if the engine does not count the steps (the fuzzer measures the time instead; see "BenchmarkFuzzer.h").
+		void* ( *CompileWithStepLimit )( const char16_t* pattern, size_t length, uint32_t limit, RegexCoreError* error );
+
+		bool AsciiOnly; // (the engine rejects non-ASCII patterns and texts)
+		bool Backtracking; // (the engine can take super-linear time; such engines are fuzzed)
+	};
+
+
+	const std::vector<BenchmarkEngine>& GetBenchmarkEngines( );
+
+	// The engines with the options that decide whether the cores take their fast paths (see "LiteralSearch.h"
+	// and "LiteralAlternation.h"): the case-insensitive modes, PCRE2 with and without UTF, the literal and POSIX
+	// modes of RE2, 'match_posix' (the longest alternative) and 'nosubs' (no groups) of the libraries, and the syntaxes
+	// and the longest match of Oniguruma. The ids are "<engine>/<options>". The fuzzer compares their results with
+	// the fast paths enabled and disabled (see "BenchmarkFuzzer.h").
+	const std::vector<BenchmarkEngine>& GetFastPathVariants( );
+}
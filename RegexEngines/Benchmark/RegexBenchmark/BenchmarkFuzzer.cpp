@@ -0,0 +1,1338 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../../NativeInfrastructure/LiteralSearch.h"
+#include "../../NativeInfrastructure/RegexCore.h"
+#include "../../NativeInfrastructure/Utf8Text.h"
+#include "BenchmarkCorpus.h"
+#include "BenchmarkEngines.h"
+#include "BenchmarkFuzzer.h"
+
+
+using namespace NativeInfrastructure;
+
+
+namespace RegexBenchmark
+{
+	namespace
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		uint32_t const StepCeiling = 1u << 24; // (steps of a single search)
+		uint32_t const StepFloor = 1000; // (the smaller costs do not show the growth reliably)
+		double const TimeCeiling = 0.25; // (seconds of a single scan)
+		double const TimeBudget = 0.02; // (the subjects grow while a scan takes less time)
+		double const TimeFloor = 0.002;
+		int const MaxPumps = 256;
+		int const MinimizationBudget = 200; // (the number of growth measurements for a finding)
+		int const DifferentialCases = 16; // (of the fast paths, in each iteration; they take much less time than the growth)
+
+
+		// A node of a generated pattern.
+		struct Node
+		{
+			enum class Kind { Atom, Group, Concatenation, Alternation, Quantifier, Backreference };
+
+			Kind Type = Kind::Atom;
+			std::u16string Text; // (the atom, the quantifier or the backreference)
+			std::vector<Node> Children; // (a single one for 'Group' and 'Quantifier')
+		};
+
+
+		void Render( const Node& node, std::u16string* pattern )
+		{
+			switch( node.Type )
+			{
+			case Node::Kind::Atom:
+			case Node::Kind::Backreference:
+				pattern->append( node.Text );
+				break;
+			case Node::Kind::Group:
+				pattern->push_back( u'(' );
+				Render( node.Children[0], pattern );
+				pattern->push_back( u')' );
+				break;
+			case Node::Kind::Concatenation:
+				for( const Node& child : node.Children )
+				{
+					bool const group = child.Type == Node::Kind::Alternation;
+
+					if( group ) pattern->push_back( u'(' );
+					Render( child, pattern );
+					if( group ) pattern->push_back( u')' );
+				}
+				break;
+			case Node::Kind::Alternation:
+				for( size_t i = 0; i < node.Children.size( ); ++i )
+				{
+					if( i > 0 ) pattern->push_back( u'|' );
+					Render( node.Children[i], pattern );
+				}
+				break;
+			case Node::Kind::Quantifier:
+			{
+				const Node& child = node.Children[0];
+				bool const group = child.Type != Node::Kind::Atom && child.Type != Node::Kind::Group && child.Type != Node::Kind::Backreference;
+
+				if( group ) pattern->push_back( u'(' );
+				Render( child, pattern );
+				if( group ) pattern->push_back( u')' );
+
+				pattern->append( node.Text );
+				break;
+			}
+			}
+		}
+
+
+		std::u16string Render( const Node& node )
+		{
+			std::u16string pattern;
+
+			Render( node, &pattern );
+
+			return pattern;
+		}
+
+
+		// The atoms and quantifiers that are supported by most of the engines; the subjects consist of 'a' and 'b'.
+		const char16_t* const Atoms[] = { u"a", u"a", u"b", u"[ab]", u".", u"\\w", u"[^b]" };
+		const char16_t* const Quantifiers[] = { u"*", u"*", u"+", u"+", u"?", u"{1,3}" };
+		const char16_t* const Tails[] = { u"", u"", u"$", u"b", u"c" };
+		const char16_t* const Suffixes[] = { u"!", u"!", u"b", u"a!", u"", u"\n" };
+
+
+		template<size_t N>
+		const char16_t* Pick( Random& random, const char16_t* const ( &items )[N] )
+		{
+			return items[random.Next( N )];
+		}
+
+
+		Node MakeNode( Node::Kind type, std::u16string text, std::vector<Node> children = { } )
+		{
+			Node node;
+
+			node.Type = type;
+			node.Text = std::move( text );
+			node.Children = std::move( children );
+
+			return node;
+		}
+
+
+		Node Generate( Random& random, int depth )
+		{
+			uint32_t const r = depth <= 0 ? 0 : random.Next( 100 );
+
+			if( r < 25 ) return MakeNode( Node::Kind::Atom, Pick( random, Atoms ) );
+
+			if( r < 65 )
+			{
+				std::vector<Node> children;
+				for( uint32_t n = 2 + random.Next( 2 ); n > 0; --n ) children.push_back( Generate( random, depth - 1 ) );
+
+				if( r < 50 ) return MakeNode( Node::Kind::Concatenation, u"", std::move( children ) );
+
+				return MakeNode( Node::Kind::Group, u"", { MakeNode( Node::Kind::Alternation, u"", std::move( children ) ) } );
+			}
+
+			if( r < 90 ) return MakeNode( Node::Kind::Quantifier, Pick( random, Quantifiers ), { Generate( random, depth - 1 ) } );
+
+			if( r < 95 ) return MakeNode( Node::Kind::Group, u"", { Generate( random, depth - 1 ) } );
+
+			return MakeNode( Node::Kind::Backreference, u"\\1" );
+		}
+
+
+		void FindQuantifiers( const Node& node, std::vector<const Node*>* quantifiers )
+		{
+			if( node.Type == Node::Kind::Quantifier ) quantifiers->push_back( &node );
+
+			for( const Node& child : node.Children ) FindQuantifiers( child, quantifiers );
+		}
+
+
+		// Appends a string that is likely matched by the node.
+		void Sample( Random& random, const Node& node, std::u16string* s )
+		{
+			switch( node.Type )
+			{
+			case Node::Kind::Atom:
+				if( node.Text.length( ) == 1 && node.Text[0] >= u'a' && node.Text[0] <= u'z' ) s->append( node.Text );
+				else if( node.Text == u"[^b]" ) s->push_back( u'a' );
+				else s->push_back( random.Next( 2 ) ? u'a' : u'b' );
+				break;
+			case Node::Kind::Group:
+			case Node::Kind::Concatenation:
+				for( const Node& child : node.Children ) Sample( random, child, s );
+				break;
+			case Node::Kind::Alternation:
+				Sample( random, node.Children[random.Next( static_cast<uint32_t>( node.Children.size( ) ) )], s );
+				break;
+			case Node::Kind::Quantifier:
+				for( uint32_t n = 1 + random.Next( 2 ); n > 0; --n ) Sample( random, node.Children[0], s );
+				break;
+			case Node::Kind::Backreference:
+				break;
+			}
+		}
+
+
+		// Adds the variants of the node where one part is removed or replaced by its child.
+		void AddReductions( const Node& node, std::vector<Node>* variants )
+		{
+			for( const Node& child : node.Children ) variants->push_back( child );
+
+			if( ( node.Type == Node::Kind::Concatenation || node.Type == Node::Kind::Alternation ) && node.Children.size( ) > 1 )
+			{
+				for( size_t i = 0; i < node.Children.size( ); ++i )
+				{
+					Node variant = node;
+
+					variant.Children.erase( variant.Children.begin( ) + i );
+					variants->push_back( std::move( variant ) );
+				}
+			}
+
+			for( size_t i = 0; i < node.Children.size( ); ++i )
+			{
+				std::vector<Node> child_variants;
+
+				AddReductions( node.Children[i], &child_variants );
+
+				for( Node& child_variant : child_variants )
+				{
+					Node variant = node;
+
+					variant.Children[i] = std::move( child_variant );
+					variants->push_back( std::move( variant ) );
+				}
+			}
+		}
+
+
+		struct FuzzCase
+		{
+			std::u16string Pattern;
+			std::u16string Prefix;
+			std::u16string Pump;
+			std::u16string Suffix;
+
+			bool HasTree = false; // (the pattern is generated; otherwise only the subject is minimized)
+			Node Tree;
+
+			size_t Size( ) const
+			{
+				return Pattern.length( ) + Prefix.length( ) + Pump.length( ) + Suffix.length( );
+			}
+		};
+
+
+		FuzzCase GenerateCase( Random& random )
+		{
+			FuzzCase c;
+			std::vector<const Node*> quantifiers;
+
+			do
+			{
+				quantifiers.clear( );
+
+				std::vector<Node> parts{ Generate( random, 3 ) };
+				const char16_t* tail = Pick( random, Tails );
+
+				if( *tail != u'\0' ) parts.push_back( MakeNode( Node::Kind::Atom, tail ) );
+
+				c.Tree = MakeNode( Node::Kind::Concatenation, u"", std::move( parts ) );
+
+				FindQuantifiers( c.Tree, &quantifiers );
+
+			} while( quantifiers.empty( ) );
+
+			c.HasTree = true;
+			c.Pattern = Render( c.Tree );
+
+			// the pump is repeated by a quantifier
+
+			Sample( random, quantifiers[random.Next( static_cast<uint32_t>( quantifiers.size( ) ) )]->Children[0], &c.Pump );
+			if( c.Pump.empty( ) ) c.Pump = u"a";
+
+			if( random.Next( 3 ) == 0 ) c.Prefix.push_back( random.Next( 2 ) ? u'a' : u'b' );
+			c.Suffix = Pick( random, Suffixes );
+
+			return c;
+		}
+
+
+		// The subject is made of the characters that occur in the pattern.
+		FuzzCase GenerateCase( Random& random, const std::u16string& pattern )
+		{
+			std::u16string alphabet = u"a0 ";
+
+			for( char16_t ch : pattern )
+			{
+				bool const literal = ( ch >= u'a' && ch <= u'z' ) || ( ch >= u'A' && ch <= u'Z' ) || ( ch >= u'0' && ch <= u'9' ) ||
+					std::char_traits<char16_t>::find( u" @.-_:/,=", 9, ch ) != nullptr;
+
+				if( literal && alphabet.find( ch ) == std::u16string::npos ) alphabet.push_back( ch );
+			}
+
+			auto pick = [&]( ) { return alphabet[random.Next( static_cast<uint32_t>( alphabet.length( ) ) )]; };
+
+			FuzzCase c;
+
+			c.Pattern = pattern;
+
+			for( uint32_t n = 1 + random.Next( 3 ); n > 0; --n ) c.Pump.push_back( pick( ) );
+			if( random.Next( 2 ) == 0 ) c.Prefix.push_back( pick( ) );
+			c.Suffix = Pick( random, Suffixes );
+
+			return c;
+		}
+
+
+		std::u16string MakeSubject( const FuzzCase& c, int pumps )
+		{
+			std::u16string subject = c.Prefix;
+
+			for( int i = 0; i < pumps; ++i ) subject += c.Pump;
+			subject += c.Suffix;
+
+			return subject;
+		}
+
+
+		// Measurement
+
+		enum class CostStatus
+		{
+			Failed, // (the pattern is not supported, or the engine failed)
+			Measured,
+			Exceeded, // (the ceiling of steps or time)
+		};
+
+
+		struct Cost
+		{
+			CostStatus Status = CostStatus::Failed;
+			double Value = 0; // (steps or seconds)
+		};
+
+
+		struct Deadline
+		{
+			Clock::time_point End;
+
+			static int32_t IsCancelled( void* context )
+			{
+				return Clock::now( ) > static_cast<Deadline*>( context )->End;
+			}
+		};
+
+
+		int32_t Scan( const BenchmarkEngine& engine, const void* regex, const std::u16string& text, double timeout )
+		{
+			Deadline deadline{ Clock::now( ) + std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( timeout ) ) };
+			RegexCoreCancellation cancellation{ &Deadline::IsCancelled, &deadline };
+			RegexCoreResults results{};
+			RegexCoreError error{};
+
+			int32_t rc = engine.Scan( regex, text.data( ), text.length( ), &cancellation, &results, &error );
+
+			RegexCoreFreeResults( &results );
+
+			return rc;
+		}
+
+
+		int32_t ScanWithStepLimit( const BenchmarkEngine& engine, const std::u16string& pattern, const std::u16string& text, uint32_t limit )
+		{
+			RegexCoreError error{};
+
+			void* regex = engine.CompileWithStepLimit( pattern.data( ), pattern.length( ), limit, &error );
+			if( regex == nullptr ) return REGEX_CORE_ERROR;
+
+			int32_t rc = Scan( engine, regex, text, 40 * TimeCeiling ); // (the steps are limited)
+
+			engine.Free( regex );
+
+			return rc;
+		}
+
+
+		// The smallest limit of steps that lets the scan finish, within about 3%.
+		Cost MeasureSteps( const BenchmarkEngine& engine, const std::u16string& pattern, const std::u16string& text )
+		{
+			Cost cost;
+			uint32_t low = 0; // (too small)
+			uint32_t high = 64;
+
+			for( ; ; )
+			{
+				int32_t rc = ScanWithStepLimit( engine, pattern, text, high );
+
+				if( rc == REGEX_CORE_OK ) break;
+				if( rc != REGEX_CORE_LIMIT ) return cost;
+
+				if( high >= StepCeiling )
+				{
+					cost.Status = CostStatus::Exceeded;
+
+					return cost;
+				}
+
+				low = high;
+				high = std::min( high * 2, StepCeiling );
+			}
+
+			while( high - low > std::max( 1u, high / 32 ) )
+			{
+				uint32_t const middle = low + ( high - low ) / 2;
+				int32_t rc = ScanWithStepLimit( engine, pattern, text, middle );
+
+				if( rc == REGEX_CORE_OK ) high = middle;
+				else if( rc == REGEX_CORE_LIMIT ) low = middle;
+				else return cost;
+			}
+
+			cost.Status = CostStatus::Measured;
+			cost.Value = high;
+
+			return cost;
+		}
+
+
+		// The best time of three scans.
+		Cost MeasureTime( const BenchmarkEngine& engine, const std::u16string& pattern, const std::u16string& text )
+		{
+			Cost cost;
+			RegexCoreError error{};
+
+			void* regex = engine.Compile( pattern.data( ), pattern.length( ), &error );
+			if( regex == nullptr ) return cost;
+
+			for( int i = 0; i < 3; ++i )
+			{
+				auto start = Clock::now( );
+				int32_t rc = Scan( engine, regex, text, TimeCeiling );
+				double const t = std::chrono::duration<double>( Clock::now( ) - start ).count( );
+
+				if( rc == REGEX_CORE_CANCELLED || rc == REGEX_CORE_LIMIT )
+				{
+					cost.Status = CostStatus::Exceeded;
+
+					break;
+				}
+
+				if( rc != REGEX_CORE_OK )
+				{
+					cost.Status = CostStatus::Failed;
+
+					break;
+				}
+
+				if( cost.Status != CostStatus::Measured || t < cost.Value ) cost.Value = t;
+				cost.Status = CostStatus::Measured;
+
+				if( t > TimeBudget ) break;
+			}
+
+			engine.Free( regex );
+
+			return cost;
+		}
+
+
+		struct Growth
+		{
+			bool Signal = false; // (the costs are large enough to show the growth)
+			double Exponent = 0; // (of cost ~ length ^ e)
+			bool Exceeded = false; // (the exponent is the lower bound: the larger subject exceeded the ceiling)
+		};
+
+
+		// Measures the cost for growing numbers of pumps; the numbers double if the steps are counted.
+		// Otherwise they grow slowly, because the scans of exponential cases cannot always be cancelled in time.
+		Growth MeasureGrowth( const BenchmarkEngine& engine, const FuzzCase& c )
+		{
+			bool const steps = engine.CompileWithStepLimit != nullptr;
+			std::vector<std::pair<int, Cost>> points; // (the number of pumps and the cost)
+
+			for( int k = 4; k <= MaxPumps; k = steps ? k * 2 : k + std::max( 1, k / 8 ) )
+			{
+				std::u16string const subject = MakeSubject( c, k );
+				Cost const cost = steps ? MeasureSteps( engine, c.Pattern, subject ) : MeasureTime( engine, c.Pattern, subject );
+
+				if( cost.Status == CostStatus::Failed ) return Growth{ };
+
+				points.emplace_back( k, cost );
+
+				if( cost.Status == CostStatus::Exceeded ) break;
+				if( !steps && cost.Value > TimeBudget ) break;
+			}
+
+			// the last point and the largest one that has at most half of the pumps
+
+			const std::pair<int, Cost>& last = points.back( );
+			const std::pair<int, Cost>* half = nullptr;
+
+			for( const auto& p : points )
+			{
+				if( p.first * 2 <= last.first ) half = &p;
+			}
+
+			if( half == nullptr || half->second.Status != CostStatus::Measured ) return Growth{ };
+
+			double const floor = steps ? StepFloor : TimeFloor;
+			double const ceiling = steps ? StepCeiling : TimeCeiling;
+			double const ratio = static_cast<double>( last.first ) / half->first;
+			Growth growth;
+
+			if( last.second.Status == CostStatus::Exceeded )
+			{
+				growth.Signal = true;
+				growth.Exceeded = true;
+				growth.Exponent = std::log( ceiling / std::max( half->second.Value, floor / 1000 ) ) / std::log( ratio );
+			}
+			else if( last.second.Value >= floor )
+			{
+				growth.Signal = true;
+				growth.Exponent = std::log( last.second.Value / std::max( half->second.Value, floor / 1000 ) ) / std::log( ratio );
+			}
+
+			return growth;
+		}
+
+
+		bool IsFinding( const Growth& growth, double threshold )
+		{
+			return growth.Signal && growth.Exponent >= threshold;
+		}
+
+
+		// Minimization
+
+		std::vector<FuzzCase> GetReductions( const FuzzCase& c )
+		{
+			std::vector<FuzzCase> reductions;
+
+			if( c.HasTree )
+			{
+				std::vector<Node> variants;
+
+				AddReductions( c.Tree, &variants );
+
+				for( Node& variant : variants )
+				{
+					FuzzCase r = c;
+
+					r.Pattern = Render( variant );
+					r.Tree = std::move( variant );
+
+					if( !r.Pattern.empty( ) ) reductions.push_back( std::move( r ) );
+				}
+			}
+
+			auto add_subject_reductions = [&]( std::u16string FuzzCase::* part, size_t minimum )
+			{
+				for( size_t i = 0; i < ( c.*part ).length( ) && ( c.*part ).length( ) > minimum; ++i )
+				{
+					FuzzCase r = c;
+
+					( r.*part ).erase( i, 1 );
+					reductions.push_back( std::move( r ) );
+				}
+			};
+
+			add_subject_reductions( &FuzzCase::Prefix, 0 );
+			add_subject_reductions( &FuzzCase::Pump, 1 );
+			add_subject_reductions( &FuzzCase::Suffix, 0 );
+
+			// the smallest first, without repetitions
+
+			std::stable_sort( reductions.begin( ), reductions.end( ), []( const FuzzCase& a, const FuzzCase& b ) { return a.Size( ) < b.Size( ); } );
+
+			std::set<std::u16string> seen;
+			std::vector<FuzzCase> unique;
+
+			for( FuzzCase& r : reductions )
+			{
+				if( r.Size( ) >= c.Size( ) ) continue;
+				if( !seen.insert( r.Pattern + u'\0' + r.Prefix + u'\0' + r.Pump + u'\0' + r.Suffix ).second ) continue;
+
+				unique.push_back( std::move( r ) );
+			}
+
+			return unique;
+		}
+
+
+		FuzzCase Minimize( const BenchmarkEngine& engine, FuzzCase c, double threshold, Growth* growth )
+		{
+			int budget = MinimizationBudget;
+			bool reduced = true;
+
+			while( reduced && budget > 0 )
+			{
+				reduced = false;
+
+				for( const FuzzCase& r : GetReductions( c ) )
+				{
+					if( budget-- <= 0 ) break;
+
+					Growth const g = MeasureGrowth( engine, r );
+
+					if( IsFinding( g, threshold ) )
+					{
+						c = r;
+						*growth = g;
+						reduced = true;
+
+						break;
+					}
+				}
+			}
+
+			return c;
+		}
+
+
+		// Corpus
+
+		// The backslashes are not escaped for display; the unpaired surrogates, which UTF-8 cannot keep, are "\uD800".
+		std::string Escape( const std::u16string& s, bool backslashes = true )
+		{
+			std::string escaped;
+
+			for( size_t i = 0; i < s.length( ); ++i )
+			{
+				char16_t const c = s[i];
+				bool const pair = ( c & 0xFC00 ) == 0xD800 && i + 1 < s.length( ) && ( s[i + 1] & 0xFC00 ) == 0xDC00;
+
+				if( ( c & 0xF800 ) == 0xD800 && !pair )
+				{
+					char buffer[8];
+					snprintf( buffer, sizeof( buffer ), "\\u%04X", static_cast<unsigned>( c ) );
+
+					escaped += buffer;
+
+					continue;
+				}
+
+				std::string utf8;
+
+				AppendUtf8( &utf8, s.data( ) + i, pair ? 2 : 1 );
+				if( pair ) ++i;
+
+				for( char ch : utf8 )
+				{
+					switch( ch )
+					{
+					case '\\': escaped += backslashes ? "\\\\" : "\\"; break;
+					case '\n': escaped += "\\n"; break;
+					case '\r': escaped += "\\r"; break;
+					case '\t': escaped += "\\t"; break;
+					default: escaped.push_back( ch );
+					}
+				}
+			}
+
+			return escaped;
+		}
+
+
+		std::u16string Unescape( const std::string& s )
+		{
+			std::string utf8;
+			std::u16string text;
+
+			for( size_t i = 0; i < s.length( ); ++i )
+			{
+				if( s[i] != '\\' || i + 1 == s.length( ) )
+				{
+					utf8.push_back( s[i] );
+
+					continue;
+				}
+
+				switch( s[++i] )
+				{
+				case 'n': utf8.push_back( '\n' ); break;
+				case 'r': utf8.push_back( '\r' ); break;
+				case 't': utf8.push_back( '\t' ); break;
+				case 'u':
+					if( i + 4 < s.length( ) && std::all_of( s.begin( ) + i + 1, s.begin( ) + i + 5, []( char h ) { return isxdigit( static_cast<unsigned char>( h ) ) != 0; } ) )
+					{
+						AppendUtf16( &text, utf8.data( ), utf8.length( ) );
+						utf8.clear( );
+
+						text.push_back( static_cast<char16_t>( strtoul( s.substr( i + 1, 4 ).c_str( ), nullptr, 16 ) ) );
+						i += 4;
+					}
+					else
+					{
+						utf8.push_back( 'u' );
+					}
+					break;
+				default: utf8.push_back( s[i] );
+				}
+			}
+
+			AppendUtf16( &text, utf8.data( ), utf8.length( ) );
+
+			return text;
+		}
+
+
+		struct CorpusEntry
+		{
+			std::string Engine;
+			FuzzCase Case;
+			std::string Metric;
+			std::string Growth;
+			int Pumps = 0; // (the entries of faults only)
+		};
+
+
+		bool ReadCorpus( const std::string& path, std::vector<CorpusEntry>* entries )
+		{
+			std::ifstream file( path, std::ios::binary );
+			if( !file ) return false;
+
+			CorpusEntry entry;
+			std::string line;
+
+			auto end_block = [&]( )
+			{
+				if( !entry.Engine.empty( ) && !entry.Case.Pattern.empty( ) ) entries->push_back( entry );
+
+				entry = CorpusEntry{ };
+			};
+
+			while( std::getline( file, line ) )
+			{
+				if( !line.empty( ) && line.back( ) == '\r' ) line.pop_back( );
+
+				if( line.empty( ) )
+				{
+					end_block( );
+
+					continue;
+				}
+
+				if( line[0] == '#' ) continue;
+
+				size_t const equals = line.find( '=' );
+				if( equals == std::string::npos ) continue;
+
+				std::string const key = line.substr( 0, equals );
+				std::string const value = line.substr( equals + 1 );
+
+				if( key == "engine" ) entry.Engine = value;
+				else if( key == "pattern" ) entry.Case.Pattern = Unescape( value );
+				else if( key == "prefix" ) entry.Case.Prefix = Unescape( value );
+				else if( key == "pump" ) entry.Case.Pump = Unescape( value );
+				else if( key == "suffix" ) entry.Case.Suffix = Unescape( value );
+				else if( key == "metric" ) entry.Metric = value;
+				else if( key == "growth" ) entry.Growth = value;
+				else if( key == "pumps" ) entry.Pumps = atoi( value.c_str( ) );
+			}
+
+			end_block( );
+
+			return true;
+		}
+
+
+		std::string FormatGrowth( const Growth& growth )
+		{
+			char buffer[32];
+			snprintf( buffer, sizeof( buffer ), "%s%.2f", growth.Exceeded ? ">" : "", growth.Exponent );
+
+			return buffer;
+		}
+
+
+		bool AppendToCorpus( const std::string& path, const CorpusEntry& entry )
+		{
+			bool const exists = std::ifstream( path, std::ios::binary ).good( );
+			std::ofstream file( path, std::ios::binary | std::ios::app );
+
+			if( !exists ) file << "# The findings of 'RegexBenchmark --fuzz' (see \"BenchmarkFuzzer.h\").\n";
+
+			file << "\nengine=" << entry.Engine
+				<< "\npattern=" << Escape( entry.Case.Pattern )
+				<< "\nprefix=" << Escape( entry.Case.Prefix )
+				<< "\npump=" << Escape( entry.Case.Pump )
+				<< "\nsuffix=" << Escape( entry.Case.Suffix )
+				<< "\nmetric=" << entry.Metric;
+
+			if( !entry.Growth.empty( ) ) file << "\ngrowth=" << entry.Growth;
+
+			file << "\n";
+
+			return static_cast<bool>( file );
+		}
+
+
+		bool IsAscii( const std::u16string& s )
+		{
+			return std::all_of( s.begin( ), s.end( ), []( char16_t c ) { return c < 0x80; } );
+		}
+
+
+		bool IsSupported( const BenchmarkEngine& engine, const FuzzCase& c )
+		{
+			return !engine.AsciiOnly || ( IsAscii( c.Pattern ) && IsAscii( c.Prefix ) && IsAscii( c.Pump ) && IsAscii( c.Suffix ) );
+		}
+
+
+		const char* GetMetric( const BenchmarkEngine& engine )
+		{
+			return engine.CompileWithStepLimit != nullptr ? "steps" : "time";
+		}
+
+
+		void PrintCase( const char* engine, const char* growth, const FuzzCase& c )
+		{
+			printf( "%-10s %6s  /%s/  on  \"%s\" + \"%s\" * k + \"%s\"\n", engine, growth,
+				Escape( c.Pattern, false ).c_str( ), Escape( c.Prefix, false ).c_str( ), Escape( c.Pump, false ).c_str( ), Escape( c.Suffix, false ).c_str( ) );
+		}
+
+
+		std::vector<const BenchmarkEngine*> SelectEngines( const FuzzSettings& settings )
+		{
+			std::vector<const BenchmarkEngine*> selected;
+
+			for( const BenchmarkEngine& e : GetBenchmarkEngines( ) )
+			{
+				bool const listed = std::find( settings.Engines.begin( ), settings.Engines.end( ), e.Id ) != settings.Engines.end( );
+
+				if( settings.Engines.empty( ) ? e.Backtracking : listed ) selected.push_back( &e );
+			}
+
+			return selected;
+		}
+
+
+		// Differential check of the fast paths
+
+		// The units of the literals: the letters that are equal to non-ASCII letters in the Unicode case folding
+		// (see 'IsAsciiCaseFoldable'), the unpaired surrogates and a pair, U+FFFD, which replaces the unpaired
+		// surrogates in RE2, and the metacharacters, which are literal in the literal modes.
+		const char16_t* const LiteralUnits[] = { u"a", u"b", u"k", u"K", u"\u212A", u"s", u"S", u"\u017F",
+			u"\xD800", u"\xDC00", u"\U0001F600", u"\uFFFD", u".", u"+" };
+		const char16_t* const SubjectUnits[] = { u"a", u"A", u"k", u"K", u"\u212A", u"s", u"S", u"\u017F",
+			u"\xD800", u"\xDC00", u"\U0001F600", u"\uFFFD", u".", u" " };
+
+		// (the letters of a class are equal in the Unicode case folding)
+		const char16_t* const CaseClasses[] = { u"aA", u"bB", u"kK\u212A", u"sS\u017F" };
+
+
+		std::u16string ChangeCase( Random& random, std::u16string s )
+		{
+			for( char16_t& c : s )
+			{
+				for( const char16_t* letters : CaseClasses )
+				{
+					size_t const count = std::char_traits<char16_t>::length( letters );
+
+					if( std::char_traits<char16_t>::find( letters, count, c ) != nullptr )
+					{
+						c = letters[random.Next( static_cast<uint32_t>( count ) )];
+
+						break;
+					}
+				}
+			}
+
+			return s;
+		}
+
+
+		// The pattern is a literal; the subject, which is the prefix, has occurrences of it in different cases.
+		FuzzCase GenerateLiteralCase( Random& random )
+		{
+			FuzzCase c;
+
+			int const units = 1 + random.Next( 4 );
+			for( int i = 0; i < units; ++i ) c.Pattern += Pick( random, LiteralUnits );
+
+			int const parts = random.Next( 8 );
+			for( int i = 0; i < parts; ++i ) c.Prefix += random.Next( 3 ) == 0 ? ChangeCase( random, c.Pattern ) : std::u16string( Pick( random, SubjectUnits ) );
+
+			return c;
+		}
+
+
+		// The units of the words of alternations: the words that are prefixes of others, which make the priority
+		// of alternatives matter, word and non-word characters next to the boundaries (U+00E9 and U+0416 are
+		// letters for some engines only) and the escaped metacharacters.
+		const char16_t* const WordUnits[] = { u"a", u"a", u"b", u"_", u"\u00E9", u"\u0416", u"-", u"\\.", u"\\|", u"\\(", u"\U0001F600" };
+		const char16_t* const WordSeparators[] = { u"", u"", u" ", u"a", u"_", u".", u"|", u"\u00E9", u"-" };
+
+
+		// The pattern is "[\b](w1|w2|...)[\b]", where the group is "(...)", "(?:...)" or none (see 'ParseLiteralAlternation'),
+		// sometimes with an empty alternative; the subject is made of the words and the separators.
+		FuzzCase GenerateAlternationCase( Random& random )
+		{
+			FuzzCase c;
+			std::vector<std::u16string> words( 1 + random.Next( 4 ) );
+
+			for( std::u16string& word : words )
+			{
+				int const units = random.Next( 10 ) == 0 ? 0 : 1 + random.Next( 3 );
+				for( int i = 0; i < units; ++i ) word += Pick( random, WordUnits );
+			}
+
+			uint32_t const group = random.Next( 3 );
+
+			if( random.Next( 2 ) == 0 ) c.Pattern += u"\\b";
+			if( group == 1 ) c.Pattern += u"(";
+			if( group == 2 ) c.Pattern += u"(?:";
+
+			for( size_t i = 0; i < words.size( ); ++i )
+			{
+				if( i > 0 ) c.Pattern += u'|';
+				c.Pattern += words[i];
+			}
+
+			if( group != 0 ) c.Pattern += u")";
+			if( random.Next( 2 ) == 0 ) c.Pattern += u"\\b";
+
+			// (the words of the subject without the escapes)
+			for( std::u16string& word : words ) word.erase( std::remove( word.begin( ), word.end( ), u'\\' ), word.end( ) );
+
+			int const parts = random.Next( 8 );
+			for( int i = 0; i < parts; ++i ) c.Prefix += random.Next( 2 ) == 0 ? words[random.Next( static_cast<uint32_t>( words.size( ) ) )] : std::u16string( Pick( random, WordSeparators ) );
+
+			return c;
+		}
+
+
+		FuzzCase GenerateDifferentialCase( Random& random )
+		{
+			return random.Next( 2 ) == 0 ? GenerateLiteralCase( random ) : GenerateAlternationCase( random );
+		}
+
+
+		// The results of a compilation and a scan.
+		struct Outcome
+		{
+			bool Compiled = false;
+			int32_t Status = REGEX_CORE_ERROR;
+			std::vector<int32_t> Items;
+			std::u16string Names; // (each one is terminated by zero)
+		};
+
+
+		Outcome Run( const BenchmarkEngine& engine, const FuzzCase& c, bool fastPaths )
+		{
+			Outcome outcome;
+			RegexCoreError error{};
+
+			SetLiteralSearchEnabled( fastPaths );
+			void* regex = engine.Compile( c.Pattern.data( ), c.Pattern.length( ), &error );
+			SetLiteralSearchEnabled( true );
+
+			if( regex == nullptr ) return outcome;
+
+			outcome.Compiled = true;
+
+			std::u16string const subject = MakeSubject( c, 0 );
+			Deadline deadline{ Clock::now( ) + std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( 40 * TimeCeiling ) ) };
+			RegexCoreCancellation cancellation{ &Deadline::IsCancelled, &deadline };
+			RegexCoreResults results{};
+
+			outcome.Status = engine.Scan( regex, subject.data( ), subject.length( ), &cancellation, &results, &error );
+
+			if( outcome.Status == REGEX_CORE_OK )
+			{
+				outcome.Items.assign( results.Items, results.Items + results.ItemCount );
+
+				const char16_t* name = results.Names;
+
+				for( int32_t i = 0; i < results.NameCount; ++i )
+				{
+					size_t const length = std::char_traits<char16_t>::length( name ) + 1;
+
+					outcome.Names.append( name, length );
+					name += length;
+				}
+			}
+
+			RegexCoreFreeResults( &results );
+			engine.Free( regex );
+
+			return outcome;
+		}
+
+
+		// The groups are "index+length" (-1 if the group did not participate), separated by commas; the matches are separated by spaces.
+		std::string FormatOutcome( const Outcome& outcome )
+		{
+			if( !outcome.Compiled ) return "not compiled";
+			if( outcome.Status != REGEX_CORE_OK ) return "status " + std::to_string( outcome.Status );
+
+			std::string s;
+			size_t i = 0;
+
+			while( i < outcome.Items.size( ) )
+			{
+				int32_t const groups = outcome.Items[i++];
+
+				if( !s.empty( ) ) s += ' ';
+
+				for( int32_t g = 0; g < groups && i + 4 <= outcome.Items.size( ); ++g )
+				{
+					if( g > 0 ) s += ',';
+					s += std::to_string( outcome.Items[i] ) + '+' + std::to_string( outcome.Items[i + 1] );
+
+					i += 4 + 2 * static_cast<size_t>( outcome.Items[i + 3] ); // (and the captures)
+				}
+			}
+
+			if( s.empty( ) ) s = "no matches";
+			if( !outcome.Names.empty( ) ) s += ", names " + Escape( outcome.Names, false );
+
+			return s;
+		}
+
+
+		// Returns true if the results with the fast paths enabled and disabled are the same; otherwise describes both.
+		bool CompareFastPaths( const BenchmarkEngine& engine, const FuzzCase& c, std::string* difference )
+		{
+			Outcome const fast = Run( engine, c, true );
+			Outcome const slow = Run( engine, c, false );
+
+			if( fast.Compiled == slow.Compiled && fast.Status == slow.Status && fast.Items == slow.Items && fast.Names == slow.Names ) return true;
+
+			*difference = "fast paths: " + FormatOutcome( fast ) + "; engine: " + FormatOutcome( slow );
+
+			return false;
+		}
+
+
+		// Removes the units of the subject while the results still differ.
+		FuzzCase MinimizeDifference( const BenchmarkEngine& engine, FuzzCase c, std::string* difference )
+		{
+			for( size_t i = c.Prefix.length( ); i-- > 0; )
+			{
+				FuzzCase r = c;
+				std::string d;
+
+				r.Prefix.erase( i, 1 );
+
+				if( !CompareFastPaths( engine, r, &d ) )
+				{
+					c = std::move( r );
+					*difference = std::move( d );
+				}
+			}
+
+			return c;
+		}
+
+
+		void PrintDifferentialCase( const char* engine, const char* status, const FuzzCase& c )
+		{
+			printf( "%-10s %6s  /%s/  on  \"%s\"\n", engine, status, Escape( c.Pattern, false ).c_str( ), Escape( c.Prefix, false ).c_str( ) );
+		}
+
+
+		// The variants of the listed engines (all of them if none is listed; see 'GetFastPathVariants').
+		std::vector<const BenchmarkEngine*> SelectFastPathVariants( const FuzzSettings& settings )
+		{
+			std::vector<const BenchmarkEngine*> selected;
+
+			for( const BenchmarkEngine& v : GetFastPathVariants( ) )
+			{
+				std::string const engine( v.Id, strchr( v.Id, '/' ) );
+
+				if( settings.Engines.empty( ) || std::find( settings.Engines.begin( ), settings.Engines.end( ), engine ) != settings.Engines.end( ) ) selected.push_back( &v );
+			}
+
+			return selected;
+		}
+
+
+		enum class FaultStatus
+		{
+			Contained, // (the scan failed with an error, and the engine works after it)
+			Fixed, // (the scan succeeded)
+			Broken, // (the engine does not work after the failure)
+		};
+
+
+		// Scans the subject of a fault entry, then a subject with a single pump.
+		FaultStatus CheckFault( const BenchmarkEngine& engine, const CorpusEntry& entry, std::string* errorText )
+		{
+			RegexCoreError error{};
+
+			void* regex = engine.Compile( entry.Case.Pattern.data( ), entry.Case.Pattern.length( ), &error );
+
+			if( regex == nullptr )
+			{
+				*errorText = error.Text;
+
+				return FaultStatus::Broken;
+			}
+
+			std::u16string const subject = MakeSubject( entry.Case, entry.Pumps );
+			RegexCoreResults results{};
+
+			int32_t rc = engine.Scan( regex, subject.data( ), subject.length( ), nullptr, &results, &error );
+
+			RegexCoreFreeResults( &results );
+
+			if( rc == REGEX_CORE_OK )
+			{
+				engine.Free( regex );
+
+				return FaultStatus::Fixed;
+			}
+
+			*errorText = error.Text;
+			errorText->erase( std::min( errorText->find( '\r' ), errorText->find( '\n' ) ) ); // (the first line)
+
+			rc = Scan( engine, regex, MakeSubject( entry.Case, 1 ), 40 * TimeCeiling );
+
+			engine.Free( regex );
+
+			return rc == REGEX_CORE_OK ? FaultStatus::Contained : FaultStatus::Broken;
+		}
+
+
+		int Replay( const FuzzSettings& settings, const std::vector<const BenchmarkEngine*>& engines, const std::vector<const BenchmarkEngine*>& variants )
+		{
+			std::vector<CorpusEntry> entries;
+
+			if( !ReadCorpus( settings.ReplayPath, &entries ) )
+			{
+				fprintf( stderr, "Cannot read '%s'.\n", settings.ReplayPath.c_str( ) );
+
+				return 2;
+			}
+
+			int super_linear = 0;
+			int checked = 0;
+			int faults = 0;
+			int failing = 0;
+			int broken = 0;
+			int differential = 0;
+			int differing = 0;
+
+			for( const CorpusEntry& entry : entries )
+			{
+				if( entry.Metric == "differential" )
+				{
+					auto variant = std::find_if( variants.begin( ), variants.end( ), [&]( const BenchmarkEngine* v ) { return entry.Engine == v->Id; } );
+
+					if( variant == variants.end( ) ) continue;
+
+					std::string difference;
+					bool const same = CompareFastPaths( **variant, entry.Case, &difference );
+
+					++differential;
+					if( !same ) ++differing;
+
+					PrintDifferentialCase( entry.Engine.c_str( ), same ? "same" : "DIFFER", entry.Case );
+					if( !same ) printf( "%-10s %6s  (%s)\n", "", "", difference.c_str( ) );
+					fflush( stdout );
+
+					continue;
+				}
+
+				auto engine = std::find_if( engines.begin( ), engines.end( ), [&]( const BenchmarkEngine* e ) { return entry.Engine == e->Id; } );
+
+				if( engine == engines.end( ) || !IsSupported( **engine, entry.Case ) ) continue;
+
+				if( entry.Metric == "fault" )
+				{
+					std::string error_text;
+					FaultStatus const status = CheckFault( **engine, entry, &error_text );
+
+					++faults;
+					if( status != FaultStatus::Fixed ) ++failing;
+					if( status == FaultStatus::Broken ) ++broken;
+
+					PrintCase( entry.Engine.c_str( ), "fault", entry.Case );
+					printf( "%-10s %6s  (k = %d%s%s)\n", "", status == FaultStatus::Contained ? "still" : status == FaultStatus::Fixed ? "fixed" : "BROKEN",
+						entry.Pumps, error_text.empty( ) ? "" : ": ", error_text.c_str( ) );
+					fflush( stdout );
+
+					continue;
+				}
+
+				Growth const growth = MeasureGrowth( **engine, entry.Case );
+				bool const finding = IsFinding( growth, settings.Threshold );
+
+				++checked;
+				if( finding ) ++super_linear;
+
+				std::string const status = !growth.Signal ? "linear" : FormatGrowth( growth );
+
+				PrintCase( entry.Engine.c_str( ), status.c_str( ), entry.Case );
+				printf( "%-10s %6s  (saved: %s, %s)\n", "", finding ? "still" : "fixed", entry.Growth.c_str( ), entry.Metric.c_str( ) );
+			}
+
+			if( checked > 0 || ( faults == 0 && differential == 0 ) ) printf( "%d of %d entries are still super-linear.\n", super_linear, checked );
+			if( faults > 0 ) printf( "%d of %d faults still fail; %d of them leave the engine broken.\n", failing, faults, broken );
+			if( differential > 0 ) printf( "%d of %d differential entries give other results with the fast paths.\n", differing, differential );
+
+			return broken > 0 || differing > 0 ? 1 : 0;
+		}
+
+
+		bool ReadPatterns( const std::string& path, std::vector<std::u16string>* patterns )
+		{
+			std::u16string text;
+
+			if( !ReadUtf8File( path.c_str( ), &text ) ) return false;
+
+			size_t start = 0;
+
+			while( start < text.length( ) )
+			{
+				size_t end = text.find( u'\n', start );
+				if( end == std::u16string::npos ) end = text.length( );
+
+				std::u16string line = text.substr( start, end - start );
+				if( !line.empty( ) && line.back( ) == u'\r' ) line.pop_back( );
+
+				if( !line.empty( ) ) patterns->push_back( std::move( line ) );
+
+				start = end + 1;
+			}
+
+			return true;
+		}
+	}
+
+
+	int RunFuzzer( const FuzzSettings& settings )
+	{
+		std::vector<const BenchmarkEngine*> const engines = SelectEngines( settings );
+		std::vector<const BenchmarkEngine*> const variants = SelectFastPathVariants( settings );
+
+		if( engines.empty( ) )
+		{
+			fprintf( stderr, "No engines to fuzz.\n" );
+
+			return 2;
+		}
+
+		if( !settings.ReplayPath.empty( ) ) return Replay( settings, engines, variants );
+
+		std::vector<std::u16string> patterns;
+
+		if( !settings.PatternsPath.empty( ) && ( !ReadPatterns( settings.PatternsPath, &patterns ) || patterns.empty( ) ) )
+		{
+			fprintf( stderr, "Cannot read the patterns from '%s'.\n", settings.PatternsPath.c_str( ) );
+
+			return 2;
+		}
+
+		// the known findings are not reported again
+
+		std::set<std::string> known;
+		{
+			std::vector<CorpusEntry> entries;
+
+			if( !settings.CorpusPath.empty( ) ) ReadCorpus( settings.CorpusPath, &entries );
+
+			for( const CorpusEntry& entry : entries ) known.insert( entry.Engine + '\n' + Escape( entry.Case.Pattern ) );
+		}
+
+		printf( "Fuzzing %d %s (seed %llu) with", settings.Iterations, patterns.empty( ) ? "generated patterns" : "subjects",
+			static_cast<unsigned long long>( settings.Seed ) );
+		for( const BenchmarkEngine* e : engines ) printf( " %s (%s)", e->Id, GetMetric( *e ) );
+		printf( "; the growth is e of cost ~ length ^ e.\n" );
+		printf( "Comparing the fast paths of %d variants of the engines on generated literals and alternations.\n", static_cast<int>( variants.size( ) ) );
+		fflush( stdout );
+
+		Random random( settings.Seed );
+		Random differential_random( ~settings.Seed ); // (a separate sequence, so that the seeds of the corpus give the same patterns)
+		int findings = 0;
+		int differences = 0;
+
+		for( int i = 0; i < settings.Iterations; ++i )
+		{
+			FuzzCase const c = patterns.empty( ) ? GenerateCase( random ) : GenerateCase( random, patterns[i % patterns.size( )] );
+
+			for( const BenchmarkEngine* e : engines )
+			{
+				if( !IsSupported( *e, c ) ) continue;
+
+				Growth growth = MeasureGrowth( *e, c );
+				if( !IsFinding( growth, settings.Threshold ) ) continue;
+
+				FuzzCase const minimized = Minimize( *e, c, settings.Threshold, &growth );
+
+				if( !known.insert( std::string( e->Id ) + '\n' + Escape( minimized.Pattern ) ).second ) continue;
+
+				++findings;
+
+				CorpusEntry const entry{ e->Id, minimized, GetMetric( *e ), FormatGrowth( growth ) };
+
+				PrintCase( e->Id, entry.Growth.c_str( ), minimized );
+
+				if( !settings.CorpusPath.empty( ) && !AppendToCorpus( settings.CorpusPath, entry ) )
+				{
+					fprintf( stderr, "Cannot write '%s'.\n", settings.CorpusPath.c_str( ) );
+
+					return 1;
+				}
+			}
+
+			// the fast paths must give the results of the engines
+
+			for( int k = 0; k < DifferentialCases; ++k )
+			{
+				FuzzCase const d = GenerateDifferentialCase( differential_random );
+
+				for( const BenchmarkEngine* v : variants )
+				{
+					std::string difference;
+
+					if( CompareFastPaths( *v, d, &difference ) ) continue;
+
+					FuzzCase const minimized = MinimizeDifference( *v, d, &difference );
+
+					if( !known.insert( std::string( v->Id ) + '\n' + Escape( minimized.Pattern ) ).second ) continue;
+
+					++differences;
+
+					CorpusEntry const entry{ v->Id, minimized, "differential", "" };
+
+					PrintDifferentialCase( v->Id, "DIFFER", minimized );
+					printf( "%-10s %6s  (%s)\n", "", "", difference.c_str( ) );
+
+					if( !settings.CorpusPath.empty( ) && !AppendToCorpus( settings.CorpusPath, entry ) )
+					{
+						fprintf( stderr, "Cannot write '%s'.\n", settings.CorpusPath.c_str( ) );
+
+						return 1;
+					}
+				}
+			}
+
+			if( ( i + 1 ) % 100 == 0 ) fprintf( stderr, "%d of %d, findings: %d, differences: %d\n", i + 1, settings.Iterations, findings, differences );
+
+			fflush( stdout );
+		}
+
+		printf( "Findings: %d; differences of the fast paths: %d.\n", findings, differences );
+
+		return differences > 0 ? 1 : 0;
+	}
+}
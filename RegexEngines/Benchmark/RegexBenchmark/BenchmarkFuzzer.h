@@ -0,0 +1,62 @@
+#pragma once
+
+// The fuzzer of pathological patterns: it looks for pairs of pattern and subject that take super-linear
+// time in the backtracking engines (see 'BenchmarkEngine::Backtracking').
+//
+// The subject is "prefix + pump * k + suffix". The cost of a scan is measured for growing k: the number
+// of backtracking steps if the engine counts them (the smallest limit of 'CompileWithStepLimit' that lets
+// the scan finish), otherwise the best time of several scans. The growth is the exponent e of
+// cost ~ length ^ e between the two largest subjects that differ about twice; a linear scan has e close
+// to 1. The pair is a finding if e reaches the threshold, or if the larger subject exceeds the ceiling
+// of steps or time while the smaller one is far below it.
+//
+// The patterns are generated from a small grammar of the constructs that tend to backtrack (nested and
+// adjacent quantifiers, overlapping alternatives, backreferences), and the pump is a string that matches
+// a quantified part of the pattern. With '--patterns', the patterns are read from a file instead (one
+// per line, to check a library of patterns) and the pumps are made of their literal characters.
+//
+// The findings are minimized (the parts of the pattern and of the subject are removed while the growth
+// stays super-linear) and appended to the corpus, which can be replayed later, for example after an update
+// of the engines. The corpus is a text file of blocks separated by empty lines; each line of a block is
+// "key=value" with the keys "engine", "pattern", "prefix", "pump", "suffix", "metric" and "growth", where
+// '\', line breaks and tabs of the values are escaped as "\\", "\n", "\r" and "\t", and the unpaired surrogates
+// as "\uD800" (any UTF-16 unit can be given as "\uXXXX"). The lines that start with '#' are comments.
+//
+// The entries with "metric=fault", which are written by hand, are the subjects that make an engine fail, such
+// as the deep recursion that overflows the stack of a recursive engine; the subject has "pumps=N" pumps. The replay
+// checks that the failure is reported by the scan, without the loss of the process, and that the engine still
+// works after it (see "StackGuard.h").
+//
+// Each iteration also checks the fast paths of the cores (see "LiteralSearch.h" and "LiteralAlternation.h").
+// The generated literals are made of the letters that are equal to non-ASCII letters in the Unicode case folding
+// ('K', 'k' and U+212A KELVIN SIGN, 's', 'S' and U+017F LATIN SMALL LETTER LONG S), unpaired surrogates and
+// metacharacters; the generated alternations, such as "\b(?:a|ab|\.)\b", have words that are prefixes of others,
+// escaped metacharacters, the three kinds of groups and the word boundaries. They are compiled by the variants of
+// 'GetFastPathVariants' (case-insensitive, with and without UTF, the literal and POSIX modes of RE2, 'match_posix'
+// and 'nosubs', the syntaxes of Oniguruma) with the fast paths enabled and disabled ('SetLiteralSearchEnabled'),
+// and a subject made of the words, or of the literal in different cases, must give the same matches and groups. The differences are appended as "metric=differential" entries, where the subject
+// is the prefix; the replay compares them again and fails if they still differ. With '--engines', the variants of
+// the listed engines are checked.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace RegexBenchmark
+{
+	struct FuzzSettings
+	{
+		std::vector<std::string> Engines; // (empty -- all the backtracking engines)
+		uint64_t Seed = 1;
+		int Iterations = 0; // (the number of generated pairs)
+		double Threshold = 1.5; // (the minimum exponent of growth of a finding)
+		std::string PatternsPath; // (empty -- the patterns are generated)
+		std::string CorpusPath; // (the new findings are appended; empty -- not saved)
+		std::string ReplayPath; // (the corpus to check instead of fuzzing)
+	};
+
+
+	// Prints the progress and the findings to standard output; returns the exit code of the program.
+	int RunFuzzer( const FuzzSettings& settings );
+}
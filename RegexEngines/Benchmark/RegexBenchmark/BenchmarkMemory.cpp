@@ -0,0 +1,151 @@
+#include <new>
+
+#include "../../NativeInfrastructure/AllocationCounter.h"
+#include "BenchmarkMemory.h"
+
+#ifdef _WIN32
+#	include <Windows.h>
+#	include <Psapi.h>
+#else
+#	include <sys/resource.h>
+#	include <cstdio>
+#	include <cstring>
+#endif
+
+
+namespace RegexBenchmark
+{
+#ifdef _WIN32
+
+	bool ResetPeakResidentSize( )
+	{
+		return false;
+	}
+
+
+	uint64_t GetPeakResidentSize( )
+	{
+		PROCESS_MEMORY_COUNTERS counters{};
+
+		if( !GetProcessMemoryInfo( GetCurrentProcess( ), &counters, sizeof( counters ) ) ) return 0;
+
+		return counters.PeakWorkingSetSize;
+	}
+
+#else
+
+	bool ResetPeakResidentSize( )
+	{
+#	ifdef __linux__
+		FILE* file = fopen( "/proc/self/clear_refs", "w" );
+		if( file == nullptr ) return false;
+
+		bool const ok = fputs( "5", file ) >= 0;
+
+		return fclose( file ) == 0 && ok;
+#	else
+		return false;
+#	endif
+	}
+
+
+	uint64_t GetPeakResidentSize( )
+	{
+#	ifdef __linux__
+		FILE* file = fopen( "/proc/self/status", "r" );
+
+		if( file != nullptr )
+		{
+			char line[256];
+			unsigned long long kb = 0;
+			bool found = false;
+
+			while( !found && fgets( line, sizeof( line ), file ) )
+			{
+				found = strncmp( line, "VmHWM:", 6 ) == 0 && sscanf( line + 6, "%llu", &kb ) == 1;
+			}
+
+			fclose( file );
+
+			if( found ) return kb * 1024;
+		}
+#	endif
+
+		struct rusage usage {};
+
+		if( getrusage( RUSAGE_SELF, &usage ) != 0 ) return 0;
+
+#	ifdef __APPLE__
+		return static_cast<uint64_t>( usage.ru_maxrss ); // (bytes)
+#	else
+		return static_cast<uint64_t>( usage.ru_maxrss ) * 1024; // (kilobytes)
+#	endif
+	}
+
+#endif
+}
+
+
+// The global allocation functions, which count the allocations of C++ engines and of the cores.
+
+void* operator new( size_t size )
+{
+	void* block = RegexCoreCountedMalloc( size != 0 ? size : 1 );
+	if( block == nullptr ) throw std::bad_alloc( );
+
+	return block;
+}
+
+
+void* operator new[]( size_t size )
+{
+	return operator new( size );
+}
+
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+	return RegexCoreCountedMalloc( size != 0 ? size : 1 );
+}
+
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept
+{
+	return RegexCoreCountedMalloc( size != 0 ? size : 1 );
+}
+
+
+void operator delete( void* block ) noexcept
+{
+	RegexCoreCountedFree( block );
+}
+
+
+void operator delete[]( void* block ) noexcept
+{
+	RegexCoreCountedFree( block );
+}
+
+
+void operator delete( void* block, size_t ) noexcept
+{
+	RegexCoreCountedFree( block );
+}
+
+
+void operator delete[]( void* block, size_t ) noexcept
+{
+	RegexCoreCountedFree( block );
+}
+
+
+void operator delete( void* block, const std::nothrow_t& ) noexcept
+{
+	RegexCoreCountedFree( block );
+}
+
+
+void operator delete[]( void* block, const std::nothrow_t& ) noexcept
+{
+	RegexCoreCountedFree( block );
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// The peak resident set size of the process.
+//
+// Windows: 'PeakWorkingSetSize' of 'GetProcessMemoryInfo'; it cannot be reset, therefore the peak
+//   of a case includes the previous cases (run a single engine and case for isolated numbers).
+// Linux: 'VmHWM' of "/proc/self/status"; it is reset by writing "5" to "/proc/self/clear_refs".
+// Other POSIX systems: 'ru_maxrss' of 'getrusage', which cannot be reset.
+//
+// The allocations of each phase are counted by "AllocationCounter.h"; "BenchmarkMemory.cpp" replaces
+// the global 'operator new' and 'operator delete' for that.
+
+#include <cstdint>
+
+
+namespace RegexBenchmark
+{
+	// Returns false if the peak cannot be reset on this system.
+	bool ResetPeakResidentSize( );
+
+	// Returns the peak in bytes, or 0 if it is unknown.
+	uint64_t GetPeakResidentSize( );
+}
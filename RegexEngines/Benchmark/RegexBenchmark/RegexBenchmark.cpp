@@ -0,0 +1,860 @@
+// RegexBenchmark: measures the engines of RegExpress on a curated corpus through their portable cores
+// (see "RegexCore.h", "BenchmarkEngines.h" and "BenchmarkCorpus.h").
+//
+// For each engine and case: the compile time, the scan throughput (MB/s of UTF-8 text, as it would be
+// stored in a file), the matches per second, the peak resident set size, and the allocations of
+// the compilation and of the scan (count, bytes and peak of live bytes; measured by an extra compilation
+// and scan, so that the counting does not affect the times) and, optionally, the hardware counters of
+// both phases. The results are printed as a table and, optionally, as JSON for tracking over time.
+//
+// The options are described by 'Usage' below, which is printed by '--help'.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../../NativeInfrastructure/AllocationCounter.h"
+#include "../../NativeInfrastructure/RegexCore.h"
+#include "../../NativeInfrastructure/Utf8Text.h"
+#include "BenchmarkCorpus.h"
+#include "BenchmarkCounters.h"
+#include "BenchmarkEngines.h"
+#include "BenchmarkFuzzer.h"
+#include "BenchmarkMemory.h"
+
+
+using namespace NativeInfrastructure;
+using namespace RegexBenchmark;
+
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+
+	const char* const Usage =
+		"Usage: RegexBenchmark [options]\n"
+		"  --engines id,...   the engines to run (default: all; see '--list')\n"
+		"  --cases id,...     the cases to run (default: all)\n"
+		"  --size MB          the size of the generated texts (default: 1)\n"
+		"  --time seconds     the minimum time of scans for each engine and case (default: 1)\n"
+		"  --timeout seconds  the limit of a single scan (default: 30)\n"
+		"  --text file        a UTF-8 file to scan instead of the generated texts\n"
+		"  --rfc822 file      the pattern of RFC 822 addresses (default: \"Misc/Sample Regex - RFC822.txt\",\n"
+		"                     looked up in the current folder and its parents)\n"
+		"  --json file        writes the results as JSON (\"-\" -- to standard output; the table goes to standard error)\n"
+		"  --counters         collects the hardware counters (cycles, instructions, branch and cache misses) of a compilation\n"
+		"                     and of a scan; Linux only, in the CMake build (see \"BenchmarkCounters.h\"); the Windows build\n"
+		"                     reports them as unavailable\n"
+		"  --list             lists the engines and the cases\n"
+		"  --help             prints this text\n"
+		"\n"
+		"Usage: RegexBenchmark --fuzz count [options], or RegexBenchmark --replay file [options]\n"
+		"  looks for super-linear matching in the backtracking engines, and for the literals and alternations of literals\n"
+		"  that the fast paths of the cores match otherwise than the engines (see \"BenchmarkFuzzer.h\"):\n"
+		"  --fuzz count       the number of generated pairs of pattern and subject\n"
+		"  --seed number      the seed of the pseudo-random generator (default: 1)\n"
+		"  --threshold e      the minimum exponent of growth, cost ~ length ^ e, of a finding (default: 1.5)\n"
+		"  --patterns file    fuzzes the subjects for the patterns of a UTF-8 file (one per line) instead of generated ones\n"
+		"  --corpus file      appends the minimized findings to the file; the known findings are not reported again\n"
+		"  --replay file      measures the findings of the corpus again instead of fuzzing\n"
+		"  --engines id,...   the engines to fuzz (default: the backtracking ones; the fast paths of all of them)\n";
+
+
+	struct Settings
+	{
+		std::vector<std::string> Engines;
+		std::vector<std::string> Cases;
+		double SizeMB = 1;
+		double Time = 1;
+		double Timeout = 30;
+		std::string TextPath;
+		std::string Rfc822Path;
+		std::string JsonPath;
+		bool Help = false;
+		bool List = false;
+		bool Counters = false;
+
+		FuzzSettings Fuzz; // (used if 'Fuzz.Iterations' or 'Fuzz.ReplayPath' is set)
+	};
+
+
+	struct Measurement
+	{
+		std::string Engine;
+		std::string Case;
+		const char* Status = "ok"; // "ok", "unsupported", "error", "limit" or "timeout"
+		std::string Error;
+
+		double CompileMicroseconds = 0; // (mean)
+		double CompileMicrosecondsBest = 0;
+		int CompileIterations = 0;
+
+		double ScanMilliseconds = 0; // (mean)
+		double ScanMillisecondsBest = 0;
+		int ScanIterations = 0;
+
+		uint64_t TextBytes = 0;
+		int32_t Matches = 0;
+		uint64_t PeakResidentBytes = 0;
+
+		bool HasAllocations = false;
+		RegexCoreAllocationStats CompileAllocations{};
+		RegexCoreAllocationStats ScanAllocations{};
+
+		bool HasCounters = false;
+		CounterValues CompileCounters; // (per compilation)
+		CounterValues ScanCounters;
+	};
+
+
+	double Seconds( Clock::duration d )
+	{
+		return std::chrono::duration<double>( d ).count( );
+	}
+
+
+	std::vector<std::string> SplitList( const char* s )
+	{
+		std::vector<std::string> items;
+		std::string item;
+
+		for( ; ; ++s )
+		{
+			if( *s == ',' || *s == '\0' )
+			{
+				if( !item.empty( ) ) items.push_back( item );
+				item.clear( );
+
+				if( *s == '\0' ) break;
+			}
+			else
+			{
+				item.push_back( *s );
+			}
+		}
+
+		return items;
+	}
+
+
+	bool Contains( const std::vector<std::string>& list, const std::string& item )
+	{
+		return list.empty( ) || std::find( list.begin( ), list.end( ), item ) != list.end( );
+	}
+
+
+	bool ParseArguments( int argc, char* argv[], Settings* settings )
+	{
+		for( int i = 1; i < argc; ++i )
+		{
+			const char* arg = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+			if( strcmp( arg, "--help" ) == 0 || strcmp( arg, "-h" ) == 0 )
+			{
+				settings->Help = true;
+
+				continue;
+			}
+
+			if( strcmp( arg, "--list" ) == 0 )
+			{
+				settings->List = true;
+
+				continue;
+			}
+
+			if( strcmp( arg, "--counters" ) == 0 )
+			{
+				settings->Counters = true;
+
+				continue;
+			}
+
+			if( value == nullptr )
+			{
+				fprintf( stderr, "Unknown option or missing value: '%s'.\n", arg );
+
+				return false;
+			}
+
+			++i;
+
+			if( strcmp( arg, "--engines" ) == 0 ) settings->Engines = SplitList( value );
+			else if( strcmp( arg, "--cases" ) == 0 ) settings->Cases = SplitList( value );
+			else if( strcmp( arg, "--size" ) == 0 ) settings->SizeMB = atof( value );
+			else if( strcmp( arg, "--time" ) == 0 ) settings->Time = atof( value );
+			else if( strcmp( arg, "--timeout" ) == 0 ) settings->Timeout = atof( value );
+			else if( strcmp( arg, "--text" ) == 0 ) settings->TextPath = value;
+			else if( strcmp( arg, "--rfc822" ) == 0 ) settings->Rfc822Path = value;
+			else if( strcmp( arg, "--json" ) == 0 ) settings->JsonPath = value;
+			else if( strcmp( arg, "--fuzz" ) == 0 ) settings->Fuzz.Iterations = atoi( value );
+			else if( strcmp( arg, "--seed" ) == 0 ) settings->Fuzz.Seed = strtoull( value, nullptr, 10 );
+			else if( strcmp( arg, "--threshold" ) == 0 ) settings->Fuzz.Threshold = atof( value );
+			else if( strcmp( arg, "--patterns" ) == 0 ) settings->Fuzz.PatternsPath = value;
+			else if( strcmp( arg, "--corpus" ) == 0 ) settings->Fuzz.CorpusPath = value;
+			else if( strcmp( arg, "--replay" ) == 0 ) settings->Fuzz.ReplayPath = value;
+			else
+			{
+				fprintf( stderr, "Unknown option: '%s'.\n", arg );
+
+				return false;
+			}
+		}
+
+		if( !( settings->SizeMB > 0 ) || !( settings->Time >= 0 ) || !( settings->Timeout > 0 ) )
+		{
+			fprintf( stderr, "Invalid size, time or timeout.\n" );
+
+			return false;
+		}
+
+		if( settings->Fuzz.Iterations < 0 || !( settings->Fuzz.Threshold > 1 ) )
+		{
+			fprintf( stderr, "Invalid number of pairs or threshold.\n" );
+
+			return false;
+		}
+
+		settings->Fuzz.Engines = settings->Engines;
+
+		return true;
+	}
+
+
+	// Reads the RFC 822 pattern; the line breaks at the end of the file are not part of the pattern.
+	std::u16string LoadRfc822Pattern( const std::string& path )
+	{
+		std::u16string pattern;
+
+		if( !path.empty( ) )
+		{
+			if( !ReadUtf8File( path.c_str( ), &pattern ) ) fprintf( stderr, "Cannot read '%s'.\n", path.c_str( ) );
+		}
+		else
+		{
+			std::string prefix;
+
+			for( int up = 0; up < 6 && pattern.empty( ); ++up, prefix += "../" )
+			{
+				ReadUtf8File( ( prefix + "Misc/Sample Regex - RFC822.txt" ).c_str( ), &pattern );
+			}
+		}
+
+		while( !pattern.empty( ) && ( pattern.back( ) == u'\n' || pattern.back( ) == u'\r' ) ) pattern.pop_back( );
+
+		return pattern;
+	}
+
+
+	bool IsAscii( const std::u16string& s )
+	{
+		return std::all_of( s.begin( ), s.end( ), []( char16_t c ) { return c < 0x80; } );
+	}
+
+
+	// Cancels the scans that take longer than the timeout.
+	struct Deadline
+	{
+		Clock::time_point End;
+
+		static int32_t IsCancelled( void* context )
+		{
+			return Clock::now( ) > static_cast<Deadline*>( context )->End;
+		}
+	};
+
+
+	// Returns 'REGEX_CORE_...' and the number of matches.
+	int32_t RunScan( const BenchmarkEngine& engine, const void* regex, const std::u16string& text, double timeout,
+		int32_t* matches, RegexCoreError* error )
+	{
+		Deadline deadline{ Clock::now( ) + std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( timeout ) ) };
+		RegexCoreCancellation cancellation{ &Deadline::IsCancelled, &deadline };
+		RegexCoreResults results{};
+
+		int32_t rc = engine.Scan( regex, text.data( ), text.length( ), &cancellation, &results, error );
+
+		*matches = results.MatchCount;
+		RegexCoreFreeResults( &results );
+
+		return rc;
+	}
+
+
+	// 'counters' is null if they are not collected.
+	void Measure( const BenchmarkEngine& engine, const BenchmarkCase& benchmarkCase, const std::u16string& text, const Settings& settings,
+		HardwareCounters* counters, Measurement* m )
+	{
+		if( engine.AsciiOnly && ( !IsAscii( benchmarkCase.Pattern ) || !IsAscii( text ) ) )
+		{
+			m->Status = "unsupported";
+			m->Error = "The engine only supports ASCII.";
+
+			return;
+		}
+
+		RegexCoreError error{};
+
+		// compile (the first compilation also checks the pattern)
+
+		void* regex = engine.Compile( benchmarkCase.Pattern.data( ), benchmarkCase.Pattern.length( ), &error );
+
+		if( regex == nullptr )
+		{
+			m->Status = "unsupported";
+			m->Error = error.Text;
+
+			return;
+		}
+
+		{
+			double const budget = std::max( 0.05, settings.Time / 10 );
+			double total = 0;
+			double best = 0;
+
+			do
+			{
+				auto start = Clock::now( );
+				void* r = engine.Compile( benchmarkCase.Pattern.data( ), benchmarkCase.Pattern.length( ), &error );
+				double const t = Seconds( Clock::now( ) - start );
+
+				if( r ) engine.Free( r );
+
+				total += t;
+				if( m->CompileIterations == 0 || t < best ) best = t;
+				++m->CompileIterations;
+
+			} while( total < budget && m->CompileIterations < 10000 );
+
+			m->CompileMicroseconds = total / m->CompileIterations * 1e6;
+			m->CompileMicrosecondsBest = best * 1e6;
+		}
+
+		// scans (the first one is a warm-up, which also finds the number of matches and the errors)
+
+		int32_t rc = RunScan( engine, regex, text, settings.Timeout, &m->Matches, &error );
+
+		if( rc == REGEX_CORE_OK )
+		{
+			double total = 0;
+			double best = 0;
+			int32_t matches;
+
+			do
+			{
+				auto start = Clock::now( );
+				rc = RunScan( engine, regex, text, settings.Timeout, &matches, &error );
+				double const t = Seconds( Clock::now( ) - start );
+
+				if( rc != REGEX_CORE_OK ) break;
+
+				total += t;
+				if( m->ScanIterations == 0 || t < best ) best = t;
+				++m->ScanIterations;
+
+			} while( total < settings.Time && m->ScanIterations < 1000 );
+
+			if( m->ScanIterations > 0 )
+			{
+				m->ScanMilliseconds = total / m->ScanIterations * 1e3;
+				m->ScanMillisecondsBest = best * 1e3;
+			}
+		}
+
+		if( rc == REGEX_CORE_OK )
+		{
+			RegexCoreStartAllocationCounting( );
+			void* counted = engine.Compile( benchmarkCase.Pattern.data( ), benchmarkCase.Pattern.length( ), &error );
+			RegexCoreStopAllocationCounting( &m->CompileAllocations );
+
+			if( counted != nullptr )
+			{
+				int32_t matches;
+
+				RegexCoreStartAllocationCounting( );
+				int32_t const counted_rc = RunScan( engine, counted, text, settings.Timeout, &matches, &error );
+				RegexCoreStopAllocationCounting( &m->ScanAllocations );
+
+				m->HasAllocations = counted_rc == REGEX_CORE_OK;
+
+				engine.Free( counted );
+			}
+		}
+
+		if( rc == REGEX_CORE_OK && counters != nullptr )
+		{
+			// (the compilations are short, therefore the counters are divided; each one includes the release of the pattern)
+
+			int const compilations = std::max( 1, std::min( m->CompileIterations, 1000 ) );
+
+			counters->Start( );
+
+			for( int i = 0; i < compilations; ++i )
+			{
+				void* r = engine.Compile( benchmarkCase.Pattern.data( ), benchmarkCase.Pattern.length( ), &error );
+				if( r ) engine.Free( r );
+			}
+
+			m->CompileCounters = counters->Stop( );
+
+			for( double& v : m->CompileCounters.Values ) v /= compilations;
+
+			int32_t matches;
+
+			counters->Start( );
+			int32_t const counted_rc = RunScan( engine, regex, text, settings.Timeout, &matches, &error );
+			m->ScanCounters = counters->Stop( );
+
+			m->HasCounters = counted_rc == REGEX_CORE_OK;
+		}
+
+		if( rc == REGEX_CORE_LIMIT )
+		{
+			m->Status = "limit";
+			m->Error = error.Text;
+		}
+		else if( rc == REGEX_CORE_CANCELLED )
+		{
+			m->Status = "timeout";
+			m->Error = "The scan takes more than " + std::to_string( settings.Timeout ) + " seconds.";
+		}
+		else if( rc != REGEX_CORE_OK )
+		{
+			m->Status = "error";
+			m->Error = error.Text;
+		}
+
+		engine.Free( regex );
+	}
+
+
+	double MegabytesPerSecond( const Measurement& m )
+	{
+		return m.ScanMilliseconds > 0 ? m.TextBytes / ( m.ScanMilliseconds * 1e3 ) : 0;
+	}
+
+
+	double MatchesPerSecond( const Measurement& m )
+	{
+		return m.ScanMilliseconds > 0 ? m.Matches / ( m.ScanMilliseconds / 1e3 ) : 0;
+	}
+
+
+	// Prints the value per 'divisor', or "n/a".
+	void PrintCounter( FILE* out, const CounterValues& values, int counter, double divisor )
+	{
+		if( values.Available[counter] && divisor > 0 ) fprintf( out, " %10.3f", values.Values[counter] / divisor );
+		else fprintf( out, " %10s", "n/a" );
+	}
+
+
+	void PrintRow( FILE* out, const Measurement& m )
+	{
+		if( strcmp( m.Status, "ok" ) != 0 )
+		{
+			// (only the first line of the error)
+			std::string error = m.Error.substr( 0, m.Error.find_first_of( "\r\n" ) );
+
+			fprintf( out, "%-24s %-10s %s: %s\n", m.Case.c_str( ), m.Engine.c_str( ), m.Status, error.c_str( ) );
+
+			return;
+		}
+
+		fprintf( out, "%-24s %-10s %12.1f %10.1f %12.0f %10d %10.1f", m.Case.c_str( ), m.Engine.c_str( ),
+			m.CompileMicroseconds, MegabytesPerSecond( m ), MatchesPerSecond( m ), m.Matches, m.PeakResidentBytes / ( 1024.0 * 1024.0 ) );
+
+		if( m.HasAllocations )
+		{
+			fprintf( out, " %10llu %10.1f %10llu %10.1f",
+				static_cast<unsigned long long>( m.CompileAllocations.Count ), m.CompileAllocations.PeakLiveBytes / 1024.0,
+				static_cast<unsigned long long>( m.ScanAllocations.Count ), m.ScanAllocations.PeakLiveBytes / 1024.0 );
+		}
+
+		if( m.HasCounters )
+		{
+			// the instructions per cycle, then per byte or kilobyte of text
+
+			const CounterValues& s = m.ScanCounters;
+			bool const ipc = s.Available[COUNTER_CYCLES] && s.Available[COUNTER_INSTRUCTIONS];
+
+			PrintCounter( out, s, COUNTER_INSTRUCTIONS, ipc ? s.Values[COUNTER_CYCLES] : 0 );
+			PrintCounter( out, s, COUNTER_INSTRUCTIONS, static_cast<double>( m.TextBytes ) );
+			PrintCounter( out, s, COUNTER_BRANCH_MISSES, m.TextBytes / 1024.0 );
+			PrintCounter( out, s, COUNTER_L1D_MISSES, m.TextBytes / 1024.0 );
+			PrintCounter( out, s, COUNTER_LLC_MISSES, m.TextBytes / 1024.0 );
+		}
+
+		fprintf( out, "\n" );
+	}
+
+
+	void AppendJsonString( std::string* json, const std::string& s )
+	{
+		json->push_back( '"' );
+
+		for( unsigned char c : s )
+		{
+			switch( c )
+			{
+			case '"': json->append( "\\\"" ); break;
+			case '\\': json->append( "\\\\" ); break;
+			case '\n': json->append( "\\n" ); break;
+			case '\r': json->append( "\\r" ); break;
+			case '\t': json->append( "\\t" ); break;
+			default:
+				if( c < 0x20 )
+				{
+					char buffer[8];
+					snprintf( buffer, sizeof( buffer ), "\\u%04x", c );
+					json->append( buffer );
+				}
+				else
+				{
+					json->push_back( static_cast<char>( c ) ); // (UTF-8)
+				}
+			}
+		}
+
+		json->push_back( '"' );
+	}
+
+
+	void AppendJsonNumber( std::string* json, double value )
+	{
+		char buffer[64];
+		snprintf( buffer, sizeof( buffer ), "%.6g", value );
+		json->append( buffer );
+	}
+
+
+	void AppendJsonAllocations( std::string* json, const RegexCoreAllocationStats& stats )
+	{
+		json->append( "{ \"count\": " + std::to_string( stats.Count ) );
+		json->append( ", \"bytes\": " + std::to_string( stats.Bytes ) );
+		json->append( ", \"peak_live_bytes\": " + std::to_string( stats.PeakLiveBytes ) + " }" );
+	}
+
+
+	// (the unavailable counters are omitted)
+	void AppendJsonCounters( std::string* json, const CounterValues& values )
+	{
+		bool first = true;
+
+		json->append( "{" );
+
+		for( int i = 0; i < COUNTER_COUNT; ++i )
+		{
+			if( !values.Available[i] ) continue;
+
+			json->append( first ? " \"" : ", \"" );
+			json->append( HardwareCounters::GetName( i ) );
+			json->append( "\": " );
+			AppendJsonNumber( json, values.Values[i] );
+
+			first = false;
+		}
+
+		json->append( " }" );
+	}
+
+
+	std::string GetTimestamp( )
+	{
+		std::time_t now = std::time( nullptr );
+		std::tm tm{};
+
+#ifdef _WIN32
+		gmtime_s( &tm, &now );
+#else
+		gmtime_r( &now, &tm );
+#endif
+
+		char buffer[32];
+		strftime( buffer, sizeof( buffer ), "%Y-%m-%dT%H:%M:%SZ", &tm );
+
+		return buffer;
+	}
+
+
+	const char* GetPlatform( )
+	{
+#if defined( _WIN32 )
+		return "windows";
+#elif defined( __linux__ )
+		return "linux";
+#elif defined( __APPLE__ )
+		return "macos";
+#else
+		return "unknown";
+#endif
+	}
+
+
+	std::string GetCompiler( )
+	{
+#if defined( _MSC_VER )
+		return "msvc " + std::to_string( _MSC_FULL_VER );
+#elif defined( __clang__ )
+		return std::string( "clang " ) + __clang_version__;
+#elif defined( __GNUC__ )
+		return std::string( "gcc " ) + __VERSION__;
+#else
+		return "unknown";
+#endif
+	}
+
+
+	// 'countersStatus' is "off", "perf_event" or the reason why the counters are unavailable.
+	std::string ToJson( const Settings& settings, const std::vector<Measurement>& measurements, bool peakIsPerCase, const std::string& countersStatus )
+	{
+		std::string json;
+
+		json += "{\n  \"tool\": \"RegexBenchmark\",\n  \"format\": 1,\n  \"timestamp\": ";
+		AppendJsonString( &json, GetTimestamp( ) );
+		json += ",\n  \"platform\": ";
+		AppendJsonString( &json, GetPlatform( ) );
+		json += ",\n  \"compiler\": ";
+		AppendJsonString( &json, GetCompiler( ) );
+		json += ",\n  \"settings\": { \"size_mb\": ";
+		AppendJsonNumber( &json, settings.SizeMB );
+		json += ", \"time_s\": ";
+		AppendJsonNumber( &json, settings.Time );
+		json += ", \"timeout_s\": ";
+		AppendJsonNumber( &json, settings.Timeout );
+		json += ", \"text\": ";
+		AppendJsonString( &json, settings.TextPath );
+		json += ", \"peak_rss_scope\": ";
+		AppendJsonString( &json, peakIsPerCase ? "case" : "process" );
+		json += ", \"counters\": ";
+		AppendJsonString( &json, countersStatus );
+		json += " },\n  \"results\": [";
+
+		for( size_t i = 0; i < measurements.size( ); ++i )
+		{
+			const Measurement& m = measurements[i];
+
+			json += i == 0 ? "\n" : ",\n";
+			json += "    { \"engine\": ";
+			AppendJsonString( &json, m.Engine );
+			json += ", \"case\": ";
+			AppendJsonString( &json, m.Case );
+			json += ", \"status\": ";
+			AppendJsonString( &json, m.Status );
+
+			if( !m.Error.empty( ) )
+			{
+				json += ", \"error\": ";
+				AppendJsonString( &json, m.Error );
+			}
+
+			if( m.CompileIterations > 0 )
+			{
+				json += ", \"compile_us\": ";
+				AppendJsonNumber( &json, m.CompileMicroseconds );
+				json += ", \"compile_us_best\": ";
+				AppendJsonNumber( &json, m.CompileMicrosecondsBest );
+				json += ", \"compile_iterations\": " + std::to_string( m.CompileIterations );
+			}
+
+			if( m.ScanIterations > 0 )
+			{
+				json += ", \"text_bytes\": " + std::to_string( m.TextBytes );
+				json += ", \"matches\": " + std::to_string( m.Matches );
+				json += ", \"scan_ms\": ";
+				AppendJsonNumber( &json, m.ScanMilliseconds );
+				json += ", \"scan_ms_best\": ";
+				AppendJsonNumber( &json, m.ScanMillisecondsBest );
+				json += ", \"scan_iterations\": " + std::to_string( m.ScanIterations );
+				json += ", \"mb_per_s\": ";
+				AppendJsonNumber( &json, MegabytesPerSecond( m ) );
+				json += ", \"matches_per_s\": ";
+				AppendJsonNumber( &json, MatchesPerSecond( m ) );
+			}
+
+			if( m.PeakResidentBytes > 0 ) json += ", \"peak_rss_bytes\": " + std::to_string( m.PeakResidentBytes );
+
+			if( m.HasAllocations )
+			{
+				json += ", \"compile_allocations\": ";
+				AppendJsonAllocations( &json, m.CompileAllocations );
+				json += ", \"scan_allocations\": ";
+				AppendJsonAllocations( &json, m.ScanAllocations );
+			}
+
+			if( m.HasCounters )
+			{
+				json += ", \"compile_counters\": ";
+				AppendJsonCounters( &json, m.CompileCounters );
+				json += ", \"scan_counters\": ";
+				AppendJsonCounters( &json, m.ScanCounters );
+			}
+
+			json += " }";
+		}
+
+		json += "\n  ]\n}\n";
+
+		return json;
+	}
+}
+
+
+int main( int argc, char* argv[] )
+{
+	Settings settings;
+
+	if( !ParseArguments( argc, argv, &settings ) )
+	{
+		fprintf( stderr, "See '--help'.\n" );
+
+		return 2;
+	}
+
+	if( settings.Help )
+	{
+		fputs( Usage, stdout );
+
+		return 0;
+	}
+
+	if( settings.Fuzz.Iterations > 0 || !settings.Fuzz.ReplayPath.empty( ) ) return RunFuzzer( settings.Fuzz );
+
+	const std::vector<BenchmarkEngine>& engines = GetBenchmarkEngines( );
+	std::u16string const rfc822_pattern = LoadRfc822Pattern( settings.Rfc822Path );
+	std::vector<BenchmarkCase> const cases = GetBenchmarkCases( rfc822_pattern );
+
+	if( settings.List )
+	{
+		printf( "Engines:\n" );
+		for( const BenchmarkEngine& e : engines ) printf( "  %-24s %s\n", e.Id, e.Description );
+
+		printf( "Cases:\n" );
+		for( const BenchmarkCase& c : cases ) printf( "  %-24s %s\n", c.Id.c_str( ), c.Description.c_str( ) );
+
+		return 0;
+	}
+
+	if( rfc822_pattern.empty( ) ) fprintf( stderr, "The RFC 822 pattern is not found; the case is skipped (see '--rfc822').\n" );
+
+	// the texts
+
+	std::u16string ascii_text;
+	std::u16string unicode_text;
+
+	if( !settings.TextPath.empty( ) )
+	{
+		if( !ReadUtf8File( settings.TextPath.c_str( ), &ascii_text ) )
+		{
+			fprintf( stderr, "Cannot read '%s'.\n", settings.TextPath.c_str( ) );
+
+			return 2;
+		}
+
+		unicode_text = ascii_text;
+	}
+	else
+	{
+		size_t const length = static_cast<size_t>( settings.SizeMB * 1024 * 1024 );
+
+		ascii_text = GenerateSubject( BenchmarkSubject::Ascii, length );
+		unicode_text = GenerateSubject( BenchmarkSubject::Unicode, length );
+	}
+
+	std::string utf8;
+
+	AppendUtf8( &utf8, ascii_text.data( ), ascii_text.length( ) );
+	uint64_t const ascii_bytes = utf8.size( );
+
+	utf8.clear( );
+	AppendUtf8( &utf8, unicode_text.data( ), unicode_text.length( ) );
+	uint64_t const unicode_bytes = utf8.size( );
+
+	utf8 = std::string( );
+
+	// the measurements
+
+	bool const json_to_stdout = settings.JsonPath == "-";
+	FILE* const table = json_to_stdout ? stderr : stdout;
+	bool peak_is_per_case = true;
+	std::vector<Measurement> measurements;
+
+	HardwareCounters counters;
+	std::string counters_status = "off";
+	bool counters_available = false;
+
+	if( settings.Counters )
+	{
+		counters_available = counters.Open( &counters_status );
+
+		if( counters_available ) counters_status = "perf_event";
+		else fprintf( stderr, "The hardware counters are unavailable: %s\n", counters_status.c_str( ) );
+	}
+
+	fprintf( table, "%-24s %-10s %12s %10s %12s %10s %10s %10s %10s %10s %10s", "case", "engine", "compile, us", "MB/s", "matches/s", "matches", "peak, MB",
+		"c.allocs", "c.live, KB", "s.allocs", "s.live, KB" );
+
+	if( counters_available ) fprintf( table, " %10s %10s %10s %10s %10s", "s.IPC", "s.instr/B", "s.br.m/KB", "s.L1.m/KB", "s.LLC.m/KB" );
+
+	fprintf( table, "\n" );
+
+	for( const BenchmarkCase& c : cases )
+	{
+		if( !Contains( settings.Cases, c.Id ) ) continue;
+
+		bool const unicode = c.Subject == BenchmarkSubject::Unicode;
+		const std::u16string& text = unicode ? unicode_text : ascii_text;
+
+		for( const BenchmarkEngine& e : engines )
+		{
+			if( !Contains( settings.Engines, e.Id ) ) continue;
+
+			Measurement m;
+
+			m.Engine = e.Id;
+			m.Case = c.Id;
+			m.TextBytes = unicode ? unicode_bytes : ascii_bytes;
+
+			if( !ResetPeakResidentSize( ) ) peak_is_per_case = false;
+
+			Measure( e, c, text, settings, counters_available ? &counters : nullptr, &m );
+
+			m.PeakResidentBytes = GetPeakResidentSize( );
+
+			PrintRow( table, m );
+			fflush( table );
+
+			measurements.push_back( std::move( m ) );
+		}
+	}
+
+	if( !settings.JsonPath.empty( ) )
+	{
+		std::string const json = ToJson( settings, measurements, peak_is_per_case, counters_status );
+
+		if( json_to_stdout )
+		{
+			fwrite( json.data( ), 1, json.size( ), stdout );
+		}
+		else
+		{
+			std::ofstream file( settings.JsonPath, std::ios::binary );
+
+			if( !( file << json ) )
+			{
+				fprintf( stderr, "Cannot write '%s'.\n", settings.JsonPath.c_str( ) );
+
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
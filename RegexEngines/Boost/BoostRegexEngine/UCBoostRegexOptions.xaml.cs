@@ -95,6 +95,7 @@ namespace BoostRegexEngineNs
 					.Where( cb => cb.IsChecked == true )
 					.Select( cb => cb.Tag.ToString( ) )
 				)
+				.Append( BoostRegexInterop.Matcher.GetStackSizePrefix( ) + tbxStackSize.Text.Trim( ) )
 				.ToArray( );
 		}
 
@@ -120,6 +121,10 @@ namespace BoostRegexEngineNs
 				{
 					cb.IsChecked = options.Contains( cb.Tag );
 				}
+
+				string stack_size_prefix = BoostRegexInterop.Matcher.GetStackSizePrefix( );
+				var stack_size = options.FirstOrDefault( o => o.StartsWith( stack_size_prefix ) );
+				tbxStackSize.Text = stack_size == null ? "" : stack_size.Substring( stack_size_prefix.Length );
 			}
 			finally
 			{
@@ -174,5 +179,16 @@ namespace BoostRegexEngineNs
 			Changed?.Invoke( null, new RegexEngineOptionsChangedArgs { PreferImmediateReaction = false } );
 		}
 
+
+		private void tbxStackSize_TextChanged( object sender, TextChangedEventArgs e )
+		{
+			if( !IsFullyLoaded ) return;
+			if( ChangeCounter != 0 ) return;
+
+			CachedOptions = GetSelectedOptions( );
+
+			Changed?.Invoke( null, new RegexEngineOptionsChangedArgs { PreferImmediateReaction = false } );
+		}
+
 	}
 }
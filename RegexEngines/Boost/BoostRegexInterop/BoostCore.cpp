@@ -0,0 +1,424 @@
+#define NOMINMAX
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pch-boost.h"
+#include "boost/regex.hpp"
+
+#include "../../NativeInfrastructure/LiteralAlternation.h"
+#include "../../NativeInfrastructure/LiteralSearch.h"
+#include "../../NativeInfrastructure/StackGuard.h"
+#include "BoostCore.h"
+
+
+using namespace NativeInfrastructure;
+
+
+// The word characters of '\b', by the traits of the regex, like 'm_word_mask' of Boost.Regex.
+struct BoostWordClass
+{
+	const boost::wregex* Regex = nullptr;
+	boost::wregex::traits_type::char_class_type Mask{ };
+};
+
+
+struct BoostCoreRegex
+{
+	boost::wregex Regex;
+	boost::regex_constants::match_flag_type MatchFlags = boost::regex_constants::match_default;
+	long StackSizeMB = 0;
+	std::vector<std::u16string> GroupNames; // (in order of appearance; can repeat)
+	std::unique_ptr<LiteralSearcher> Literal; // (not null -- the matches are found without Boost.Regex; see "LiteralSearch.h")
+	std::unique_ptr<LiteralAlternationSearcher> Alternation; // (same, for the alternations of literals; see "LiteralAlternation.h")
+	int32_t AlternationGroups = 0;
+	BoostWordClass WordClass; // (used by 'Alternation')
+};
+
+
+namespace
+{
+	// The data that is shared with the thread of matching; the thread keeps it alive when the scan is cancelled.
+	struct BoostScanData
+	{
+		std::atomic_bool Stop{ false };
+
+		boost::wregex Regex; // (copy; the compiled pattern is shared by reference counting)
+		boost::regex_constants::match_flag_type MatchFlags = boost::regex_constants::match_default;
+		std::wstring Text; // (one 'wchar_t' for each UTF-16 unit, therefore the positions are the same)
+		std::vector<std::wstring> GroupNames;
+		std::vector<int32_t> NameIds; // (the index of each of 'GroupNames' in the results)
+
+		RegexCoreResultsBuilder Builder;
+		char ErrorText[256] = "";
+		bool LimitReached = false; // (the error is 'error_complexity' or 'error_stack')
+	};
+
+
+	// Finds the names like the regular expression "\(\? ((?'a'')|<) (?'n'.*?) (?(a)'|>)", which was used
+	// in the managed code: "(?<name>" or "(?'name'", where the name does not contain line breaks.
+	std::vector<std::u16string> FindGroupNames( const char16_t* pattern, size_t length )
+	{
+		std::vector<std::u16string> names;
+
+		for( size_t i = 0; i + 2 < length; )
+		{
+			if( pattern[i] != u'(' || pattern[i + 1] != u'?' || ( pattern[i + 2] != u'<' && pattern[i + 2] != u'\'' ) )
+			{
+				++i;
+
+				continue;
+			}
+
+			char16_t const close = pattern[i + 2] == u'<' ? u'>' : u'\'';
+			size_t j = i + 3;
+
+			while( j < length && pattern[j] != close && pattern[j] != u'\n' ) ++j;
+
+			if( j < length && pattern[j] == close )
+			{
+				names.emplace_back( pattern + i + 3, j - ( i + 3 ) );
+				i = j + 1;
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		return names;
+	}
+
+
+	void FindMatches( BoostScanData* data )
+	{
+		const wchar_t* native_text = data->Text.c_str( );
+
+		boost::wcregex_iterator results_begin( native_text, native_text + data->Text.length( ), data->Regex, data->MatchFlags );
+		boost::wcregex_iterator results_end{};
+
+		std::vector<int32_t> group_names;
+
+		for( auto i = results_begin; i != results_end; ++i )
+		{
+			if( data->Stop ) return;
+
+			const boost::wcmatch& match = *i;
+			ptrdiff_t match_index = match.position( );
+
+			// the names of groups in this match (the later names take precedence)
+
+			group_names.assign( match.size( ), -1 );
+
+			for( size_t k = 0; k < data->GroupNames.size( ); ++k )
+			{
+				const std::wstring& name = data->GroupNames[k];
+				int n = match.named_subexpression_index( name.c_str( ), name.c_str( ) + name.length( ) );
+
+				if( n >= 0 && static_cast<size_t>( n ) < group_names.size( ) ) group_names[n] = data->NameIds[k];
+			}
+
+			data->Builder.BeginMatch( static_cast<int32_t>( match.size( ) ) );
+
+			for( size_t j = 0; j < match.size( ); ++j )
+			{
+				const boost::wcsub_match& submatch = match[j];
+
+				if( !submatch.matched )
+				{
+					data->Builder.AddFailedGroup( group_names[j] );
+
+					continue;
+				}
+
+				data->Builder.AddGroup( match.position( j ), submatch.length( ), group_names[j] );
+
+				for( const boost::wcsub_match& c : submatch.captures( ) )
+				{
+					if( !c.matched ) continue;
+
+					ptrdiff_t index = c.first - native_text;
+
+					// WORKAROUND for an apparent problem of Boost Regex: the collection includes captures from other groups
+					if( index < match_index ) continue;
+
+					data->Builder.AddCapture( index, c.length( ) );
+				}
+			}
+		}
+	}
+
+
+	void FindMatchesProc( void* p )
+	{
+		std::unique_ptr<std::shared_ptr<BoostScanData>> holder( static_cast<std::shared_ptr<BoostScanData>*>( p ) );
+		BoostScanData* data = holder->get( );
+
+		try
+		{
+			FindMatches( data );
+		}
+		catch( const boost::regex_error& exc )
+		{
+			// (the limits of Boost.Regex: 'BOOST_REGEX_MAX_STATE_COUNT' and the size of the backtracking stack)
+			data->LimitReached = exc.code( ) == boost::regex_constants::error_complexity || exc.code( ) == boost::regex_constants::error_stack;
+			snprintf( data->ErrorText, sizeof( data->ErrorText ), "%s", exc.what( ) );
+		}
+		catch( const std::exception& exc )
+		{
+			snprintf( data->ErrorText, sizeof( data->ErrorText ), "%s", exc.what( ) );
+		}
+		catch( ... )
+		{
+			snprintf( data->ErrorText, sizeof( data->ErrorText ), "%s", "Unknown error." );
+		}
+
+		// (in case of stack overflow and other faults, 'holder' is not released; see "StackGuard.h")
+	}
+
+
+	// Returns the searcher if the literal search finds the same matches as Boost.Regex, otherwise null.
+	std::unique_ptr<LiteralSearcher> MakeLiteralSearcher( const char16_t* pattern, size_t length, const BoostCoreOptions* options )
+	{
+		namespace rc = boost::regex_constants;
+		typedef boost::regbase rb;
+
+		// the case-insensitive matching depends on the locale; 'mod_x' (perl syntax) and 'newline_alt' change
+		// the meaning of the spaces and line breaks; the match flags other than these do not affect a literal
+
+		uint32_t const syntax_flags = options->SyntaxFlags;
+		bool const perl_syntax = ( syntax_flags & rb::basic_syntax_group ) == 0;
+
+		if( ( syntax_flags & ( rb::icase | rb::newline_alt ) ) != 0 || ( perl_syntax && ( syntax_flags & rb::mod_x ) != 0 ) ) return nullptr;
+
+		uint32_t const neutral_match_flags = rc::match_not_dot_newline | rc::match_not_dot_null | rc::match_perl | rc::match_posix |
+			rc::match_nosubs | rc::match_single_line;
+
+		if( ( options->MatchFlags & ~neutral_match_flags ) != 0 ) return nullptr;
+
+		bool const literal = ( syntax_flags & rb::literal ) != 0 ? length > 0 : IsLiteralPattern( pattern, length );
+		if( !literal ) return nullptr;
+
+		return std::unique_ptr<LiteralSearcher>( new LiteralSearcher( pattern, length, false ) );
+	}
+
+
+	bool IsBoostWordCharacter( const void* context, char16_t c )
+	{
+		const BoostWordClass* word_class = static_cast<const BoostWordClass*>( context );
+
+		return word_class->Regex->get_traits( ).isctype( static_cast<wchar_t>( c ), word_class->Mask );
+	}
+
+
+	// Returns the searcher if the alternation of literals finds the same matches as Boost.Regex, otherwise null;
+	// 'groups' receives the number of groups of the matches.
+	std::unique_ptr<LiteralAlternationSearcher> MakeAlternationSearcher( const char16_t* pattern, size_t length, const BoostCoreOptions* options,
+		const boost::wregex& regex, BoostWordClass* wordClass, int32_t* groups )
+	{
+		namespace rc = boost::regex_constants;
+		typedef boost::regbase rb;
+
+		// (the perl syntax only; the options below do not affect the words and the groups)
+		uint32_t const neutral_syntax_flags = rb::nosubs | rb::collate | rb::no_except | rb::no_mod_m | rb::no_mod_s | rb::mod_s |
+			rb::save_subexpression_location | rb::no_empty_expressions | rb::no_bk_refs;
+
+		if( ( options->SyntaxFlags & ~neutral_syntax_flags ) != 0 ) return nullptr;
+
+		// (with 'match_posix', the longest alternative is taken)
+		uint32_t const neutral_match_flags = rc::match_not_dot_newline | rc::match_not_dot_null | rc::match_perl | rc::match_posix |
+			rc::match_single_line;
+
+		if( ( options->MatchFlags & ~neutral_match_flags ) != 0 ) return nullptr;
+
+		LiteralAlternation alternation;
+		if( !ParseLiteralAlternation( pattern, length, &alternation ) ) return nullptr;
+
+		wchar_t const w = L'w';
+
+		wordClass->Regex = &regex;
+		wordClass->Mask = regex.get_traits( ).lookup_classname( &w, &w + 1 );
+
+		*groups = alternation.CapturingGroup && ( options->SyntaxFlags & rb::nosubs ) == 0 ? 2 : 1;
+
+		LiteralAlternationSearcher::Priority const priority = ( options->MatchFlags & rc::match_posix ) != 0 ?
+			LiteralAlternationSearcher::Priority::Longest : LiteralAlternationSearcher::Priority::First;
+
+		return LiteralAlternationSearcher::Create( alternation, priority, &IsBoostWordCharacter, wordClass );
+	}
+}
+
+
+extern "C" BoostCoreRegex* BoostCoreCompile( const char16_t* pattern, size_t length, const BoostCoreOptions* options, RegexCoreError* error )
+{
+	try
+	{
+		std::unique_ptr<BoostCoreRegex> regex( new BoostCoreRegex );
+
+		regex->MatchFlags = static_cast<boost::regex_constants::match_flag_type>( options->MatchFlags );
+		regex->StackSizeMB = options->StackSizeMB;
+
+		if( GuardedStackSizeFromMegabytes( regex->StackSizeMB ) == 0 )
+		{
+			SetRegexCoreError( error, "Invalid stack size." );
+
+			return nullptr;
+		}
+
+		regex->Regex.assign( std::wstring( pattern, pattern + length ), static_cast<boost::regex_constants::syntax_option_type>( options->SyntaxFlags ) );
+		regex->GroupNames = FindGroupNames( pattern, length );
+
+#ifndef REGEX_CORE_NO_LITERAL_SEARCH
+		if( IsLiteralSearchEnabled( ) )
+		{
+			regex->Literal = MakeLiteralSearcher( pattern, length, options );
+
+			if( regex->Literal == nullptr ) regex->Alternation = MakeAlternationSearcher( pattern, length, options, regex->Regex, &regex->WordClass,
+				&regex->AlternationGroups );
+		}
+#endif
+
+		return regex.release( );
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return nullptr;
+	}
+}
+
+
+extern "C" int32_t BoostCoreScan( const BoostCoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+	RegexCoreResults* results, RegexCoreError* error )
+{
+	*results = RegexCoreResults{ };
+
+	try
+	{
+		if( regex->Literal != nullptr )
+		{
+			RegexCoreResultsBuilder builder;
+
+			// (the names that were found in the literal are listed, like in the results of the engine)
+			for( const std::u16string& name : regex->GroupNames ) builder.AddName( name.data( ), name.size( ) );
+
+			int32_t const rc = regex->Literal->FindAll( text, length, cancellation, &builder );
+
+			if( rc == REGEX_CORE_OK ) builder.Release( results );
+
+			return rc;
+		}
+
+		if( regex->Alternation != nullptr )
+		{
+			RegexCoreResultsBuilder builder;
+
+			int32_t const rc = regex->Alternation->FindAll( text, length, regex->AlternationGroups, cancellation, &builder );
+
+			if( rc == REGEX_CORE_OK ) builder.Release( results );
+
+			return rc;
+		}
+
+		std::shared_ptr<BoostScanData> data = std::make_shared<BoostScanData>( );
+
+		data->Regex = regex->Regex;
+		data->MatchFlags = regex->MatchFlags;
+		data->Text.assign( text, text + length );
+
+		for( const std::u16string& name : regex->GroupNames )
+		{
+			data->GroupNames.emplace_back( name.begin( ), name.end( ) );
+			data->NameIds.push_back( data->Builder.AddName( name.data( ), name.size( ) ) );
+		}
+
+		GuardedThread thread;
+
+		std::unique_ptr<std::shared_ptr<BoostScanData>> holder( new std::shared_ptr<BoostScanData>( data ) );
+
+		if( !thread.Start( GuardedStackSizeFromMegabytes( regex->StackSizeMB ), &FindMatchesProc, holder.get( ) ) )
+		{
+			SetRegexCoreError( error, thread.GetErrorText( ) );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		holder.release( ); // (owned by the thread)
+
+		while( !thread.Wait( 33 ) )
+		{
+			if( cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context ) )
+			{
+				// (the library cannot be interrupted: the abandoned thread stops at the next match; such threads
+				// are limited by 'MaxAbandonedGuardedThreads', see "StackGuard.h")
+				data->Stop = true;
+
+				return REGEX_CORE_CANCELLED;
+			}
+		}
+
+		switch( thread.GetResult( ) )
+		{
+		case GuardedRunResult::Completed:
+			break;
+		case GuardedRunResult::StackOverflow:
+		{
+			std::string message = thread.GetErrorText( );
+			message += "\r\n(Consider increasing the stack size.)";
+
+			SetRegexCoreError( error, message.c_str( ) );
+
+			return REGEX_CORE_ERROR;
+		}
+		default:
+			SetRegexCoreError( error, thread.GetErrorText( ) );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		if( data->ErrorText[0] != '\0' )
+		{
+			SetRegexCoreError( error, data->ErrorText );
+
+			return data->LimitReached ? REGEX_CORE_LIMIT : REGEX_CORE_ERROR;
+		}
+
+		data->Builder.Release( results );
+
+		return REGEX_CORE_OK;
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return REGEX_CORE_ERROR;
+	}
+}
+
+
+extern "C" void BoostCoreFree( BoostCoreRegex* regex )
+{
+	delete regex;
+}
+
+
+extern "C" size_t BoostCoreGetSize( const BoostCoreRegex* regex )
+{
+	const auto& data = regex->Regex.get_data( );
+
+	// ('raw_storage::capacity' is not 'const', but does not change the buffer)
+	size_t size = sizeof( BoostCoreRegex ) + sizeof( data ) + const_cast<boost::BOOST_REGEX_DETAIL_NS::raw_storage&>( data.m_data ).capacity( ) +
+		data.m_subs.capacity( ) * sizeof( data.m_subs[0] );
+
+	for( const std::u16string& name : regex->GroupNames ) size += name.capacity( ) * sizeof( char16_t );
+
+	if( regex->Literal ) size += sizeof( LiteralSearcher );
+	if( regex->Alternation ) size += regex->Alternation->GetSize( );
+
+	return size;
+}
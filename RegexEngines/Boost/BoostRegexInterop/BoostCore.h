@@ -0,0 +1,43 @@
+#pragma once
+
+// The portable core of Boost.Regex interop (see "RegexCore.h").
+//
+// The matches are collected on a separate thread that has 'StackSizeMB' megabytes of stack (0 -- default),
+// so that the deep recursion of the engine cannot crash the process. If the scan is cancelled,
+// the thread is abandoned; it stops after the current match. The scan returns 'REGEX_CORE_LIMIT'
+// if the engine gives up because of its own limits ('error_complexity', 'error_stack').
+
+#include "../../NativeInfrastructure/RegexCore.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	typedef struct BoostCoreOptions
+	{
+		uint32_t SyntaxFlags; // ('boost::regex_constants::syntax_option_type')
+		uint32_t MatchFlags; // ('boost::regex_constants::match_flag_type')
+		int32_t StackSizeMB;
+	} BoostCoreOptions;
+
+
+	typedef struct BoostCoreRegex BoostCoreRegex;
+
+
+	// The names of groups are taken from the pattern ("(?<name>...)" and "(?'name'...)"), since
+	// Boost.Regex does not enumerate them; they are resolved in each match.
+	BoostCoreRegex* BoostCoreCompile( const char16_t* pattern, size_t length, const BoostCoreOptions* options, RegexCoreError* error );
+
+	int32_t BoostCoreScan( const BoostCoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+		RegexCoreResults* results, RegexCoreError* error );
+
+	void BoostCoreFree( BoostCoreRegex* regex );
+
+	// The buffer of the state machine of Boost.Regex (which also holds the pattern) and the accelerators, in bytes.
+	size_t BoostCoreGetSize( const BoostCoreRegex* regex );
+
+#ifdef __cplusplus
+}
+#endif
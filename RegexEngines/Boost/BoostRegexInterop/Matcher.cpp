@@ -1,45 +1,69 @@
 #include "pch.h"
 
+#include "BoostCore.h"
+#include "../../NativeInfrastructure/CompiledPatternCache.h"
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/RegexCoreMatches.h"
 #include "Matcher.h"
 
 
 using namespace System::Diagnostics;
-using namespace System::Text::RegularExpressions;
-using namespace System::Collections::Specialized;
 
 
 using namespace boost;
-using namespace msclr::interop;
+using namespace NativeInfrastructure;
 
 
 namespace BoostRegexInterop
 {
 
+	// (called by the cache of compiled patterns)
+	static void FreeRegex( void* regex )
+	{
+		BoostCoreFree( static_cast<BoostCoreRegex*>( regex ) );
+	}
+
+
 	static Matcher::Matcher( )
 	{
-		mRegexGroupNames = gcnew Regex(
-			//R"REGEX( \(\? ((?'a'')|<) (?'n'\p{L}\w*?) (?(a)'|>) )REGEX",
-			R"REGEX( \(\? ((?'a'')|<) (?'n'.*?) (?(a)'|>) )REGEX",
-			RegexOptions::Compiled | RegexOptions::ExplicitCapture | RegexOptions::IgnorePatternWhitespace
-		);
+		StackSizePrefix = "stack:";
 
 		BuildOptions( );
 	}
 
 
 	Matcher::Matcher( String^ pattern0, cli::array<String^>^ options )
-		: mData( nullptr )
+		: mRegex( nullptr )
 	{
 		try
 		{
-			marshal_context context{};
+			TraceSpan options_span( "boost", "options" );
+
 			wregex::flag_type regex_flags{};
 			regex_constants::match_flag_type match_flags = regex_constants::match_flag_type::match_default;
 
-			std::wstring pattern = context.marshal_as<std::wstring>( pattern0 );
+			long stack_size = 0; // (default)
 
 			for each( String ^ o in options )
 			{
+				if( o->StartsWith( StackSizePrefix ) )
+				{
+					String^ stack_size_s = o->Substring( StackSizePrefix->Length );
+
+					if( !String::IsNullOrWhiteSpace( stack_size_s ) )
+					{
+						int v;
+						if( !Int32::TryParse( stack_size_s, v ) || v < 0 || v > 1024 )
+						{
+							throw gcnew Exception( String::Format( "Invalid stack size: '{0}'. Enter the number of megabytes between 1 and 1024, or 0 for default", stack_size_s ) );
+						}
+
+						stack_size = v;
+					}
+
+					continue;
+				}
+
 #define C(n) \
 	if( o == L#n ) regex_flags |= regex_constants::##n; \
 	else
@@ -108,30 +132,36 @@ namespace BoostRegexInterop
 #undef C
 			}
 
-			mData = new MatcherData{};
-			mData->mMatchFlags = match_flags;
+			BoostCoreOptions core_options{};
+
+			core_options.SyntaxFlags = static_cast<uint32_t>( regex_flags );
+			core_options.MatchFlags = static_cast<uint32_t>( match_flags );
+			core_options.StackSizeMB = stack_size;
 
-			mData->mRegex.assign( std::move( pattern ), regex_flags );
+			options_span.End( );
 
-			//?auto nsubs = mData->mRegex.get_named_subs( );
+			// (the names of groups are found in the pattern by the core)
 
-			// try identifying group names
+			pin_ptr<const wchar_t> pinned_pattern = PtrToStringChars( pattern0 );
+			const char16_t* native_pattern = reinterpret_cast<const char16_t*>( pinned_pattern );
+			std::string const cache_key = MakeCompiledPatternKey( "boost", &core_options, sizeof( core_options ), native_pattern, pattern0->Length );
 
-			mGroupNames = nullptr;
+			mRegex = static_cast<BoostCoreRegex*>( AcquireCompiledPattern( cache_key ) );
 
-			auto matches = mRegexGroupNames->Matches( pattern0 );
-			if( matches->Count > 0 )
+			if( mRegex == nullptr )
 			{
-				mGroupNames = gcnew StringCollection;
+				RegexCoreError error{};
 
-				for( int i = 0; i < matches->Count; ++i )
+				TraceSpan compile_span( "boost", "compile", pattern0->Length );
+				mRegex = BoostCoreCompile( native_pattern, pattern0->Length, &core_options, &error );
+				compile_span.End( );
+
+				if( mRegex == nullptr )
 				{
-					auto n = matches[i]->Groups["n"];
-					if( n->Success )
-					{
-						mGroupNames->Add( n->Value );
-					}
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
 				}
+
+				AddCompiledPattern( cache_key, mRegex, BoostCoreGetSize( mRegex ), &FreeRegex );
 			}
 		}
 		catch( const regex_error & exc )
@@ -166,8 +196,8 @@ namespace BoostRegexInterop
 
 	Matcher::!Matcher( )
 	{
-		delete mData;
-		mData = nullptr;
+		ReleaseCompiledPattern( mRegex ); // (the pattern can remain in the cache)
+		mRegex = nullptr;
 	}
 
 
@@ -192,44 +222,33 @@ namespace BoostRegexInterop
 	{
 		try
 		{
-			marshal_context mc{};
-
-			mData->mText = mc.marshal_as<std::wstring>( text0 );
+			mText = text0;
 
-			auto matches = gcnew List<IMatch^>( );
+			pin_ptr<const wchar_t> pinned_text = PtrToStringChars( text0 );
+			RegexCoreManagedCancellation cancellation( cnc );
+			RegexCoreResults results{};
+			RegexCoreError error{};
 
-			auto* native_text = mData->mText.c_str( );
+			TraceSpan scan_span( "boost", "scan", text0->Length );
+			int32_t r = BoostCoreScan( mRegex, reinterpret_cast<const char16_t*>( pinned_text ), text0->Length, cancellation.Get( ), &results, &error );
+			scan_span.End( );
 
-			wcregex_iterator results_begin( native_text, native_text + mData->mText.length( ), mData->mRegex, mData->mMatchFlags );
-			wcregex_iterator results_end{};
-
-			for( auto i = results_begin; i != results_end; ++i )
+			try
 			{
-				const wcmatch& match = *i;
-
-				Dictionary<int, String^>^ names = nullptr;
-
-				if( GroupNames )
+				switch( r )
 				{
-					names = gcnew Dictionary<int, String^>( GroupNames->Count ); // (or use array?)
-
-					for each( auto name0 in GroupNames )
-					{
-						const wchar_t* name = mc.marshal_as<const wchar_t*>( name0 );
-
-						int i = match.named_subexpression_index( name, name + wcslen( name ) );
-						if( i >= 0 )
-						{
-							names[i] = name0;
-						}
-					}
+				case REGEX_CORE_OK:
+					return RegexCoreResultsToMatches( results, this, 0, "boost" );
+				case REGEX_CORE_CANCELLED:
+					return RegexMatches::Empty;
+				default:
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
 				}
-
-				auto m = CreateMatch( match, names );
-				matches->Add( m );
 			}
-
-			return gcnew RegexMatches( matches->Count, matches );
+			finally
+			{
+				RegexCoreFreeResults( &results );
+			}
 		}
 		catch( const regex_error & exc )
 		{
@@ -257,48 +276,7 @@ namespace BoostRegexInterop
 
 	String^ Matcher::GetText( int index, int length )
 	{
-		return gcnew String( mData->mText.c_str( ), index, length );
-	}
-
-
-	IMatch^ Matcher::CreateMatch( const wcmatch& match, Dictionary<int, String^>^ names )
-	{
-		auto m = SimpleMatch::Create( CheckedCast::ToInt32( match.position( ) ), CheckedCast::ToInt32( match.length( ) ), this );
-
-		int j = 0;
-
-		for( auto i = match.begin( ); i != match.end( ); ++i, ++j )
-		{
-			const boost::wcsub_match& submatch = *i;
-
-			String^ name = nullptr;
-			if( !names || !names->TryGetValue( j, name ) ) name = j.ToString( System::Globalization::CultureInfo::InvariantCulture );
-
-			if( !submatch.matched )
-			{
-				m->AddGroup( 0, 0, false, name );
-			}
-			else
-			{
-				auto submatch_index = match.position( j );
-
-				auto group = m->AddGroup( CheckedCast::ToInt32( submatch_index ), CheckedCast::ToInt32( submatch.length( ) ), true, name );
-
-				for( const boost::wcsub_match& c : submatch.captures( ) )
-				{
-					if( !c.matched ) continue;
-
-					auto index = c.first - mData->mText.c_str( );
-
-					// WORKAROUND for an apparent problem of Boost Regex: the collection includes captures from other groups
-					if( index < m->Index ) continue;
-
-					group->AddCapture( CheckedCast::ToInt32( index ), CheckedCast::ToInt32( c.length( ) ) );
-				}
-			}
-		}
-
-		return m;
+		return mText->Substring( index, length );
 	}
 
 
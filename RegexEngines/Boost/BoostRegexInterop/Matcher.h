@@ -28,14 +28,6 @@ namespace BoostRegexInterop
 	};
 
 
-	struct MatcherData
-	{
-		std::wstring mText;
-		boost::wregex mRegex;
-		boost::regex_constants::match_flag_type mMatchFlags;
-	};
-
-
 	public ref class Matcher : IMatcher, ISimpleTextGetter
 	{
 	public:
@@ -52,6 +44,7 @@ namespace BoostRegexInterop
 
 		static List<OptionInfo^>^ GetCompileOptions( ) { return mCompileOptions; }
 		static List<OptionInfo^>^ GetMatchOptions( ) { return mMatchOptions; }
+		static String^ GetStackSizePrefix( ) { return StackSizePrefix; }
 
 #pragma region IMatcher
 
@@ -65,26 +58,15 @@ namespace BoostRegexInterop
 
 #pragma endregion
 
-	internal:
-
-		property System::Collections::Specialized::StringCollection^ GroupNames
-		{
-			System::Collections::Specialized::StringCollection^ get( )
-			{
-				return mGroupNames;
-			}
-		}
-
 	private:
 
-		MatcherData* mData;
-		System::Collections::Specialized::StringCollection^ mGroupNames;
+		BoostCoreRegex* mRegex;
+		String^ mText;
 
 		static List<OptionInfo^>^ mCompileOptions;
 		static List<OptionInfo^>^ mMatchOptions;
-		static System::Text::RegularExpressions::Regex^ mRegexGroupNames;
+		static String^ StackSizePrefix;
 
-		IMatch^ CreateMatch( const boost::wcmatch& match, Dictionary<int, String^>^ names );
 		static void BuildOptions( );
 	};
 
@@ -71,6 +71,28 @@ void BinaryReader::ReadBytes( void* buffer0, size_t size ) const
 }
 
 
+bool BinaryReader::TryReadBytes( void* buffer0, size_t size ) const
+{
+	if( size == 0 ) return true;
+
+	char* dest = (char*)buffer0;
+	DWORD n;
+
+	if( !ReadFile( mHandle, dest, 1, &n, NULL ) )
+	{
+		if( GetLastError( ) == ERROR_BROKEN_PIPE ) return false; // (the pipe was closed)
+
+		throw L"Failed to read bytes (1)";
+	}
+
+	if( n == 0 ) return false;
+
+	ReadBytes( dest + 1, size - 1 );
+
+	return true;
+}
+
+
 int BinaryReader::Read7BitEncodedInt( ) const
 {
 	// From the sources of .NET: https://referencesource.microsoft.com/#mscorlib/system/io/binaryreader.cs,f30b8b6e8ca06e0f
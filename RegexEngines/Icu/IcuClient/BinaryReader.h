@@ -23,6 +23,9 @@ public:
 
 	void ReadBytes( void* buffer, size_t size ) const;
 
+	// Returns false if the end of input was reached before the first byte.
+	bool TryReadBytes( void* buffer, size_t size ) const;
+
 private:
 
 	HANDLE const mHandle;
@@ -20,6 +20,40 @@ void BinaryWriter::Write( LPCWSTR s, int charlen )
 
 
 void BinaryWriter::WriteBytes( const void* buffer0, DWORD size )
+{
+	const char* buffer = (const char*)buffer0;
+
+	if( mBuffer.size( ) + size <= BufferSize )
+	{
+		mBuffer.insert( mBuffer.end( ), buffer, buffer + size );
+
+		return;
+	}
+
+	Flush( );
+
+	if( size < BufferSize )
+	{
+		mBuffer.insert( mBuffer.end( ), buffer, buffer + size );
+	}
+	else
+	{
+		WriteToHandle( buffer, size ); // (large blocks are not copied)
+	}
+}
+
+
+void BinaryWriter::Flush( )
+{
+	if( mBuffer.empty( ) ) return;
+
+	WriteToHandle( mBuffer.data( ), (DWORD)mBuffer.size( ) );
+
+	mBuffer.clear( );
+}
+
+
+void BinaryWriter::WriteToHandle( const void* buffer0, DWORD size )
 {
 	const char* buffer = (const char*)buffer0;
 	DWORD to_write = size;
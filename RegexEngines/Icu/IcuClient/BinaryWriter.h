@@ -3,6 +3,7 @@
 
 /// <summary>
 /// A writer that is designed to be partially compatible with 'BinaryWriter' class from .NET, using Unicode encoding.
+/// The data are collected in a buffer, which is written by 'Flush' or when it is full.
 /// </summary>
 class BinaryWriter final
 {
@@ -11,13 +12,28 @@ public:
 	BinaryWriter( HANDLE h )
 		: mHandle( h )
 	{
+		mBuffer.reserve( BufferSize );
+	}
+
 
+	~BinaryWriter( )
+	{
+		try
+		{
+			Flush( );
+		}
+		catch( ... )
+		{
+			// (cannot report)
+		}
 	}
 
 
 	void Write( unsigned __int8 b )
 	{
-		WriteBytes( &b, sizeof( b ) );
+		if( mBuffer.size( ) >= BufferSize ) Flush( );
+
+		mBuffer.push_back( (char)b );
 	}
 
 
@@ -32,10 +48,16 @@ public:
 
 	void WriteBytes( const void* buffer0, DWORD size );
 
+	void Flush( );
+
 
 private:
 
+	static const DWORD BufferSize = 64 * 1024;
+
 	HANDLE const mHandle;
+	std::vector<char> mBuffer;
 
 	void Write7BitEncodedInt( int value );
+	void WriteToHandle( const void* buffer0, DWORD size );
 };
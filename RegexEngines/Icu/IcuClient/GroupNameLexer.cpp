@@ -0,0 +1,127 @@
+#include "GroupNameLexer.h"
+
+
+static bool IsLineEnd( char16_t c )
+{
+	return c == u'\n' || c == u'\r' || c == u'\u0085' || c == u'\u2028' || c == u'\u2029';
+}
+
+
+std::vector<GroupNameSpan> FindGroupNames( const char16_t* pattern, size_t length, bool comments )
+{
+	std::vector<GroupNameSpan> names;
+	size_t i = 0;
+
+	while( i < length )
+	{
+		char16_t c = pattern[i];
+
+		switch( c )
+		{
+		case u'\\':
+			if( i + 1 < length && pattern[i + 1] == u'Q' )
+			{
+				// quoted until '\E' or the end
+				i += 2;
+				while( i < length && !( pattern[i] == u'\\' && i + 1 < length && pattern[i + 1] == u'E' ) ) ++i;
+			}
+			i += 2;
+			break;
+
+		case u'[':
+		{
+			// character class; the sets can be nested; ']' is literal at the beginning
+			int depth = 0;
+
+			do
+			{
+				if( pattern[i] == u'\\' )
+				{
+					i += 2;
+
+					continue;
+				}
+
+				if( pattern[i] == u'[' )
+				{
+					++depth;
+					++i;
+
+					if( i < length && pattern[i] == u'^' ) ++i;
+					if( i < length && pattern[i] == u']' ) ++i;
+
+					continue;
+				}
+
+				if( pattern[i] == u']' ) --depth;
+
+				++i;
+			} while( depth > 0 && i < length );
+		}
+		break;
+
+		case u'#':
+			if( comments )
+			{
+				while( i < length && !IsLineEnd( pattern[i] ) ) ++i;
+			}
+			else
+			{
+				++i;
+			}
+			break;
+
+		case u'(':
+			++i;
+
+			if( i >= length || pattern[i] != u'?' ) break;
+
+			++i;
+
+			if( i >= length ) break;
+
+			if( pattern[i] == u'#' )
+			{
+				// '(?#...)'
+				while( i < length && pattern[i] != u')' ) ++i;
+				++i;
+			}
+			else if( pattern[i] == u'<' )
+			{
+				++i;
+
+				if( i < length && pattern[i] != u'=' && pattern[i] != u'!' )
+				{
+					size_t start = i;
+
+					while( i < length && pattern[i] != u'>' ) ++i;
+
+					if( i < length ) names.push_back( GroupNameSpan{ start, i - start } );
+
+					++i;
+				}
+			}
+			else
+			{
+				// inline flags, '(?ix-s)' or '(?ix-s:'
+				bool on = true;
+				size_t j = i;
+
+				while( j < length && ( ( pattern[j] >= u'a' && pattern[j] <= u'z' ) || pattern[j] == u'-' ) )
+				{
+					if( pattern[j] == u'-' ) on = false;
+					else if( pattern[j] == u'x' ) comments = on;
+					++j;
+				}
+
+				i = j;
+			}
+			break;
+
+		default:
+			++i;
+		}
+	}
+
+	return names;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// Finds the names of groups, '(?<name>...)', in ICU patterns in one pass, skipping the
+// escapes ('\x', '\Q...\E'), character classes (also nested), '(?#...)' comments, and,
+// in 'UREGEX_COMMENTS' mode (also turned on and off by inline '(?x)', '(?-x)'), the '#...' comments.
+//
+// (The names are not validated; the compiled pattern is asked for the group numbers).
+
+#include <cstddef>
+#include <vector>
+
+
+struct GroupNameSpan
+{
+	size_t Start; // (offset of the name in the pattern)
+	size_t Length;
+};
+
+
+std::vector<GroupNameSpan> FindGroupNames( const char16_t* pattern, size_t length, bool comments );
@@ -8,20 +8,50 @@
 #include "BinaryReader.h"
 #include "BinaryWriter.h"
 #include "StreamWriter.h"
+#include "IcuServer.h"
 
 
-static void Check( UErrorCode status )
+/// <summary>
+/// Frames of the server mode over the standard handles.
+/// </summary>
+class HandleFrameStream final : public FrameStream
 {
-	if( U_FAILURE( status ) )
+public:
+
+	HandleFrameStream( const BinaryReader& reader, BinaryWriter& writer )
+		: mReader( reader ), mWriter( writer )
 	{
-		LPCSTR error_name = u_errorName( status );
-		wchar_t buffer[256];
 
-		StringCbPrintfW( buffer, sizeof( buffer ), L"Error %hs (%u)", error_name, (unsigned)status );
+	}
+
+
+	bool ReadFrame( std::vector<char>* payload ) override
+	{
+		__int32 length;
 
-		throw buffer;
+		if( !mReader.TryReadBytes( &length, sizeof( length ) ) ) return false;
+
+		if( length < 0 ) throw L"Invalid frame length";
+
+		payload->resize( length );
+		mReader.ReadBytes( payload->data( ), length );
+
+		return true;
 	}
-}
+
+
+	void WriteFrame( const char* payload, size_t size ) override
+	{
+		mWriter.Write( (__int32)size );
+		mWriter.WriteBytes( payload, (DWORD)size );
+		mWriter.Flush( );
+	}
+
+private:
+
+	const BinaryReader& mReader;
+	BinaryWriter& mWriter;
+};
 
 
 int APIENTRY wWinMain( _In_ HINSTANCE hInstance,
@@ -73,6 +103,7 @@ int APIENTRY wWinMain( _In_ HINSTANCE hInstance,
 			auto v = L"" U_ICU_VERSION;
 
 			outbw.Write( v );
+			outbw.Flush( );
 
 			return 0;
 		}
@@ -86,115 +117,45 @@ int APIENTRY wWinMain( _In_ HINSTANCE hInstance,
 			__int32 remote_flags = inbr.ReadInt32( );
 			__int32 limit = inbr.ReadInt32( );
 
-			uint32_t flags = 0;
-			if( remote_flags & ( 1 << 0 ) ) flags |= UREGEX_CANON_EQ;
-			if( remote_flags & ( 1 << 1 ) ) flags |= UREGEX_CASE_INSENSITIVE;
-			if( remote_flags & ( 1 << 2 ) ) flags |= UREGEX_COMMENTS;
-			if( remote_flags & ( 1 << 3 ) ) flags |= UREGEX_DOTALL;
-			if( remote_flags & ( 1 << 4 ) ) flags |= UREGEX_LITERAL;
-			if( remote_flags & ( 1 << 5 ) ) flags |= UREGEX_MULTILINE;
-			if( remote_flags & ( 1 << 6 ) ) flags |= UREGEX_UNIX_LINES;
-			if( remote_flags & ( 1 << 7 ) ) flags |= UREGEX_UWORD;
-			if( remote_flags & ( 1 << 8 ) ) flags |= UREGEX_ERROR_ON_UNKNOWN_ESCAPES;
-
-			UErrorCode status = U_ZERO_ERROR;
-			UParseError parse_error{};
-
-			icu::UnicodeString us_pattern( pattern.c_str( ), pattern.length( ) );
-
-			icu::RegexPattern* icu_pattern = icu::RegexPattern::compile( us_pattern, flags, parse_error, status );
+			std::unique_ptr<CompiledPattern> icu_pattern;
 
-			if( U_FAILURE( status ) )
+			try
 			{
-				LPCSTR error_name = u_errorName( status );
-
-				errwr.WriteStringF( L"Invalid pattern at line %i, column %i.\r\n\r\n(%hs, %u)",
-					parse_error.line, parse_error.offset, error_name, (unsigned)status );
-
-				return 9;
+				icu_pattern = CompilePattern( std::u16string( pattern.begin( ), pattern.end( ) ), ToIcuFlags( remote_flags ) );
 			}
-
-			// try identifying named groups; (ICU does not seem to offer such feature)
+			catch( const PatternException& exc )
 			{
-				icu::UnicodeString up( LR"REGEX(\(\?<(?![=!])(?<n>.*?)>)REGEX" );
-				icu::RegexPattern* p = icu::RegexPattern::compile( up, 0, parse_error, status );
-				if( U_FAILURE( status ) ) { errwr.WriteString( L"Internal error" ); return 11; }
-
-				icu::RegexMatcher* m = p->matcher( us_pattern, status );
-				if( U_FAILURE( status ) ) { errwr.WriteString( L"Internal error" ); return 11; }
+				std::wstring m;
+				for( const char* p = exc.what( ); *p != '\0'; ++p ) m.push_back( *p );
 
-				for( ;; )
-				{
-					status = U_ZERO_ERROR;
+				errwr.WriteString( m.c_str( ) );
 
-					if( !m->find( status ) )
-					{
-						if( U_FAILURE( status ) ) { errwr.WriteString( L"Internal error" ); return 11; }
-
-						break;
-					}
-
-					int32_t start = m->start( 1, status );
-					if( U_FAILURE( status ) ) { errwr.WriteString( L"Internal error" ); return 11; }
-
-					int32_t end = m->end( 1, status );
-					if( U_FAILURE( status ) ) { errwr.WriteString( L"Internal error" ); return 11; }
+				return 9;
+			}
 
-					icu::UnicodeString possible_name;
-					us_pattern.extract( start, end - start, possible_name );
-					if( U_FAILURE( status ) ) { errwr.WriteString( L"Internal error" ); return 11; }
+			MatchOptions options;
+			options.TimeLimit = limit;
 
-					__int32 group_number = icu_pattern->groupNumberFromName( possible_name, status );
-					// TODO: detect and show errors
-					if( !U_FAILURE( status ) )
-					{
-						outbw.Write( group_number );
-						outbw.Write( (LPCWSTR)possible_name.getBuffer( ), possible_name.length( ) );
-					}
-				}
+			MemoryWriter out;
 
-				outbw.Write( (__int32)-1 ); // end of names
-			}
+			WriteMatches( out, *icu_pattern, reinterpret_cast<const char16_t*>( text.c_str( ) ), text.length( ), options, [] { return false; } );
 
-			// find matches
+			outbw.WriteBytes( out.Buffer( ).data( ), (DWORD)out.Buffer( ).size( ) );
+			outbw.Flush( );
 
-			icu::UnicodeString us_text( text.c_str( ), text.length( ) );
+			return 0;
+		}
 
-			icu::RegexMatcher* icu_matcher = icu_pattern->matcher( us_text, status );
-			Check( status );
+		//
 
-			icu_matcher->setTimeLimit( limit, status );
-			Check( status );
+		if( command == L"s" )
+		{
+			// server mode; see 'IcuServer'
 
-			for( ;; )
-			{
-				if( !icu_matcher->find( status ) )
-				{
-					Check( status );
-
-					break;
-				}
-
-				int group_count = icu_matcher->groupCount( );
-
-				outbw.Write( group_count );
-
-				for( int i = 0; i <= group_count; ++i )
-				{
-					int32_t start = icu_matcher->start( i, status );
-					Check( status );
-					outbw.Write( start );
-
-					if( start >= 0 )
-					{
-						int32_t end = icu_matcher->end( i, status );
-						Check( status );
-						outbw.Write( end );
-					}
-				}
-			}
+			HandleFrameStream stream( inbr, outbw );
+			IcuServer server( stream );
 
-			outbw.Write( -1 );
+			server.Run( );
 
 			return 0;
 		}
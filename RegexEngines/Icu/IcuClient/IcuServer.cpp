@@ -0,0 +1,986 @@
+#include "IcuServer.h"
+#include "GroupNameLexer.h"
+#include "../../NativeInfrastructure/MappedFile.h"
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/Utf8Text.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <system_error>
+#include <thread>
+
+
+static void Check( UErrorCode status )
+{
+	if( U_FAILURE( status ) )
+	{
+		throw IcuException( std::string( "Error " ) + u_errorName( status ) + " (" + std::to_string( (unsigned)status ) + ")" );
+	}
+}
+
+
+uint32_t ToIcuFlags( int32_t remoteFlags )
+{
+	uint32_t flags = 0;
+	if( remoteFlags & ( 1 << 0 ) ) flags |= UREGEX_CANON_EQ;
+	if( remoteFlags & ( 1 << 1 ) ) flags |= UREGEX_CASE_INSENSITIVE;
+	if( remoteFlags & ( 1 << 2 ) ) flags |= UREGEX_COMMENTS;
+	if( remoteFlags & ( 1 << 3 ) ) flags |= UREGEX_DOTALL;
+	if( remoteFlags & ( 1 << 4 ) ) flags |= UREGEX_LITERAL;
+	if( remoteFlags & ( 1 << 5 ) ) flags |= UREGEX_MULTILINE;
+	if( remoteFlags & ( 1 << 6 ) ) flags |= UREGEX_UNIX_LINES;
+	if( remoteFlags & ( 1 << 7 ) ) flags |= UREGEX_UWORD;
+	if( remoteFlags & ( 1 << 8 ) ) flags |= UREGEX_ERROR_ON_UNKNOWN_ESCAPES;
+
+	return flags;
+}
+
+
+std::unique_ptr<CompiledPattern> CompilePattern( const std::u16string& pattern, uint32_t flags )
+{
+	NativeInfrastructure::TraceSpan span( "icu", "compile", static_cast<int64_t>( pattern.length( ) ) );
+
+	UErrorCode status = U_ZERO_ERROR;
+	UParseError parse_error{};
+
+	icu::UnicodeString us_pattern( pattern.data( ), static_cast<int32_t>( pattern.length( ) ) );
+
+	std::unique_ptr<CompiledPattern> compiled( new CompiledPattern( ) );
+
+	compiled->Pattern.reset( icu::RegexPattern::compile( us_pattern, flags, parse_error, status ) );
+
+	if( U_FAILURE( status ) )
+	{
+		throw PatternException( "Invalid pattern at line " + std::to_string( parse_error.line ) + ", column " + std::to_string( parse_error.offset ) +
+			".\r\n\r\n(" + u_errorName( status ) + ", " + std::to_string( (unsigned)status ) + ")" );
+	}
+
+	// identify named groups; (ICU does not seem to offer such feature)
+
+	for( const GroupNameSpan& span : FindGroupNames( pattern.data( ), pattern.length( ), ( flags & UREGEX_COMMENTS ) != 0 ) )
+	{
+		std::u16string name( pattern, span.Start, span.Length );
+
+		status = U_ZERO_ERROR;
+
+		int32_t group_number = compiled->Pattern->groupNumberFromName( icu::UnicodeString( name.data( ), static_cast<int32_t>( name.length( ) ) ), status );
+		if( U_SUCCESS( status ) ) compiled->GroupNames.push_back( GroupName{ group_number, std::move( name ) } );
+	}
+
+	return compiled;
+}
+
+
+static void WriteGroupNames( MemoryWriter& out, const CompiledPattern& pattern )
+{
+	for( const GroupName& group_name : pattern.GroupNames )
+	{
+		out.Write( group_name.Number );
+		out.Write( group_name.Name );
+	}
+
+	out.Write( (int32_t)-1 ); // end of names
+}
+
+
+// A matcher with its own input (the matchers and UTexts must not be shared between threads).
+struct InputMatcher
+{
+	std::unique_ptr<UText, UText* ( * )( UText* )> Input{ nullptr, &utext_close };
+	std::unique_ptr<icu::RegexMatcher> Matcher;
+};
+
+
+static void ResetMatcher( InputMatcher& m, const icu::RegexPattern& pattern, UText* input, UErrorCode status )
+{
+	m.Input.reset( input );
+	Check( status );
+
+	m.Matcher.reset( pattern.matcher( status ) );
+	Check( status );
+
+	m.Matcher->reset( input );
+}
+
+
+// (the text is not copied; the native indexes are UTF-16 offsets)
+static InputMatcher OpenMatcher( const icu::RegexPattern& pattern, const char16_t* text, size_t length )
+{
+	UErrorCode status = U_ZERO_ERROR;
+	InputMatcher m;
+
+	ResetMatcher( m, pattern, utext_openUChars( nullptr, text, static_cast<int64_t>( length ), &status ), status );
+
+	return m;
+}
+
+
+// (the text is not decoded; the native indexes are byte offsets)
+static InputMatcher OpenMatcher( const icu::RegexPattern& pattern, const char* text, size_t length )
+{
+	UErrorCode status = U_ZERO_ERROR;
+	InputMatcher m;
+
+	ResetMatcher( m, pattern, utext_openUTF8( nullptr, text, static_cast<int64_t>( length ), &status ), status );
+
+	return m;
+}
+
+
+// Stops the search inside 'find' when the request is cancelled or, in parallel search, when another part has failed.
+struct StopCondition
+{
+	const std::function<bool( )>& IsCancelled;
+	const std::atomic<bool>* Stop; // (null in serial search)
+
+	bool IsSet( ) const
+	{
+		return ( Stop != nullptr && Stop->load( std::memory_order_relaxed ) ) || IsCancelled( );
+	}
+};
+
+
+static UBool U_CALLCONV MatchCallback( const void* context, int32_t steps )
+{
+	(void)steps;
+
+	return !static_cast<const StopCondition*>( context )->IsSet( );
+}
+
+
+static UBool U_CALLCONV FindProgressCallback( const void* context, int64_t matchIndex )
+{
+	(void)matchIndex;
+
+	return !static_cast<const StopCondition*>( context )->IsSet( );
+}
+
+
+// Applies the limits and installs the callbacks, which make 'find' fail with 'U_REGEX_STOPPED_BY_CALLER'
+// when the condition is set. (The condition must outlive the search).
+static void ConfigureMatcher( icu::RegexMatcher& icuMatcher, const MatchOptions& options, const StopCondition* stopCondition )
+{
+	UErrorCode status = U_ZERO_ERROR;
+
+	icuMatcher.setTimeLimit( options.TimeLimit, status );
+	Check( status );
+
+	if( options.StackLimit >= 0 )
+	{
+		icuMatcher.setStackLimit( options.StackLimit, status );
+		Check( status );
+	}
+
+	icuMatcher.setMatchCallback( &MatchCallback, stopCondition, status );
+	Check( status );
+
+	icuMatcher.setFindProgressCallback( &FindProgressCallback, stopCondition, status );
+	Check( status );
+}
+
+
+// Gets the native start and end of the match and of each group (-1 for the groups that did not participate).
+static void GetBounds( const icu::RegexMatcher& icuMatcher, int32_t groupCount, int32_t* bounds )
+{
+	UErrorCode status = U_ZERO_ERROR;
+
+	for( int32_t i = 0; i <= groupCount; ++i )
+	{
+		bounds[2 * i] = icuMatcher.start( i, status );
+		Check( status );
+		bounds[2 * i + 1] = icuMatcher.end( i, status );
+		Check( status );
+	}
+}
+
+
+// Writes the matches in the format described at 'WriteMatches'; 'toUtf16' translates the native indexes
+// to UTF-16 offsets. If 'nativeOut' is not null, the native positions of the matches are written to it too.
+// If 'flushBatch' is not empty, it is called when 'out' holds a batch; it must send and clear the output.
+template<typename ToUtf16>
+class MatchEncoder final
+{
+public:
+
+	MatchEncoder( MemoryWriter& out, MemoryWriter* nativeOut, int32_t groupCount, ToUtf16 toUtf16, const std::function<void( )>& flushBatch )
+		: mOut( out ), mNativeOut( nativeOut ), mGroupCount( groupCount ), mToUtf16( toUtf16 ), mFlushBatch( flushBatch ),
+		mBitmap( ( groupCount + 7 ) / 8 ), mPreviousEnd( 0 ), mPreviousNativeEnd( 0 ), mCount( 0 )
+	{
+		mOut.Write7BitEncodedInt( groupCount );
+	}
+
+
+	int32_t Count( ) const { return mCount; }
+
+
+	void Write( const int32_t* bounds )
+	{
+		WriteMatch( bounds );
+
+		++mCount;
+
+		if( mFlushBatch && mOut.Buffer( ).size( ) >= BatchSize ) mFlushBatch( );
+	}
+
+
+	// Sends the written matches before the batch is full.
+	void Flush( )
+	{
+		if( mFlushBatch && mCount > 0 && !mOut.Buffer( ).empty( ) ) mFlushBatch( );
+	}
+
+
+	void Finish( )
+	{
+		mOut.Write7BitEncodedInt( 0 ); // end of matches
+
+		if( mNativeOut != nullptr ) mNativeOut->Write7BitEncodedInt( 0 );
+	}
+
+private:
+
+	static const size_t BatchSize = 64 * 1024;
+
+	MemoryWriter& mOut;
+	MemoryWriter* const mNativeOut;
+	int32_t const mGroupCount;
+	ToUtf16 mToUtf16;
+	const std::function<void( )>& mFlushBatch;
+	std::vector<uint8_t> mBitmap;
+	int32_t mPreviousEnd;
+	int32_t mPreviousNativeEnd;
+	int32_t mCount;
+
+
+	void WriteMatch( const int32_t* bounds )
+	{
+		int32_t start0 = mToUtf16( bounds[0] );
+		int32_t end0 = mToUtf16( bounds[1] );
+
+		// (the matches do not overlap, therefore the distance from the previous one is not negative)
+		mOut.Write7BitEncodedInt( start0 - mPreviousEnd + 1 );
+		mOut.Write7BitEncodedInt( end0 - start0 );
+
+		mPreviousEnd = end0;
+
+		if( mNativeOut != nullptr )
+		{
+			mNativeOut->Write7BitEncodedInt( bounds[0] - mPreviousNativeEnd + 1 );
+			mNativeOut->Write7BitEncodedInt( bounds[1] - bounds[0] );
+
+			mPreviousNativeEnd = bounds[1];
+		}
+
+		if( mGroupCount == 0 ) return;
+
+		std::fill( mBitmap.begin( ), mBitmap.end( ), (uint8_t)0 );
+
+		for( int32_t i = 1; i <= mGroupCount; ++i )
+		{
+			if( bounds[2 * i] >= 0 ) mBitmap[( i - 1 ) / 8] |= (uint8_t)( 1 << ( ( i - 1 ) % 8 ) );
+		}
+
+		mOut.WriteBytes( mBitmap.data( ), mBitmap.size( ) );
+
+		for( int32_t i = 1; i <= mGroupCount; ++i )
+		{
+			if( bounds[2 * i] < 0 ) continue;
+
+			int32_t start = mToUtf16( bounds[2 * i] );
+			int32_t end = mToUtf16( bounds[2 * i + 1] );
+
+			// (groups in look-arounds can begin before the match)
+			int32_t delta = start - start0;
+
+			mOut.Write7BitEncodedInt( (int32_t)( ( (uint32_t)delta << 1 ) ^ (uint32_t)( delta >> 31 ) ) );
+			mOut.Write7BitEncodedInt( end - start );
+		}
+	}
+};
+
+
+// Splits the range of text into 'count' parts or less; each part, except the first one, begins after a separator.
+// Returns the native bounds of the parts.
+template<typename CharT>
+static std::vector<int32_t> SplitText( const CharT* text, size_t begin, size_t end, const std::basic_string<CharT>& separator, int32_t count )
+{
+	std::vector<int32_t> bounds{ static_cast<int32_t>( begin ) };
+
+	for( int32_t k = 1; k < count; ++k )
+	{
+		size_t target = std::max( begin + ( end - begin ) / count * k, static_cast<size_t>( bounds.back( ) ) );
+
+		const CharT* f = std::search( text + target, text + end, separator.begin( ), separator.end( ) );
+		size_t bound = static_cast<size_t>( f - text ) + separator.length( );
+
+		if( bound >= end ) break;
+		if( bound > static_cast<size_t>( bounds.back( ) ) ) bounds.push_back( static_cast<int32_t>( bound ) );
+	}
+
+	bounds.push_back( static_cast<int32_t>( end ) );
+
+	return bounds;
+}
+
+
+// Searches each part on a separate thread and writes the matches in order: the first part is searched on this thread
+// and written when it ends, each next one when its thread ends, therefore the batches are sent before the whole search
+// ends. The matchers use transparent bounds, therefore the look-arounds and '\b' see the neighbouring parts, but
+// the matches do not cross the parts. With 'MaxMatches', a part stops when the parts before it hold enough matches.
+// (The last part extends to the end of text; the matches that begin at 'windowEnd' or later are not taken).
+template<typename CharT, typename Encoder>
+static bool FindInParts( Encoder& encoder, const CompiledPattern& pattern, const CharT* text, size_t length,
+	const std::vector<int32_t>& parts, int64_t windowEnd, int32_t groupCount, const MatchOptions& options, const std::function<bool( )>& isCancelled )
+{
+	size_t const part_count = parts.size( ) - 1;
+	size_t const stride = 2 * ( groupCount + 1 );
+
+	std::vector<std::vector<int32_t>> part_bounds( part_count );
+	std::unique_ptr<std::atomic<int32_t>[]> part_counts( new std::atomic<int32_t>[part_count] );
+	std::vector<std::exception_ptr> errors( part_count );
+	std::atomic<bool> stop{ false };
+	StopCondition const stop_condition{ isCancelled, &stop };
+
+	for( size_t k = 0; k < part_count; ++k ) part_counts[k].store( 0, std::memory_order_relaxed );
+
+	auto enough_before = [&] ( size_t k )
+	{
+		if( options.MaxMatches <= 0 ) return false;
+
+		int64_t count = 0;
+
+		for( size_t j = 0; j < k; ++j ) count += part_counts[j].load( std::memory_order_relaxed );
+
+		return count >= options.MaxMatches;
+	};
+
+	auto find = [&] ( size_t k )
+	{
+		try
+		{
+			UErrorCode status = U_ZERO_ERROR;
+			InputMatcher m = OpenMatcher( *pattern.Pattern, text, length );
+
+			ConfigureMatcher( *m.Matcher, options, &stop_condition );
+
+			m.Matcher->region( parts[k], k + 1 == part_count ? static_cast<int64_t>( length ) : parts[k + 1], status );
+			Check( status );
+
+			m.Matcher->useTransparentBounds( true );
+			m.Matcher->useAnchoringBounds( false );
+
+			std::vector<int32_t>& bounds = part_bounds[k];
+
+			// (each part can supply all of the 'MaxMatches' matches)
+			for( int32_t count = 0; options.MaxMatches <= 0 || count < options.MaxMatches; ++count )
+			{
+				if( stop.load( std::memory_order_relaxed ) ) break;
+
+				if( isCancelled( ) )
+				{
+					stop = true;
+
+					break;
+				}
+
+				if( enough_before( k ) ) break;
+
+				if( !m.Matcher->find( status ) )
+				{
+					if( status == U_REGEX_STOPPED_BY_CALLER )
+					{
+						stop = true;
+
+						break;
+					}
+
+					Check( status );
+
+					break;
+				}
+
+				int64_t const start = m.Matcher->start64( status );
+
+				if( start >= windowEnd ) break;
+
+				// (the match at the end of a part is empty; the next part finds the match that the serial search finds there)
+				if( k + 1 < part_count && start == parts[k + 1] ) break;
+
+				bounds.resize( bounds.size( ) + stride );
+				GetBounds( *m.Matcher, groupCount, &bounds[bounds.size( ) - stride] );
+
+				part_counts[k].store( count + 1, std::memory_order_relaxed );
+			}
+		}
+		catch( ... )
+		{
+			errors[k] = std::current_exception( );
+			stop = true;
+		}
+	};
+
+	std::vector<std::thread> threads( part_count ); // (by part; not joinable for the first part and if a thread cannot be created)
+
+	for( size_t k = 1; k < part_count; ++k )
+	{
+		try
+		{
+			threads[k] = std::thread( find, k );
+		}
+		catch( const std::system_error& )
+		{
+			find( k ); // (no more threads)
+		}
+	}
+
+	bool completed = true;
+
+	for( size_t k = 0; k < part_count && completed; ++k )
+	{
+		if( k == 0 )
+		{
+			find( 0 );
+		}
+		else if( threads[k].joinable( ) )
+		{
+			threads[k].join( );
+		}
+
+		if( stop ) break; // (cancelled or failed)
+
+		const std::vector<int32_t>& bounds = part_bounds[k];
+
+		for( size_t i = 0; i < bounds.size( ); i += stride )
+		{
+			if( options.MaxMatches > 0 && encoder.Count( ) >= options.MaxMatches )
+			{
+				completed = false; // (the rest is not needed; the other threads stop by 'enough_before')
+
+				break;
+			}
+
+			encoder.Write( &bounds[i] );
+		}
+
+		std::vector<int32_t>( ).swap( part_bounds[k] );
+
+		if( completed && k + 1 < part_count ) encoder.Flush( ); // (the next parts can take long)
+	}
+
+	for( std::thread& t : threads )
+	{
+		if( t.joinable( ) ) t.join( );
+	}
+
+	for( const std::exception_ptr& error : errors )
+	{
+		if( error ) std::rethrow_exception( error );
+	}
+
+	return !stop; // (false if cancelled)
+}
+
+
+static std::u16string ToNativeSeparator( const std::u16string& separator, const char16_t* )
+{
+	return separator;
+}
+
+
+static std::string ToNativeSeparator( const std::u16string& separator, const char* )
+{
+	std::string utf8_separator;
+	NativeInfrastructure::AppendUtf8( &utf8_separator, separator.data( ), separator.length( ) );
+
+	return utf8_separator;
+}
+
+
+// Finds and writes the matches, using several threads if requested and the text is large enough.
+template<typename CharT, typename ToUtf16>
+static bool WriteMatchList( MemoryWriter& out, MemoryWriter* nativeOut, const CompiledPattern& pattern, const CharT* text, size_t length,
+	const MatchOptions& options, ToUtf16 toUtf16, const std::function<bool( )>& isCancelled, const std::function<void( )>& flushBatch )
+{
+	// (the parallel search is not worth it for the shorter parts)
+	const size_t MinimumPartLength = 64 * 1024;
+
+	if( length > INT32_MAX ) throw std::runtime_error( "The text is too large." );
+
+	UErrorCode status = U_ZERO_ERROR;
+	InputMatcher m = OpenMatcher( *pattern.Pattern, text, length );
+
+	int32_t group_count = m.Matcher->groupCount( );
+	MatchEncoder<ToUtf16> encoder( out, nativeOut, group_count, toUtf16, flushBatch );
+
+	// the matches that begin in the window
+	size_t const window_start = std::min( static_cast<size_t>( std::max( options.WindowStart, 0 ) ), length );
+	int64_t const window_end = options.WindowEnd < 0 ? INT64_MAX : options.WindowEnd;
+	size_t const split_end = static_cast<size_t>( std::max( std::min( window_end, static_cast<int64_t>( length ) ), static_cast<int64_t>( window_start ) ) );
+
+	int32_t part_count = static_cast<int32_t>( std::min( static_cast<size_t>( std::max( options.Threads, 1 ) ), ( split_end - window_start ) / MinimumPartLength + 1 ) );
+
+	if( part_count > 1 )
+	{
+		auto separator = ToNativeSeparator( options.Separator.empty( ) ? u"\n" : options.Separator, text );
+		std::vector<int32_t> parts = SplitText( text, window_start, split_end, separator, part_count );
+
+		if( parts.size( ) > 2 )
+		{
+			if( !FindInParts( encoder, pattern, text, length, parts, window_end, group_count, options, isCancelled ) ) return false;
+
+			encoder.Finish( );
+
+			return true;
+		}
+	}
+
+	StopCondition const stop_condition{ isCancelled, nullptr };
+
+	ConfigureMatcher( *m.Matcher, options, &stop_condition );
+
+	std::vector<int32_t> bounds( 2 * ( group_count + 1 ) );
+
+	// (the search stops early when the maximum number of matches is reached or the window is passed)
+	while( options.MaxMatches <= 0 || encoder.Count( ) < options.MaxMatches )
+	{
+		if( isCancelled( ) ) return false;
+
+		bool found = encoder.Count( ) == 0 ? m.Matcher->find( static_cast<int64_t>( window_start ), status ) : m.Matcher->find( status );
+
+		if( !found )
+		{
+			if( status == U_REGEX_STOPPED_BY_CALLER ) return false; // (cancelled)
+
+			Check( status );
+
+			break;
+		}
+
+		GetBounds( *m.Matcher, group_count, bounds.data( ) );
+
+		if( bounds[0] >= window_end ) break;
+
+		encoder.Write( bounds.data( ) );
+	}
+
+	encoder.Finish( );
+
+	return true;
+}
+
+
+bool WriteMatches( MemoryWriter& out, const CompiledPattern& pattern, const char16_t* text, size_t length, const MatchOptions& options,
+	const std::function<bool( )>& isCancelled, const std::function<void( )>& flushBatch )
+{
+	// (includes the encoding of the results; the batches are traced as "send")
+	NativeInfrastructure::TraceSpan span( "icu", "scan", static_cast<int64_t>( length ) );
+
+	WriteGroupNames( out, pattern );
+
+	// (the native indexes are UTF-16 offsets)
+	return WriteMatchList( out, nullptr, pattern, text, length, options, [] ( int32_t index ) { return index; }, isCancelled, flushBatch );
+}
+
+
+bool WriteFileMatches( MemoryWriter& out, const CompiledPattern& pattern, const char* utf8, size_t size, const MatchOptions& options,
+	const std::function<bool( )>& isCancelled, const std::function<void( )>& flushBatch )
+{
+	NativeInfrastructure::TraceSpan span( "icu", "scan", static_cast<int64_t>( size ) );
+
+	WriteGroupNames( out, pattern );
+
+	// (the UTF-16 offsets are computed only at the reported positions)
+	NativeInfrastructure::Utf8OffsetTranslator offsets( utf8, size );
+	MemoryWriter native_out;
+
+	bool completed = WriteMatchList( out, &native_out, pattern, utf8, size, options,
+		[&offsets] ( int32_t index ) { return static_cast<int32_t>( offsets.ToUtf16( static_cast<size_t>( index ) ) ); }, isCancelled, flushBatch );
+
+	if( !completed ) return false;
+
+	out.WriteBytes( native_out.Buffer( ).data( ), native_out.Buffer( ).size( ) );
+
+	return true;
+}
+
+
+std::shared_ptr<const CompiledPattern> PatternCache::Get( const std::u16string& pattern, uint32_t flags )
+{
+	std::u16string key;
+	key.reserve( 2 + pattern.length( ) );
+	key.push_back( static_cast<char16_t>( flags & 0xFFFF ) );
+	key.push_back( static_cast<char16_t>( flags >> 16 ) );
+	key.append( pattern );
+
+	auto f = mIndex.find( key );
+
+	if( f != mIndex.end( ) )
+	{
+		mEntries.splice( mEntries.begin( ), mEntries, f->second );
+
+		return f->second->Pattern;
+	}
+
+	std::shared_ptr<const CompiledPattern> compiled( CompilePattern( pattern, flags ) ); // (invalid patterns are not cached)
+
+	mEntries.push_front( Entry{ key, compiled } );
+	mIndex.emplace( std::move( key ), mEntries.begin( ) );
+
+	if( mEntries.size( ) > mCapacity )
+	{
+		mIndex.erase( mEntries.back( ).Key );
+		mEntries.pop_back( );
+	}
+
+	return compiled;
+}
+
+
+struct IcuServer::SharedState
+{
+	std::mutex Mutex;
+	std::condition_variable Condition;
+	std::deque<std::vector<char>> Queue;
+	bool EndOfInput = false;
+
+	int32_t CurrentId = INT32_MIN; // (the request that is being processed)
+	std::set<int32_t> CancelledIds; // (queued requests that were cancelled)
+	std::atomic<bool> CancelCurrent{ false };
+};
+
+
+IcuServer::IcuServer( FrameStream& stream, size_t cacheCapacity )
+	: mStream( stream ), mCache( cacheCapacity ), mState( std::make_shared<SharedState>( ) )
+{
+
+}
+
+
+IcuServer::~IcuServer( )
+{
+
+}
+
+
+void IcuServer::ReaderProc( std::shared_ptr<SharedState> state, FrameStream* stream )
+{
+	try
+	{
+		for( ;;)
+		{
+			std::vector<char> frame;
+
+			if( !stream->ReadFrame( &frame ) ) break;
+
+			// handle the cancellations immediately; the other requests are queued
+
+			try
+			{
+				MemoryReader r( frame.data( ), frame.size( ) );
+				r.ReadInt32( );
+
+				if( r.ReadString( ) == u"x" )
+				{
+					int32_t id = r.ReadInt32( );
+
+					// (the IDs increase; the smaller ones are already answered)
+					std::lock_guard<std::mutex> lock( state->Mutex );
+
+					if( id == state->CurrentId ) state->CancelCurrent = true;
+					else if( id > state->CurrentId ) state->CancelledIds.insert( id );
+
+					continue;
+				}
+			}
+			catch( const MemoryReaderException& )
+			{
+				// (the worker will report the error)
+			}
+
+			{
+				std::lock_guard<std::mutex> lock( state->Mutex );
+
+				state->Queue.push_back( std::move( frame ) );
+			}
+
+			state->Condition.notify_one( );
+		}
+	}
+	catch( ... )
+	{
+		// (treated as the end of input)
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( state->Mutex );
+
+		state->EndOfInput = true;
+	}
+
+	state->Condition.notify_one( );
+}
+
+
+void IcuServer::Run( )
+{
+	// (the reader can remain blocked in 'ReadFrame' when the server stops; the state outlives the server)
+	std::thread reader( &IcuServer::ReaderProc, mState, &mStream );
+	reader.detach( );
+
+	for( ;;)
+	{
+		std::vector<char> request;
+
+		{
+			std::unique_lock<std::mutex> lock( mState->Mutex );
+
+			mState->Condition.wait( lock, [this] { return !mState->Queue.empty( ) || mState->EndOfInput; } );
+
+			if( mState->Queue.empty( ) ) break; // (end of input)
+
+			request = std::move( mState->Queue.front( ) );
+			mState->Queue.pop_front( );
+
+			int32_t id = INT32_MIN;
+			if( request.size( ) >= sizeof( id ) ) memcpy( &id, request.data( ), sizeof( id ) );
+
+			mState->CurrentId = id;
+			mState->CancelCurrent = mState->CancelledIds.erase( id ) != 0;
+		}
+
+		if( !Process( request ) ) break;
+	}
+}
+
+
+bool IcuServer::Process( const std::vector<char>& request )
+{
+	// (the reading of the request is the time that is not covered by the nested spans)
+	NativeInfrastructure::TraceSpan span( "icu", "request", static_cast<int64_t>( request.size( ) ) );
+
+	MemoryReader r( request.data( ), request.size( ) );
+	int32_t id;
+
+	mResponse.Clear( );
+
+	try
+	{
+		id = r.ReadInt32( );
+	}
+	catch( const MemoryReaderException& )
+	{
+		return true; // (cannot be answered)
+	}
+
+	mResponse.Write( id );
+
+	const std::atomic<bool>& cancel = mState->CancelCurrent;
+	auto is_cancelled = [&cancel] { return cancel.load( std::memory_order_relaxed ); };
+
+	// (sends the matches that are in 'mOutput' before the search ends)
+	std::function<void( )> const flush_batch = [this, id] { SendBatch( id, Partial ); };
+
+	try
+	{
+		std::u16string command = r.ReadString( );
+
+		if( command == u"q" ) return false;
+
+		if( is_cancelled( ) )
+		{
+			mResponse.Write( (uint8_t)Cancelled );
+		}
+		else if( command == u"v" )
+		{
+			mResponse.Write( (uint8_t)Ok );
+			mResponse.Write( u"" U_ICU_VERSION );
+		}
+		else if( command == u"m" )
+		{
+			std::u16string pattern = r.ReadString( );
+			std::u16string text = r.ReadString( );
+			int32_t remote_flags = r.ReadInt32( );
+			MatchOptions options = ReadMatchOptions( r );
+
+			std::shared_ptr<const CompiledPattern> icu_pattern = mCache.Get( pattern, ToIcuFlags( remote_flags ) );
+
+			mOutput.Clear( );
+
+			bool completed = WriteMatches( mOutput, *icu_pattern, text.data( ), text.length( ), options, is_cancelled, flush_batch );
+
+			WriteLastBatch( id, completed );
+		}
+		else if( command == u"mf" )
+		{
+			std::u16string pattern = r.ReadString( );
+			std::u16string path = r.ReadString( );
+			int32_t remote_flags = r.ReadInt32( );
+			MatchOptions options = ReadMatchOptions( r );
+
+			std::shared_ptr<const CompiledPattern> icu_pattern = mCache.Get( pattern, ToIcuFlags( remote_flags ) );
+
+			std::string utf8_path;
+			NativeInfrastructure::AppendUtf8( &utf8_path, path.data( ), path.length( ) );
+
+			NativeInfrastructure::MappedFile file;
+
+			if( !file.Open( utf8_path.c_str( ) ) ) throw std::runtime_error( file.GetErrorText( ) );
+
+			const char* text = file.Data( );
+			size_t size = file.Size( );
+
+			if( size >= 3 && memcmp( text, "\xEF\xBB\xBF", 3 ) == 0 )
+			{
+				text += 3;
+				size -= 3;
+			}
+
+			mOutput.Clear( );
+
+			bool completed = WriteFileMatches( mOutput, *icu_pattern, text, size, options, is_cancelled, flush_batch );
+
+			WriteLastBatch( id, completed );
+		}
+		else if( command == u"ms" )
+		{
+			std::u16string pattern = r.ReadString( );
+			std::u16string text_name = r.ReadString( );
+			int32_t text_length = r.ReadInt32( );
+			std::u16string output_name = r.ReadString( );
+			int32_t output_capacity = r.ReadInt32( );
+			int32_t remote_flags = r.ReadInt32( );
+			MatchOptions options = ReadMatchOptions( r );
+
+			if( text_length < 0 || output_capacity < 0 ) throw std::runtime_error( "Invalid size of shared memory" );
+
+			std::shared_ptr<const CompiledPattern> icu_pattern = mCache.Get( pattern, ToIcuFlags( remote_flags ) );
+
+			OpenSharedMemory( mTextMemory, text_name, static_cast<size_t>( text_length ) * sizeof( char16_t ) );
+			OpenSharedMemory( mOutputMemory, output_name, static_cast<size_t>( output_capacity ) );
+
+			mOutput.Clear( );
+
+			// (the shared text is not copied; the host does not change it until the response)
+			if( !WriteMatches( mOutput, *icu_pattern, reinterpret_cast<const char16_t*>( mTextMemory.Data( ) ), static_cast<size_t>( text_length ),
+				options, is_cancelled ) )
+			{
+				mResponse.Write( (uint8_t)Cancelled );
+			}
+			else
+			{
+				const std::vector<char>& output = mOutput.Buffer( );
+
+				mResponse.Write( (uint8_t)Ok );
+
+				if( output.size( ) <= mOutputMemory.Size( ) )
+				{
+					if( !output.empty( ) ) memcpy( mOutputMemory.Data( ), output.data( ), output.size( ) );
+
+					mResponse.Write( static_cast<int32_t>( output.size( ) ) );
+				}
+				else
+				{
+					// (does not fit; sent in the response, the host will enlarge the memory)
+					mResponse.Write( (int32_t)-1 );
+					mResponse.WriteBytes( output.data( ), output.size( ) );
+				}
+			}
+		}
+		else
+		{
+			throw std::runtime_error( "Unsupported command" );
+		}
+	}
+	catch( const std::exception& exc )
+	{
+		std::u16string message;
+		for( const char* p = exc.what( ); *p != '\0'; ++p ) message.push_back( (unsigned char)*p );
+
+		mResponse.Clear( );
+		mResponse.Write( id );
+		mResponse.Write( (uint8_t)Error );
+		mResponse.Write( message );
+	}
+
+	SendResponse( );
+
+	return true;
+}
+
+
+void IcuServer::SendResponse( )
+{
+	NativeInfrastructure::TraceSpan span( "icu", "send", static_cast<int64_t>( mResponse.Buffer( ).size( ) ) );
+
+	mStream.WriteFrame( mResponse.Buffer( ).data( ), mResponse.Buffer( ).size( ) );
+}
+
+
+void IcuServer::SendBatch( int32_t id, IcuServerStatus status )
+{
+	mResponse.Clear( );
+	mResponse.Write( id );
+	mResponse.Write( (uint8_t)status );
+	mResponse.WriteBytes( mOutput.Buffer( ).data( ), mOutput.Buffer( ).size( ) );
+
+	SendResponse( );
+
+	mOutput.Clear( );
+}
+
+
+void IcuServer::WriteLastBatch( int32_t id, bool completed )
+{
+	mResponse.Clear( );
+	mResponse.Write( id );
+
+	if( completed )
+	{
+		mResponse.Write( (uint8_t)Ok );
+		mResponse.WriteBytes( mOutput.Buffer( ).data( ), mOutput.Buffer( ).size( ) );
+	}
+	else
+	{
+		mResponse.Write( (uint8_t)Cancelled );
+	}
+}
+
+
+MatchOptions IcuServer::ReadMatchOptions( MemoryReader& r )
+{
+	MatchOptions options;
+
+	options.TimeLimit = r.ReadInt32( );
+	options.StackLimit = r.ReadInt32( );
+	options.Threads = r.ReadInt32( );
+	options.Separator = r.ReadString( );
+	options.MaxMatches = r.ReadInt32( );
+	options.WindowStart = r.ReadInt32( );
+	options.WindowEnd = r.ReadInt32( );
+
+	return options;
+}
+
+
+void IcuServer::OpenSharedMemory( NativeInfrastructure::SharedMemory& memory, const std::u16string& name, size_t size )
+{
+	// (the names are generated by the host and contain ASCII characters only)
+	std::string utf8_name;
+	for( char16_t c : name )
+	{
+		if( c == 0 || c > 0x7F ) throw std::runtime_error( "Invalid name of shared memory" );
+
+		utf8_name.push_back( static_cast<char>( c ) );
+	}
+
+	if( memory.Data( ) != nullptr && memory.Size( ) == size && memory.Name( ) == utf8_name ) return;
+
+	if( !memory.Open( utf8_name.c_str( ), size ) ) throw std::runtime_error( memory.GetErrorText( ) );
+}
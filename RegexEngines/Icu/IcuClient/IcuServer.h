@@ -0,0 +1,231 @@
+#pragma once
+
+// The portable part of IcuClient: compilation and caching of patterns, matching, and the
+// server mode, where the client stays alive and answers the requests that arrive in frames.
+//
+// (This file does not depend on Windows, therefore it can be built and tested with the system ICU).
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "unicode/regex.h"
+
+#include "MemoryStreams.h"
+#include "../../NativeInfrastructure/SharedMemory.h"
+
+
+// Thrown for the unexpected ICU errors.
+class IcuException : public std::runtime_error
+{
+public:
+
+	explicit IcuException( const std::string& message )
+		: std::runtime_error( message )
+	{
+
+	}
+};
+
+
+// Thrown if the pattern cannot be compiled; the message is shown to the user.
+class PatternException : public std::runtime_error
+{
+public:
+
+	explicit PatternException( const std::string& message )
+		: std::runtime_error( message )
+	{
+
+	}
+};
+
+
+// Converts the flags that are sent by the host to 'UREGEX_...' flags.
+uint32_t ToIcuFlags( int32_t remoteFlags );
+
+struct GroupName
+{
+	int32_t Number;
+	std::u16string Name;
+};
+
+
+// The compiled pattern and the names of its groups, which are found once.
+struct CompiledPattern
+{
+	std::unique_ptr<icu::RegexPattern> Pattern;
+	std::vector<GroupName> GroupNames;
+};
+
+
+// Throws 'PatternException' if the pattern is invalid.
+std::unique_ptr<CompiledPattern> CompilePattern( const std::u16string& pattern, uint32_t flags );
+
+
+// The parameters of search that are not part of the compiled pattern.
+struct MatchOptions
+{
+	int32_t TimeLimit = 0; // (see 'RegexMatcher::setTimeLimit'; 0: no limit)
+	int32_t StackLimit = -1; // (bytes, see 'RegexMatcher::setStackLimit'; 0: no limit; -1: the default of ICU)
+
+	// The text is split into up to 'Threads' parts, which begin after 'Separator' (line feed if empty)
+	// and are searched in parallel; the matches cannot cross the parts. 0 or 1: the text is searched serially.
+	int32_t Threads = 0;
+	std::u16string Separator;
+
+	// The search stops after 'MaxMatches' matches (0: no limit). It begins at 'WindowStart' and stops at the first match
+	// that begins at 'WindowEnd' or later (-1: no limit); the matches can end after 'WindowEnd'. The positions are native
+	// indexes: UTF-16 offsets, or byte offsets in files.
+	int32_t MaxMatches = 0;
+	int32_t WindowStart = 0;
+	int32_t WindowEnd = -1;
+};
+
+
+// Writes the group names and the matches (the output of "m" command):
+//	names -- pairs of Int32 group number and string, terminated by -1;
+//	7-bit encoded number of groups (G), then, for each match:
+//		7-bit encoded distance from the end of the previous match plus 1 (0 terminates the list), length;
+//		if G > 0: bitmap of the participating groups 1..G, (G + 7) / 8 bytes, then for each participating group
+//		the 7-bit encoded start relative to the match start (zigzag: 2*d for d >= 0, -2*d-1 for d < 0) and length.
+// Returns false if 'isCancelled' returned true; the output is incomplete in this case.
+// ('isCancelled' is called on several threads during the parallel search).
+// If 'flushBatch' is not empty, it is called each time 'out' holds a batch of matches; it must send and clear 'out'.
+bool WriteMatches( MemoryWriter& out, const CompiledPattern& pattern, const char16_t* text, size_t length, const MatchOptions& options,
+	const std::function<bool( )>& isCancelled, const std::function<void( )>& flushBatch = nullptr );
+
+// Writes the matches in UTF-8 text (the output of "mf" command), which is searched in place through UText.
+// The output is the same as of 'WriteMatches', with positions in UTF-16 units, followed by the native positions
+// (byte offsets) of the matches in the same form: distance plus 1 (0 terminates the list), length.
+// The text is expected to be valid UTF-8; the size must not exceed 'INT32_MAX'.
+bool WriteFileMatches( MemoryWriter& out, const CompiledPattern& pattern, const char* utf8, size_t size, const MatchOptions& options,
+	const std::function<bool( )>& isCancelled, const std::function<void( )>& flushBatch = nullptr );
+
+
+// The most recently used compiled patterns, keyed by pattern and flags.
+class PatternCache final
+{
+public:
+
+	explicit PatternCache( size_t capacity )
+		: mCapacity( capacity )
+	{
+
+	}
+
+	// Compiles the pattern or takes it from the cache; throws 'PatternException'.
+	std::shared_ptr<const CompiledPattern> Get( const std::u16string& pattern, uint32_t flags );
+
+	size_t Size( ) const { return mEntries.size( ); }
+
+private:
+
+	struct Entry
+	{
+		std::u16string Key;
+		std::shared_ptr<const CompiledPattern> Pattern;
+	};
+
+	size_t const mCapacity;
+	std::list<Entry> mEntries; // (the most recently used first)
+	std::unordered_map<std::u16string, std::list<Entry>::iterator> mIndex;
+};
+
+
+// Source and destination of frames in server mode. A frame is a 32-bit length followed by the payload.
+class FrameStream
+{
+public:
+
+	virtual ~FrameStream( ) { }
+
+	// Returns false at the end of input.
+	virtual bool ReadFrame( std::vector<char>* payload ) = 0;
+
+	virtual void WriteFrame( const char* payload, size_t size ) = 0;
+};
+
+
+// Server mode.
+//
+// Request payload: Int32 request ID, command (string), arguments:
+//	"m" -- pattern (string), text (string), flags (Int32), options;
+//	"ms" -- the same as "m", but the text and the output are in shared memory created by the host:
+//		pattern (string), name of text memory (string), text length in chars (Int32),
+//		name of output memory (string), capacity of output memory in bytes (Int32), flags (Int32), options;
+//	"mf" -- pattern (string), path of UTF-8 file (string), flags (Int32), options; the file is mapped to memory
+//		and searched in place (see 'WriteFileMatches'); the BOM is skipped; IcuRegexEngine, which only searches
+//		the text of the editor, does not send it;
+//	"v" -- (none);
+//	"x" -- ID of the request to cancel (Int32); not answered (the cancelled request is answered with 'Cancelled');
+//	"q" -- (none); stops the server.
+//
+// Options ('MatchOptions'): limit (Int32), stack limit (Int32), threads (Int32), separator (string),
+//	maximum number of matches (Int32), window start (Int32), window end (Int32).
+//
+// Response payload: Int32 request ID, status (byte, 'IcuServerStatus'), then:
+//	'Ok' -- the output of the command, the same as in the one-time mode; for "ms": the size of the output (Int32)
+//		written to the output memory, or -1 followed by the output if it does not fit;
+//	'Error' -- the error message (string);
+//	'Cancelled' -- (nothing);
+//	'Partial' -- for "m" and "mf": the next part of the output; more responses with the same ID follow,
+//		the last of them is 'Ok', 'Error' or 'Cancelled'.
+//
+// The requests are read on a separate thread, so that "x" can interrupt the current request
+// (also inside a long 'find', through the callbacks of ICU).
+// The IDs must increase.
+class IcuServer final
+{
+public:
+
+	enum IcuServerStatus : uint8_t
+	{
+		Ok = 0,
+		Error = 1,
+		Cancelled = 2,
+		Partial = 3,
+	};
+
+	explicit IcuServer( FrameStream& stream, size_t cacheCapacity = 32 );
+	~IcuServer( );
+
+	// Returns at the end of input or after "q".
+	void Run( );
+
+private:
+
+	struct SharedState;
+
+	FrameStream& mStream;
+	PatternCache mCache;
+	std::shared_ptr<SharedState> mState;
+	MemoryWriter mResponse; // (reused)
+	MemoryWriter mOutput; // (the output of matching commands; reused)
+	NativeInfrastructure::SharedMemory mTextMemory; // (kept open while the host uses the same one)
+	NativeInfrastructure::SharedMemory mOutputMemory;
+
+	static void ReaderProc( std::shared_ptr<SharedState> state, FrameStream* stream );
+
+	// Returns false if the server must stop.
+	bool Process( const std::vector<char>& request );
+
+	void SendResponse( );
+
+	// Sends the response with the output, which is in 'mOutput', and clears it.
+	void SendBatch( int32_t id, IcuServerStatus status );
+
+	// Prepares the last response: 'Ok' and the rest of 'mOutput', or 'Cancelled'.
+	void WriteLastBatch( int32_t id, bool completed );
+
+	static MatchOptions ReadMatchOptions( MemoryReader& r );
+
+	// Maps the memory unless it is already mapped with the same name and size; throws an exception on errors.
+	static void OpenSharedMemory( NativeInfrastructure::SharedMemory& memory, const std::u16string& name, size_t size );
+};
@@ -0,0 +1,111 @@
+#include "MemoryStreams.h"
+
+#include <cstring>
+
+
+uint8_t MemoryReader::ReadByte( )
+{
+	uint8_t b;
+
+	ReadBytes( &b, sizeof( b ) );
+
+	return b;
+}
+
+
+int32_t MemoryReader::ReadInt32( )
+{
+	int32_t i;
+
+	ReadBytes( &i, sizeof( i ) );
+
+	return i;
+}
+
+
+std::u16string MemoryReader::ReadString( )
+{
+	int32_t bytelen = Read7BitEncodedInt( );
+	std::u16string s;
+
+	if( bytelen < 0 || ( bytelen % sizeof( s[0] ) ) != 0 )
+	{
+		throw MemoryReaderException( "Invalid string length" );
+	}
+
+	if( static_cast<size_t>( bytelen ) > mSize - mPosition )
+	{
+		throw MemoryReaderException( "Unexpected end of data" );
+	}
+
+	s.resize( bytelen / sizeof( s[0] ) );
+
+	ReadBytes( &s[0], bytelen );
+
+	return s;
+}
+
+
+void MemoryReader::ReadBytes( void* buffer, size_t size )
+{
+	if( size > mSize - mPosition )
+	{
+		throw MemoryReaderException( "Unexpected end of data" );
+	}
+
+	if( size != 0 ) memcpy( buffer, mData + mPosition, size );
+
+	mPosition += size;
+}
+
+
+int32_t MemoryReader::Read7BitEncodedInt( )
+{
+	// (see 'BinaryReader::Read7BitEncodedInt')
+
+	uint32_t count = 0;
+	int shift = 0;
+	uint8_t b;
+	do
+	{
+		if( shift == 5 * 7 ) throw MemoryReaderException( "Format_Bad7BitInt32" );
+
+		b = ReadByte( );
+		count |= static_cast<uint32_t>( b & 0x7F ) << shift;
+		shift += 7;
+	} while( ( b & 0x80 ) != 0 );
+
+	return static_cast<int32_t>( count );
+}
+
+
+void MemoryWriter::Write( const char16_t* s, size_t charlen )
+{
+	size_t bytelen = charlen * sizeof( s[0] );
+
+	Write7BitEncodedInt( static_cast<int32_t>( bytelen ) );
+	WriteBytes( s, bytelen );
+}
+
+
+void MemoryWriter::WriteBytes( const void* buffer, size_t size )
+{
+	const char* p = static_cast<const char*>( buffer );
+
+	mBuffer.insert( mBuffer.end( ), p, p + size );
+}
+
+
+void MemoryWriter::Write7BitEncodedInt( int32_t value )
+{
+	// (see 'BinaryWriter::Write7BitEncodedInt')
+
+	uint32_t v = static_cast<uint32_t>( value );
+	while( v >= 0x80 )
+	{
+		Write( static_cast<uint8_t>( v | 0x80 ) );
+		v >>= 7;
+	}
+
+	Write( static_cast<uint8_t>( v ) );
+}
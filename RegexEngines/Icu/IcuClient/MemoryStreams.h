@@ -0,0 +1,92 @@
+#pragma once
+
+// Portable counterparts of 'BinaryReader' and 'BinaryWriter' that work with memory buffers
+// (the payloads of frames in server mode). The formats are compatible with .NET 'BinaryReader'
+// and 'BinaryWriter' using Unicode encoding.
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+class MemoryReader final
+{
+public:
+
+	MemoryReader( const char* data, size_t size )
+		: mData( data ), mSize( size ), mPosition( 0 )
+	{
+
+	}
+
+
+	uint8_t ReadByte( );
+
+	int32_t ReadInt32( );
+
+	std::u16string ReadString( );
+
+	void ReadBytes( void* buffer, size_t size );
+
+	int32_t Read7BitEncodedInt( );
+
+private:
+
+	const char* const mData;
+	size_t const mSize;
+	size_t mPosition;
+};
+
+
+class MemoryWriter final
+{
+public:
+
+	void Write( uint8_t b )
+	{
+		mBuffer.push_back( static_cast<char>( b ) );
+	}
+
+
+	void Write( int32_t i )
+	{
+		WriteBytes( &i, sizeof( i ) );
+	}
+
+
+	void Write( const char16_t* s, size_t charlen );
+
+	void Write( const std::u16string& s )
+	{
+		Write( s.data( ), s.length( ) );
+	}
+
+
+	void WriteBytes( const void* buffer, size_t size );
+
+	// (the compact form of non-negative numbers)
+	void Write7BitEncodedInt( int32_t value );
+
+	const std::vector<char>& Buffer( ) const { return mBuffer; }
+
+	void Clear( ) { mBuffer.clear( ); } // (keeps the capacity)
+
+private:
+
+	std::vector<char> mBuffer;
+};
+
+
+// Thrown when a buffer does not contain enough data.
+class MemoryReaderException : public std::runtime_error
+{
+public:
+
+	explicit MemoryReaderException( const char* message )
+		: std::runtime_error( message )
+	{
+
+	}
+};
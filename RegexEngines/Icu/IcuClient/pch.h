@@ -16,6 +16,7 @@
 
 #include <cassert>
 #include <string>
+#include <vector>
 
 
 #include "unicode/regex.h"
@@ -9,6 +9,7 @@ using System.IO;
 using System.Linq;
 using System.Reflection;
 using System.Text;
+using System.Text.RegularExpressions;
 using System.Threading.Tasks;
 
 
@@ -16,8 +17,18 @@ namespace IcuRegexEngineNs
 {
 	class IcuMatcher : IMatcher
 	{
+		// texts that are not shorter are sent through shared memory (see "ms" command in IcuClient)
+		const int SharedMemoryThreshold = 256 * 1024; // (chars)
+		const long MinimumTextMemoryCapacity = 1L << 20; // (bytes)
+		const long MinimumOutputMemoryCapacity = 4L << 20; // (bytes)
+
+		static readonly object SharedMemoryLocker = new object( );
+		static IcuSharedMemory TextMemory;
+		static IcuSharedMemory OutputMemory;
+
 		readonly IcuRegexOptions Options;
 		readonly string Pattern;
+		readonly string RecordSeparator; // (unescaped; empty for line feed)
 
 
 		public IcuMatcher( string pattern, IcuRegexOptions options )
@@ -29,29 +40,49 @@ namespace IcuRegexEngineNs
 				throw new ApplicationException( "Invalid limit. Please enter an integer number." );
 			}
 
+			if( !string.IsNullOrWhiteSpace( options.StackLimit ) && !( int.TryParse( options.StackLimit, out var stack_limit ) && stack_limit >= 0 ) )
+			{
+				throw new ApplicationException( "Invalid stack limit. Please enter a non-negative integer number." );
+			}
+
+			if( !string.IsNullOrWhiteSpace( options.MaxMatches ) && !( int.TryParse( options.MaxMatches, out var max_matches ) && max_matches > 0 ) )
+			{
+				throw new ApplicationException( "Invalid maximum number of matches. Please enter a positive integer number." );
+			}
+
+			if( !string.IsNullOrWhiteSpace( options.WindowStart ) && !( int.TryParse( options.WindowStart, out var window_start ) && window_start >= 0 ) )
+			{
+				throw new ApplicationException( "Invalid start of window. Please enter a non-negative integer number." );
+			}
+
+			if( !string.IsNullOrWhiteSpace( options.WindowEnd ) && !( int.TryParse( options.WindowEnd, out var window_end ) && window_end >= 0 ) )
+			{
+				throw new ApplicationException( "Invalid end of window. Please enter a non-negative integer number." );
+			}
+
+			try
+			{
+				RecordSeparator = Regex.Unescape( options.RecordSeparator ?? "" );
+			}
+			catch( ArgumentException )
+			{
+				throw new ApplicationException( @"Invalid record separator. Please enter a text with escapes like '\n'." );
+			}
+
 			Pattern = pattern;
 		}
 
 
 		public static string GetIcuVersion( ICancellable cnc )
 		{
-			MemoryStream stdout_contents;
-			string stderr_contents;
+			// (the server is started early and stays alive; cancellation does not terminate it)
+			IcuServerProcess server = IcuServerProcess.GetInstance( GetIcuClientExePath( ) );
 
-			Action<Stream> stdinWriter = s =>
-			{
-				using( var bw = new BinaryWriter( s, Encoding.Unicode, leaveOpen: false ) )
-				{
-					bw.Write( "v" );
-				}
-			};
+			BinaryReader response = server.Call( "v", null, cnc );
 
-			if( !ProcessUtilities.InvokeExe( cnc, GetIcuClientExePath( ), null, stdinWriter, out stdout_contents, out stderr_contents, EncodingEnum.Unicode ) )
-			{
-				return "Unknown version";
-			}
+			if( response == null ) return "Unknown version";
 
-			using( var br = new BinaryReader( stdout_contents, Encoding.Unicode ) )
+			using( var br = response )
 			{
 				string version = br.ReadString( );
 
@@ -64,22 +95,8 @@ namespace IcuRegexEngineNs
 
 		public RegexMatches Matches( string text, ICancellable cnc )
 		{
-			MemoryStream stdout_contents;
-			string stderr_contents;
-
-			int limit;
-			if( !int.TryParse( Options.Limit, out limit ) ) limit = 0;
-
-			uint flags = 0;
-			if( Options.UREGEX_CANON_EQ ) flags |= 1 << 0;
-			if( Options.UREGEX_CASE_INSENSITIVE ) flags |= 1 << 1;
-			if( Options.UREGEX_COMMENTS ) flags |= 1 << 2;
-			if( Options.UREGEX_DOTALL ) flags |= 1 << 3;
-			if( Options.UREGEX_LITERAL ) flags |= 1 << 4;
-			if( Options.UREGEX_MULTILINE ) flags |= 1 << 5;
-			if( Options.UREGEX_UNIX_LINES ) flags |= 1 << 6;
-			if( Options.UREGEX_UWORD ) flags |= 1 << 7;
-			if( Options.UREGEX_ERROR_ON_UNKNOWN_ESCAPES ) flags |= 1 << 8;
+			int limit = GetLimit( );
+			uint flags = GetFlags( );
 
 #if DEBUG
 			{
@@ -98,106 +115,229 @@ namespace IcuRegexEngineNs
 			}
 #endif
 
-			Action<Stream> stdinWriter = s =>
+			// (the server keeps the process and the compiled patterns between calls)
+			IcuServerProcess server = IcuServerProcess.GetInstance( GetIcuClientExePath( ) );
+
+			BinaryReader response;
+
+			if( text.Length >= SharedMemoryThreshold )
+			{
+				response = CallWithSharedMemory( server, text, flags, limit, cnc );
+			}
+			else
 			{
-				using( var bw = new BinaryWriter( s, Encoding.Unicode, leaveOpen: false ) )
+				response = server.Call( "m", bw =>
 				{
-					bw.Write( "m" );
 					bw.Write( Pattern );
 					bw.Write( text );
 					bw.Write( flags );
-					bw.Write( limit );
-				}
-			};
+					WriteMatchOptions( bw, limit );
+				}, cnc );
+			}
+
+			if( response == null ) return RegexMatches.Empty; // (cancelled)
 
-			if( !ProcessUtilities.InvokeExe( cnc, GetIcuClientExePath( ), null, stdinWriter, out stdout_contents, out stderr_contents, EncodingEnum.Unicode ) )
+			try
+			{
+				// (the matches are read while the client is still searching)
+				using( var br = response )
+				{
+					return ReadMatches( br, new SimpleTextGetter( text ) );
+				}
+			}
+			catch( OperationCanceledException )
 			{
 				return RegexMatches.Empty;
 			}
+		}
+
+		#endregion IMatcher
+
+
+		int GetLimit( )
+		{
+			int limit;
+			if( !int.TryParse( Options.Limit, out limit ) ) limit = 0;
 
-			if( !string.IsNullOrWhiteSpace( stderr_contents ) )
+			return limit;
+		}
+
+
+		uint GetFlags( )
+		{
+			uint flags = 0;
+			if( Options.UREGEX_CANON_EQ ) flags |= 1 << 0;
+			if( Options.UREGEX_CASE_INSENSITIVE ) flags |= 1 << 1;
+			if( Options.UREGEX_COMMENTS ) flags |= 1 << 2;
+			if( Options.UREGEX_DOTALL ) flags |= 1 << 3;
+			if( Options.UREGEX_LITERAL ) flags |= 1 << 4;
+			if( Options.UREGEX_MULTILINE ) flags |= 1 << 5;
+			if( Options.UREGEX_UNIX_LINES ) flags |= 1 << 6;
+			if( Options.UREGEX_UWORD ) flags |= 1 << 7;
+			if( Options.UREGEX_ERROR_ON_UNKNOWN_ESCAPES ) flags |= 1 << 8;
+
+			return flags;
+		}
+
+
+		void WriteMatchOptions( BinaryWriter bw, int limit )
+		{
+			// (see 'MatchOptions' in IcuClient)
+			bw.Write( limit );
+			bw.Write( int.TryParse( Options.StackLimit, out int stack_limit ) ? stack_limit : -1 ); // (-1: default)
+			bw.Write( Options.Parallel ? Environment.ProcessorCount : 0 );
+			bw.Write( RecordSeparator );
+			bw.Write( int.TryParse( Options.MaxMatches, out int max_matches ) ? max_matches : 0 ); // (0: all)
+			bw.Write( int.TryParse( Options.WindowStart, out int window_start ) ? window_start : 0 );
+			bw.Write( int.TryParse( Options.WindowEnd, out int window_end ) ? window_end : -1 ); // (-1: the end of text)
+		}
+
+
+		static RegexMatches ReadMatches( BinaryReader br, ISimpleTextGetter stg )
+		{
+			// read group names
+
+			var group_names = new Dictionary<int, string>( );
+
+			for(; ; )
 			{
-				throw new Exception( stderr_contents );
+				int i = br.ReadInt32( );
+				if( i <= 0 ) break;
+
+				string name = br.ReadString( );
+
+				group_names.Add( i, name );
 			}
 
-			using( var br = new BinaryReader( stdout_contents, Encoding.Unicode ) )
-			{
-				// read group names
+			// read matches (see 'WriteMatches' in IcuClient)
 
-				var group_names = new Dictionary<int, string>( );
+			List<IMatch> matches = new List<IMatch>( );
 
-				for(; ; )
+			int group_count = Read7BitEncodedInt( br );
+			int bitmap_length = ( group_count + 7 ) / 8;
+			string[] names = new string[group_count + 1];
+
+			for( int i = 1; i <= group_count; ++i )
+			{
+				if( !group_names.TryGetValue( i, out names[i] ) )
 				{
-					int i = br.ReadInt32( );
-					if( i <= 0 ) break;
+					names[i] = i.ToString( CultureInfo.InvariantCulture );
+				}
+			}
 
-					string name = br.ReadString( );
+			int previous_end = 0;
 
-					group_names.Add( i, name );
-				}
+			for(; ; )
+			{
+				int distance = Read7BitEncodedInt( br );
+				if( distance == 0 ) break;
 
-				// read matches
+				int start0 = previous_end + distance - 1;
+				int length0 = Read7BitEncodedInt( br );
 
-				List<IMatch> matches = new List<IMatch>( );
-				ISimpleTextGetter stg = null;
+				previous_end = start0 + length0;
 
-				for(; ; )
-				{
-					int group_count = br.ReadInt32( );
-					if( group_count < 0 ) break;
+				SimpleMatch match = SimpleMatch.Create( start0, length0, stg );
+				match.AddGroup( start0, length0, true, "0" );
 
-					SimpleMatch match = null; ;
+				if( group_count > 0 )
+				{
+					byte[] bitmap = br.ReadBytes( bitmap_length );
+					if( bitmap.Length != bitmap_length ) throw new FormatException( "The response of IcuClient is truncated." );
 
-					for( int i = 0; i <= group_count; ++i )
+					for( int i = 1; i <= group_count; ++i )
 					{
-						int start = br.ReadInt32( );
-						bool success = start >= 0;
-						int end;
-						int length;
-						if( success )
+						if( ( bitmap[( i - 1 ) / 8] & ( 1 << ( ( i - 1 ) % 8 ) ) ) == 0 )
 						{
-							end = br.ReadInt32( );
-							length = success ? end - start : 0;
+							match.AddGroup( -1, 0, false, names[i] );
 						}
 						else
 						{
-							end = 0;
-							length = 0;
+							uint zigzag = unchecked((uint)Read7BitEncodedInt( br ));
+							int start = start0 + ( (int)( zigzag >> 1 ) ^ -(int)( zigzag & 1 ) );
+							int length = Read7BitEncodedInt( br );
+
+							match.AddGroup( start, length, true, names[i] );
 						}
+					}
+				}
 
-						if( i == 0 )
-						{
-							Debug.Assert( success );
-							Debug.Assert( match == null );
+				matches.Add( match );
+			}
 
-							if( stg == null ) stg = new SimpleTextGetter( text );
+			return new RegexMatches( matches.Count, matches );
+		}
 
-							match = SimpleMatch.Create( start, length, stg );
-							match.AddGroup( start, length, success, "0" );
-						}
-						else
-						{
-							string name;
 
-							if( !group_names.TryGetValue( i, out name ) )
-							{
-								name = i.ToString( CultureInfo.InvariantCulture );
-							}
+		BinaryReader CallWithSharedMemory( IcuServerProcess server, string text, uint flags, int limit, ICancellable cnc )
+		{
+			lock( SharedMemoryLocker )
+			{
+				TextMemory = IcuSharedMemory.Ensure( TextMemory, (long)text.Length * sizeof( char ), MinimumTextMemoryCapacity );
+				OutputMemory = IcuSharedMemory.Ensure( OutputMemory, 0, MinimumOutputMemoryCapacity );
 
-							match.AddGroup( start, length, success, name );
-						}
-					}
+				TextMemory.WriteText( text );
+
+				BinaryReader response = server.Call( "ms", bw =>
+				{
+					bw.Write( Pattern );
+					bw.Write( TextMemory.Name );
+					bw.Write( text.Length );
+					bw.Write( OutputMemory.Name );
+					bw.Write( checked((int)OutputMemory.Capacity) );
+					bw.Write( flags );
+					WriteMatchOptions( bw, limit );
+				}, cnc );
+
+				if( response == null )
+				{
+					// the client can still be reading the text of the cancelled request; the next text goes to a new memory
+
+					TextMemory.Dispose( );
+					TextMemory = null;
 
-					Debug.Assert( match != null );
+					return null;
+				}
+
+				int size = response.ReadInt32( );
+
+				if( size >= 0 )
+				{
+					response.Dispose( );
 
-					matches.Add( match );
+					return new BinaryReader( new MemoryStream( OutputMemory.ReadBytes( size ), writable: false ), Encoding.Unicode );
 				}
 
-				return new RegexMatches( matches.Count, matches );
+				// the output did not fit and is in the response; the next one will probably be large too
+
+				long output_size = response.BaseStream.Length - response.BaseStream.Position;
+
+				if( output_size <= int.MaxValue / 4 ) OutputMemory = IcuSharedMemory.Ensure( OutputMemory, output_size * 2, MinimumOutputMemoryCapacity );
+
+				return response;
 			}
 		}
 
-		#endregion IMatcher
+
+		static int Read7BitEncodedInt( BinaryReader br )
+		{
+			// (the same as the protected 'BinaryReader.Read7BitEncodedInt')
+
+			uint value = 0;
+			int shift = 0;
+			byte b;
+
+			do
+			{
+				if( shift == 5 * 7 ) throw new FormatException( "Invalid 7-bit encoded integer." );
+
+				b = br.ReadByte( );
+				value |= (uint)( b & 0x7F ) << shift;
+				shift += 7;
+			} while( ( b & 0x80 ) != 0 );
+
+			return unchecked((int)value);
+		}
 
 
 		static string GetIcuClientExePath( )
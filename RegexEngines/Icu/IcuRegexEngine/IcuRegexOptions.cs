@@ -21,6 +21,14 @@ namespace IcuRegexEngineNs
 
 
 		public string Limit { get; set; }
+		public string StackLimit { get; set; } // (bytes; empty for default)
+
+		public bool Parallel { get; set; }
+		public string RecordSeparator { get; set; } // (with escapes like "\n"; empty for line feed)
+
+		public string MaxMatches { get; set; } // (empty for all)
+		public string WindowStart { get; set; } // (the matches that begin in the window; empty for the whole text)
+		public string WindowEnd { get; set; }
 
 
 		public IcuRegexOptions Clone( )
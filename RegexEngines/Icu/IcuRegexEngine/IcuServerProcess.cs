@@ -0,0 +1,486 @@
+﻿using RegexEngineInfrastructure;
+using System;
+using System.Collections.Generic;
+using System.ComponentModel;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using System.Reflection;
+using System.Text;
+using System.Threading;
+
+
+namespace IcuRegexEngineNs
+{
+	/// <summary>
+	/// IcuClient that stays alive in server mode and answers the requests sent in frames
+	/// (see 'IcuServer' in IcuClient). The process and the compiled patterns are reused between calls.
+	/// </summary>
+	sealed class IcuServerProcess : IDisposable
+	{
+		const byte StatusOk = 0;
+		const byte StatusError = 1;
+		const byte StatusCancelled = 2;
+		const byte StatusPartial = 3;
+
+		static readonly Encoding UnicodeEncoding = new UnicodeEncoding( bigEndian: false, byteOrderMark: false, throwOnInvalidBytes: true );
+
+		static readonly object StaticLocker = new object( );
+		static IcuServerProcess Instance;
+
+		readonly Process Process;
+		readonly Stream Input;
+		readonly Thread ReaderThread;
+		readonly object WriteLocker = new object( );
+		readonly Dictionary<int, PendingRequest> PendingRequests = new Dictionary<int, PendingRequest>( );
+		readonly StringBuilder ErrorSb = new StringBuilder( );
+		int LastId = 0;
+		volatile bool IsBroken = false;
+
+
+		class PendingRequest
+		{
+			public readonly SemaphoreSlim Available = new SemaphoreSlim( 0 );
+			public readonly Queue<byte[]> Responses = new Queue<byte[]>( ); // (null if the process has terminated)
+		}
+
+
+		IcuServerProcess( string exePath )
+		{
+			Process = new Process( );
+
+			Process.StartInfo.FileName = exePath;
+
+			Process.StartInfo.UseShellExecute = false;
+			Process.StartInfo.CreateNoWindow = true;
+			Process.StartInfo.WindowStyle = ProcessWindowStyle.Hidden;
+
+			Process.StartInfo.RedirectStandardInput = true;
+			Process.StartInfo.RedirectStandardOutput = true;
+			Process.StartInfo.RedirectStandardError = true;
+			Process.StartInfo.StandardErrorEncoding = UnicodeEncoding;
+
+			Process.ErrorDataReceived += ( s, a ) =>
+			{
+				lock( ErrorSb )
+				{
+					if( ErrorSb.Length < 4096 ) ErrorSb.AppendLine( a.Data );
+				}
+			};
+
+			Process.Start( );
+			Process.BeginErrorReadLine( );
+
+			Input = Process.StandardInput.BaseStream;
+
+			// enter server mode
+			using( var bw = new BinaryWriter( Input, UnicodeEncoding, leaveOpen: true ) )
+			{
+				bw.Write( "s" );
+			}
+			Input.Flush( );
+
+			ReaderThread = new Thread( ReaderProc );
+			ReaderThread.IsBackground = true;
+			ReaderThread.Start( );
+		}
+
+
+		/// <summary>
+		/// Returns the running server; starts a new one if it does not exist or has terminated.
+		/// </summary>
+		public static IcuServerProcess GetInstance( string exePath )
+		{
+			lock( StaticLocker )
+			{
+				if( Instance == null || Instance.IsBroken )
+				{
+					Instance?.Dispose( );
+
+					Instance = new IcuServerProcess( exePath );
+
+					AppDomain.CurrentDomain.ProcessExit -= CurrentDomain_ProcessExit;
+					AppDomain.CurrentDomain.ProcessExit += CurrentDomain_ProcessExit;
+				}
+
+				return Instance;
+			}
+		}
+
+
+		/// <summary>
+		/// Sends the request and waits for the response. Returns a reader positioned after the status,
+		/// or null if cancelled. Throws an exception with the error message returned by the server.
+		/// If the server sends the output in parts ('Partial' status), the returned reader waits for the
+		/// next parts while reading; it throws 'OperationCanceledException' if cancelled in the meantime.
+		/// </summary>
+		public BinaryReader Call( string command, Action<BinaryWriter> argumentsWriter, ICancellable cnc )
+		{
+			var pending = new PendingRequest( );
+			int id = SendRequest( command, argumentsWriter, pending );
+			var stream = new ResponseStream( this, id, pending, cnc );
+
+			try
+			{
+				byte[] response = stream.ReadFirst( );
+
+				if( response == null ) // (cancelled)
+				{
+					stream.Dispose( );
+
+					return null;
+				}
+
+				if( stream.IsComplete )
+				{
+					stream.Dispose( );
+
+					// (a single response; the status is skipped)
+					return new BinaryReader( new MemoryStream( response, sizeof( int ) + 1, response.Length - sizeof( int ) - 1, writable: false ), UnicodeEncoding );
+				}
+
+				return new BinaryReader( stream, UnicodeEncoding );
+			}
+			catch
+			{
+				stream.Dispose( );
+
+				throw;
+			}
+		}
+
+
+		void Cancel( int id )
+		{
+			// the server answers with 'Cancelled', which will be ignored
+
+			if( IsBroken ) return;
+
+			try
+			{
+				SendRequest( "x", bw => bw.Write( id ), null );
+			}
+			catch( IOException )
+			{
+				// (the process has terminated)
+			}
+		}
+
+
+		Exception GetTerminationException( )
+		{
+			string error_text;
+			lock( ErrorSb ) error_text = ErrorSb.ToString( );
+
+			return new Exception( $"IcuClient has terminated unexpectedly.\r\n\r\n{error_text}".Trim( ) );
+		}
+
+
+		int SendRequest( string command, Action<BinaryWriter> argumentsWriter, PendingRequest pending )
+		{
+			lock( WriteLocker ) // (the IDs must increase in the order of sending)
+			{
+				int id = ++LastId;
+
+				if( pending != null )
+				{
+					lock( PendingRequests ) PendingRequests.Add( id, pending );
+				}
+
+				var ms = new MemoryStream( );
+
+				using( var bw = new BinaryWriter( ms, UnicodeEncoding, leaveOpen: true ) )
+				{
+					bw.Write( id );
+					bw.Write( command );
+					argumentsWriter?.Invoke( bw );
+				}
+
+				try
+				{
+					Input.Write( BitConverter.GetBytes( checked((int)ms.Length) ), 0, sizeof( int ) );
+					ms.WriteTo( Input );
+					Input.Flush( );
+				}
+				catch( Exception )
+				{
+					IsBroken = true;
+
+					if( pending != null )
+					{
+						lock( PendingRequests ) PendingRequests.Remove( id );
+					}
+
+					throw;
+				}
+
+				return id;
+			}
+		}
+
+
+		void ReaderProc( )
+		{
+			try
+			{
+				Stream output = Process.StandardOutput.BaseStream;
+				byte[] length_bytes = new byte[sizeof( int )];
+
+				for(; ; )
+				{
+					if( !ReadExactly( output, length_bytes ) ) break;
+
+					int length = BitConverter.ToInt32( length_bytes, 0 );
+					if( length < sizeof( int ) ) break;
+
+					byte[] payload = new byte[length];
+					if( !ReadExactly( output, payload ) ) break;
+
+					int id = BitConverter.ToInt32( payload, 0 );
+					PendingRequest pending;
+
+					lock( PendingRequests )
+					{
+						if( !PendingRequests.TryGetValue( id, out pending ) ) continue; // (cancelled)
+					}
+
+					lock( pending.Responses ) pending.Responses.Enqueue( payload );
+					pending.Available.Release( );
+				}
+			}
+			catch( Exception exc )
+			{
+				_ = exc;
+				// (treated as termination)
+			}
+
+			IsBroken = true;
+
+			lock( PendingRequests )
+			{
+				foreach( var pending in PendingRequests.Values )
+				{
+					lock( pending.Responses ) pending.Responses.Enqueue( null );
+					pending.Available.Release( );
+				}
+			}
+		}
+
+
+		static bool ReadExactly( Stream stream, byte[] buffer )
+		{
+			int offset = 0;
+
+			while( offset < buffer.Length )
+			{
+				int n = stream.Read( buffer, offset, buffer.Length - offset );
+				if( n <= 0 ) return false;
+
+				offset += n;
+			}
+
+			return true;
+		}
+
+
+		/// <summary>
+		/// The output of a request that is answered in parts; the parts are read when they arrive.
+		/// </summary>
+		sealed class ResponseStream : Stream
+		{
+			readonly IcuServerProcess Server;
+			readonly int Id;
+			readonly PendingRequest Pending;
+			readonly ICancellable Cnc;
+			byte[] Response; // (the current part)
+			int Offset;
+			bool IsRemoved = false;
+
+			public bool IsComplete { get; private set; } = false;
+
+
+			public ResponseStream( IcuServerProcess server, int id, PendingRequest pending, ICancellable cnc )
+			{
+				Server = server;
+				Id = id;
+				Pending = pending;
+				Cnc = cnc;
+			}
+
+
+			/// <summary>
+			/// Waits for the first response. Returns null if cancelled.
+			/// </summary>
+			public byte[] ReadFirst( )
+			{
+				return ReadNext( ) ? Response : null;
+			}
+
+
+			bool ReadNext( )
+			{
+				for(; ; )
+				{
+					if( Cnc.IsCancellationRequested )
+					{
+						Remove( );
+
+						return false;
+					}
+
+					if( Pending.Available.Wait( 22 ) ) break;
+
+					if( Server.IsBroken && Pending.Available.CurrentCount == 0 ) throw Server.GetTerminationException( );
+				}
+
+				byte[] response;
+				lock( Pending.Responses ) response = Pending.Responses.Dequeue( );
+
+				if( response == null ) throw Server.GetTerminationException( );
+
+				byte status = response[sizeof( int )];
+
+				switch( status )
+				{
+				case StatusOk:
+					IsComplete = true;
+					Remove( );
+					break;
+				case StatusPartial:
+					break;
+				case StatusError:
+					IsComplete = true;
+					Remove( );
+					using( var br = new BinaryReader( new MemoryStream( response, sizeof( int ) + 1, response.Length - sizeof( int ) - 1, writable: false ), UnicodeEncoding ) )
+					{
+						throw new Exception( br.ReadString( ) );
+					}
+				case StatusCancelled:
+					IsComplete = true;
+					Remove( );
+					return false;
+				default:
+					IsComplete = true;
+					Remove( );
+					throw new Exception( $"Invalid response from IcuClient: {status}" );
+				}
+
+				Response = response;
+				Offset = sizeof( int ) + 1;
+
+				return true;
+			}
+
+
+			void Remove( )
+			{
+				if( IsRemoved ) return;
+				IsRemoved = true;
+
+				lock( Server.PendingRequests ) Server.PendingRequests.Remove( Id );
+
+				if( !IsComplete ) Server.Cancel( Id ); // (the rest is not needed)
+			}
+
+
+			bool EnsureData( )
+			{
+				while( Offset >= Response.Length )
+				{
+					if( IsComplete ) return false;
+
+					if( !ReadNext( ) ) throw new OperationCanceledException( );
+				}
+
+				return true;
+			}
+
+
+			public override int Read( byte[] buffer, int offset, int count )
+			{
+				if( count == 0 || !EnsureData( ) ) return 0;
+
+				int n = Math.Min( count, Response.Length - Offset );
+
+				Buffer.BlockCopy( Response, Offset, buffer, offset, n );
+				Offset += n;
+
+				return n;
+			}
+
+
+			public override int ReadByte( )
+			{
+				if( !EnsureData( ) ) return -1;
+
+				return Response[Offset++];
+			}
+
+
+			public override bool CanRead => true;
+			public override bool CanSeek => false;
+			public override bool CanWrite => false;
+			public override long Length => throw new NotSupportedException( );
+			public override long Position { get => throw new NotSupportedException( ); set => throw new NotSupportedException( ); }
+			public override void Flush( ) { }
+			public override long Seek( long offset, SeekOrigin origin ) => throw new NotSupportedException( );
+			public override void SetLength( long value ) => throw new NotSupportedException( );
+			public override void Write( byte[] buffer, int offset, int count ) => throw new NotSupportedException( );
+
+
+			protected override void Dispose( bool disposing )
+			{
+				if( disposing ) Remove( );
+
+				base.Dispose( disposing );
+			}
+		}
+
+
+		static void CurrentDomain_ProcessExit( object sender, EventArgs e )
+		{
+			lock( StaticLocker )
+			{
+				Instance?.Dispose( );
+				Instance = null;
+			}
+		}
+
+
+		#region IDisposable
+
+		bool IsDisposed = false;
+
+		public void Dispose( )
+		{
+			if( IsDisposed ) return;
+			IsDisposed = true;
+
+			IsBroken = true;
+
+			try
+			{
+				// closing the input stops the server
+
+				lock( WriteLocker ) Input.Close( );
+
+				if( !Process.WaitForExit( 444 ) ) Process.Kill( );
+			}
+			catch( Win32Exception )
+			{
+				// (the process is terminating)
+			}
+			catch( Exception exc )
+			{
+				_ = exc;
+				if( Debugger.IsAttached ) Debugger.Break( );
+
+				// ignore
+			}
+
+			Process.Dispose( );
+		}
+
+		#endregion IDisposable
+	}
+}
@@ -0,0 +1,101 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO.MemoryMappedFiles;
+using System.Threading;
+
+
+namespace IcuRegexEngineNs
+{
+	/// <summary>
+	/// Named memory shared with IcuClient (see the "ms" command in 'IcuServer'). Large texts are copied
+	/// once into the memory instead of being serialised into the pipe, and the output is read back directly.
+	/// </summary>
+	sealed class IcuSharedMemory : IDisposable
+	{
+		const int ChunkLength = 64 * 1024; // (chars)
+
+		static int LastNumber = 0;
+
+		public readonly string Name;
+		public readonly long Capacity; // (bytes)
+
+		readonly MemoryMappedFile MemoryMappedFile;
+		readonly MemoryMappedViewAccessor Accessor;
+		string Text; // (the last written text)
+
+
+		IcuSharedMemory( long capacity )
+		{
+			Name = $@"Local\RegExpress-Icu-{Process.GetCurrentProcess( ).Id}-{Interlocked.Increment( ref LastNumber )}";
+			Capacity = capacity;
+
+			MemoryMappedFile = MemoryMappedFile.CreateNew( Name, capacity, MemoryMappedFileAccess.ReadWrite );
+			Accessor = MemoryMappedFile.CreateViewAccessor( 0, capacity, MemoryMappedFileAccess.ReadWrite );
+		}
+
+
+		/// <summary>
+		/// Returns the given memory if it holds at least 'size' bytes, otherwise disposes it and creates a larger one.
+		/// </summary>
+		public static IcuSharedMemory Ensure( IcuSharedMemory memory, long size, long minimumCapacity )
+		{
+			if( memory != null && memory.Capacity >= size ) return memory;
+
+			memory?.Dispose( );
+
+			long capacity = minimumCapacity;
+			while( capacity < size ) capacity *= 2;
+
+			return new IcuSharedMemory( capacity );
+		}
+
+
+		/// <summary>
+		/// Copies the text to the beginning of the memory, unless the same string was copied last time.
+		/// </summary>
+		public void WriteText( string text )
+		{
+			if( object.ReferenceEquals( text, Text ) ) return;
+
+			Text = null;
+
+			char[] chunk = new char[Math.Min( ChunkLength, text.Length )];
+
+			for( int i = 0; i < text.Length; i += chunk.Length )
+			{
+				int count = Math.Min( chunk.Length, text.Length - i );
+
+				text.CopyTo( i, chunk, 0, count );
+				Accessor.WriteArray( (long)i * sizeof( char ), chunk, 0, count );
+			}
+
+			Text = text;
+		}
+
+
+		public byte[] ReadBytes( int size )
+		{
+			byte[] bytes = new byte[size];
+
+			Accessor.ReadArray( 0, bytes, 0, size );
+
+			return bytes;
+		}
+
+
+		#region IDisposable
+
+		bool IsDisposed = false;
+
+		public void Dispose( )
+		{
+			if( IsDisposed ) return;
+			IsDisposed = true;
+
+			Accessor.Dispose( );
+			MemoryMappedFile.Dispose( );
+		}
+
+		#endregion IDisposable
+	}
+}
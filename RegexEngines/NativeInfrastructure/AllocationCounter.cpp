@@ -0,0 +1,138 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "AllocationCounter.h"
+
+
+namespace
+{
+	struct alignas( alignof( std::max_align_t ) ) BlockHeader
+	{
+		size_t Size;
+		uint32_t Session; // (0 -- not counted)
+	};
+
+
+	std::atomic<uint32_t> CurrentSession{ 0 };
+	std::atomic_bool Counting{ false };
+
+	std::atomic<uint64_t> Count{ 0 };
+	std::atomic<uint64_t> Bytes{ 0 };
+	std::atomic<int64_t> LiveBytes{ 0 };
+	std::atomic<int64_t> PeakLiveBytes{ 0 };
+
+
+	void AddLiveBytes( int64_t delta )
+	{
+		int64_t const live = LiveBytes.fetch_add( delta, std::memory_order_relaxed ) + delta;
+		int64_t peak = PeakLiveBytes.load( std::memory_order_relaxed );
+
+		while( live > peak && !PeakLiveBytes.compare_exchange_weak( peak, live, std::memory_order_relaxed ) ) {}
+	}
+
+
+	void* Allocate( size_t size )
+	{
+		if( size > SIZE_MAX - sizeof( BlockHeader ) ) return nullptr;
+
+		BlockHeader* header = static_cast<BlockHeader*>( malloc( sizeof( BlockHeader ) + size ) );
+		if( header == nullptr ) return nullptr;
+
+		header->Size = size;
+		header->Session = Counting.load( std::memory_order_relaxed ) ? CurrentSession.load( std::memory_order_relaxed ) : 0;
+
+		if( header->Session != 0 )
+		{
+			Count.fetch_add( 1, std::memory_order_relaxed );
+			Bytes.fetch_add( size, std::memory_order_relaxed );
+			AddLiveBytes( static_cast<int64_t>( size ) );
+		}
+
+		return header + 1;
+	}
+
+
+	BlockHeader* GetHeader( void* block )
+	{
+		return static_cast<BlockHeader*>( block ) - 1;
+	}
+}
+
+
+extern "C" void* RegexCoreCountedMalloc( size_t size )
+{
+	return Allocate( size );
+}
+
+
+extern "C" void* RegexCoreCountedCalloc( size_t count, size_t size )
+{
+	if( size != 0 && count > SIZE_MAX / size ) return nullptr;
+
+	void* block = Allocate( count * size );
+
+	if( block != nullptr ) memset( block, 0, count * size );
+
+	return block;
+}
+
+
+extern "C" void* RegexCoreCountedRealloc( void* block, size_t size )
+{
+	if( block == nullptr ) return Allocate( size );
+
+	// (a new block, so that the reallocation is counted like an allocation)
+
+	void* new_block = Allocate( size );
+	if( new_block == nullptr ) return nullptr;
+
+	memcpy( new_block, block, GetHeader( block )->Size < size ? GetHeader( block )->Size : size );
+	RegexCoreCountedFree( block );
+
+	return new_block;
+}
+
+
+extern "C" void RegexCoreCountedFree( void* block )
+{
+	if( block == nullptr ) return;
+
+	BlockHeader* header = GetHeader( block );
+
+	if( header->Session != 0 && header->Session == CurrentSession.load( std::memory_order_relaxed ) )
+	{
+		AddLiveBytes( -static_cast<int64_t>( header->Size ) );
+	}
+
+	free( header );
+}
+
+
+extern "C" void RegexCoreStartAllocationCounting( void )
+{
+	Counting = false;
+
+	Count = 0;
+	Bytes = 0;
+	LiveBytes = 0;
+	PeakLiveBytes = 0;
+
+	uint32_t session = CurrentSession.load( ) + 1;
+	if( session == 0 ) session = 1;
+
+	CurrentSession = session;
+	Counting = true;
+}
+
+
+extern "C" void RegexCoreStopAllocationCounting( RegexCoreAllocationStats* stats )
+{
+	Counting = false;
+
+	stats->Count = Count;
+	stats->Bytes = Bytes;
+	stats->PeakLiveBytes = static_cast<uint64_t>( PeakLiveBytes.load( ) );
+}
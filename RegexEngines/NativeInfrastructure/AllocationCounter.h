@@ -0,0 +1,44 @@
+#pragma once
+
+// Counting of the allocations of the engines, for the benchmark (see "RegexBenchmark.cpp").
+//
+// The cores are compiled with 'REGEX_CORE_COUNT_ALLOCATIONS' there: PCRE2 allocates through a general context
+// with these functions (see "Pcre2Core.cpp"), Oniguruma through its 'xmalloc' macros (see "regint.h"); the
+// allocations of C++ engines (RE2, Boost.Regex, std::regex) and of the cores themselves are counted by the global
+// 'operator new' of the benchmark. Other builds do not use this file.
+//
+// The counters are process-wide, therefore the allocations of the threads of the scans are included.
+// The blocks have a header with the size; the ones that are allocated while the counting is off are not
+// counted when they are released.
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	typedef struct RegexCoreAllocationStats
+	{
+		uint64_t Count; // (the number of allocations, including reallocations)
+		uint64_t Bytes; // (the total of requested sizes)
+		uint64_t PeakLiveBytes; // (the maximum of counted blocks that were not released)
+	} RegexCoreAllocationStats;
+
+
+	void* RegexCoreCountedMalloc( size_t size );
+	void* RegexCoreCountedCalloc( size_t count, size_t size );
+	void* RegexCoreCountedRealloc( void* block, size_t size );
+	void RegexCoreCountedFree( void* block );
+
+	// Resets the statistics and turns the counting on; the blocks that are alive are not included.
+	void RegexCoreStartAllocationCounting( void );
+
+	// Turns the counting off and returns the statistics since the start.
+	void RegexCoreStopAllocationCounting( RegexCoreAllocationStats* stats );
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,187 @@
+#include "CompiledPatternCache.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace NativeInfrastructure
+{
+	namespace
+	{
+		struct Entry
+		{
+			std::string Key;
+			void* Regex;
+			size_t Bytes;
+			CompiledPatternFreeProc* Free;
+			size_t References;
+			bool IsCached; // (false -- evicted, or a duplicate of a cached pattern)
+			std::list<Entry*>::iterator Position; // (in 'mRecent' if cached)
+		};
+
+
+		class Cache final
+		{
+		public:
+
+			void* Acquire( const std::string& key )
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+
+				auto f = mIndex.find( key );
+
+				if( f == mIndex.end( ) )
+				{
+					++mStatistics.Misses;
+
+					return nullptr;
+				}
+
+				Entry* e = f->second;
+
+				mRecent.splice( mRecent.begin( ), mRecent, e->Position );
+				++e->References;
+				++mStatistics.Hits;
+
+				return e->Regex;
+			}
+
+			void Add( const std::string& key, void* regex, size_t bytes, CompiledPatternFreeProc* free )
+			{
+				std::vector<Entry> released;
+
+				{
+					std::lock_guard<std::mutex> lock( mMutex );
+
+					std::unique_ptr<Entry> e( new Entry{ key, regex, bytes, free, 1, false, mRecent.end( ) } );
+					Entry* p = e.get( );
+
+					mEntries.emplace( regex, std::move( e ) );
+
+					// (the same pattern could be compiled by two threads; the second one is not cached)
+					if( mIndex.count( key ) != 0 ) return;
+
+					mRecent.push_front( p );
+					p->Position = mRecent.begin( );
+					p->IsCached = true;
+					mIndex.emplace( key, p );
+
+					++mStatistics.Count;
+					mStatistics.Bytes += bytes;
+
+					while( !mRecent.empty( ) && ( mStatistics.Count > CompiledPatternCacheCapacity || mStatistics.Bytes > CompiledPatternCacheByteCapacity ) )
+					{
+						Evict( mRecent.back( ), &released );
+					}
+				}
+
+				for( const Entry& e : released ) e.Free( e.Regex );
+			}
+
+			void Release( void* regex )
+			{
+				Entry released{};
+
+				{
+					std::lock_guard<std::mutex> lock( mMutex );
+
+					auto f = mEntries.find( regex );
+					if( f == mEntries.end( ) ) return;
+
+					Entry* e = f->second.get( );
+
+					if( --e->References != 0 || e->IsCached ) return;
+
+					released = *e;
+					mEntries.erase( f );
+				}
+
+				released.Free( released.Regex );
+			}
+
+			CompiledPatternCacheStatistics GetStatistics( )
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+
+				return mStatistics;
+			}
+
+		private:
+
+			std::mutex mMutex;
+			std::list<Entry*> mRecent; // (the cached patterns; the most recently used first)
+			std::unordered_map<std::string, Entry*> mIndex; // (the cached patterns)
+			std::unordered_map<void*, std::unique_ptr<Entry>> mEntries; // (all patterns that have references or are cached)
+			CompiledPatternCacheStatistics mStatistics{};
+
+			// Removes the pattern from the cache; adds it to 'released' if it is not used.
+			void Evict( Entry* e, std::vector<Entry>* released )
+			{
+				mRecent.erase( e->Position );
+				mIndex.erase( e->Key );
+				e->IsCached = false;
+
+				--mStatistics.Count;
+				mStatistics.Bytes -= e->Bytes;
+				++mStatistics.Evictions;
+
+				if( e->References == 0 )
+				{
+					released->push_back( *e );
+					mEntries.erase( e->Regex );
+				}
+			}
+		};
+
+
+		Cache& GetCache( )
+		{
+			static Cache* cache = new Cache; // (not destroyed at exit, when the engines can be unloaded)
+
+			return *cache;
+		}
+	}
+
+
+	std::string MakeCompiledPatternKey( const char* engine, const void* options, size_t optionsSize, const char16_t* pattern, size_t length )
+	{
+		std::string key( engine );
+
+		key.push_back( '\0' );
+		key.append( static_cast<const char*>( options ), optionsSize );
+		key.append( reinterpret_cast<const char*>( pattern ), length * sizeof( char16_t ) );
+
+		return key;
+	}
+
+
+	void* AcquireCompiledPattern( const std::string& key )
+	{
+		return GetCache( ).Acquire( key );
+	}
+
+
+	void AddCompiledPattern( const std::string& key, void* regex, size_t bytes, CompiledPatternFreeProc* free )
+	{
+		// (the estimate for the engines that do not tell the size, which is std::regex: a fixed part and a part that is proportional to the pattern)
+		if( bytes == 0 ) bytes = 1024 + 32 * key.size( );
+
+		GetCache( ).Add( key, regex, bytes, free );
+	}
+
+
+	void ReleaseCompiledPattern( void* regex )
+	{
+		if( regex != nullptr ) GetCache( ).Release( regex );
+	}
+
+
+	CompiledPatternCacheStatistics GetCompiledPatternCacheStatistics( )
+	{
+		return GetCache( ).GetStatistics( );
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// The most recently used compiled patterns of the interop (each module has its own cache), so that
+// the repeated compilations -- undo, redo, toggling of options -- take the existing pattern.
+//
+// The key consists of the engine, the canonical options (the bytes of the zero-initialized options structure
+// that was built from the option strings, therefore the order of the options does not matter) and the pattern.
+// The patterns are counted by references: a pattern that is evicted while a 'Matcher' uses it is released
+// by the last 'ReleaseCompiledPattern'. The cache keeps up to 'CompiledPatternCacheCapacity' patterns
+// and 'CompiledPatternCacheByteCapacity' bytes; the size of a pattern is given by the engine (PCRE2, RE2,
+// Boost.Regex, Oniguruma). The size of std::regex is unknown and estimated from the length of the pattern,
+// which rarely reaches the byte capacity, therefore its patterns are evicted by count.
+//
+// The invalid patterns are not cached. The cached patterns are not released at exit.
+// This file can be included in managed code.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace NativeInfrastructure
+{
+	const size_t CompiledPatternCacheCapacity = 64;
+	const size_t CompiledPatternCacheByteCapacity = 64 * 1024 * 1024;
+
+
+	typedef void CompiledPatternFreeProc( void* regex );
+
+
+	struct CompiledPatternCacheStatistics
+	{
+		uint64_t Hits;
+		uint64_t Misses;
+		uint64_t Evictions;
+		size_t Count; // (the cached patterns)
+		size_t Bytes;
+	};
+
+
+	std::string MakeCompiledPatternKey( const char* engine, const void* options, size_t optionsSize, const char16_t* pattern, size_t length );
+
+	// Returns the cached pattern with a new reference, or null (then the caller compiles it and calls 'AddCompiledPattern').
+	void* AcquireCompiledPattern( const std::string& key );
+
+	// Adds the compiled pattern with one reference of the caller. 'bytes' is the size of the pattern (0 -- unknown;
+	// then it is estimated from the length of the key, see above). Evicts the least recently used patterns.
+	void AddCompiledPattern( const std::string& key, void* regex, size_t bytes, CompiledPatternFreeProc* free );
+
+	// Releases the reference of 'AcquireCompiledPattern' or 'AddCompiledPattern'; the null is ignored.
+	void ReleaseCompiledPattern( void* regex );
+
+	CompiledPatternCacheStatistics GetCompiledPatternCacheStatistics( );
+
+}
@@ -0,0 +1,412 @@
+#include "LiteralAlternation.h"
+
+#include <algorithm>
+
+
+namespace NativeInfrastructure
+{
+	namespace
+	{
+		// (the limit of the table of transitions, 16 MB)
+		const size_t MaxTransitions = size_t( 1 ) << 22;
+
+
+		bool IsMetacharacter( char16_t c )
+		{
+			switch( c )
+			{
+			case u'\\':
+			case u'^':
+			case u'$':
+			case u'.':
+			case u'|':
+			case u'?':
+			case u'*':
+			case u'+':
+			case u'(':
+			case u')':
+			case u'[':
+			case u']':
+			case u'{':
+			case u'}':
+				return true;
+			default:
+				return false;
+			}
+		}
+
+
+		bool IsWordBoundaryAt( const char16_t* pattern, size_t length, size_t i )
+		{
+			return i + 1 < length && pattern[i] == u'\\' && pattern[i + 1] == u'b';
+		}
+	}
+
+
+	bool ParseLiteralAlternation( const char16_t* pattern, size_t length, LiteralAlternation* alternation )
+	{
+		LiteralAlternation a;
+		size_t i = 0;
+
+		if( IsWordBoundaryAt( pattern, length, i ) )
+		{
+			a.LeadingWordBoundary = true;
+			i += 2;
+		}
+
+		bool const group = i < length && pattern[i] == u'(';
+
+		if( group )
+		{
+			if( i + 1 < length && pattern[i + 1] == u'?' )
+			{
+				if( i + 2 >= length || pattern[i + 2] != u':' ) return false;
+
+				a.NonCapturingGroup = true;
+				i += 3;
+			}
+			else
+			{
+				a.CapturingGroup = true;
+				i += 1;
+			}
+		}
+
+		std::u16string word;
+
+		for( ;;)
+		{
+			if( i >= length )
+			{
+				if( group ) return false; // (not closed)
+
+				break;
+			}
+
+			char16_t const c = pattern[i];
+
+			if( c == u'|' )
+			{
+				if( word.empty( ) ) return false;
+
+				a.Words.push_back( word );
+				word.clear( );
+				++i;
+
+				continue;
+			}
+
+			if( c == u')' && group )
+			{
+				++i;
+
+				break;
+			}
+
+			if( c == u'\\' )
+			{
+				if( !group && i + 2 == length && pattern[i + 1] == u'b' )
+				{
+					a.TrailingWordBoundary = true;
+					i += 2;
+
+					break;
+				}
+
+				if( i + 1 >= length || !IsMetacharacter( pattern[i + 1] ) ) return false;
+
+				word += pattern[i + 1];
+				a.EscapedCharacters = true;
+				i += 2;
+
+				continue;
+			}
+
+			if( IsMetacharacter( c ) ) return false;
+
+			word += c;
+			++i;
+		}
+
+		if( word.empty( ) ) return false;
+
+		a.Words.push_back( word );
+
+		if( group && IsWordBoundaryAt( pattern, length, i ) )
+		{
+			a.TrailingWordBoundary = true;
+			i += 2;
+		}
+
+		if( i != length ) return false;
+
+		// (without a group, the boundaries belong to the first and the last alternative only)
+		if( !group && ( a.LeadingWordBoundary || a.TrailingWordBoundary ) && a.Words.size( ) > 1 ) return false;
+
+		// (a single word is a literal, which is searched by "LiteralSearch.h")
+		if( a.Words.size( ) < 2 && !a.LeadingWordBoundary && !a.TrailingWordBoundary ) return false;
+
+		*alternation = std::move( a );
+
+		return true;
+	}
+
+
+	std::unique_ptr<LiteralAlternationSearcher> LiteralAlternationSearcher::Create( const LiteralAlternation& alternation, Priority priority,
+		IsWordCharacterProc* isWordCharacter, const void* context )
+	{
+		std::unique_ptr<LiteralAlternationSearcher> searcher( new LiteralAlternationSearcher );
+
+		searcher->mPriority = priority;
+
+		// the classes of units: one for each unit of the words, and 0 for the rest
+
+		std::vector<uint16_t>& classes = searcher->mClasses;
+		classes.assign( 0x10000, 0 );
+
+		size_t number_of_classes = 1;
+
+		for( const std::u16string& word : alternation.Words )
+		{
+			for( char16_t c : word )
+			{
+				if( classes[c] == 0 ) classes[c] = static_cast<uint16_t>( number_of_classes++ );
+			}
+		}
+
+		size_t const nc = number_of_classes;
+
+		searcher->mNumberOfClasses = nc;
+
+		// the trie of words; the state 0 is the root
+
+		std::vector<int32_t>& transitions = searcher->mTransitions;
+		std::vector<int32_t>& depths = searcher->mDepths;
+		std::vector<int32_t>& word_indices = searcher->mWordIndices;
+
+		transitions.assign( nc, -1 );
+		depths.assign( 1, 0 );
+		word_indices.assign( 1, -1 );
+
+		for( size_t w = 0; w < alternation.Words.size( ); ++w )
+		{
+			const std::u16string& word = alternation.Words[w];
+			int32_t state = 0;
+
+			for( char16_t c : word )
+			{
+				size_t const t = state * nc + classes[c];
+
+				if( transitions[t] < 0 )
+				{
+					if( transitions.size( ) + nc > MaxTransitions ) return nullptr;
+
+					transitions[t] = static_cast<int32_t>( depths.size( ) );
+					transitions.resize( transitions.size( ) + nc, -1 );
+					depths.push_back( depths[state] + 1 );
+					word_indices.push_back( -1 );
+				}
+
+				state = transitions[t];
+			}
+
+			// (the repeated words match by the first alternative)
+			if( word_indices[state] < 0 ) word_indices[state] = static_cast<int32_t>( w );
+
+			searcher->mMaxLength = std::max( searcher->mMaxLength, word.size( ) );
+		}
+
+		// the failure links, by breadth-first traversal; the missing transitions are replaced
+		// by the transitions of the failure state, which makes a complete automaton
+
+		size_t const number_of_states = depths.size( );
+
+		std::vector<int32_t> failures( number_of_states, 0 );
+		std::vector<int32_t>& outputs = searcher->mOutputs;
+		std::vector<int32_t>& next_outputs = searcher->mNextOutputs;
+
+		outputs.assign( number_of_states, 0 );
+		next_outputs.assign( number_of_states, 0 );
+
+		std::vector<int32_t> queue;
+		queue.reserve( number_of_states );
+
+		for( size_t c = 0; c < nc; ++c )
+		{
+			int32_t& s = transitions[c];
+
+			if( s < 0 )
+			{
+				s = 0;
+			}
+			else
+			{
+				queue.push_back( s );
+			}
+		}
+
+		for( size_t q = 0; q < queue.size( ); ++q )
+		{
+			int32_t const r = queue[q];
+			int32_t const f = failures[r];
+
+			// (the failure state is shallower, therefore its outputs are known)
+			outputs[r] = word_indices[r] >= 0 ? r : outputs[f];
+			next_outputs[r] = outputs[f];
+
+			int32_t* row = transitions.data( ) + r * nc;
+			const int32_t* failure_row = transitions.data( ) + f * nc;
+
+			for( size_t c = 0; c < nc; ++c )
+			{
+				if( row[c] < 0 )
+				{
+					row[c] = failure_row[c];
+				}
+				else
+				{
+					failures[row[c]] = failure_row[c];
+					queue.push_back( row[c] );
+				}
+			}
+		}
+
+		// the rows instead of the states, which saves a multiplication for each unit of the text
+
+		for( int32_t& s : transitions )
+		{
+			s = outputs[s] != 0 ? -static_cast<int32_t>( s * nc ) : static_cast<int32_t>( s * nc );
+		}
+
+		// the word characters, for the boundaries
+
+		if( isWordCharacter != nullptr && ( alternation.LeadingWordBoundary || alternation.TrailingWordBoundary ) )
+		{
+			searcher->mLeadingWordBoundary = alternation.LeadingWordBoundary;
+			searcher->mTrailingWordBoundary = alternation.TrailingWordBoundary;
+			searcher->mIsWordCharacter = isWordCharacter;
+			searcher->mContext = context;
+
+			for( uint32_t c = 0; c < 256; ++c )
+			{
+				if( isWordCharacter( context, static_cast<char16_t>( c ) ) ) searcher->mLatin1WordCharacters[c / 32] |= uint32_t( 1 ) << ( c % 32 );
+			}
+		}
+
+		return searcher;
+	}
+
+
+	size_t LiteralAlternationSearcher::Find( const char16_t* text, size_t length, size_t start, size_t* matchLength ) const
+	{
+		const uint16_t* const classes = mClasses.data( );
+		const int32_t* const transitions = mTransitions.data( );
+		size_t const nc = mNumberOfClasses;
+
+		size_t best = LiteralNotFound;
+		size_t best_length = 0;
+		int32_t best_word = 0;
+
+		size_t limit = length;
+		size_t row = 0;
+
+		for( size_t j = start; j < limit; ++j )
+		{
+			int32_t const next = transitions[row + classes[text[j]]];
+
+			if( next >= 0 )
+			{
+				row = static_cast<size_t>( next );
+
+				continue;
+			}
+
+			row = static_cast<size_t>( -next );
+
+			// the words that end here, from the longest one, which starts first
+
+			for( int32_t t = mOutputs[row / nc]; t != 0; t = mNextOutputs[t] )
+			{
+				size_t const word_length = static_cast<size_t>( mDepths[t] );
+				size_t const index = j + 1 - word_length;
+
+				if( index > best ) break;
+
+				if( mTrailingWordBoundary && !IsWordBoundary( text, length, j + 1 ) ) break; // (the same end for all)
+				if( mLeadingWordBoundary && !IsWordBoundary( text, length, index ) ) continue;
+
+				int32_t const word = mWordIndices[t];
+
+				bool const better = index < best || ( mPriority == Priority::Longest ? word_length > best_length : word < best_word );
+
+				if( better )
+				{
+					best = index;
+					best_length = word_length;
+					best_word = word;
+
+					// (the words that start at 'best' or earlier end before the limit)
+					limit = std::min( length, best + mMaxLength );
+				}
+			}
+		}
+
+		*matchLength = best_length;
+
+		return best;
+	}
+
+
+	int32_t LiteralAlternationSearcher::FindAll( const char16_t* text, size_t length, int32_t numberOfGroups, const RegexCoreCancellation* cancellation,
+		RegexCoreResultsBuilder* builder ) const
+	{
+		size_t start = 0;
+
+		for( ;;)
+		{
+			if( cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context ) )
+			{
+				return REGEX_CORE_CANCELLED;
+			}
+
+			size_t match_length;
+			size_t const index = Find( text, length, start, &match_length );
+
+			if( index == LiteralNotFound ) break;
+
+			builder->BeginMatch( numberOfGroups );
+
+			for( int32_t i = 0; i < numberOfGroups; ++i ) builder->AddGroup( index, match_length );
+
+			start = index + match_length; // (the words are not empty)
+		}
+
+		return REGEX_CORE_OK;
+	}
+
+
+	size_t LiteralAlternationSearcher::GetSize( ) const
+	{
+		size_t const states = mTransitions.capacity( ) + mOutputs.capacity( ) + mNextOutputs.capacity( ) + mDepths.capacity( ) + mWordIndices.capacity( );
+
+		return sizeof( *this ) + mClasses.capacity( ) * sizeof( uint16_t ) + states * sizeof( int32_t );
+	}
+
+
+	bool LiteralAlternationSearcher::IsWordBoundary( const char16_t* text, size_t length, size_t index ) const
+	{
+		bool const before = index > 0 && IsWordCharacter( text[index - 1] );
+		bool const after = index < length && IsWordCharacter( text[index] );
+
+		return before != after;
+	}
+
+
+	bool LiteralAlternationSearcher::IsWordCharacter( char16_t c ) const
+	{
+		if( c < 256 ) return ( mLatin1WordCharacters[c / 32] >> ( c % 32 ) & 1 ) != 0;
+
+		return mIsWordCharacter( mContext, c );
+	}
+
+}
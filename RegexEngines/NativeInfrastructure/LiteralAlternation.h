@@ -0,0 +1,101 @@
+#pragma once
+
+// The accelerator for the patterns that are alternations of literals, optionally enclosed in a group and
+// in word boundaries, such as "\b(?:word1|word2|...|word5000)\b", which the backtracking engines try
+// alternative by alternative at each position. The words are put in an Aho-Corasick automaton, which scans
+// the text once, with the same work per unit regardless of the number of words.
+//
+// The cores of std::regex and Boost.Regex find the matches with the automaton (the priority of alternatives
+// and the word characters are taken from the engine); Oniguruma verifies the candidate positions, which are
+// the starts of occurrences, with 'onig_match'. With 'REGEX_CORE_NO_LITERAL_SEARCH', or after
+// 'SetLiteralSearchEnabled( false )', the engines are always used.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LiteralSearch.h"
+#include "RegexCore.h"
+
+
+namespace NativeInfrastructure
+{
+	// The parsed pattern: "[\b]( w1|w2|... )[\b]", where the group is "(?:...)", "(...)" or none.
+	struct LiteralAlternation
+	{
+		std::vector<std::u16string> Words; // (in the order of alternatives; not empty)
+		bool LeadingWordBoundary = false;
+		bool TrailingWordBoundary = false;
+		bool CapturingGroup = false; // (the words are in "(...)")
+		bool NonCapturingGroup = false; // (the words are in "(?:...)")
+		bool EscapedCharacters = false; // (the words contain "\" followed by a metacharacter)
+	};
+
+
+	// Returns true if the pattern is an alternation of non-empty literals in the Perl-like syntaxes. The words
+	// consist of the characters other than the metacharacters ("\^$.|?*+()[]{}") and of the escaped metacharacters.
+	// Without a group, the word boundaries are accepted for a single word only. The options that change the syntax,
+	// such as the extended mode, are checked by the cores.
+	bool ParseLiteralAlternation( const char16_t* pattern, size_t length, LiteralAlternation* alternation );
+
+
+	// (the engines call it for single UTF-16 units)
+	typedef bool IsWordCharacterProc( const void* context, char16_t c );
+
+
+	class LiteralAlternationSearcher final
+	{
+	public:
+
+		enum class Priority
+		{
+			First, // (the first of the alternatives that match at the leftmost position; Perl, ECMAScript)
+			Longest, // (the longest of them; POSIX)
+		};
+
+		// Returns null if the automaton is too large. If 'isWordCharacter' is null, the word boundaries
+		// are not checked, and the matches are the candidates to verify; otherwise the context must live
+		// while the searcher is used.
+		static std::unique_ptr<LiteralAlternationSearcher> Create( const LiteralAlternation& alternation, Priority priority,
+			IsWordCharacterProc* isWordCharacter, const void* context );
+
+		// Returns the index of the leftmost match that starts at 'start' or later, or 'LiteralNotFound'.
+		size_t Find( const char16_t* text, size_t length, size_t start, size_t* matchLength ) const;
+
+		// Adds the non-overlapping matches, the leftmost first, with 'numberOfGroups' groups (1 or 2), which are
+		// the same span. Returns 'REGEX_CORE_OK' or 'REGEX_CORE_CANCELLED'.
+		int32_t FindAll( const char16_t* text, size_t length, int32_t numberOfGroups, const RegexCoreCancellation* cancellation,
+			RegexCoreResultsBuilder* builder ) const;
+
+		// The memory of the searcher, in bytes (mostly the table of classes and the transitions).
+		size_t GetSize( ) const;
+
+	private:
+
+		LiteralAlternationSearcher( ) = default;
+
+		std::vector<uint16_t> mClasses; // (the class of each UTF-16 unit; 0 -- the units that are not in the words)
+		size_t mNumberOfClasses = 0;
+		std::vector<int32_t> mTransitions; // (by the row of the state and the class: the row of the next state, which is 'state * mNumberOfClasses',
+		                                   // negated if words end at the next state; complete, the failures are resolved)
+		std::vector<int32_t> mOutputs; // (the longest word that ends at the state, as a state, or 0)
+		std::vector<int32_t> mNextOutputs; // (for the output states: the next shorter word that ends there, or 0)
+		std::vector<int32_t> mDepths;
+		std::vector<int32_t> mWordIndices; // (for the output states: the first alternative of the word)
+		size_t mMaxLength = 0;
+
+		Priority mPriority = Priority::First;
+		bool mLeadingWordBoundary = false;
+		bool mTrailingWordBoundary = false;
+		IsWordCharacterProc* mIsWordCharacter = nullptr; // (null if the boundaries are not checked)
+		const void* mContext = nullptr;
+		uint32_t mLatin1WordCharacters[256 / 32] = { }; // (bits, for U+0000...U+00FF; the rest is asked from 'mIsWordCharacter')
+
+		bool IsWordCharacter( char16_t c ) const;
+
+		bool IsWordBoundary( const char16_t* text, size_t length, size_t index ) const;
+	};
+
+}
@@ -0,0 +1,496 @@
+#include "LiteralSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined( _M_X64 ) || defined( __x86_64__ )
+#	define LITERAL_SEARCH_X64
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	endif
+#	include <immintrin.h>
+#endif
+
+
+namespace NativeInfrastructure
+{
+	namespace
+	{
+		char16_t FoldAscii( char16_t c )
+		{
+			return c >= u'A' && c <= u'Z' ? static_cast<char16_t>( c | 0x20 ) : c;
+		}
+
+
+		// Returns false if the unit is an unpaired surrogate; moves to the second unit of a pair.
+		bool SkipSurrogatePair( const char16_t* text, size_t length, size_t* i )
+		{
+			char16_t const c = text[*i];
+
+			if( ( c & 0xF800 ) != 0xD800 ) return true;
+
+			if( ( c & 0xFC00 ) != 0xD800 || *i + 1 >= length || ( text[*i + 1] & 0xFC00 ) != 0xDC00 ) return false;
+
+			++*i;
+
+			return true;
+		}
+
+
+		// Finds the maximal suffix of the literal by the order of units ('reversed' -- by the opposite order);
+		// returns its start, and its period in 'period' (see "Two-Way String-Matching", Crochemore and Perrin, 1991).
+		size_t FindMaximalSuffix( const char16_t* x, size_t m, bool reversed, size_t* period )
+		{
+			ptrdiff_t const n = static_cast<ptrdiff_t>( m );
+			ptrdiff_t start = -1; // (minus one)
+			ptrdiff_t j = 0;
+			ptrdiff_t k = 1;
+			ptrdiff_t p = 1;
+
+			while( j + k < n )
+			{
+				char16_t const a = x[j + k];
+				char16_t const b = x[start + k];
+
+				if( a == b )
+				{
+					if( k == p )
+					{
+						j += p;
+						k = 1;
+					}
+					else
+					{
+						++k;
+					}
+				}
+				else if( reversed ? a > b : a < b )
+				{
+					j += k;
+					k = 1;
+					p = j - start;
+				}
+				else
+				{
+					start = j++;
+					k = p = 1;
+				}
+			}
+
+			*period = static_cast<size_t>( p );
+
+			return static_cast<size_t>( start + 1 );
+		}
+
+
+#ifdef LITERAL_SEARCH_X64
+
+#	ifdef _MSC_VER
+#		define LITERAL_SEARCH_AVX2_TARGET
+#	else
+#		define LITERAL_SEARCH_AVX2_TARGET __attribute__( ( target( "avx2" ) ) )
+#	endif
+
+
+		unsigned CountTrailingZeros( uint32_t bits )
+		{
+#	ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward( &index, bits );
+
+			return index;
+#	else
+			return static_cast<unsigned>( __builtin_ctz( bits ) );
+#	endif
+		}
+
+
+		bool IsAvx2Supported( )
+		{
+#	ifdef _MSC_VER
+			int regs[4];
+
+			__cpuid( regs, 0 );
+			if( regs[0] < 7 ) return false;
+
+			// (AVX and the saving of YMM registers by the system)
+			__cpuid( regs, 1 );
+			if( ( regs[2] & ( 1 << 27 ) ) == 0 || ( regs[2] & ( 1 << 28 ) ) == 0 ) return false;
+			if( ( _xgetbv( 0 ) & 6 ) != 6 ) return false;
+
+			__cpuidex( regs, 7, 0 );
+
+			return ( regs[1] & ( 1 << 5 ) ) != 0;
+#	else
+			return __builtin_cpu_supports( "avx2" ) != 0;
+#	endif
+		}
+
+
+		bool const HasAvx2 = IsAvx2Supported( );
+
+
+		// The vector filter gives up, leaving the rest to Two-Way, when the verified units exceed this number.
+		size_t GetVerificationBudget( size_t scanned, size_t literalLength )
+		{
+			return 4 * scanned + 64 * literalLength;
+		}
+
+#endif
+
+		std::atomic<bool> LiteralSearchEnabled{ true };
+	}
+
+
+	void SetLiteralSearchEnabled( bool enabled )
+	{
+		LiteralSearchEnabled.store( enabled );
+	}
+
+
+	bool IsLiteralSearchEnabled( )
+	{
+		return LiteralSearchEnabled.load( );
+	}
+
+
+	bool IsLiteralPattern( const char16_t* pattern, size_t length )
+	{
+		if( length == 0 ) return false;
+
+		for( size_t i = 0; i < length; ++i )
+		{
+			switch( pattern[i] )
+			{
+			case u'\\':
+			case u'^':
+			case u'$':
+			case u'.':
+			case u'|':
+			case u'?':
+			case u'*':
+			case u'+':
+			case u'(':
+			case u')':
+			case u'[':
+			case u']':
+			case u'{':
+			case u'}':
+				return false;
+			default:
+				break;
+			}
+		}
+
+		return true;
+	}
+
+
+	bool IsAsciiCaseFoldable( const char16_t* pattern, size_t length )
+	{
+		for( size_t i = 0; i < length; ++i )
+		{
+			char16_t const c = FoldAscii( pattern[i] );
+
+			if( c >= 0x80 || c == u'k' || c == u's' ) return false;
+		}
+
+		return true;
+	}
+
+
+	bool HasUnpairedSurrogates( const char16_t* text, size_t length )
+	{
+		size_t i = 0;
+
+#ifdef LITERAL_SEARCH_X64
+		// (the blocks without surrogates are skipped; a pair can cross the end of a block)
+
+		__m128i const surrogate_mask = _mm_set1_epi16( static_cast<short>( 0xF800 ) );
+		__m128i const surrogate_value = _mm_set1_epi16( static_cast<short>( 0xD800 ) );
+
+		while( i + 16 <= length )
+		{
+			__m128i const a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( text + i ) );
+			__m128i const b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( text + i + 8 ) );
+
+			__m128i const surrogates = _mm_or_si128(
+				_mm_cmpeq_epi16( _mm_and_si128( a, surrogate_mask ), surrogate_value ),
+				_mm_cmpeq_epi16( _mm_and_si128( b, surrogate_mask ), surrogate_value ) );
+
+			if( _mm_movemask_epi8( surrogates ) == 0 )
+			{
+				i += 16;
+
+				continue;
+			}
+
+			for( size_t const end = i + 16; i < end; ++i )
+			{
+				if( !SkipSurrogatePair( text, length, &i ) ) return true;
+			}
+		}
+#endif
+
+		for( ; i < length; ++i )
+		{
+			if( !SkipSurrogatePair( text, length, &i ) ) return true;
+		}
+
+		return false;
+	}
+
+
+	LiteralSearcher::LiteralSearcher( const char16_t* literal, size_t length, bool ignoreAsciiCase )
+		:
+		mLiteral( literal, length ),
+		mIgnoreCase( ignoreAsciiCase ),
+		mFirstValue( 0 ),
+		mFirstMask( 0 ),
+		mLastValue( 0 ),
+		mLastMask( 0 ),
+		mCriticalPosition( 0 ),
+		mPeriod( 1 ),
+		mPeriodicMemory( 0 )
+	{
+		if( mLiteral.empty( ) ) return;
+
+		if( mIgnoreCase )
+		{
+			for( char16_t& c : mLiteral ) c = FoldAscii( c );
+		}
+
+		// ('c | 0x20' is equal to a lower-case letter only if 'c' is the same letter in either case)
+
+		mFirstValue = mLiteral.front( );
+		mLastValue = mLiteral.back( );
+
+		if( mIgnoreCase && mFirstValue >= u'a' && mFirstValue <= u'z' ) mFirstMask = 0x20;
+		if( mIgnoreCase && mLastValue >= u'a' && mLastValue <= u'z' ) mLastMask = 0x20;
+
+		// the critical factorization is given by the later of the two maximal suffixes
+
+		size_t period;
+		size_t reversed_period;
+		size_t const start = FindMaximalSuffix( mLiteral.data( ), mLiteral.size( ), false, &period );
+		size_t const reversed_start = FindMaximalSuffix( mLiteral.data( ), mLiteral.size( ), true, &reversed_period );
+
+		if( reversed_start > start )
+		{
+			mCriticalPosition = reversed_start;
+			mPeriod = reversed_period;
+		}
+		else
+		{
+			mCriticalPosition = start;
+			mPeriod = period;
+		}
+
+		if( std::char_traits<char16_t>::compare( mLiteral.data( ), mLiteral.data( ) + mPeriod, mCriticalPosition ) == 0 )
+		{
+			mPeriodicMemory = mLiteral.size( ) - mPeriod;
+		}
+		else
+		{
+			mPeriod = std::max( mCriticalPosition, mLiteral.size( ) - mCriticalPosition ) + 1;
+			mPeriodicMemory = 0;
+		}
+	}
+
+
+	size_t LiteralSearcher::Find( const char16_t* text, size_t length, size_t start ) const
+	{
+		size_t const m = mLiteral.size( );
+
+		if( m == 0 || length < m || start > length - m ) return LiteralNotFound;
+
+		size_t position = start;
+
+#ifdef LITERAL_SEARCH_X64
+		size_t const found = HasAvx2 ? FindAvx2( text, length, &position ) : FindSse2( text, length, &position );
+
+		if( found != LiteralNotFound ) return found;
+#endif
+
+		return FindTwoWay( text, length, position );
+	}
+
+
+	int32_t LiteralSearcher::FindAll( const char16_t* text, size_t length, const RegexCoreCancellation* cancellation, RegexCoreResultsBuilder* builder ) const
+	{
+		size_t start = 0;
+
+		for( ;;)
+		{
+			if( cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context ) )
+			{
+				return REGEX_CORE_CANCELLED;
+			}
+
+			size_t const index = Find( text, length, start );
+
+			if( index == LiteralNotFound ) break;
+
+			builder->BeginMatch( 1 );
+			builder->AddGroup( index, mLiteral.size( ) );
+
+			start = index + mLiteral.size( );
+		}
+
+		return REGEX_CORE_OK;
+	}
+
+
+	bool LiteralSearcher::IsMatchAt( const char16_t* text ) const
+	{
+		size_t const m = mLiteral.size( );
+
+		if( !mIgnoreCase ) return memcmp( text, mLiteral.data( ), m * sizeof( char16_t ) ) == 0;
+
+		for( size_t i = 0; i < m; ++i )
+		{
+			if( FoldAscii( text[i] ) != mLiteral[i] ) return false;
+		}
+
+		return true;
+	}
+
+
+	size_t LiteralSearcher::FindTwoWay( const char16_t* text, size_t length, size_t start ) const
+	{
+		const char16_t* const x = mLiteral.data( );
+		size_t const m = mLiteral.size( );
+		size_t const critical = mCriticalPosition;
+		bool const fold = mIgnoreCase;
+
+		// (the right part is compared from the critical position; on success, the left part, down to the prefix
+		// that is known to match after a shift by the period)
+
+		size_t memory = 0;
+
+		for( size_t j = start; j <= length - m; )
+		{
+			const char16_t* const y = text + j;
+
+			size_t k = std::max( critical, memory );
+
+			while( k < m && ( fold ? FoldAscii( y[k] ) : y[k] ) == x[k] ) ++k;
+
+			if( k < m )
+			{
+				j += k - critical + 1;
+				memory = 0;
+
+				continue;
+			}
+
+			k = critical;
+
+			while( k > memory && ( fold ? FoldAscii( y[k - 1] ) : y[k - 1] ) == x[k - 1] ) --k;
+
+			if( k <= memory ) return j;
+
+			j += mPeriod;
+			memory = mPeriodicMemory;
+		}
+
+		return LiteralNotFound;
+	}
+
+
+#ifdef LITERAL_SEARCH_X64
+
+	size_t LiteralSearcher::FindSse2( const char16_t* text, size_t length, size_t* position ) const
+	{
+		size_t const m = mLiteral.size( );
+		size_t const start = *position;
+
+		__m128i const first_value = _mm_set1_epi16( static_cast<short>( mFirstValue ) );
+		__m128i const first_mask = _mm_set1_epi16( static_cast<short>( mFirstMask ) );
+		__m128i const last_value = _mm_set1_epi16( static_cast<short>( mLastValue ) );
+		__m128i const last_mask = _mm_set1_epi16( static_cast<short>( mLastMask ) );
+
+		size_t verified = 0;
+		size_t i = start;
+
+		for( ; i + m - 1 + 8 <= length; i += 8 )
+		{
+			__m128i const first = _mm_or_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( text + i ) ), first_mask );
+			__m128i const last = _mm_or_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( text + i + m - 1 ) ), last_mask );
+
+			// (two bits for each unit)
+			uint32_t bits = static_cast<uint32_t>( _mm_movemask_epi8(
+				_mm_and_si128( _mm_cmpeq_epi16( first, first_value ), _mm_cmpeq_epi16( last, last_value ) ) ) ) & 0x5555;
+
+			for( ; bits != 0; bits &= bits - 1 )
+			{
+				size_t const k = i + CountTrailingZeros( bits ) / 2;
+
+				if( IsMatchAt( text + k ) ) return k;
+
+				verified += m;
+			}
+
+			if( verified > GetVerificationBudget( i - start, m ) )
+			{
+				i += 8;
+
+				break;
+			}
+		}
+
+		*position = i;
+
+		return LiteralNotFound;
+	}
+
+
+	LITERAL_SEARCH_AVX2_TARGET
+	size_t LiteralSearcher::FindAvx2( const char16_t* text, size_t length, size_t* position ) const
+	{
+		size_t const m = mLiteral.size( );
+		size_t const start = *position;
+
+		__m256i const first_value = _mm256_set1_epi16( static_cast<short>( mFirstValue ) );
+		__m256i const first_mask = _mm256_set1_epi16( static_cast<short>( mFirstMask ) );
+		__m256i const last_value = _mm256_set1_epi16( static_cast<short>( mLastValue ) );
+		__m256i const last_mask = _mm256_set1_epi16( static_cast<short>( mLastMask ) );
+
+		size_t verified = 0;
+		size_t i = start;
+
+		for( ; i + m - 1 + 16 <= length; i += 16 )
+		{
+			__m256i const first = _mm256_or_si256( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( text + i ) ), first_mask );
+			__m256i const last = _mm256_or_si256( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( text + i + m - 1 ) ), last_mask );
+
+			// (two bits for each unit)
+			uint32_t bits = static_cast<uint32_t>( _mm256_movemask_epi8(
+				_mm256_and_si256( _mm256_cmpeq_epi16( first, first_value ), _mm256_cmpeq_epi16( last, last_value ) ) ) ) & 0x55555555;
+
+			for( ; bits != 0; bits &= bits - 1 )
+			{
+				size_t const k = i + CountTrailingZeros( bits ) / 2;
+
+				if( IsMatchAt( text + k ) ) return k;
+
+				verified += m;
+			}
+
+			if( verified > GetVerificationBudget( i - start, m ) )
+			{
+				i += 16;
+
+				break;
+			}
+		}
+
+		*position = i;
+
+		return LiteralNotFound;
+	}
+
+#endif
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// The fast path of the cores for the patterns that are plain literals: the literal options of the engines
+// ('PCRE2_LITERAL', 'literal' of RE2 and Boost.Regex) and the patterns without metacharacters. The cores decide,
+// by the options of the engine, whether the literal search gives the same matches as the engine, and then
+// scan the text without the engine.
+//
+// The text is scanned by blocks of 8 (SSE2) or 16 (AVX2, if supported by the processor) UTF-16 units, comparing
+// the first and the last unit of the literal at each position; the candidates are verified by comparing the rest.
+// If the verifications take too much time (for example, "aaab" in "aaaa..."), or the processor is not x86/x64,
+// the Two-Way algorithm (Crochemore and Perrin), which is linear in the worst case, is used.
+//
+// With 'REGEX_CORE_NO_LITERAL_SEARCH', the cores always use the engines (to compare the results and the timings);
+// 'SetLiteralSearchEnabled' does the same at run time, which lets the fuzzer compare both paths in one process.
+
+#include <cstddef>
+#include <string>
+
+#include "RegexCore.h"
+
+
+namespace NativeInfrastructure
+{
+	const size_t LiteralNotFound = static_cast<size_t>( -1 );
+
+
+	// Enables or disables the fast paths (the literal search and the alternations of literals) of the patterns
+	// that are compiled later; the compiled patterns keep their paths. Enabled by default.
+	void SetLiteralSearchEnabled( bool enabled );
+	bool IsLiteralSearchEnabled( );
+
+
+	// Returns true if the pattern is not empty and does not contain the metacharacters of the Perl-like syntaxes
+	// ("\^$.|?*+()[]{}"). The options that change the syntax, such as the extended mode, are checked by the cores.
+	bool IsLiteralPattern( const char16_t* pattern, size_t length );
+
+	// Returns true if the letters of the pattern are ASCII and are not equivalent to non-ASCII letters in the
+	// Unicode case folding ('K' and U+212A KELVIN SIGN, 'S' and U+017F LATIN SMALL LETTER LONG S), so that
+	// the case-insensitive engines that fold by Unicode find the same matches as the ASCII folding.
+	bool IsAsciiCaseFoldable( const char16_t* pattern, size_t length );
+
+	// Returns true if the text contains a surrogate that is not a part of a pair.
+	bool HasUnpairedSurrogates( const char16_t* text, size_t length );
+
+
+	class LiteralSearcher final
+	{
+	public:
+
+		// 'ignoreAsciiCase' -- 'A'...'Z' are equal to 'a'...'z'; other units are compared exactly.
+		LiteralSearcher( const char16_t* literal, size_t length, bool ignoreAsciiCase );
+
+		size_t Length( ) const { return mLiteral.size( ); }
+
+		// Returns the index of the first occurrence that starts at 'start' or later, or 'LiteralNotFound'.
+		size_t Find( const char16_t* text, size_t length, size_t start ) const;
+
+		// Adds the non-overlapping occurrences (the leftmost first, the next one after the end of the previous one),
+		// as one-group matches, which is what the engines find for a non-empty literal.
+		// Returns 'REGEX_CORE_OK' or 'REGEX_CORE_CANCELLED'.
+		int32_t FindAll( const char16_t* text, size_t length, const RegexCoreCancellation* cancellation, RegexCoreResultsBuilder* builder ) const;
+
+	private:
+
+		std::u16string mLiteral; // (in lower case if 'mIgnoreCase')
+		bool mIgnoreCase;
+
+		// the anchors: the unit at the position is equal if '( unit | mask ) == value'
+		char16_t mFirstValue;
+		char16_t mFirstMask;
+		char16_t mLastValue;
+		char16_t mLastMask;
+
+		// the factorization of Two-Way
+		size_t mCriticalPosition;
+		size_t mPeriod; // (the shift after an occurrence or after a mismatch in the left part)
+		size_t mPeriodicMemory; // (if the literal is periodic: the prefix that still matches after the shift; otherwise 0)
+
+		bool IsMatchAt( const char16_t* text ) const;
+		size_t FindTwoWay( const char16_t* text, size_t length, size_t start ) const;
+
+#if defined( _M_X64 ) || defined( __x86_64__ )
+		size_t FindSse2( const char16_t* text, size_t length, size_t* position ) const;
+		size_t FindAvx2( const char16_t* text, size_t length, size_t* position ) const;
+#endif
+	};
+
+}
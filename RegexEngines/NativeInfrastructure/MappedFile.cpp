@@ -0,0 +1,196 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#	include <Windows.h>
+#	include <cstdint>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <cerrno>
+#	include <cstring>
+#endif
+
+
+namespace NativeInfrastructure
+{
+
+#ifdef _WIN32
+
+	MappedFile::MappedFile( )
+		:
+		mData( nullptr ),
+		mSize( 0 ),
+		mFile( INVALID_HANDLE_VALUE ),
+		mMapping( nullptr )
+	{
+	}
+
+
+	static std::string FormatWindowsError( const char* operation )
+	{
+		DWORD code = GetLastError( );
+		char buffer[256] = "";
+
+		FormatMessageA( FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, nullptr, code, 0, buffer, sizeof( buffer ), nullptr );
+
+		return std::string( operation ) + " failed: " + buffer;
+	}
+
+
+	bool MappedFile::Open( const char* utf8Path )
+	{
+		Close( );
+
+		int length = MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, utf8Path, -1, nullptr, 0 );
+		if( length <= 0 )
+		{
+			mErrorText = "Invalid file name.";
+
+			return false;
+		}
+
+		std::wstring path( length, L'\0' );
+		MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, utf8Path, -1, &path[0], length );
+
+		mFile = CreateFileW( path.c_str( ), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if( mFile == INVALID_HANDLE_VALUE )
+		{
+			mErrorText = FormatWindowsError( "CreateFile" );
+
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if( !GetFileSizeEx( mFile, &size ) )
+		{
+			mErrorText = FormatWindowsError( "GetFileSizeEx" );
+			Close( );
+
+			return false;
+		}
+
+		if( size.QuadPart == 0 ) return true; // (empty files cannot be mapped)
+
+		if( static_cast<unsigned long long>( size.QuadPart ) > SIZE_MAX )
+		{
+			mErrorText = "The file is too large.";
+			Close( );
+
+			return false;
+		}
+
+		mMapping = CreateFileMappingW( mFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		if( mMapping == nullptr )
+		{
+			mErrorText = FormatWindowsError( "CreateFileMapping" );
+			Close( );
+
+			return false;
+		}
+
+		mData = static_cast<const char*>( MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 ) );
+		if( mData == nullptr )
+		{
+			mErrorText = FormatWindowsError( "MapViewOfFile" );
+			Close( );
+
+			return false;
+		}
+
+		mSize = static_cast<size_t>( size.QuadPart );
+
+		return true;
+	}
+
+
+	void MappedFile::Close( )
+	{
+		if( mData != nullptr ) UnmapViewOfFile( mData );
+		if( mMapping != nullptr ) CloseHandle( mMapping );
+		if( mFile != INVALID_HANDLE_VALUE ) CloseHandle( mFile );
+
+		mData = nullptr;
+		mSize = 0;
+		mMapping = nullptr;
+		mFile = INVALID_HANDLE_VALUE;
+	}
+
+#else
+
+	MappedFile::MappedFile( )
+		:
+		mData( nullptr ),
+		mSize( 0 ),
+		mFile( -1 )
+	{
+	}
+
+
+	static std::string FormatPosixError( const char* operation )
+	{
+		return std::string( operation ) + " failed: " + strerror( errno );
+	}
+
+
+	bool MappedFile::Open( const char* utf8Path )
+	{
+		Close( );
+
+		mFile = open( utf8Path, O_RDONLY | O_CLOEXEC );
+		if( mFile < 0 )
+		{
+			mErrorText = FormatPosixError( "open" );
+
+			return false;
+		}
+
+		struct stat st;
+		if( fstat( mFile, &st ) != 0 )
+		{
+			mErrorText = FormatPosixError( "fstat" );
+			Close( );
+
+			return false;
+		}
+
+		if( st.st_size == 0 ) return true; // (empty files cannot be mapped)
+
+		void* p = mmap( nullptr, static_cast<size_t>( st.st_size ), PROT_READ, MAP_PRIVATE, mFile, 0 );
+		if( p == MAP_FAILED )
+		{
+			mErrorText = FormatPosixError( "mmap" );
+			Close( );
+
+			return false;
+		}
+
+		madvise( p, static_cast<size_t>( st.st_size ), MADV_SEQUENTIAL );
+
+		mData = static_cast<const char*>( p );
+		mSize = static_cast<size_t>( st.st_size );
+
+		return true;
+	}
+
+
+	void MappedFile::Close( )
+	{
+		if( mData != nullptr ) munmap( const_cast<char*>( mData ), mSize );
+		if( mFile >= 0 ) close( mFile );
+
+		mData = nullptr;
+		mSize = 0;
+		mFile = -1;
+	}
+
+#endif
+
+
+	MappedFile::~MappedFile( )
+	{
+		Close( );
+	}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// Read-only memory-mapped file.
+//
+// Windows: 'CreateFileMappingW' and 'MapViewOfFile'.
+// POSIX: 'mmap', with a sequential access hint.
+//
+// (Do not include this file in managed code; see "NativeMatcher.h" files for the wrappers).
+
+#include <cstddef>
+#include <string>
+
+
+namespace NativeInfrastructure
+{
+
+	class MappedFile final
+	{
+	public:
+
+		MappedFile( );
+		~MappedFile( );
+
+		MappedFile( const MappedFile& ) = delete;
+		MappedFile& operator =( const MappedFile& ) = delete;
+
+		// Maps the whole file; the path is in UTF-8.
+		// Returns false if the file cannot be mapped; see 'GetErrorText'.
+		bool Open( const char* utf8Path );
+
+		void Close( );
+
+		const char* Data( ) const { return mData; } // (null for empty files)
+		size_t Size( ) const { return mSize; }
+
+		const std::string& GetErrorText( ) const { return mErrorText; }
+
+	private:
+
+		const char* mData;
+		size_t mSize;
+		std::string mErrorText;
+
+#ifdef _WIN32
+		void* mFile;
+		void* mMapping;
+#else
+		int mFile;
+#endif
+	};
+
+}
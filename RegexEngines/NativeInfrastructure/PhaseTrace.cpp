@@ -0,0 +1,228 @@
+#include "PhaseTrace.h"
+
+#ifdef _WIN32
+#	include <Windows.h>
+#else
+#	include <unistd.h>
+#	ifdef __linux__
+#		include <sys/syscall.h>
+#	endif
+#endif
+
+#if defined( REGEX_TRACE_USDT ) && defined( __linux__ )
+#	include <sys/sdt.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace NativeInfrastructure
+{
+	namespace
+	{
+		struct TraceEvent
+		{
+			const char* Category;
+			const char* Name;
+			int64_t Start;
+			int64_t Duration;
+			int64_t Size;
+			uint64_t ThreadId;
+		};
+
+
+		class TraceBuffer final
+		{
+		public:
+
+			TraceBuffer( )
+				:
+				mNext( 0 ),
+				mFirst( 0 )
+			{
+#ifdef _WIN32
+				wchar_t path[1024];
+				DWORD const length = GetEnvironmentVariableW( L"REGEXPRESS_TRACE", path, sizeof( path ) / sizeof( path[0] ) );
+
+				if( length > 0 && length < sizeof( path ) / sizeof( path[0] ) ) mPath.assign( path, length );
+#else
+				const char* path = getenv( "REGEXPRESS_TRACE" );
+
+				if( path != nullptr ) mPath = path;
+#endif
+				if( !mPath.empty( ) ) mEvents.resize( TraceCapacity );
+			}
+
+			~TraceBuffer( )
+			{
+				Flush( );
+			}
+
+			bool IsEnabled( ) const { return !mEvents.empty( ); }
+
+			void Add( const TraceEvent& e )
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+
+				mEvents[mNext % TraceCapacity] = e;
+				++mNext;
+			}
+
+			void Flush( )
+			{
+				if( !IsEnabled( ) ) return;
+
+				std::string json;
+
+				{
+					std::lock_guard<std::mutex> lock( mMutex );
+
+					// (the oldest spans are overwritten)
+					uint64_t const first = mNext - mFirst > TraceCapacity ? mNext - TraceCapacity : mFirst;
+
+					for( uint64_t i = first; i < mNext; ++i ) AppendJson( &json, mEvents[i % TraceCapacity] );
+
+					mFirst = mNext;
+				}
+
+				if( json.empty( ) ) return;
+
+				FILE* file = nullptr;
+#ifdef _WIN32
+				if( _wfopen_s( &file, mPath.c_str( ), L"ab" ) != 0 ) file = nullptr;
+#else
+				file = fopen( mPath.c_str( ), "ab" );
+#endif
+				if( file == nullptr ) return;
+
+				// (one write, so that the spans of other processes are not interleaved)
+				fseek( file, 0, SEEK_END );
+				if( ftell( file ) == 0 ) json.insert( 0, "[\n" );
+
+				fwrite( json.data( ), 1, json.size( ), file );
+				fclose( file );
+			}
+
+		private:
+
+#ifdef _WIN32
+			std::wstring mPath;
+#else
+			std::string mPath;
+#endif
+			std::mutex mMutex;
+			std::vector<TraceEvent> mEvents; // (empty if the tracing is off)
+			uint64_t mNext;
+			uint64_t mFirst; // (the first span that is not written)
+
+			static void AppendJson( std::string* json, const TraceEvent& e )
+			{
+				char buffer[512];
+
+				// "X" -- complete event; the times are in microseconds
+				int n = snprintf( buffer, sizeof( buffer ),
+					"{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%llu",
+					e.Category, e.Name, e.Start / 1e3, e.Duration / 1e3, CurrentProcessId( ), static_cast<unsigned long long>( e.ThreadId ) );
+
+				if( n <= 0 || n >= static_cast<int>( sizeof( buffer ) ) ) return;
+
+				json->append( buffer, n );
+
+				if( e.Size >= 0 )
+				{
+					json->append( ",\"args\":{\"size\":" );
+					json->append( std::to_string( e.Size ) );
+					json->append( "}" );
+				}
+
+				json->append( "},\n" );
+			}
+
+			static unsigned long CurrentProcessId( )
+			{
+#ifdef _WIN32
+				return ::GetCurrentProcessId( );
+#else
+				return static_cast<unsigned long>( getpid( ) );
+#endif
+			}
+		};
+
+
+		TraceBuffer& GetBuffer( )
+		{
+			static TraceBuffer buffer; // (flushed when the module is unloaded)
+
+			return buffer;
+		}
+
+
+		uint64_t CurrentThreadId( )
+		{
+#ifdef _WIN32
+			return ::GetCurrentThreadId( );
+#elif defined( __linux__ )
+			static thread_local uint64_t const id = static_cast<uint64_t>( syscall( SYS_gettid ) );
+
+			return id;
+#else
+			return std::hash<std::thread::id>( )( std::this_thread::get_id( ) );
+#endif
+		}
+
+
+		// 0 -- not known yet, 1 -- off, 2 -- on
+		std::atomic<int> State{ 0 };
+	}
+
+
+	bool IsTraceEnabled( )
+	{
+#if defined( REGEX_TRACE_USDT ) && defined( __linux__ )
+		return true;
+#else
+		int state = State.load( std::memory_order_relaxed );
+
+		if( state == 0 )
+		{
+			state = GetBuffer( ).IsEnabled( ) ? 2 : 1;
+			State.store( state, std::memory_order_relaxed );
+		}
+
+		return state == 2;
+#endif
+	}
+
+
+	int64_t GetTraceTime( )
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+	}
+
+
+	void AddTraceSpan( const char* category, const char* name, int64_t start, int64_t end, int64_t size )
+	{
+#if defined( REGEX_TRACE_USDT ) && defined( __linux__ )
+		DTRACE_PROBE5( regexpress, phase, category, name, start, end - start, size );
+#endif
+
+		TraceBuffer& buffer = GetBuffer( );
+
+		if( buffer.IsEnabled( ) ) buffer.Add( TraceEvent{ category, name, start, end - start, size, CurrentThreadId( ) } );
+	}
+
+
+	void FlushTrace( )
+	{
+		GetBuffer( ).Flush( );
+	}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// Phase-level tracing of the requests in the interops and clients (option parsing, conversion of the text,
+// compilation, scan, creation of the results), in the Chrome trace event format ("chrome://tracing",
+// "https://ui.perfetto.dev").
+//
+// The tracing is enabled by the environment variable 'REGEXPRESS_TRACE' with the path of the trace file,
+// which is inherited by the clients (child processes). Each module (interop DLL, client) keeps the last
+// 'TraceCapacity' spans in its own ring buffer and appends them to the file when it is unloaded, or when
+// 'FlushTrace' is called; the array format allows the missing ']', therefore the modules and the processes
+// share one file. The times are taken from the steady clock, which is common to the processes
+// ('QueryPerformanceCounter', 'CLOCK_MONOTONIC'). When the tracing is off, a span costs a check of a flag.
+//
+// With 'REGEX_TRACE_USDT' (Linux, <sys/sdt.h>), each span also fires the USDT probe 'regexpress:phase'
+// with the category, name, start and duration (nanoseconds) and size; then the spans are always timed.
+//
+// The category and the name must be string literals (only the pointers are kept).
+// This file can be included in managed code.
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace NativeInfrastructure
+{
+	const size_t TraceCapacity = 32 * 1024;
+
+
+	bool IsTraceEnabled( );
+
+	// Nanoseconds of the steady clock.
+	int64_t GetTraceTime( );
+
+	// 'size' is shown as an argument of the span (for example, the length of the text), unless negative.
+	void AddTraceSpan( const char* category, const char* name, int64_t start, int64_t end, int64_t size );
+
+	// Appends the collected spans to the trace file and empties the buffer.
+	void FlushTrace( );
+
+
+	// Records the time from the construction to the destruction (or 'End').
+	class TraceSpan final
+	{
+	public:
+
+		TraceSpan( const char* category, const char* name, int64_t size = -1 )
+			:
+			mCategory( category ),
+			mName( name ),
+			mSize( size ),
+			mStart( IsTraceEnabled( ) ? GetTraceTime( ) : -1 )
+		{
+		}
+
+		~TraceSpan( )
+		{
+			End( );
+		}
+
+		// Records the span before the end of the scope; the destructor does nothing then.
+		void End( )
+		{
+			if( mStart >= 0 ) AddTraceSpan( mCategory, mName, mStart, GetTraceTime( ), mSize );
+
+			mStart = -1;
+		}
+
+		// (for the sizes that are known at the end, such as the number of matches)
+		void SetSize( int64_t size ) { mSize = size; }
+
+	private:
+
+		const char* const mCategory;
+		const char* const mName;
+		int64_t mSize;
+		int64_t mStart;
+
+		TraceSpan( const TraceSpan& ) = delete;
+		TraceSpan& operator =( const TraceSpan& ) = delete;
+	};
+
+}
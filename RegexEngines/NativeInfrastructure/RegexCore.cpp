@@ -0,0 +1,136 @@
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "RegexCore.h"
+
+
+extern "C" void RegexCoreFreeResults( RegexCoreResults* results )
+{
+	if( results == nullptr ) return;
+
+	free( results->Items );
+	free( results->Names );
+
+	*results = RegexCoreResults{ };
+}
+
+
+namespace NativeInfrastructure
+{
+
+	RegexCoreResultsBuilder::RegexCoreResultsBuilder( )
+		:
+		mCaptureCountItem( 0 ),
+		mMatchCount( 0 ),
+		mNameCount( 0 )
+	{
+
+	}
+
+
+	int32_t RegexCoreResultsBuilder::ToInt32( ptrdiff_t value )
+	{
+		if( value > INT32_MAX || value < INT32_MIN ) throw std::overflow_error( "The text is too large." );
+
+		return static_cast<int32_t>( value );
+	}
+
+
+	int32_t RegexCoreResultsBuilder::AddName( const char16_t* name, size_t length )
+	{
+		mNames.append( name, length );
+		mNames.push_back( u'\0' );
+
+		return mNameCount++;
+	}
+
+
+	void RegexCoreResultsBuilder::BeginMatch( int32_t groupCount )
+	{
+		mItems.push_back( groupCount );
+
+		++mMatchCount;
+	}
+
+
+	void RegexCoreResultsBuilder::AddGroup( ptrdiff_t index, ptrdiff_t length, int32_t name )
+	{
+		mItems.push_back( ToInt32( index ) );
+		mItems.push_back( ToInt32( length ) );
+		mItems.push_back( name );
+
+		mCaptureCountItem = mItems.size( );
+		mItems.push_back( 0 );
+	}
+
+
+	void RegexCoreResultsBuilder::AddFailedGroup( int32_t name )
+	{
+		AddGroup( -1, 0, name );
+	}
+
+
+	void RegexCoreResultsBuilder::AddCapture( ptrdiff_t index, ptrdiff_t length )
+	{
+		mItems.push_back( ToInt32( index ) );
+		mItems.push_back( ToInt32( length ) );
+
+		++mItems[mCaptureCountItem];
+	}
+
+
+	void RegexCoreResultsBuilder::Release( RegexCoreResults* results )
+	{
+		*results = RegexCoreResults{ };
+
+		// (the buffers are allocated by 'malloc', since 'RegexCoreFreeResults' can be called from C)
+
+		if( !mItems.empty( ) )
+		{
+			results->Items = static_cast<int32_t*>( malloc( mItems.size( ) * sizeof( int32_t ) ) );
+			if( results->Items == nullptr ) throw std::bad_alloc( );
+
+			memcpy( results->Items, mItems.data( ), mItems.size( ) * sizeof( int32_t ) );
+		}
+
+		if( !mNames.empty( ) )
+		{
+			results->Names = static_cast<char16_t*>( malloc( mNames.size( ) * sizeof( char16_t ) ) );
+
+			if( results->Names == nullptr )
+			{
+				RegexCoreFreeResults( results );
+
+				throw std::bad_alloc( );
+			}
+
+			memcpy( results->Names, mNames.data( ), mNames.size( ) * sizeof( char16_t ) );
+		}
+
+		results->MatchCount = mMatchCount;
+		results->ItemCount = mItems.size( );
+		results->NameCount = mNameCount;
+
+		mItems.clear( );
+		mCaptureCountItem = 0;
+		mMatchCount = 0;
+		mNames.clear( );
+		mNameCount = 0;
+	}
+
+
+	void SetRegexCoreError( RegexCoreError* error, const char* message )
+	{
+		if( error == nullptr ) return;
+
+		size_t length = strlen( message );
+		if( length >= sizeof( error->Text ) ) length = sizeof( error->Text ) - 1;
+
+		memcpy( error->Text, message, length );
+		error->Text[length] = '\0';
+	}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+// The uniform C interface of the portable engine cores ("...Core.h" files in the interop projects).
+//
+// Each core exports the same three functions, prefixed with the name of the engine:
+//	<Engine>CoreCompile -- compiles the UTF-16 pattern with the engine-specific options ('<Engine>CoreOptions');
+//		returns an opaque handle, or null and the error text;
+//	<Engine>CoreScan -- finds all matches in the UTF-16 text and stores them in 'RegexCoreResults';
+//		returns one of 'REGEX_CORE_...' codes;
+//	<Engine>CoreFree -- releases the compiled pattern.
+// The results are released by 'RegexCoreFreeResults'. Some cores also export <Engine>CoreGetSize, the approximate
+// memory of the compiled pattern, for the caches of the interops (see "CompiledPatternCache.h").
+//
+// The cores do not depend on .NET or Windows, therefore they can be built, tested and profiled
+// without the host; the C++/CLI 'Matcher' classes only convert the options and the results.
+// On Linux, they are built with the benchmark by "RegexEngines/CMakeLists.txt".
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef __cplusplus
+#	include <uchar.h>
+#endif
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	enum
+	{
+		REGEX_CORE_OK = 0,
+		REGEX_CORE_ERROR = 1, // (see 'RegexCoreError')
+		REGEX_CORE_CANCELLED = 2,
+		REGEX_CORE_LIMIT = 3, // the engine stopped at its limit of backtracking steps, depth or memory (see 'RegexCoreError')
+	};
+
+
+	typedef struct RegexCoreError
+	{
+		char Text[512]; // (UTF-8)
+	} RegexCoreError;
+
+
+	// Returns non-zero if the scan must stop. It is called between the matches (or more often),
+	// on the thread that called the scan function.
+	typedef int32_t RegexCoreIsCancelledProc( void* context );
+
+
+	typedef struct RegexCoreCancellation
+	{
+		RegexCoreIsCancelledProc* IsCancelled; // (can be null)
+		void* Context;
+	} RegexCoreCancellation;
+
+
+	// The matches in one flat buffer; the positions are in UTF-16 units.
+	//	For each match: the number of groups G (the first group is the whole match), then, for each group:
+	//		index (-1 if the group did not participate), length, name (index in 'Names', or -1),
+	//		number of captures C, then C pairs of index and length.
+	//	'Names' contains 'NameCount' names, each terminated by zero.
+	typedef struct RegexCoreResults
+	{
+		int32_t MatchCount;
+		int32_t* Items;
+		size_t ItemCount;
+		char16_t* Names;
+		int32_t NameCount;
+	} RegexCoreResults;
+
+
+	void RegexCoreFreeResults( RegexCoreResults* results );
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#ifdef __cplusplus
+
+#include <string>
+#include <vector>
+
+
+namespace NativeInfrastructure
+{
+
+	// Collects the results of a core in the format of 'RegexCoreResults'.
+	// The positions are checked against 'INT32_MAX' (throws 'std::overflow_error').
+	class RegexCoreResultsBuilder final
+	{
+	public:
+
+		RegexCoreResultsBuilder( );
+
+		// Returns the index of the name, which is used by 'AddGroup'.
+		int32_t AddName( const char16_t* name, size_t length );
+
+		void BeginMatch( int32_t groupCount );
+
+		void AddGroup( ptrdiff_t index, ptrdiff_t length, int32_t name = -1 );
+		void AddFailedGroup( int32_t name = -1 );
+
+		// Adds a capture to the last group.
+		void AddCapture( ptrdiff_t index, ptrdiff_t length );
+
+		int32_t MatchCount( ) const { return mMatchCount; }
+
+		// Moves the collected results; the builder can be used again.
+		void Release( RegexCoreResults* results );
+
+	private:
+
+		std::vector<int32_t> mItems;
+		size_t mCaptureCountItem; // (the item of the last group)
+		int32_t mMatchCount;
+		std::u16string mNames;
+		int32_t mNameCount;
+
+		static int32_t ToInt32( ptrdiff_t value );
+	};
+
+
+	// Copies the message, which can be truncated, to the error.
+	void SetRegexCoreError( RegexCoreError* error, const char* message );
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+
+// The managed side of "RegexCore.h", for the C++/CLI 'Matcher' classes (compiled with '/clr' only).
+
+#include <cstring>
+#include <string>
+#include <vcclr.h>
+
+#include "PhaseTrace.h"
+#include "RegexCore.h"
+
+
+namespace NativeInfrastructure
+{
+
+	// Makes 'RegexCoreCancellation' that calls 'ICancellable' of the host.
+	class RegexCoreManagedCancellation final
+	{
+	public:
+
+		explicit RegexCoreManagedCancellation( RegexEngineInfrastructure::ICancellable^ cnc )
+			:
+			mCnc( cnc )
+		{
+			mCancellation.IsCancelled = &IsCancelled;
+			mCancellation.Context = this;
+		}
+
+		const RegexCoreCancellation* Get( ) const { return &mCancellation; }
+
+	private:
+
+		gcroot<RegexEngineInfrastructure::ICancellable^> mCnc;
+		RegexCoreCancellation mCancellation;
+
+		RegexCoreManagedCancellation( const RegexCoreManagedCancellation& ) = delete;
+		RegexCoreManagedCancellation& operator=( const RegexCoreManagedCancellation& ) = delete;
+
+		static int32_t IsCancelled( void* context )
+		{
+			return static_cast<RegexCoreManagedCancellation*>( context )->mCnc->IsCancellationRequested ? 1 : 0;
+		}
+	};
+
+
+	inline System::String^ RegexCoreErrorToString( const RegexCoreError& error )
+	{
+		return gcnew System::String( error.Text, 0, static_cast<int>( strlen( error.Text ) ), System::Text::Encoding::UTF8 );
+	}
+
+
+	// Converts the results to 'SimpleMatch' objects. The groups without names are named by number;
+	// the failed groups get 'failedGroupIndex' (the engines did not agree on it).
+	// The conversion is traced as the "results" phase of 'traceCategory' (see "PhaseTrace.h").
+	inline RegexEngineInfrastructure::Matches::RegexMatches^ RegexCoreResultsToMatches( const RegexCoreResults& results,
+		RegexEngineInfrastructure::Matches::Simple::ISimpleTextGetter^ textGetter, int failedGroupIndex, const char* traceCategory )
+	{
+		using namespace System;
+		using namespace System::Collections::Generic;
+		using namespace RegexEngineInfrastructure::Matches;
+		using namespace RegexEngineInfrastructure::Matches::Simple;
+
+		TraceSpan span( traceCategory, "results", results.MatchCount );
+
+		auto names = gcnew cli::array<String^>( results.NameCount );
+		{
+			const char16_t* name = results.Names;
+
+			for( int i = 0; i < names->Length; ++i )
+			{
+				size_t length = std::char_traits<char16_t>::length( name );
+
+				names[i] = gcnew String( reinterpret_cast<const wchar_t*>( name ), 0, static_cast<int>( length ) );
+				name += length + 1;
+			}
+		}
+
+		auto matches = gcnew List<IMatch^>( results.MatchCount );
+		const int32_t* item = results.Items;
+
+		for( int32_t m = 0; m < results.MatchCount; ++m )
+		{
+			int32_t const group_count = *item++;
+			SimpleMatch^ match = nullptr;
+
+			// (the first group is the whole match)
+			for( int32_t g = 0; g < group_count; ++g )
+			{
+				int32_t const index = *item++;
+				int32_t const length = *item++;
+				int32_t const name = *item++;
+				int32_t const capture_count = *item++;
+
+				String^ group_name = name >= 0 ? names[name] : g.ToString( System::Globalization::CultureInfo::InvariantCulture );
+
+				if( match == nullptr ) match = SimpleMatch::Create( index, length, textGetter );
+
+				SimpleGroup^ group = index < 0 ?
+					match->AddGroup( failedGroupIndex, 0, false, group_name ) :
+					match->AddGroup( index, length, true, group_name );
+
+				for( int32_t c = 0; c < capture_count; ++c, item += 2 )
+				{
+					group->AddCapture( item[0], item[1] );
+				}
+			}
+
+			if( match != nullptr ) matches->Add( match );
+		}
+
+		return gcnew RegexMatches( matches->Count, matches );
+	}
+
+}
@@ -0,0 +1,160 @@
+#include "SharedMemory.h"
+
+#ifdef _WIN32
+#	include <Windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <cerrno>
+#	include <cstring>
+#endif
+
+
+namespace NativeInfrastructure
+{
+
+#ifdef _WIN32
+
+	SharedMemory::SharedMemory( )
+		:
+		mData( nullptr ),
+		mSize( 0 ),
+		mMapping( nullptr )
+	{
+	}
+
+
+	static std::string FormatWindowsError( const char* operation )
+	{
+		DWORD code = GetLastError( );
+		char buffer[256] = "";
+
+		FormatMessageA( FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, nullptr, code, 0, buffer, sizeof( buffer ), nullptr );
+
+		return std::string( operation ) + " failed: " + buffer;
+	}
+
+
+	bool SharedMemory::Open( const char* utf8Name, size_t size )
+	{
+		Close( );
+
+		if( size == 0 ) return true; // (nothing to map)
+
+		int length = MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, utf8Name, -1, nullptr, 0 );
+		if( length <= 0 )
+		{
+			mErrorText = "Invalid name of shared memory.";
+
+			return false;
+		}
+
+		std::wstring name( length, L'\0' );
+		MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, utf8Name, -1, &name[0], length );
+
+		mMapping = OpenFileMappingW( FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name.c_str( ) );
+		if( mMapping == nullptr )
+		{
+			mErrorText = FormatWindowsError( "OpenFileMapping" );
+
+			return false;
+		}
+
+		mData = static_cast<char*>( MapViewOfFile( mMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size ) );
+		if( mData == nullptr )
+		{
+			mErrorText = FormatWindowsError( "MapViewOfFile" );
+			Close( );
+
+			return false;
+		}
+
+		mSize = size;
+		mName = utf8Name;
+
+		return true;
+	}
+
+
+	void SharedMemory::Close( )
+	{
+		if( mData != nullptr ) UnmapViewOfFile( mData );
+		if( mMapping != nullptr ) CloseHandle( mMapping );
+
+		mData = nullptr;
+		mSize = 0;
+		mMapping = nullptr;
+		mName.clear( );
+	}
+
+#else
+
+	SharedMemory::SharedMemory( )
+		:
+		mData( nullptr ),
+		mSize( 0 )
+	{
+	}
+
+
+	static std::string FormatPosixError( const char* operation )
+	{
+		return std::string( operation ) + " failed: " + strerror( errno );
+	}
+
+
+	bool SharedMemory::Open( const char* utf8Name, size_t size )
+	{
+		Close( );
+
+		if( size == 0 ) return true; // (nothing to map)
+
+		int fd = shm_open( utf8Name, O_RDWR, 0 );
+		if( fd < 0 )
+		{
+			mErrorText = FormatPosixError( "shm_open" );
+
+			return false;
+		}
+
+		void* p = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		int mmap_errno = errno;
+
+		close( fd ); // (the mapping remains valid)
+
+		if( p == MAP_FAILED )
+		{
+			errno = mmap_errno;
+			mErrorText = FormatPosixError( "mmap" );
+
+			return false;
+		}
+
+		mData = static_cast<char*>( p );
+		mSize = size;
+		mName = utf8Name;
+
+		return true;
+	}
+
+
+	void SharedMemory::Close( )
+	{
+		if( mData != nullptr ) munmap( mData, mSize );
+
+		mData = nullptr;
+		mSize = 0;
+		mName.clear( );
+	}
+
+#endif
+
+
+	SharedMemory::~SharedMemory( )
+	{
+		Close( );
+	}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Named shared memory that was created by another process (the host), opened for reading and writing.
+//
+// Windows: 'OpenFileMappingW' and 'MapViewOfFile'; the name is like "Local\...".
+// POSIX: 'shm_open' and 'mmap'; the name is like "/...".
+//
+// (Do not include this file in managed code).
+
+#include <cstddef>
+#include <string>
+
+
+namespace NativeInfrastructure
+{
+
+	class SharedMemory final
+	{
+	public:
+
+		SharedMemory( );
+		~SharedMemory( );
+
+		SharedMemory( const SharedMemory& ) = delete;
+		SharedMemory& operator =( const SharedMemory& ) = delete;
+
+		// Maps the first 'size' bytes, which must not exceed the size of the memory; the name is in UTF-8.
+		// Returns false if the memory cannot be mapped; see 'GetErrorText'.
+		bool Open( const char* utf8Name, size_t size );
+
+		void Close( );
+
+		char* Data( ) const { return mData; }
+		size_t Size( ) const { return mSize; }
+		const std::string& Name( ) const { return mName; }
+
+		const std::string& GetErrorText( ) const { return mErrorText; }
+
+	private:
+
+		char* mData;
+		size_t mSize;
+		std::string mName;
+		std::string mErrorText;
+
+#ifdef _WIN32
+		void* mMapping;
+#endif
+	};
+
+}
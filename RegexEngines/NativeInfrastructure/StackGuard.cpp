@@ -0,0 +1,647 @@
+#include "StackGuard.h"
+
+#ifdef _WIN32
+#	include <Windows.h>
+#	include <process.h>
+#else
+#	include <pthread.h>
+#	include <signal.h>
+#	include <setjmp.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <cstdlib>
+#	include <cstdint>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+
+namespace NativeInfrastructure
+{
+	const size_t GuardAreaSize = 256 * 1024; // (large frames can jump over small guard areas)
+
+
+	struct GuardedThreadState
+	{
+		GuardedProc* proc = nullptr;
+		void* arg = nullptr;
+		size_t stackSize = 0;
+
+		std::mutex mutex;
+		std::condition_variable finished;
+		bool isFinished = false;
+		bool isDetached = false; // (the owner was destroyed while the procedure was running)
+
+		GuardedRunResult result = GuardedRunResult::Completed;
+		char errorText[256] = "";
+		bool isAbandoned = false; // (the run failed with a fault; the thread is parked)
+
+#ifdef _WIN32
+		HANDLE thread = nullptr;
+#else
+		pthread_t thread{};
+		bool threadCreated = false;
+#endif
+	};
+
+
+	// The number of the detached threads that are still running (see 'MaxAbandonedGuardedThreads').
+	static std::mutex sAbandonedMutex;
+	static std::condition_variable sAbandonedFinished;
+	static unsigned sAbandonedCount = 0;
+
+	// The number of the threads that are parked after a fault (see 'MaxParkedGuardedThreads').
+	static std::atomic<unsigned> sParkedCount{ 0 };
+
+
+	static void SetErrorText( char* errorText, size_t errorTextSize, const char* text )
+	{
+		if( errorTextSize == 0 ) return;
+
+		size_t length = strlen( text );
+		if( length >= errorTextSize ) length = errorTextSize - 1;
+
+		memcpy( errorText, text, length );
+		errorText[length] = '\0';
+	}
+
+
+#ifdef _WIN32
+
+	static DWORD SEHFilter( DWORD code, GuardedThreadState* state )
+	{
+		const char* text;
+
+		switch( code )
+		{
+
+#define E(e) case e: text = #e; break;
+
+			E( EXCEPTION_ACCESS_VIOLATION )
+				E( EXCEPTION_DATATYPE_MISALIGNMENT )
+				E( EXCEPTION_BREAKPOINT )
+				E( EXCEPTION_SINGLE_STEP )
+				E( EXCEPTION_ARRAY_BOUNDS_EXCEEDED )
+				E( EXCEPTION_FLT_DENORMAL_OPERAND )
+				E( EXCEPTION_FLT_DIVIDE_BY_ZERO )
+				E( EXCEPTION_FLT_INEXACT_RESULT )
+				E( EXCEPTION_FLT_INVALID_OPERATION )
+				E( EXCEPTION_FLT_OVERFLOW )
+				E( EXCEPTION_FLT_STACK_CHECK )
+				E( EXCEPTION_FLT_UNDERFLOW )
+				E( EXCEPTION_INT_DIVIDE_BY_ZERO )
+				E( EXCEPTION_INT_OVERFLOW )
+				E( EXCEPTION_PRIV_INSTRUCTION )
+				E( EXCEPTION_IN_PAGE_ERROR )
+				E( EXCEPTION_ILLEGAL_INSTRUCTION )
+				E( EXCEPTION_NONCONTINUABLE_EXCEPTION )
+				E( EXCEPTION_STACK_OVERFLOW )
+				E( EXCEPTION_INVALID_DISPOSITION )
+				E( EXCEPTION_GUARD_PAGE )
+				E( EXCEPTION_INVALID_HANDLE )
+
+#undef E
+
+		default:
+			return EXCEPTION_CONTINUE_SEARCH; // also covers code E06D7363, probably associated with 'throw std::exception'
+		}
+
+		state->result = code == EXCEPTION_STACK_OVERFLOW ? GuardedRunResult::StackOverflow : GuardedRunResult::Fault;
+		state->isAbandoned = true;
+
+		snprintf( state->errorText, sizeof( state->errorText ), "SEH Error: %s", text );
+
+		return EXCEPTION_EXECUTE_HANDLER;
+	}
+
+
+	static void RunGuardedSEH( GuardedThreadState* state )
+	{
+		__try
+		{
+			state->proc( state->arg );
+		}
+		__except( SEHFilter( GetExceptionCode( ), state ) )
+		{
+			// things done in filter
+		}
+	}
+
+
+	static void RunGuarded( GuardedThreadState* state )
+	{
+		// reserve some stack for the handlers
+		ULONG ss = 64 * 1024;
+		SetThreadStackGuarantee( &ss );
+
+		RunGuardedSEH( state );
+	}
+
+
+	static void ParkAbandonedThread( )
+	{
+		for( ;; ) Sleep( INFINITE );
+	}
+
+#else
+
+	struct FaultContext
+	{
+		sigjmp_buf jump;
+		uintptr_t stackLow;
+		uintptr_t stackHigh;
+		uintptr_t signalStackLow;
+		uintptr_t signalStackHigh;
+		volatile sig_atomic_t armed; // (the jump buffer is set; cleared by the first fault)
+		volatile sig_atomic_t signal;
+		void* volatile address;
+	};
+
+
+	// The contexts of the running guarded threads, which the handler reads instead of thread-local storage
+	// (the first access to a thread-local variable can allocate, which is not allowed in a signal handler).
+	const size_t MaxGuardedThreads = 1024;
+
+	static_assert( ATOMIC_POINTER_LOCK_FREE == 2, "The handler needs lock-free atomic pointers." );
+
+	static std::atomic<FaultContext*> sFaultContexts[MaxGuardedThreads];
+	static struct sigaction sPreviousSegvAction;
+	static struct sigaction sPreviousBusAction;
+	static std::once_flag sInstallHandlersFlag;
+
+
+	static std::atomic<FaultContext*>* RegisterFaultContext( FaultContext* fc )
+	{
+		for( std::atomic<FaultContext*>& slot : sFaultContexts )
+		{
+			FaultContext* expected = nullptr;
+
+			if( slot.compare_exchange_strong( expected, fc ) ) return &slot;
+		}
+
+		return nullptr;
+	}
+
+
+	// Returns the context of the guarded thread whose signal stack holds the frame of the handler, or null.
+	static FaultContext* FindFaultContext( uintptr_t handlerFrame )
+	{
+		for( std::atomic<FaultContext*>& slot : sFaultContexts )
+		{
+			FaultContext* fc = slot.load( std::memory_order_acquire );
+
+			if( fc != nullptr && handlerFrame >= fc->signalStackLow && handlerFrame < fc->signalStackHigh ) return fc;
+		}
+
+		return nullptr;
+	}
+
+
+	static void FaultHandler( int sig, siginfo_t* info, void* context )
+	{
+		char frame;
+		FaultContext* fc = FindFaultContext( (uintptr_t)&frame );
+
+		if( fc == nullptr || !fc->armed )
+		{
+			// not a guarded thread, or a fault after the first one; delegate to the previous handler
+
+			const struct sigaction& previous = sig == SIGBUS ? sPreviousBusAction : sPreviousSegvAction;
+
+			if( ( previous.sa_flags & SA_SIGINFO ) && previous.sa_sigaction != nullptr )
+			{
+				previous.sa_sigaction( sig, info, context );
+			}
+			else if( previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN )
+			{
+				previous.sa_handler( sig );
+			}
+			else
+			{
+				// the faulting instruction will be re-executed and the default action will terminate the process
+				signal( sig, SIG_DFL );
+			}
+
+			return;
+		}
+
+		fc->armed = 0;
+		fc->signal = sig;
+		fc->address = info->si_addr;
+
+		siglongjmp( fc->jump, 1 );
+	}
+
+
+	static void InstallHandlers( )
+	{
+		struct sigaction sa;
+		memset( &sa, 0, sizeof( sa ) );
+
+		sa.sa_sigaction = &FaultHandler;
+		sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+		sigemptyset( &sa.sa_mask );
+
+		sigaction( SIGSEGV, &sa, &sPreviousSegvAction );
+		sigaction( SIGBUS, &sa, &sPreviousBusAction );
+	}
+
+
+	// Returns false after a fault; the frames of the procedure are abandoned then.
+	static bool RunGuardedSignals( GuardedThreadState* state, FaultContext* fc )
+	{
+		if( sigsetjmp( fc->jump, 1 ) == 0 )
+		{
+			fc->armed = 1;
+
+			state->proc( state->arg );
+
+			fc->armed = 0;
+
+			return true;
+		}
+
+		// returned from 'FaultHandler'; only the code that does not allocate or lock is used below
+
+		uintptr_t address = (uintptr_t)fc->address;
+		bool is_stack_overflow =
+			address < fc->stackHigh &&
+			address + GuardAreaSize + 64 * 1024 >= fc->stackLow && // (including the guard area)
+			address < fc->stackLow + 64 * 1024;
+
+		state->result = is_stack_overflow ? GuardedRunResult::StackOverflow : GuardedRunResult::Fault;
+
+		const char* text;
+
+		if( fc->signal == SIGBUS )
+		{
+			text = is_stack_overflow ? "SIGBUS: stack overflow" : "SIGBUS: access violation";
+		}
+		else
+		{
+			text = is_stack_overflow ? "SIGSEGV: stack overflow" : "SIGSEGV: access violation";
+		}
+
+		SetErrorText( state->errorText, sizeof( state->errorText ), text );
+
+		return false;
+	}
+
+
+	static void RunGuarded( GuardedThreadState* state )
+	{
+		std::call_once( sInstallHandlersFlag, &InstallHandlers );
+
+		// the handler cannot run on the overflowed stack
+
+		size_t alt_size = 256 * 1024;
+		void* alt_stack = malloc( alt_size );
+
+		if( alt_stack == nullptr )
+		{
+			state->result = GuardedRunResult::Failed;
+			SetErrorText( state->errorText, sizeof( state->errorText ), "Failed to allocate the signal stack." );
+
+			return;
+		}
+
+		char marker;
+
+		FaultContext fc{};
+		fc.stackHigh = (uintptr_t)&marker;
+		fc.stackLow = fc.stackHigh - state->stackSize;
+		fc.signalStackLow = (uintptr_t)alt_stack;
+		fc.signalStackHigh = fc.signalStackLow + alt_size;
+
+		// (the context is reachable by the handler before the signal stack is used)
+		std::atomic<FaultContext*>* slot = RegisterFaultContext( &fc );
+
+		if( slot == nullptr )
+		{
+			free( alt_stack );
+
+			state->result = GuardedRunResult::Failed;
+			SetErrorText( state->errorText, sizeof( state->errorText ), "Too many guarded threads." );
+
+			return;
+		}
+
+		stack_t ss{};
+		ss.ss_sp = alt_stack;
+		ss.ss_size = alt_size;
+		ss.ss_flags = 0;
+
+		if( sigaltstack( &ss, nullptr ) != 0 )
+		{
+			slot->store( nullptr );
+			free( alt_stack );
+
+			state->result = GuardedRunResult::Failed;
+			SetErrorText( state->errorText, sizeof( state->errorText ), "Failed to set the signal stack." );
+
+			return;
+		}
+
+		bool const completed = RunGuardedSignals( state, &fc );
+
+		stack_t disabled{};
+		disabled.ss_flags = SS_DISABLE;
+		sigaltstack( &disabled, nullptr );
+
+		slot->store( nullptr );
+
+		if( completed )
+		{
+			free( alt_stack );
+
+			return;
+		}
+
+		// the thread is abandoned (see "StackGuard.h"); the signal stack is not freed, since the allocator
+		// can be inconsistent, but the pages of the stack below this frame are given back to the system
+
+		state->isAbandoned = true;
+
+		long page_size = sysconf( _SC_PAGESIZE );
+		if( page_size <= 0 ) page_size = 4096;
+
+		uintptr_t const low = ( fc.stackLow + page_size - 1 ) / page_size * page_size;
+		uintptr_t const high = ( (uintptr_t)&marker - 64 * 1024 ) / page_size * page_size;
+
+		if( low < high ) madvise( (void*)low, high - low, MADV_DONTNEED );
+	}
+
+
+	static void ParkAbandonedThread( )
+	{
+		for( ;; ) pause( );
+	}
+
+#endif
+
+
+	static void RunGuardedTryCatch( GuardedThreadState* state )
+	{
+		try
+		{
+			RunGuarded( state );
+		}
+		catch( const std::exception& exc )
+		{
+			state->result = GuardedRunResult::Failed;
+			SetErrorText( state->errorText, sizeof( state->errorText ), exc.what( ) );
+		}
+		catch( ... )
+		{
+			state->result = GuardedRunResult::Failed;
+			SetErrorText( state->errorText, sizeof( state->errorText ), "Unknown error" );
+		}
+	}
+
+
+	static void GuardedThreadProc0( std::shared_ptr<GuardedThreadState>* p )
+	{
+		std::shared_ptr<GuardedThreadState> state = std::move( *p );
+		delete p;
+
+		RunGuardedTryCatch( state.get( ) );
+
+		bool const abandoned = state->isAbandoned;
+
+		// (counted before the result is published, so that the next 'Start' of the caller sees it)
+		if( abandoned ) ++sParkedCount;
+		bool detached;
+
+		{
+			std::lock_guard<std::mutex> lock( state->mutex );
+
+			state->isFinished = true;
+			detached = state->isDetached;
+		}
+
+		state->finished.notify_all( );
+
+		if( detached )
+		{
+			{
+				std::lock_guard<std::mutex> lock( sAbandonedMutex );
+
+				--sAbandonedCount;
+			}
+
+			sAbandonedFinished.notify_all( );
+		}
+
+		// (the thread, which keeps the state alive, is never reused after a fault; see "StackGuard.h")
+		if( abandoned ) ParkAbandonedThread( );
+	}
+
+
+#ifdef _WIN32
+
+	static unsigned __stdcall GuardedThreadProc( void* p )
+	{
+		GuardedThreadProc0( (std::shared_ptr<GuardedThreadState>*)p );
+
+		return 0;
+	}
+
+#else
+
+	static void* GuardedThreadProc( void* p )
+	{
+		GuardedThreadProc0( (std::shared_ptr<GuardedThreadState>*)p );
+
+		return nullptr;
+	}
+
+#endif
+
+
+	GuardedThread::GuardedThread( )
+	{
+	}
+
+
+	GuardedThread::~GuardedThread( )
+	{
+		if( !mState ) return;
+
+		{
+			std::lock_guard<std::mutex> lock( mState->mutex );
+
+			if( !mState->isFinished )
+			{
+				mState->isDetached = true;
+
+				std::lock_guard<std::mutex> abandoned_lock( sAbandonedMutex );
+
+				++sAbandonedCount;
+			}
+		}
+
+#ifdef _WIN32
+		if( mState->thread ) CloseHandle( mState->thread );
+#else
+		if( mState->threadCreated )
+		{
+			if( Wait( 0 ) && !mState->isAbandoned )
+			{
+				pthread_join( mState->thread, nullptr );
+			}
+			else
+			{
+				pthread_detach( mState->thread );
+			}
+		}
+#endif
+	}
+
+
+	bool GuardedThread::Start( size_t stackSize, GuardedProc* proc, void* arg )
+	{
+		if( mState ) return false; // (already started)
+
+		if( stackSize < MinimumGuardedStackSize ) stackSize = MinimumGuardedStackSize;
+
+		mState = std::make_shared<GuardedThreadState>( );
+		mState->proc = proc;
+		mState->arg = arg;
+		mState->stackSize = stackSize;
+
+		if( sParkedCount.load( ) >= MaxParkedGuardedThreads )
+		{
+			mState->isFinished = true;
+			mState->result = GuardedRunResult::Failed;
+			snprintf( mState->errorText, sizeof( mState->errorText ),
+				"Too many searches failed with a fault (%u threads are parked). Restart the application to search again.", MaxParkedGuardedThreads );
+
+			return false;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock( sAbandonedMutex );
+
+			if( !sAbandonedFinished.wait_for( lock, std::chrono::milliseconds( AbandonedGuardedThreadsWait ),
+				[] { return sAbandonedCount < MaxAbandonedGuardedThreads; } ) )
+			{
+				mState->isFinished = true;
+				mState->result = GuardedRunResult::Failed;
+				SetErrorText( mState->errorText, sizeof( mState->errorText ),
+					"Too many abandoned searches are still running. Try again later, or use a pattern that backtracks less." );
+
+				return false;
+			}
+		}
+
+		auto* p = new std::shared_ptr<GuardedThreadState>( mState ); // (owned by thread)
+
+#ifdef _WIN32
+
+		uintptr_t thread = _beginthreadex( nullptr, (unsigned)stackSize, &GuardedThreadProc, p, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr );
+
+		if( thread == 0 )
+		{
+			delete p;
+
+			mState->isFinished = true;
+			mState->result = GuardedRunResult::Failed;
+			SetErrorText( mState->errorText, sizeof( mState->errorText ), "Failed to create the thread." );
+
+			return false;
+		}
+
+		mState->thread = (HANDLE)thread;
+
+#else
+
+		pthread_attr_t attr;
+		pthread_attr_init( &attr );
+
+		long page_size = sysconf( _SC_PAGESIZE );
+		if( page_size <= 0 ) page_size = 4096;
+
+		size_t rounded_size = ( stackSize + page_size - 1 ) / page_size * page_size;
+
+		// the library allocates the stack using 'mmap', with a 'PROT_NONE' guard area below it
+		int r = pthread_attr_setstacksize( &attr, rounded_size );
+		if( r == 0 ) r = pthread_attr_setguardsize( &attr, GuardAreaSize );
+		if( r == 0 ) r = pthread_create( &mState->thread, &attr, &GuardedThreadProc, p );
+
+		pthread_attr_destroy( &attr );
+
+		if( r != 0 )
+		{
+			delete p;
+
+			mState->isFinished = true;
+			mState->result = GuardedRunResult::Failed;
+			snprintf( mState->errorText, sizeof( mState->errorText ), "Failed to create the thread (%s).", strerror( r ) );
+
+			return false;
+		}
+
+		mState->threadCreated = true;
+
+#endif
+
+		return true;
+	}
+
+
+	bool GuardedThread::Wait( unsigned milliseconds )
+	{
+		if( !mState ) return true;
+
+		std::unique_lock<std::mutex> lock( mState->mutex );
+
+		return mState->finished.wait_for( lock, std::chrono::milliseconds( milliseconds ), [this] { return mState->isFinished; } );
+	}
+
+
+	GuardedRunResult GuardedThread::GetResult( ) const
+	{
+		return mState ? mState->result : GuardedRunResult::Failed;
+	}
+
+
+	const char* GuardedThread::GetErrorText( ) const
+	{
+		return mState ? mState->errorText : "Thread not started.";
+	}
+
+
+	GuardedRunResult RunOnGuardedThread( size_t stackSize, GuardedProc* proc, void* arg, char* errorText, size_t errorTextSize )
+	{
+		GuardedThread thread;
+
+		if( thread.Start( stackSize, proc, arg ) )
+		{
+			while( !thread.Wait( 1000 ) );
+		}
+
+		SetErrorText( errorText, errorTextSize, thread.GetErrorText( ) );
+
+		return thread.GetResult( );
+	}
+
+
+	size_t GuardedStackSizeFromMegabytes( long megabytes )
+	{
+		if( megabytes == 0 ) return DefaultGuardedStackSize;
+
+		if( megabytes < 0 ) return 0;
+		if( (unsigned long)megabytes > MaximumGuardedStackSize / ( 1024 * 1024 ) ) return 0;
+
+		size_t size = (size_t)megabytes * 1024 * 1024;
+
+		return size < MinimumGuardedStackSize ? MinimumGuardedStackSize : size;
+	}
+
+}
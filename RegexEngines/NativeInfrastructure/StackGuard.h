@@ -0,0 +1,96 @@
+#pragma once
+
+// Portable isolation of recursive engines: runs native code on a worker thread that has
+// a large stack with guard pages, and turns a stack overflow into a reportable error.
+//
+// Windows: the thread is created by '_beginthreadex' with a reserved stack; faults are caught by SEH.
+// POSIX: the thread is created by 'pthread_create' with a large stack and a wide guard area;
+//   faults are caught by a 'SIGSEGV'/'SIGBUS' handler that runs on an alternate signal stack ('sigaltstack')
+//   and leaves the failed run with 'siglongjmp', across the C++ frames of the engine. The handler does not
+//   use thread-local storage: the context of the run is registered, with the range of its signal stack,
+//   before the signal stack is installed, and the handler finds it by the address of its own frame.
+//
+// After a fault, the thread and everything that the failed run allocated are abandoned: the destructors
+// are not called, and the locks that the run held (including the ones of the memory allocator, if the fault
+// happened there) are not released. Therefore the thread is never reused and never exits: it publishes
+// the result and is parked until the end of the process, with the unused part of its stack given back to
+// the system. The data passed to the procedure must not be used after a failed run, except the results
+// that are already stored, and must not be released by the caller. The parked threads are limited: after
+// 'MaxParkedGuardedThreads' faults, 'Start' fails, which the engines report as an error of the scan.
+//
+// When the caller stops waiting, for example after a cancellation that the engine cannot interrupt at once,
+// the thread is detached and runs until the engine returns, with its own copy of the data. Such abandoned threads
+// are limited: while 'MaxAbandonedGuardedThreads' of them are running, 'Start' waits for one of them to finish,
+// at most 'AbandonedGuardedThreadsWait' milliseconds, and then fails, which the engines report as an error
+// of the scan. The abandoned threads are not stopped, therefore an engine that ignores the cancellation keeps
+// the CPU busy until its searches end.
+//
+// (Do not include this file in managed code; see "NativeMatcher.h" files for the wrappers).
+
+#include <cstddef>
+#include <memory>
+
+
+namespace NativeInfrastructure
+{
+	typedef void GuardedProc( void* arg );
+
+
+	enum class GuardedRunResult
+	{
+		Completed,
+		StackOverflow,
+		Fault,
+		Failed,
+	};
+
+
+	const size_t MinimumGuardedStackSize = 1 * 1024 * 1024;
+	const size_t DefaultGuardedStackSize = 64 * 1024 * 1024;
+	const size_t MaximumGuardedStackSize = 1024 * 1024 * 1024;
+
+	const unsigned MaxAbandonedGuardedThreads = 8;
+	const unsigned AbandonedGuardedThreadsWait = 1000;
+	const unsigned MaxParkedGuardedThreads = 16;
+
+
+	struct GuardedThreadState;
+
+
+	class GuardedThread final
+	{
+	public:
+
+		GuardedThread( );
+		~GuardedThread( ); // (if the thread is still running, or was abandoned after a fault, it is detached)
+
+		GuardedThread( const GuardedThread& ) = delete;
+		GuardedThread& operator =( const GuardedThread& ) = delete;
+
+		// Starts 'proc(arg)' on a new thread having 'stackSize' bytes of stack. Returns false if the thread
+		// cannot be created, if too many abandoned threads are still running, or if too many threads are parked
+		// after faults; see 'GetErrorText'.
+		bool Start( size_t stackSize, GuardedProc* proc, void* arg );
+
+		// Returns true if the procedure finished (successfully or not).
+		bool Wait( unsigned milliseconds );
+
+		GuardedRunResult GetResult( ) const;
+		const char* GetErrorText( ) const; // (empty if completed)
+
+	private:
+
+		std::shared_ptr<GuardedThreadState> mState;
+	};
+
+
+	// Executes 'proc(arg)' on a guarded thread and waits for completion.
+	// Returns 'Completed' or the reason of failure, which is also described in 'errorText'.
+	GuardedRunResult RunOnGuardedThread( size_t stackSize, GuardedProc* proc, void* arg, char* errorText, size_t errorTextSize );
+
+
+	// Converts the user-specified size, in megabytes, to bytes; 0 means the default.
+	// Returns 0 if the value is out of range.
+	size_t GuardedStackSizeFromMegabytes( long megabytes );
+
+}
@@ -0,0 +1,158 @@
+#include "Utf8Text.h"
+
+
+namespace NativeInfrastructure
+{
+
+	void AppendUtf8( std::string* out, const char16_t* text, size_t length )
+	{
+		out->reserve( out->size( ) + length ); // (exact for ASCII)
+
+		for( size_t i = 0; i < length; ++i )
+		{
+			char32_t c = text[i];
+
+			if( c >= 0xD800 && c <= 0xDBFF && i + 1 < length && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF )
+			{
+				c = 0x10000 + ( ( c - 0xD800 ) << 10 ) + ( text[i + 1] - 0xDC00 );
+				++i;
+			}
+			else if( c >= 0xD800 && c <= 0xDFFF )
+			{
+				c = 0xFFFD; // (three bytes, one UTF-16 unit; the offsets stay in sync)
+			}
+
+			if( c < 0x80 )
+			{
+				out->push_back( static_cast<char>( c ) );
+			}
+			else if( c < 0x800 )
+			{
+				out->push_back( static_cast<char>( 0xC0 | ( c >> 6 ) ) );
+				out->push_back( static_cast<char>( 0x80 | ( c & 0x3F ) ) );
+			}
+			else if( c < 0x10000 )
+			{
+				out->push_back( static_cast<char>( 0xE0 | ( c >> 12 ) ) );
+				out->push_back( static_cast<char>( 0x80 | ( ( c >> 6 ) & 0x3F ) ) );
+				out->push_back( static_cast<char>( 0x80 | ( c & 0x3F ) ) );
+			}
+			else
+			{
+				out->push_back( static_cast<char>( 0xF0 | ( c >> 18 ) ) );
+				out->push_back( static_cast<char>( 0x80 | ( ( c >> 12 ) & 0x3F ) ) );
+				out->push_back( static_cast<char>( 0x80 | ( ( c >> 6 ) & 0x3F ) ) );
+				out->push_back( static_cast<char>( 0x80 | ( c & 0x3F ) ) );
+			}
+		}
+	}
+
+
+	void AppendUtf16( std::u16string* out, const char* text, size_t size )
+	{
+		const unsigned char* p = reinterpret_cast<const unsigned char*>( text );
+		const unsigned char* end = p + size;
+
+		out->reserve( out->size( ) + size );
+
+		while( p < end )
+		{
+			unsigned char b = *p++;
+
+			if( b < 0x80 )
+			{
+				out->push_back( b );
+
+				continue;
+			}
+
+			// (0xF8 and above, and the stray continuation bytes, are invalid)
+			int continuation = b >= 0xF8 ? -1 : b >= 0xF0 ? 3 : b >= 0xE0 ? 2 : b >= 0xC0 ? 1 : -1;
+
+			if( continuation < 0 )
+			{
+				out->push_back( u'\uFFFD' );
+
+				continue;
+			}
+
+			static const char32_t minimum[] = { 0, 0x80, 0x800, 0x10000 };
+			char32_t const lowest = minimum[continuation];
+			char32_t c = b & ( 0x3F >> continuation );
+
+			for( ; continuation > 0 && p < end && ( *p & 0xC0 ) == 0x80; --continuation, ++p ) c = ( c << 6 ) | ( *p & 0x3F );
+
+			if( continuation > 0 || c < lowest || c > 0x10FFFF || ( c >= 0xD800 && c <= 0xDFFF ) )
+			{
+				out->push_back( u'\uFFFD' );
+			}
+			else if( c >= 0x10000 )
+			{
+				out->push_back( static_cast<char16_t>( 0xD800 + ( ( c - 0x10000 ) >> 10 ) ) );
+				out->push_back( static_cast<char16_t>( 0xDC00 + ( ( c - 0x10000 ) & 0x3FF ) ) );
+			}
+			else
+			{
+				out->push_back( static_cast<char16_t>( c ) );
+			}
+		}
+	}
+
+
+	Utf8OffsetTranslator::Utf8OffsetTranslator( const char* data, size_t size )
+		:
+		mData( reinterpret_cast<const unsigned char*>( data ) ),
+		mSize( size ),
+		mCursorByte( 0 ),
+		mCursorUnit( 0 )
+	{
+		mBlockStarts.push_back( 0 );
+	}
+
+
+	size_t Utf8OffsetTranslator::CountUnits( const unsigned char* begin, const unsigned char* end )
+	{
+		size_t n = 0;
+
+		for( const unsigned char* p = begin; p < end; ++p )
+		{
+			unsigned char b = *p;
+
+			n += ( b & 0xC0 ) != 0x80; // (not a continuation byte)
+			n += b >= 0xF0; // (surrogate pair)
+		}
+
+		return n;
+	}
+
+
+	size_t Utf8OffsetTranslator::ToUtf16( size_t byteOffset )
+	{
+		if( byteOffset > mSize ) byteOffset = mSize;
+
+		size_t block = byteOffset / BlockSize;
+
+		// extend the table of blocks
+
+		while( mBlockStarts.size( ) <= block )
+		{
+			size_t b = mBlockStarts.size( ) - 1;
+
+			mBlockStarts.push_back( mBlockStarts[b] + CountUnits( mData + b * BlockSize, mData + ( b + 1 ) * BlockSize ) );
+		}
+
+		// continue from the cursor if it is in the same block and before the offset; otherwise from the block start
+
+		if( mCursorByte > byteOffset || mCursorByte < block * BlockSize )
+		{
+			mCursorByte = block * BlockSize;
+			mCursorUnit = mBlockStarts[block];
+		}
+
+		mCursorUnit += CountUnits( mData + mCursorByte, mData + byteOffset );
+		mCursorByte = byteOffset;
+
+		return mCursorUnit;
+	}
+
+}
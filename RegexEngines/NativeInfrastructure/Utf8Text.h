@@ -0,0 +1,48 @@
+#pragma once
+
+// Helpers for searching UTF-8 text and reporting the positions in UTF-16 units,
+// which are used by the .NET strings.
+//
+// (Do not include this file in managed code).
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace NativeInfrastructure
+{
+
+	// Appends the UTF-8 form of UTF-16 text; unpaired surrogates become U+FFFD.
+	void AppendUtf8( std::string* out, const char16_t* text, size_t length );
+
+	// Appends the UTF-16 form of UTF-8 text; invalid sequences become U+FFFD.
+	void AppendUtf16( std::u16string* out, const char* text, size_t size );
+
+
+	// Translates byte offsets in UTF-8 text to UTF-16 offsets without decoding the text.
+	// Every lead byte adds one UTF-16 unit (two for four-byte sequences); continuation
+	// bytes add nothing, therefore the text is expected to be valid UTF-8.
+	class Utf8OffsetTranslator final
+	{
+	public:
+
+		Utf8OffsetTranslator( const char* data, size_t size );
+
+		// The offsets can be given in any order; increasing offsets are the fastest.
+		size_t ToUtf16( size_t byteOffset );
+
+	private:
+
+		static const size_t BlockSize = 4096;
+
+		const unsigned char* mData;
+		size_t mSize;
+		std::vector<size_t> mBlockStarts; // (UTF-16 offset of each block that was passed)
+		size_t mCursorByte;
+		size_t mCursorUnit;
+
+		static size_t CountUnits( const unsigned char* begin, const unsigned char* end );
+	};
+
+}
@@ -56,6 +56,52 @@ namespace OnigurumaRegexEngineNs
 				cbxSyntax.SelectedItem = cbxSyntax.Items.OfType<ComboBoxItem>( ).FirstOrDefault( );
 			}
 
+			// insert RegSet modes
+
+			{
+				cbxRegSet.Items.Add( new ComboBoxItem
+				{
+					Tag = null,
+					Content = new TextAndNote { Text = "(none)", Note = "single pattern" }
+				} );
+
+				List<OnigurumaRegexInterop.OptionInfo> regset_options = OnigurumaRegexInterop.Matcher.GetRegSetOptions( );
+
+				foreach( var o in regset_options )
+				{
+					var cbi = new ComboBoxItem
+					{
+						Tag = o.FlagName,
+						Content = new TextAndNote { Text = o.FlagName, Note = o.Note }
+					};
+
+					cbxRegSet.Items.Add( cbi );
+				}
+
+				// select first (default)
+				cbxRegSet.SelectedItem = cbxRegSet.Items.OfType<ComboBoxItem>( ).FirstOrDefault( );
+			}
+
+			// insert encodings
+
+			{
+				List<OnigurumaRegexInterop.OptionInfo> encoding_options = OnigurumaRegexInterop.Matcher.GetEncodingOptions( );
+
+				foreach( var o in encoding_options )
+				{
+					var cbi = new ComboBoxItem
+					{
+						Tag = o.FlagName,
+						Content = new TextAndNote { Text = o.FlagName, Note = o.Note }
+					};
+
+					cbxEncoding.Items.Add( cbi );
+				}
+
+				// select first (default)
+				cbxEncoding.SelectedItem = cbxEncoding.Items.OfType<ComboBoxItem>( ).FirstOrDefault( );
+			}
+
 			// insert checkboxes
 
 			{
@@ -126,6 +172,15 @@ namespace OnigurumaRegexEngineNs
 				syntax = cbxSyntax.Items.OfType<ComboBoxItem>( ).FirstOrDefault( )?.Tag?.ToString( );
 			}
 
+			var regset = ( cbxRegSet.SelectedItem as ComboBoxItem )?.Tag?.ToString( ); // (null -- single pattern)
+
+			var encoding = ( cbxEncoding.SelectedItem as ComboBoxItem )?.Tag?.ToString( );
+			if( encoding == null )
+			{
+				// get first (default)
+				encoding = cbxEncoding.Items.OfType<ComboBoxItem>( ).FirstOrDefault( )?.Tag?.ToString( );
+			}
+
 			var compile_options =
 				pnlCompileOptions.Children.OfType<CheckBox>( )
 					.Where( cb => cb.IsChecked == true )
@@ -141,8 +196,15 @@ namespace OnigurumaRegexEngineNs
 					.Where( cb => cb.IsChecked == true )
 					.Select( cb => cb.Tag.ToString( ) );
 
+			var limits = new[]
+			{
+				OnigurumaRegexInterop.Matcher.OptionPrefix_RETRY_LIMIT_IN_MATCH + tbRetryLimitInMatch.Text.Trim( ),
+				OnigurumaRegexInterop.Matcher.OptionPrefix_RETRY_LIMIT_IN_SEARCH + tbRetryLimitInSearch.Text.Trim( ),
+				OnigurumaRegexInterop.Matcher.OptionPrefix_MATCH_STACK_LIMIT + tbMatchStackLimit.Text.Trim( ),
+			};
+
 			return
-				new[] { syntax }.Concat( compile_options ).Concat( search_options ).Concat( configuration_options ).ToArray( );
+				new[] { syntax, encoding }.Concat( regset == null ? Enumerable.Empty<string>( ) : new[] { regset } ).Concat( compile_options ).Concat( search_options ).Concat( configuration_options ).Concat( limits ).ToArray( );
 		}
 
 
@@ -162,6 +224,22 @@ namespace OnigurumaRegexEngineNs
 				}
 				cbxSyntax.SelectedItem = syntax_item;
 
+				var regset_item = cbxRegSet.Items.OfType<ComboBoxItem>( ).FirstOrDefault( i => i.Tag != null && options.Contains( i.Tag.ToString( ) ) );
+				if( regset_item == null )
+				{
+					// get first (default)
+					regset_item = cbxRegSet.Items.OfType<ComboBoxItem>( ).FirstOrDefault( );
+				}
+				cbxRegSet.SelectedItem = regset_item;
+
+				var encoding_item = cbxEncoding.Items.OfType<ComboBoxItem>( ).FirstOrDefault( i => options.Contains( i.Tag.ToString( ) ) );
+				if( encoding_item == null )
+				{
+					// get first (default)
+					encoding_item = cbxEncoding.Items.OfType<ComboBoxItem>( ).FirstOrDefault( );
+				}
+				cbxEncoding.SelectedItem = encoding_item;
+
 				foreach( var cb in pnlCompileOptions.Children.OfType<CheckBox>( ) )
 				{
 					cb.IsChecked = options.Contains( cb.Tag.ToString( ) );
@@ -176,6 +254,10 @@ namespace OnigurumaRegexEngineNs
 				{
 					cb.IsChecked = options.Contains( cb.Tag.ToString( ) );
 				}
+
+				tbRetryLimitInMatch.Text = GetLimitOption( options, OnigurumaRegexInterop.Matcher.OptionPrefix_RETRY_LIMIT_IN_MATCH );
+				tbRetryLimitInSearch.Text = GetLimitOption( options, OnigurumaRegexInterop.Matcher.OptionPrefix_RETRY_LIMIT_IN_SEARCH );
+				tbMatchStackLimit.Text = GetLimitOption( options, OnigurumaRegexInterop.Matcher.OptionPrefix_MATCH_STACK_LIMIT );
 			}
 			finally
 			{
@@ -184,6 +266,14 @@ namespace OnigurumaRegexEngineNs
 		}
 
 
+		static string GetLimitOption( string[] options, string prefix )
+		{
+			var o = options.FirstOrDefault( s => s.StartsWith( prefix ) );
+
+			return o == null ? "" : o.Substring( prefix.Length ); // (empty -- default)
+		}
+
+
 		internal OnigurumaRegexInterop.OnigurumaHelper CreateOnigurumaHelper( )
 		{
 			return OnigurumaRegexInterop.Matcher.CreateOnigurumaHelper( CachedOptions );
@@ -225,6 +315,17 @@ namespace OnigurumaRegexEngineNs
 		}
 
 
+		private void tbLimit_TextChanged( object sender, TextChangedEventArgs e )
+		{
+			if( !IsFullyLoaded ) return;
+			if( ChangeCounter != 0 ) return;
+
+			CachedOptions = GetSelectedOptions( );
+
+			Changed?.Invoke( null, new RegexEngineOptionsChangedArgs { PreferImmediateReaction = false } );
+		}
+
+
 		private void cbxSyntax_SelectionChanged( object sender, SelectionChangedEventArgs e )
 		{
 			if( !IsFullyLoaded ) return;
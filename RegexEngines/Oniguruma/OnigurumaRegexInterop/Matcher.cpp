@@ -1,11 +1,17 @@
 #include "pch.h"
 
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/RegexCoreMatches.h"
+#include "NativeMatcher.h"
+#include "OnigurumaCore.h"
 #include "Matcher.h"
 #include "OnigurumaHelper.h"
 
 
 using namespace System::Diagnostics;
+using namespace System::Globalization;
 using namespace System::Runtime::InteropServices;
+using namespace System::Text;
 using namespace msclr::interop;
 
 
@@ -13,15 +19,27 @@ namespace OnigurumaRegexInterop
 {
 
 	static String^ FormatError( int code, const OnigErrorInfo* optionalEinfo );
+	static String^ FormatError( int code, const std::string& message );
+	static unsigned long ParseLimitOption( cli::array<String^>^ options, String^ prefix, unsigned long defaultValue );
+
+
+	unsigned long Matcher::Default_RETRY_LIMIT_IN_MATCH::get( ) { return onig_get_retry_limit_in_match( ); }
+	unsigned long Matcher::Default_RETRY_LIMIT_IN_SEARCH::get( ) { return onig_get_retry_limit_in_search( ); }
+	unsigned long Matcher::Default_MATCH_STACK_LIMIT::get( ) { return onig_get_match_stack_limit_size( ); }
 
 
 	static Matcher::Matcher( )
 	{
+		ConstOptionPrefix_RETRY_LIMIT_IN_MATCH = "retry_limit_in_match:";
+		ConstOptionPrefix_RETRY_LIMIT_IN_SEARCH = "retry_limit_in_search:";
+		ConstOptionPrefix_MATCH_STACK_LIMIT = "match_stack_limit:";
+
 		mTagToOption = gcnew Dictionary<String^, IntPtr>;
 		BuildOptions( );
 
-		OnigEncoding use_encs[1];
+		OnigEncoding use_encs[2];
 		use_encs[0] = ONIG_ENCODING_UTF16_LE;
+		use_encs[1] = ONIG_ENCODING_UTF8;
 
 		int r = onig_initialize( use_encs, sizeof( use_encs ) / sizeof( use_encs[0] ) );
 
@@ -39,9 +57,10 @@ namespace OnigurumaRegexInterop
 		:mData( nullptr )
 	{
 		regex_t* reg;
-		OnigErrorInfo einfo;
 		int r;
 
+		NativeInfrastructure::TraceSpan options_span( "oniguruma", "options" );
+
 		msclr::auto_handle< OnigurumaHelper> helper( CreateOnigurumaHelper( options ) );
 
 		auto search_options = ONIG_OPTION_NONE;
@@ -63,26 +82,93 @@ namespace OnigurumaRegexInterop
 			}
 		}
 
+		NativeScanLimits limits{};
+		limits.RetryLimitInMatch = ParseLimitOption( options, ConstOptionPrefix_RETRY_LIMIT_IN_MATCH, Default_RETRY_LIMIT_IN_MATCH );
+		limits.RetryLimitInSearch = ParseLimitOption( options, ConstOptionPrefix_RETRY_LIMIT_IN_SEARCH, Default_RETRY_LIMIT_IN_SEARCH );
+		limits.MatchStackLimit = ParseLimitOption( options, ConstOptionPrefix_MATCH_STACK_LIMIT, Default_MATCH_STACK_LIMIT );
+
+		OnigEncoding encoding = ONIG_ENCODING_UTF16_LE;
+
+		for each( auto o in mEncodingOptions )
+		{
+			if( Array::IndexOf( options, o->FlagName ) >= 0 )
+			{
+				IntPtr p;
+
+				if( mTagToOption->TryGetValue( o->FlagName, p ) )
+				{
+					encoding = static_cast<OnigEncoding>( p.ToPointer( ) );
+				}
+				else
+				{
+					Debug::Assert( false );
+				}
+
+				break;
+			}
+		}
+
+		for each( auto o in mRegSetOptions )
+		{
+			if( Array::IndexOf( options, o->FlagName ) >= 0 )
+			{
+				IntPtr p;
+
+				if( mTagToOption->TryGetValue( o->FlagName, p ) )
+				{
+					mData = new MatcherData{};
+					mData->mEncoding = encoding;
+					mData->mRegSetLead = static_cast<OnigRegSetLead>( p.ToInt32( ) );
+					mData->mSearchOptions = search_options;
+					mData->mLimits = limits;
+
+					options_span.End( );
+
+					CreateRegSet( pattern, helper.get( ) );
+
+					return;
+				}
+				else
+				{
+					Debug::Assert( false );
+				}
+			}
+		}
+
+		options_span.End( );
+
 		pin_ptr<const wchar_t> pinned_pattern = PtrToStringChars( pattern );
-		const wchar_t* native_pattern = pinned_pattern;
+		const char16_t* native_pattern = reinterpret_cast<const char16_t*>( pinned_pattern );
+
+		std::string error_message;
+		std::shared_ptr<regex_t> regex;
 
-		r = onig_new(
-			&reg,
-			(UChar*)native_pattern,
-			(UChar*)( native_pattern + pattern->Length ),
+		r = NativeCompileCached(
+			&regex,
+			native_pattern,
+			pattern->Length,
 			helper->GetCompileOptions( ),
-			ONIG_ENCODING_UTF16_LE,
+			encoding,
 			helper->GetSyntax( ),
-			&einfo );
+			&error_message );
 
 		if( r )
 		{
-			throw gcnew Exception( FormatError( r, &einfo ) );
+			throw gcnew Exception( FormatError( r, error_message ) );
 		}
 
+		reg = regex.get( );
+
 		mData = new MatcherData{};
-		mData->mRegex = reg;
+		mData->mRegex = regex;
+		mData->mPrefilter = NativeCreateLiteralPrefilter( reg, native_pattern, pattern->Length, helper->GetSyntax( ) );
+		mData->mEncoding = encoding;
 		mData->mSearchOptions = search_options;
+		mData->mLimits = limits;
+		mData->mNumberOfCaptureHistories = onig_number_of_capture_histories( reg );
+
+		mData->mNames.resize( 1 );
+		OnigurumaCoreResolveNames( reg, &mData->mNames[0] );
 	}
 
 
@@ -99,6 +185,85 @@ namespace OnigurumaRegexInterop
 	}
 
 
+	void Matcher::CreateRegSet( String^ pattern, OnigurumaHelper^ helper )
+	{
+		// one pattern per line; empty lines are ignored
+
+		cli::array<String^>^ lines = pattern->Split( gcnew cli::array<String^>{ "\r\n", "\n", "\r" }, StringSplitOptions::None );
+		List<int>^ line_numbers = gcnew List<int>;
+
+		for( int i = 0; i < lines->Length; ++i )
+		{
+			if( lines[i]->Length == 0 ) continue;
+
+			pin_ptr<const wchar_t> pinned_line = PtrToStringChars( lines[i] );
+			const char16_t* native_line = reinterpret_cast<const char16_t*>( pinned_line );
+
+			mData->mRegSetPatterns.emplace_back( native_line, lines[i]->Length );
+			line_numbers->Add( i + 1 );
+		}
+
+		onig_copy_syntax( &mData->mSyntax, helper->GetSyntax( ) );
+		mData->mCompileOptions = helper->GetCompileOptions( );
+
+		int failed_pattern;
+		std::string error_message;
+
+		int r = NativeCreateRegSet( &mData->mRegSet, mData->mRegSetPatterns, mData->mCompileOptions, mData->mEncoding, &mData->mSyntax, &failed_pattern, &error_message );
+
+		if( r != ONIG_NORMAL )
+		{
+			if( failed_pattern >= 0 )
+			{
+				throw gcnew Exception( String::Format( CultureInfo::InvariantCulture, "Pattern on line {0}: {1}", line_numbers[failed_pattern], FormatError( r, error_message ) ) );
+			}
+
+			if( ( mData->mCompileOptions & ONIG_OPTION_FIND_LONGEST ) != 0 )
+			{
+				throw gcnew Exception( "The option ONIG_OPTION_FIND_LONGEST cannot be used with RegSet." );
+			}
+
+			throw gcnew Exception( FormatError( r, nullptr ) );
+		}
+
+		int number_of_patterns = onig_regset_number_of_regex( mData->mRegSet.get( ) );
+
+		mData->mNames.resize( number_of_patterns );
+
+		for( int i = 0; i < number_of_patterns; ++i )
+		{
+			regex_t* reg = onig_regset_get_regex( mData->mRegSet.get( ), i );
+			OnigurumaCoreNames& names = mData->mNames[i];
+
+			OnigurumaCoreResolveNames( reg, &names );
+
+			std::string pattern_name = "pattern (line " + std::to_string( line_numbers[i] ) + ")";
+
+			names.PatternName = static_cast<int32_t>( names.Names.size( ) );
+			names.Names.emplace_back( pattern_name.begin( ), pattern_name.end( ) );
+			mData->mNumberOfCaptureHistories = Math::Max( mData->mNumberOfCaptureHistories, onig_number_of_capture_histories( reg ) );
+		}
+	}
+
+
+	void Matcher::RebuildRegSet( )
+	{
+		std::shared_ptr<OnigRegSet> set;
+		int failed_pattern;
+		std::string error_message;
+
+		int r = NativeCreateRegSet( &set, mData->mRegSetPatterns, mData->mCompileOptions, mData->mEncoding, &mData->mSyntax, &failed_pattern, &error_message );
+
+		if( r != ONIG_NORMAL )
+		{
+			// (not expected, since the same patterns were compiled before)
+			throw gcnew Exception( FormatError( r, nullptr ) );
+		}
+
+		mData->mRegSet = set;
+	}
+
+
 	OnigurumaHelper^ Matcher::CreateOnigurumaHelper( cli::array<String^>^ options )
 	{
 		String^ selected_syntax_name = L"ONIG_SYNTAX_ONIGURUMA";
@@ -175,227 +340,225 @@ namespace OnigurumaRegexInterop
 	}
 
 
-	String^ Matcher::GetVersion( )
+	static unsigned long ParseLimitOption( cli::array<String^>^ options, String^ prefix, unsigned long defaultValue )
 	{
-		return gcnew String( onig_version( ) );
-	}
+		for each( String ^ o in options )
+		{
+			if( !o->StartsWith( prefix ) ) continue;
 
+			String^ s = o->Substring( prefix->Length );
+			if( String::IsNullOrWhiteSpace( s ) ) return defaultValue;
 
-	private value struct ForEachNameData
-	{
-		List<String^>^ names;
-	};
+			UInt32 v;
+			if( !UInt32::TryParse( s,
+				NumberStyles::AllowLeadingWhite | NumberStyles::AllowTrailingWhite | NumberStyles::AllowThousands,
+				CultureInfo::InvariantCulture,
+				v ) )
+			{
+				throw gcnew Exception( String::Format( CultureInfo::InvariantCulture, "Invalid option: {0}. Please enter a non-negative integer number, or set to 0 to disable the limit. The default value is {1:#,##0}.",
+					prefix->TrimEnd( ':' ), defaultValue ) );
+			}
 
+			return v;
+		}
+
+		return defaultValue;
+	}
 
-	static int ForEachNameCallback( const OnigUChar* name, const OnigUChar* nameEnd,
-		int numberOfGroups, int* groupNumberList, OnigRegex regex, void* lparam )
-	{
-		ForEachNameData* data = (ForEachNameData*)lparam;
 
-		String^ group_name = gcnew String( (wchar_t*)name, 0, CheckedCast::ToInt32( ( (wchar_t*)nameEnd ) - ( (wchar_t*)name ) ) );
+	String^ Matcher::GetVersion( )
+	{
+		return gcnew String( onig_version( ) );
+	}
 
-		int* nums;
-		int r = onig_name_to_group_numbers( regex, name, nameEnd, &nums );
 
-		for( int i = 0; i < r; ++i )
+	RegexMatches^ Matcher::Matches( String^ text, ICancellable^ cnc )
+	{
+		try
 		{
-			int group_number = nums[i];
+			OriginalText = text;
+			mData->mFile.reset( );
 
-			while( data->names->Count <= group_number ) data->names->Add( nullptr );
+			pin_ptr<const wchar_t> pinned_text = PtrToStringChars( text );
+			const char16_t* native_text = reinterpret_cast<const char16_t*>( pinned_text );
 
-			data->names[group_number] = group_name;
-		}
+			// the capture history is only available for the groups enabled by 'ONIG_SYN_OP2_ATMARK_CAPTURE_HISTORY'
 
-		return 0;
-	}
+			bool has_capture_history = mData->mNumberOfCaptureHistories > 0;
 
+			NativeScanTask* task;
 
-	private value struct TraverseTreeData
-	{
-		int groupNumber;
-		SimpleGroup^ group;
-	};
+			if( mData->mRegSet )
+			{
+				// the set keeps the regions of the last search, therefore it cannot be used while an abandoned search is running
 
+				if( mData->mRegSet.use_count( ) > 1 ) RebuildRegSet( );
 
-	static int TraverseTreeCallback( int group, int beg, int end, int level, int at, void* arg )
-	{
-		TraverseTreeData* data = (TraverseTreeData*)arg;
+				task = NativeStartRegSetScan( mData->mRegSet, mData->mRegSetLead, native_text, text->Length, mData->mSearchOptions, has_capture_history, mData->mLimits );
+			}
+			else
+			{
+				task = NativeStartScan( mData->mRegex, mData->mPrefilter, native_text, text->Length, mData->mSearchOptions, has_capture_history, mData->mLimits );
+			}
 
-		if( group == 0 )
+			return CollectMatches( task, cnc );
+		}
+		//catch( const std::exception & exc )
+		//{
+		//	String^ what = gcnew String( exc.what( ) );
+		//	throw gcnew Exception( what );
+		//}
+		catch( Exception^ exc )
 		{
-			// skip, not needed
+			UNREFERENCED_PARAMETER( exc );
+			throw;
 		}
-		else
+		catch( ... )
 		{
-			if( group == data->groupNumber )
-			{
-				Debug::Assert( ( beg % 2 ) == 0 ); // event positions expected
-				Debug::Assert( ( end % 2 ) == 0 );
-
-				data->group->AddCapture( beg / 2, ( end - beg ) / 2 );
-			}
+			throw gcnew Exception( "Unknown error.\r\n" __FILE__ );
 		}
-
-		return 0;
 	}
 
 
-	RegexMatches^ Matcher::Matches( String^ text, ICancellable^ cnc )
+	RegexMatches^ Matcher::MatchesInFile( String^ path, ICancellable^ cnc )
 	{
 		try
 		{
-			OriginalText = text;
-
-
-			// extract group names
-
-			List<String^>^ group_names = gcnew List<String^>( );
+			if( mData->mEncoding != ONIG_ENCODING_UTF8 )
 			{
-				ForEachNameData data{};
-				data.names = group_names;
-
-				onig_foreach_name( mData->mRegex, &ForEachNameCallback, &data );
+				throw gcnew Exception( "Files can be searched with the \x91ONIG_ENCODING_UTF8\x92 option only." );
 			}
 
+			OriginalText = nullptr; // (decoded on demand; see 'GetText')
+			mData->mFile.reset( );
 
-			pin_ptr<const wchar_t> pinned_text = PtrToStringChars( text );
-			const wchar_t* native_text = pinned_text;
+			cli::array<Byte>^ utf8_path = Encoding::UTF8->GetBytes( path + L'\0' );
+			pin_ptr<Byte> pinned_path = &utf8_path[0];
 
-			auto matches = gcnew List<IMatch^>;
+			std::string native_error;
 
-			OnigMatchParam* match_params = onig_new_match_param( );
-			OnigRegion* region = onig_region_new( );
+			mData->mFile = NativeOpenUtf8File( (const char*)pinned_path, &native_error );
 
-			try
+			if( !mData->mFile )
 			{
-				// currently default parameters are used
-				onig_initialize_match_param( match_params );
-
-				//onig_set_match_stack_limit_size_of_match_param ( OnigMatchParam * param, unsigned int limit );
-				//onig_set_retry_limit_in_match_of_match_param ( OnigMatchParam * param, unsigned long limit );
-				//onig_set_subexp_call_max_nest_level(  ); 
+				throw gcnew Exception( String::Format( "Cannot open \x91{0}\x92: {1}", path, gcnew String( native_error.c_str( ) ) ) );
+			}
 
-				int r;
-				const wchar_t* start = native_text;
-				const wchar_t* previous_start = start;
+			bool has_capture_history = mData->mNumberOfCaptureHistories > 0;
 
-				for( ;;)
-				{
-					r = onig_search_with_param(
-						mData->mRegex,
-						(UChar*)native_text, (UChar*)( native_text + text->Length ),
-						(UChar*)start, (UChar*)( native_text + text->Length ),
-						region,
-						mData->mSearchOptions,
-						match_params );
+			if( mData->mRegSet && mData->mRegSet.use_count( ) > 1 ) RebuildRegSet( );
 
-					if( r == ONIG_MISMATCH ) break;
+			NativeScanTask* task = NativeStartFileScan( mData->mRegex, mData->mRegSet, mData->mRegSetLead, mData->mFile,
+				mData->mSearchOptions, has_capture_history, mData->mLimits );
 
-					if( r < 0 )
-					{
-						throw gcnew Exception( FormatError( r, nullptr ) );
-					}
+			return CollectMatches( task, cnc );
+		}
+		catch( Exception^ exc )
+		{
+			UNREFERENCED_PARAMETER( exc );
+			throw;
+		}
+		catch( ... )
+		{
+			throw gcnew Exception( "Unknown error.\r\n" __FILE__ );
+		}
+	}
 
 
-					SimpleMatch^ match0 = nullptr;
+	RegexMatches^ Matcher::CollectMatches( NativeScanTask* task, ICancellable^ cnc )
+	{
+		while( !NativeWaitScan( task, 33 ) )
+		{
+			if( cnc->IsCancellationRequested )
+			{
+				NativeCancelScan( task );
 
-					for( int i = 0; i < region->num_regs; ++i )
-					{
-						int group_number = i;
-						String^ group_name = nullptr;
-						if( group_number < group_names->Count ) group_name = group_names[group_number];
-						if( group_name == nullptr ) group_name = group_number.ToString( System::Globalization::CultureInfo::InvariantCulture );
-
-						if( region->beg[i] < 0 )
-						{
-							// failed group
-
-							if( i == 0 )
-							{
-								Debug::Assert( false );
-							}
-							else
-							{
-								match0->AddGroup( 0, 0, false, group_name );
-							}
-						}
-						else
-						{
-							// succeeded group
-
-							Debug::Assert( ( region->beg[i] % sizeof( wchar_t ) ) == 0 ); // even positions expected
-							Debug::Assert( ( region->end[i] % sizeof( wchar_t ) ) == 0 );
-
-							int begin = region->beg[i] / sizeof( wchar_t );
-							int end = region->end[i] / sizeof( wchar_t );
-
-							if( i == 0 )
-							{
-								match0 = SimpleMatch::Create( begin, end - begin, this );
-								matches->Add( match0 );
-							}
-
-							SimpleGroup^ group = match0->AddGroup( begin, end - begin, true, group_name );
-
-							// captures
-
-							int number_of_captures = onig_number_of_captures( mData->mRegex );
-							int number_of_capture_histories = onig_number_of_capture_histories( mData->mRegex );
-							OnigCaptureTreeNode* capture_tree = onig_get_capture_tree( region );
-
-							{
-								TraverseTreeData data{};
-								data.groupNumber = group_number;
-								data.group = group;
-
-								onig_capture_tree_traverse( region, ONIG_TRAVERSE_CALLBACK_AT_FIRST, &TraverseTreeCallback, &data );
-							}
-						}
-					}
+				return RegexMatches::Empty;
+			}
+		}
 
-					// TODO: check if it should be much more complicated -- see PCRE2
+		NativeScanResults native_results;
+		std::string native_error;
 
-					start = native_text + match0->Index + match0->Length;
+		int r = NativeFinishScan( task, &native_results, &native_error );
 
-					if( start == previous_start )
-					{
-						++start;
-					}
+		if( !native_error.empty( ) )
+		{
+			throw gcnew Exception( gcnew String( native_error.c_str( ) ) );
+		}
 
-					previous_start = start;
-				}
-			}
-			finally
-			{
-				onig_region_free( region, 1 );
-				onig_free_match_param( match_params );
-			}
+		if( r == ONIG_ABORT && cnc->IsCancellationRequested ) return RegexMatches::Empty;
 
-			return gcnew RegexMatches( matches->Count, matches );
+		if( r < 0 )
+		{
+			throw gcnew Exception( FormatScanError( r ) );
 		}
-		//catch( const std::exception & exc )
-		//{
-		//	String^ what = gcnew String( exc.what( ) );
-		//	throw gcnew Exception( what );
-		//}
-		catch( Exception^ exc )
+
+		RegexCoreResults results{};
+
+		OnigurumaCoreBuildResults( native_results, mData->mNames, &results );
+
+		try
 		{
-			UNREFERENCED_PARAMETER( exc );
-			throw;
+			return NativeInfrastructure::RegexCoreResultsToMatches( results, this, 0, "oniguruma" );
 		}
-		catch( ... )
+		finally
 		{
-			throw gcnew Exception( "Unknown error.\r\n" __FILE__ );
+			RegexCoreFreeResults( &results );
 		}
 	}
 
 
 	String^ Matcher::GetText( int index, int length )
 	{
+		if( OriginalText == nullptr && mData->mFile )
+		{
+			// decode the searched file once, when a value is needed
+
+			const char* text;
+			size_t size;
+
+			NativeGetUtf8FileText( mData->mFile.get( ), &text, &size );
+
+			OriginalText = gcnew String( (signed char*)text, 0, CheckedCast::ToInt32( size ), Encoding::UTF8 );
+		}
+
 		return OriginalText->Substring( index, length );
 	}
 
 
+	String^ Matcher::FormatScanError( int code )
+	{
+		// tell which of budgets is exhausted
+
+		String^ option_name = nullptr;
+		unsigned long value = 0;
+
+		switch( code )
+		{
+		case ONIGERR_RETRY_LIMIT_IN_MATCH_OVER:
+			option_name = ConstOptionPrefix_RETRY_LIMIT_IN_MATCH;
+			value = mData->mLimits.RetryLimitInMatch;
+			break;
+		case ONIGERR_RETRY_LIMIT_IN_SEARCH_OVER:
+			option_name = ConstOptionPrefix_RETRY_LIMIT_IN_SEARCH;
+			value = mData->mLimits.RetryLimitInSearch;
+			break;
+		case ONIGERR_MATCH_STACK_LIMIT_OVER:
+			option_name = ConstOptionPrefix_MATCH_STACK_LIMIT;
+			value = mData->mLimits.MatchStackLimit;
+			break;
+		}
+
+		String^ message = FormatError( code, nullptr );
+
+		if( option_name == nullptr ) return message;
+
+		return String::Format( CultureInfo::InvariantCulture, "{0}\r\n\r\nThe limit {1} ({2:#,##0}) was exceeded. It can be changed in options.",
+			message, option_name->TrimEnd( ':' ), value );
+	}
+
+
 	static const char* TryGetErrorSymbol0( int code )
 	{
 
@@ -494,12 +657,8 @@ namespace OnigurumaRegexInterop
 	}
 
 
-	static String^ FormatError( int code, const OnigErrorInfo* optionalEinfo )
+	static String^ FormatErrorText( int code, String^ text )
 	{
-		char s[ONIG_MAX_ERROR_MESSAGE_LEN];
-		onig_error_code_to_str( (UChar*)s, code, optionalEinfo );
-		String^ text = gcnew String( s );
-
 		String^ symbol = TryGetErrorSymbol( code );
 
 		if( symbol != nullptr )
@@ -513,65 +672,19 @@ namespace OnigurumaRegexInterop
 	}
 
 
-
-	IMatch^ Matcher::CreateMatch( OnigRegion* region, List<String^>^ groupNames )
+	static String^ FormatError( int code, const OnigErrorInfo* optionalEinfo )
 	{
-		SimpleMatch^ match = nullptr;
-
-		for( int i = 0; i < region->num_regs; ++i )
-		{
-			int group_number = i;
-			String^ group_name = nullptr;
-			if( group_number < groupNames->Count ) group_name = groupNames[group_number];
-			if( group_name == nullptr ) group_name = group_number.ToString( System::Globalization::CultureInfo::InvariantCulture );
-
-			if( region->beg[i] < 0 )
-			{
-				// failed group
-
-				if( i == 0 )
-				{
-					Debug::Assert( false );
-				}
-				else
-				{
-					match->AddGroup( 0, 0, false, group_name );
-				}
-			}
-			else
-			{
-				// succeeded group
-
-				Debug::Assert( ( region->beg[i] % sizeof( wchar_t ) ) == 0 ); // even positions expected
-				Debug::Assert( ( region->end[i] % sizeof( wchar_t ) ) == 0 );
-
-				int begin = region->beg[i] / sizeof( wchar_t );
-				int end = region->end[i] / sizeof( wchar_t );
-
-				if( i == 0 )
-				{
-					match = SimpleMatch::Create( begin, end - begin, this );
-				}
-
-				SimpleGroup^ group = match->AddGroup( begin, end - begin, true, group_name );
-
-				// captures
-
-				int number_of_captures = onig_number_of_captures( mData->mRegex );
-				int number_of_capture_histories = onig_number_of_capture_histories( mData->mRegex );
-				OnigCaptureTreeNode* capture_tree = onig_get_capture_tree( region );
+		char s[ONIG_MAX_ERROR_MESSAGE_LEN];
+		onig_error_code_to_str( (UChar*)s, code, optionalEinfo );
 
-				{
-					TraverseTreeData data{};
-					data.groupNumber = group_number;
-					data.group = group;
+		return FormatErrorText( code, gcnew String( s ) );
+	}
 
-					onig_capture_tree_traverse( region, ONIG_TRAVERSE_CALLBACK_AT_FIRST, &TraverseTreeCallback, &data );
-				}
-			}
-		}
 
-		return match;
+	static String^ FormatError( int code, const std::string& message )
+	{
+		// (the message can include the names from UTF-8 patterns)
+		return FormatErrorText( code, gcnew String( (signed char*)message.c_str( ), 0, CheckedCast::ToInt32( message.length( ) ), Encoding::UTF8 ) );
 	}
 
 
@@ -661,6 +774,23 @@ namespace OnigurumaRegexInterop
 		mConfigurationOptions = list;
 
 
+		list = gcnew List<OptionInfo^>( );
+
+		C( ONIG_REGSET_POSITION_LEAD, "one pattern per line; leftmost match, searching by position" );
+		C( ONIG_REGSET_REGEX_LEAD, "one pattern per line; leftmost match, searching by pattern" );
+		C( ONIG_REGSET_PRIORITY_TO_REGEX_ORDER, "one pattern per line; first pattern that matches" );
+
+		mRegSetOptions = list;
+
+
+		list = gcnew List<OptionInfo^>( );
+
+		C( ONIG_ENCODING_UTF16_LE, "native .NET strings" );
+		C( ONIG_ENCODING_UTF8, "UTF-8; the text is converted, files are searched in place" );
+
+		mEncodingOptions = list;
+
+
 #undef C
 
 	}
@@ -30,22 +30,32 @@ namespace OnigurumaRegexInterop
 
 	struct MatcherData
 	{
-		regex_t* mRegex;
+		std::shared_ptr<regex_t> mRegex; // (shared with the abandoned searches)
+		std::shared_ptr<NativeLiteralPrefilter> mPrefilter; // (null if the pattern is not an alternation of literals)
+		OnigEncoding mEncoding; // (UTF-16LE or UTF-8)
+		std::shared_ptr<NativeUtf8File> mFile; // (the last file searched by 'MatchesInFile')
+		std::shared_ptr<OnigRegSet> mRegSet; // (RegSet mode; 'mRegex' is null)
+		OnigRegSetLead mRegSetLead;
+		std::vector<std::u16string> mRegSetPatterns; // (to rebuild the set while an abandoned search still uses it)
+		OnigSyntaxType mSyntax;
+		OnigOptionType mCompileOptions;
 		decltype( ONIG_OPTION_NONE ) mSearchOptions;
+		int mNumberOfCaptureHistories;
+		NativeScanLimits mLimits;
+		std::vector<OnigurumaCoreNames> mNames; // (resolved once; one item, or one for each pattern of RegSet)
 
 		MatcherData( )
 			:
-			mRegex( nullptr ),
-			mSearchOptions( ONIG_OPTION_NONE )
+			mEncoding( ONIG_ENCODING_UTF16_LE ),
+			mRegSetLead( ONIG_REGSET_POSITION_LEAD ),
+			mSyntax( ),
+			mCompileOptions( ONIG_OPTION_NONE ),
+			mSearchOptions( ONIG_OPTION_NONE ),
+			mNumberOfCaptureHistories( 0 ),
+			mLimits( )
 		{
 
 		}
-
-		~MatcherData( )
-		{
-			if( mRegex ) onig_free( mRegex );
-			mRegex = nullptr;
-		}
 	};
 
 
@@ -53,6 +63,14 @@ namespace OnigurumaRegexInterop
 	{
 	public:
 
+		static property String^ OptionPrefix_RETRY_LIMIT_IN_MATCH { String^ get( ) { return ConstOptionPrefix_RETRY_LIMIT_IN_MATCH; } }
+		static property String^ OptionPrefix_RETRY_LIMIT_IN_SEARCH { String^ get( ) { return ConstOptionPrefix_RETRY_LIMIT_IN_SEARCH; } }
+		static property String^ OptionPrefix_MATCH_STACK_LIMIT { String^ get( ) { return ConstOptionPrefix_MATCH_STACK_LIMIT; } }
+
+		static property unsigned long Default_RETRY_LIMIT_IN_MATCH { unsigned long get( ); }
+		static property unsigned long Default_RETRY_LIMIT_IN_SEARCH { unsigned long get( ); }
+		static property unsigned long Default_MATCH_STACK_LIMIT { unsigned long get( ); }
+
 		static Matcher( );
 
 		Matcher( String^ pattern, cli::array<String^>^ options );
@@ -65,6 +83,8 @@ namespace OnigurumaRegexInterop
 		static List<OptionInfo^>^ GetCompileOptions( ) { return mCompileOptions; }
 		static List<OptionInfo^>^ GetSearchOptions( ) { return mSearchOptions; }
 		static List<OptionInfo^>^ GetConfigurationOptions( ) { return mConfigurationOptions; }
+		static List<OptionInfo^>^ GetRegSetOptions( ) { return mRegSetOptions; }
+		static List<OptionInfo^>^ GetEncodingOptions( ) { return mEncodingOptions; }
 
 		static OnigurumaHelper^ CreateOnigurumaHelper( cli::array<String^>^ options );
 
@@ -74,6 +94,10 @@ namespace OnigurumaRegexInterop
 
 #pragma endregion
 
+		// Searches a UTF-8 file, which is mapped to memory and is not converted to UTF-16.
+		// Requires the 'ONIG_ENCODING_UTF8' option. The reported positions are in UTF-16 units.
+		RegexMatches^ MatchesInFile( String^ path, ICancellable^ cnc );
+
 #pragma region ISimpleTextReader
 
 		virtual String^ GetText( int index, int length );
@@ -89,9 +113,18 @@ namespace OnigurumaRegexInterop
 		static List<OptionInfo^>^ mCompileOptions;
 		static List<OptionInfo^>^ mSearchOptions;
 		static List<OptionInfo^>^ mConfigurationOptions;
+		static List<OptionInfo^>^ mRegSetOptions;
+		static List<OptionInfo^>^ mEncodingOptions;
 		static Dictionary<String^, IntPtr>^ mTagToOption;
+		static String^ ConstOptionPrefix_RETRY_LIMIT_IN_MATCH;
+		static String^ ConstOptionPrefix_RETRY_LIMIT_IN_SEARCH;
+		static String^ ConstOptionPrefix_MATCH_STACK_LIMIT;
+
+		void CreateRegSet( String^ pattern, OnigurumaHelper^ helper );
+		void RebuildRegSet( );
 
-		IMatch^ CreateMatch( OnigRegion* region, List<String^>^ groupNames );
+		RegexMatches^ CollectMatches( NativeScanTask* task, ICancellable^ cnc );
+		String^ FormatScanError( int code );
 		static void BuildOptions( );
 	};
 
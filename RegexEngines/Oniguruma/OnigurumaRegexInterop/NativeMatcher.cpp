@@ -0,0 +1,746 @@
+#include <atomic>
+#include <climits>
+#include <cstring>
+
+#include "Oniguruma-min/src/oniguruma.h"
+
+#include "../../NativeInfrastructure/CompiledPatternCache.h"
+#include "../../NativeInfrastructure/LiteralAlternation.h"
+#include "../../NativeInfrastructure/LiteralSearch.h"
+#include "../../NativeInfrastructure/StackGuard.h"
+#include "../../NativeInfrastructure/MappedFile.h"
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/Utf8Text.h"
+#include "NativeMatcher.h"
+
+
+namespace OnigurumaRegexInterop
+{
+
+	struct NativeUtf8File
+	{
+		NativeInfrastructure::MappedFile file;
+		const char* text; // (after BOM)
+		size_t size;
+	};
+
+
+	struct NativeLiteralPrefilter
+	{
+		std::unique_ptr<NativeInfrastructure::LiteralAlternationSearcher> searcher; // (without the word boundaries)
+	};
+
+
+	// (the search options that do not affect the words; the other options are not expected with the prefilter)
+	const OnigOptionType PrefilterSearchOptions = ONIG_OPTION_NOTBOL | ONIG_OPTION_NOTEOL | ONIG_OPTION_NOT_BEGIN_STRING |
+		ONIG_OPTION_NOT_END_STRING | ONIG_OPTION_NOT_BEGIN_POSITION;
+
+
+	struct NativeScanJob
+	{
+		std::shared_ptr<regex_t> regex;
+		std::shared_ptr<NativeLiteralPrefilter> prefilter; // (UTF-16 only; null if not used)
+		std::shared_ptr<OnigRegSet> regSet; // (if not null, 'regex' is not used)
+		OnigRegSetLead lead;
+
+		// the subject is one of these
+		std::u16string text;
+		std::string utf8Text; // (converted from UTF-16)
+		std::shared_ptr<NativeUtf8File> utf8File;
+		bool isUtf8;
+
+		const OnigUChar* begin;
+		const OnigUChar* end;
+		std::unique_ptr<NativeInfrastructure::Utf8OffsetTranslator> offsets; // (null for UTF-16)
+
+		OnigOptionType searchOptions;
+		bool collectCaptureHistory;
+		NativeScanLimits limits;
+
+		std::atomic_bool cancel;
+
+		NativeScanResults results;
+		int result;
+
+		NativeScanJob( )
+			:
+			lead( ONIG_REGSET_POSITION_LEAD ),
+			isUtf8( false ),
+			begin( nullptr ),
+			end( nullptr ),
+			searchOptions( ONIG_OPTION_NONE ),
+			collectCaptureHistory( false ),
+			limits( ),
+			cancel( false ),
+			results( ),
+			result( 0 )
+		{
+		}
+	};
+
+
+	struct NativeScanTask
+	{
+		std::shared_ptr<NativeScanJob> job;
+		NativeInfrastructure::GuardedThread thread;
+	};
+
+
+	// Converts the byte offset to UTF-16 units.
+	static int ToUtf16( NativeScanJob* job, int offset )
+	{
+		if( job->offsets ) return (int)job->offsets->ToUtf16( (size_t)offset );
+
+		return offset / 2; // (byte offsets are even in UTF-16)
+	}
+
+
+	static int NativeTraverseTreeCallback( int group, int beg, int end, int level, int at, void* arg )
+	{
+		(void)level;
+		(void)at;
+
+		NativeScanJob* job = (NativeScanJob*)arg;
+
+		if( group != 0 ) // (the whole match is not needed)
+		{
+			int index = ToUtf16( job, beg );
+
+			job->results.Captures.push_back( NativeCapture{ group, index, ToUtf16( job, end ) - index } );
+		}
+
+		return 0;
+	}
+
+
+	static void CollectMatch( NativeScanJob* job, OnigRegion* region, int numberOfGroups )
+	{
+		NativeScanResults* results = &job->results;
+
+		for( int i = 0; i < numberOfGroups; ++i )
+		{
+			if( i >= region->num_regs || region->beg[i] < 0 )
+			{
+				results->Groups.push_back( -1 );
+				results->Groups.push_back( 0 );
+			}
+			else
+			{
+				int index = ToUtf16( job, region->beg[i] );
+
+				results->Groups.push_back( index );
+				results->Groups.push_back( ToUtf16( job, region->end[i] ) - index );
+			}
+		}
+
+		if( job->collectCaptureHistory )
+		{
+			results->CaptureStarts.push_back( results->Captures.size( ) );
+
+			if( onig_get_capture_tree( region ) != nullptr )
+			{
+				onig_capture_tree_traverse( region, ONIG_TRAVERSE_CALLBACK_AT_FIRST, &NativeTraverseTreeCallback, job );
+			}
+		}
+	}
+
+
+	static int ProgressCallout( OnigCalloutArgs* args, void* userData )
+	{
+		(void)args;
+
+		const std::atomic_bool* cancel = (const std::atomic_bool*)userData;
+
+		return cancel->load( std::memory_order_relaxed ) ? ONIG_ABORT : ONIG_CALLOUT_SUCCESS;
+	}
+
+
+	static OnigMatchParam* NewMatchParam( NativeScanJob* job )
+	{
+		OnigMatchParam* mp = onig_new_match_param( );
+		if( mp == nullptr ) return nullptr;
+
+		onig_initialize_match_param( mp );
+
+		// (for 'retry_limit_in_match', 0 means "no retries" in Oniguruma)
+		onig_set_retry_limit_in_match_of_match_param( mp, job->limits.RetryLimitInMatch == 0 ? ULONG_MAX : job->limits.RetryLimitInMatch );
+		onig_set_retry_limit_in_search_of_match_param( mp, job->limits.RetryLimitInSearch );
+		onig_set_match_stack_limit_size_of_match_param( mp, job->limits.MatchStackLimit );
+		onig_set_progress_callout_of_match_param( mp, &ProgressCallout );
+		onig_set_callout_user_data_of_match_param( mp, &job->cancel );
+
+		return mp;
+	}
+
+
+	// Returns the position of the next search, or null if the end is reached.
+	static const OnigUChar* NextStart( OnigEncoding enc, const OnigUChar* str, const OnigUChar* start, const OnigUChar* end, OnigRegion* region )
+	{
+		if( region->end[0] == start - str )
+		{
+			// empty match; advance by a whole character
+			if( start >= end ) return nullptr;
+
+			return start + ONIGENC_MBC_ENC_LEN( enc, start );
+		}
+
+		return str + region->end[0];
+	}
+
+
+	static int ScanRegex( NativeScanJob* job )
+	{
+		regex_t* reg = job->regex.get( );
+		OnigEncoding enc = onig_get_encoding( reg );
+		int number_of_groups = onig_number_of_captures( reg ) + 1;
+
+		OnigMatchParam* mp = NewMatchParam( job );
+		if( mp == nullptr ) return ONIGERR_MEMORY;
+
+		OnigRegion* region = onig_region_new( );
+
+		const OnigUChar* str = job->begin;
+		const OnigUChar* end = job->end;
+		const OnigUChar* start = str;
+
+		// same as 'onig_scan', which does not accept the match parameters
+
+		int n = 0;
+
+		for( ;;)
+		{
+			if( job->cancel.load( std::memory_order_relaxed ) )
+			{
+				n = ONIG_ABORT;
+				break;
+			}
+
+			int r = onig_search_with_param( reg, str, end, start, end, region, job->searchOptions, mp );
+
+			if( r == ONIG_MISMATCH ) break;
+
+			if( r < 0 )
+			{
+				n = r;
+				break;
+			}
+
+			CollectMatch( job, region, number_of_groups );
+			++n;
+
+			start = NextStart( enc, str, start, end, region );
+
+			if( start == nullptr || start > end ) break;
+		}
+
+		onig_region_free( region, 1 );
+		onig_free_match_param( mp );
+
+		return n;
+	}
+
+
+	// Like 'ScanRegex', but the regex is matched only at the starts of the words of the prefilter, in order;
+	// the text does not contain unpaired surrogates, therefore the starts are at the characters.
+	static int ScanPrefiltered( NativeScanJob* job )
+	{
+		regex_t* reg = job->regex.get( );
+		int number_of_groups = onig_number_of_captures( reg ) + 1;
+		const NativeInfrastructure::LiteralAlternationSearcher* searcher = job->prefilter->searcher.get( );
+
+		OnigMatchParam* mp = NewMatchParam( job );
+		if( mp == nullptr ) return ONIGERR_MEMORY;
+
+		OnigRegion* region = onig_region_new( );
+
+		const OnigUChar* str = job->begin;
+		const OnigUChar* end = job->end;
+		const char16_t* text = (const char16_t*)str;
+		size_t length = ( end - str ) / 2;
+		size_t start = 0;
+
+		int n = 0;
+
+		for( ;;)
+		{
+			if( job->cancel.load( std::memory_order_relaxed ) )
+			{
+				n = ONIG_ABORT;
+				break;
+			}
+
+			size_t word_length;
+			size_t candidate = searcher->Find( text, length, start, &word_length );
+
+			if( candidate == NativeInfrastructure::LiteralNotFound ) break;
+
+			int r = onig_match_with_param( reg, str, end, str + 2 * candidate, region, job->searchOptions, mp );
+
+			if( r == ONIG_MISMATCH )
+			{
+				start = candidate + 1;
+				continue;
+			}
+
+			if( r < 0 )
+			{
+				n = r;
+				break;
+			}
+
+			CollectMatch( job, region, number_of_groups );
+			++n;
+
+			start = region->end[0] / 2; // (the matches are not empty)
+		}
+
+		onig_region_free( region, 1 );
+		onig_free_match_param( mp );
+
+		return n;
+	}
+
+
+	static int ScanRegSet( NativeScanJob* job )
+	{
+		OnigRegSet* set = job->regSet.get( );
+		int number_of_regexes = onig_regset_number_of_regex( set );
+		if( number_of_regexes <= 0 ) return 0;
+
+		OnigEncoding enc = onig_get_encoding( onig_regset_get_regex( set, 0 ) );
+
+		std::vector<int> number_of_groups( number_of_regexes );
+		for( int i = 0; i < number_of_regexes; ++i ) number_of_groups[i] = onig_number_of_captures( onig_regset_get_regex( set, i ) ) + 1;
+
+		// (the limits apply to each regex separately)
+		std::vector<OnigMatchParam*> mps( number_of_regexes, nullptr );
+		int n = 0;
+
+		for( int i = 0; i < number_of_regexes; ++i )
+		{
+			mps[i] = NewMatchParam( job );
+			if( mps[i] == nullptr ) n = ONIGERR_MEMORY;
+		}
+
+		const OnigUChar* str = job->begin;
+		const OnigUChar* end = job->end;
+		const OnigUChar* start = str;
+
+		// the text is traversed once; at each position, the first (or, depending on 'lead', the earliest) matching regex wins
+
+		while( n >= 0 )
+		{
+			if( job->cancel.load( std::memory_order_relaxed ) )
+			{
+				n = ONIG_ABORT;
+				break;
+			}
+
+			int match_pos;
+			int r = onig_regset_search_with_param( set, str, end, start, end, job->lead, job->searchOptions, mps.data( ), &match_pos );
+
+			if( r == ONIG_MISMATCH ) break;
+
+			if( r < 0 )
+			{
+				n = r;
+				break;
+			}
+
+			OnigRegion* region = onig_regset_get_region( set, r );
+
+			job->results.Patterns.push_back( r );
+			CollectMatch( job, region, number_of_groups[r] );
+			++n;
+
+			start = NextStart( enc, str, start, end, region );
+
+			if( start == nullptr || start > end ) break;
+		}
+
+		for( OnigMatchParam* mp : mps ) if( mp != nullptr ) onig_free_match_param( mp );
+
+		return n;
+	}
+
+
+	static void ScanJobProc( void* p )
+	{
+		std::shared_ptr<NativeScanJob>* job_ptr = (std::shared_ptr<NativeScanJob>*)p;
+		NativeScanJob* job = job_ptr->get( );
+
+		if( job->utf8File )
+		{
+			job->begin = (const OnigUChar*)job->utf8File->text;
+			job->end = job->begin + job->utf8File->size;
+		}
+		else if( job->isUtf8 )
+		{
+			job->begin = (const OnigUChar*)job->utf8Text.c_str( );
+			job->end = job->begin + job->utf8Text.length( );
+		}
+		else
+		{
+			job->begin = (const OnigUChar*)job->text.c_str( );
+			job->end = (const OnigUChar*)( job->text.c_str( ) + job->text.length( ) );
+		}
+
+		if( job->isUtf8 )
+		{
+			job->offsets.reset( new NativeInfrastructure::Utf8OffsetTranslator( (const char*)job->begin, job->end - job->begin ) );
+		}
+
+		NativeInfrastructure::TraceSpan span( "oniguruma", "scan", job->end - job->begin ); // (on the guarded thread)
+		if( job->regSet )
+		{
+			job->result = ScanRegSet( job );
+		}
+		else if( job->prefilter && !NativeInfrastructure::HasUnpairedSurrogates( job->text.c_str( ), job->text.length( ) ) )
+		{
+			job->result = ScanPrefiltered( job );
+		}
+		else
+		{
+			job->result = ScanRegex( job );
+		}
+		span.End( );
+
+		delete job_ptr; // (leaks if the thread failed)
+	}
+
+
+	static NativeScanTask* StartJob( const std::shared_ptr<NativeScanJob>& job )
+	{
+		std::unique_ptr<NativeScanTask> task( new NativeScanTask );
+
+		task->job = job;
+
+		auto* job_ptr = new std::shared_ptr<NativeScanJob>( task->job ); // (owned by thread)
+
+		if( !task->thread.Start( NativeInfrastructure::DefaultGuardedStackSize, &ScanJobProc, job_ptr ) )
+		{
+			delete job_ptr;
+		}
+
+		return task.release( );
+	}
+
+
+	static void SetText( NativeScanJob* job, OnigEncoding encoding, const char16_t* text, size_t length )
+	{
+		NativeInfrastructure::TraceSpan span( "oniguruma", encoding == ONIG_ENCODING_UTF8 ? "to_utf8" : "copy_text", static_cast<int64_t>( length ) );
+
+		if( encoding == ONIG_ENCODING_UTF8 )
+		{
+			job->isUtf8 = true;
+			NativeInfrastructure::AppendUtf8( &job->utf8Text, text, length );
+		}
+		else
+		{
+			job->text.assign( text, length );
+		}
+	}
+
+
+	NativeScanTask* NativeStartScan( const std::shared_ptr<regex_t>& regex, const std::shared_ptr<NativeLiteralPrefilter>& prefilter,
+		const char16_t* text, size_t length, OnigOptionType searchOptions, bool collectCaptureHistory, const NativeScanLimits& limits )
+	{
+		auto job = std::make_shared<NativeScanJob>( );
+
+		job->regex = regex;
+
+		// ('onig_match' does not count the retries of the whole search)
+		if( ( searchOptions & ~PrefilterSearchOptions ) == 0 && limits.RetryLimitInSearch == 0 ) job->prefilter = prefilter;
+
+		SetText( job.get( ), onig_get_encoding( regex.get( ) ), text, length );
+		job->searchOptions = searchOptions;
+		job->collectCaptureHistory = collectCaptureHistory;
+		job->limits = limits;
+		job->results.NumberOfGroups = onig_number_of_captures( regex.get( ) ) + 1;
+
+		return StartJob( job );
+	}
+
+
+	NativeScanTask* NativeStartRegSetScan( const std::shared_ptr<OnigRegSet>& regSet, OnigRegSetLead lead, const char16_t* text, size_t length,
+		OnigOptionType searchOptions, bool collectCaptureHistory, const NativeScanLimits& limits )
+	{
+		auto job = std::make_shared<NativeScanJob>( );
+
+		job->regSet = regSet;
+		job->lead = lead;
+		if( onig_regset_number_of_regex( regSet.get( ) ) > 0 )
+		{
+			SetText( job.get( ), onig_get_encoding( onig_regset_get_regex( regSet.get( ), 0 ) ), text, length );
+		}
+		job->searchOptions = searchOptions;
+		job->collectCaptureHistory = collectCaptureHistory;
+		job->limits = limits;
+		job->results.NumberOfGroups = 0; // (depends on pattern)
+
+		return StartJob( job );
+	}
+
+
+	NativeScanTask* NativeStartFileScan( const std::shared_ptr<regex_t>& regex, const std::shared_ptr<OnigRegSet>& regSet, OnigRegSetLead lead,
+		const std::shared_ptr<NativeUtf8File>& file, OnigOptionType searchOptions, bool collectCaptureHistory, const NativeScanLimits& limits )
+	{
+		auto job = std::make_shared<NativeScanJob>( );
+
+		job->regex = regex;
+		job->regSet = regSet;
+		job->lead = lead;
+		job->utf8File = file;
+		job->isUtf8 = true;
+		job->searchOptions = searchOptions;
+		job->collectCaptureHistory = collectCaptureHistory;
+		job->limits = limits;
+		job->results.NumberOfGroups = regSet ? 0 : onig_number_of_captures( regex.get( ) ) + 1;
+
+		return StartJob( job );
+	}
+
+
+	int NativeCompile( regex_t** regex, const char16_t* pattern, size_t length,
+		OnigOptionType compileOptions, OnigEncoding encoding, OnigSyntaxType* syntax, std::string* errorMessage )
+	{
+		std::string utf8_pattern;
+		const OnigUChar* begin;
+		const OnigUChar* end;
+
+		if( encoding == ONIG_ENCODING_UTF8 )
+		{
+			NativeInfrastructure::TraceSpan span( "oniguruma", "to_utf8", static_cast<int64_t>( length ) );
+
+			NativeInfrastructure::AppendUtf8( &utf8_pattern, pattern, length );
+
+			begin = (const OnigUChar*)utf8_pattern.c_str( );
+			end = begin + utf8_pattern.length( );
+		}
+		else
+		{
+			begin = (const OnigUChar*)pattern;
+			end = (const OnigUChar*)( pattern + length );
+		}
+
+		OnigErrorInfo einfo{};
+
+		NativeInfrastructure::TraceSpan span( "oniguruma", "compile", end - begin );
+		int r = onig_new( regex, begin, end, compileOptions, encoding, syntax, &einfo );
+		span.End( );
+
+		if( r != ONIG_NORMAL )
+		{
+			// (format it now, since 'einfo' can point to the converted pattern)
+
+			char s[ONIG_MAX_ERROR_MESSAGE_LEN];
+			onig_error_code_to_str( (OnigUChar*)s, r, &einfo );
+
+			*errorMessage = s;
+		}
+
+		return r;
+	}
+
+
+	// (the canonical options of the key in the cache; the padding is zeroed)
+	struct NativeCompileKeyOptions
+	{
+		OnigOptionType CompileOptions;
+		OnigEncoding Encoding;
+		OnigSyntaxType Syntax;
+	};
+
+
+	static void FreeCachedRegex( void* regex )
+	{
+		onig_free( static_cast<regex_t*>( regex ) );
+	}
+
+
+	int NativeCompileCached( std::shared_ptr<regex_t>* regex, const char16_t* pattern, size_t length,
+		OnigOptionType compileOptions, OnigEncoding encoding, OnigSyntaxType* syntax, std::string* errorMessage )
+	{
+		NativeCompileKeyOptions key_options;
+		memset( &key_options, 0, sizeof( key_options ) );
+
+		key_options.CompileOptions = compileOptions;
+		key_options.Encoding = encoding;
+		onig_copy_syntax( &key_options.Syntax, syntax );
+
+		std::string const key = NativeInfrastructure::MakeCompiledPatternKey( "oniguruma", &key_options, sizeof( key_options ), pattern, length );
+
+		regex_t* reg = static_cast<regex_t*>( NativeInfrastructure::AcquireCompiledPattern( key ) );
+
+		if( reg == nullptr )
+		{
+			int r = NativeCompile( &reg, pattern, length, compileOptions, encoding, syntax, errorMessage );
+
+			if( r != ONIG_NORMAL ) return r;
+
+			NativeInfrastructure::AddCompiledPattern( key, reg, onig_memsize( reg ), &FreeCachedRegex );
+		}
+
+		regex->reset( reg, &NativeInfrastructure::ReleaseCompiledPattern );
+
+		return ONIG_NORMAL;
+	}
+
+
+	std::shared_ptr<NativeLiteralPrefilter> NativeCreateLiteralPrefilter( regex_t* regex, const char16_t* pattern, size_t length,
+		const OnigSyntaxType* syntax )
+	{
+#ifdef REGEX_CORE_NO_LITERAL_SEARCH
+		return nullptr;
+#else
+		if( !NativeInfrastructure::IsLiteralSearchEnabled( ) ) return nullptr;
+
+		if( onig_get_encoding( regex ) != ONIG_ENCODING_UTF16_LE ) return nullptr;
+
+		// (the case-insensitive and extended modes change the words; the longest match is searched in the whole text)
+		if( ( onig_get_options( regex ) & ( ONIG_OPTION_IGNORECASE | ONIG_OPTION_EXTEND | ONIG_OPTION_FIND_LONGEST | ONIG_OPTION_FIND_NOT_EMPTY ) ) != 0 ) return nullptr;
+
+		NativeInfrastructure::LiteralAlternation alternation;
+		if( !NativeInfrastructure::ParseLiteralAlternation( pattern, length, &alternation ) ) return nullptr;
+
+		if( NativeInfrastructure::HasUnpairedSurrogates( pattern, length ) ) return nullptr;
+
+		// the operators must have the meaning of the Perl-like syntaxes
+
+		if( ( syntax->op & ONIG_SYN_OP_VARIABLE_META_CHARACTERS ) != 0 ) return nullptr;
+		if( alternation.Words.size( ) > 1 && ( syntax->op & ONIG_SYN_OP_VBAR_ALT ) == 0 ) return nullptr;
+		if( ( alternation.CapturingGroup || alternation.NonCapturingGroup ) && ( syntax->op & ONIG_SYN_OP_LPAREN_SUBEXP ) == 0 ) return nullptr;
+		if( alternation.NonCapturingGroup && ( syntax->op2 & ONIG_SYN_OP2_QMARK_GROUP_EFFECT ) == 0 ) return nullptr;
+		if( ( alternation.LeadingWordBoundary || alternation.TrailingWordBoundary ) && ( syntax->op & ONIG_SYN_OP_ESC_B_WORD_BOUND ) == 0 ) return nullptr;
+
+		unsigned const escaped_operators = ONIG_SYN_OP_ESC_ASTERISK_ZERO_INF | ONIG_SYN_OP_ESC_PLUS_ONE_INF | ONIG_SYN_OP_ESC_QMARK_ZERO_ONE |
+			ONIG_SYN_OP_ESC_BRACE_INTERVAL | ONIG_SYN_OP_ESC_VBAR_ALT | ONIG_SYN_OP_ESC_LPAREN_SUBEXP;
+
+		if( alternation.EscapedCharacters && ( syntax->op & escaped_operators ) != 0 ) return nullptr;
+
+		// (the word boundaries and the rest are verified by Oniguruma)
+		auto prefilter = std::make_shared<NativeLiteralPrefilter>( );
+
+		prefilter->searcher = NativeInfrastructure::LiteralAlternationSearcher::Create( alternation,
+			NativeInfrastructure::LiteralAlternationSearcher::Priority::First, nullptr, nullptr );
+
+		if( !prefilter->searcher ) return nullptr;
+
+		return prefilter;
+#endif
+	}
+
+
+	int NativeCreateRegSet( std::shared_ptr<OnigRegSet>* regSet, const std::vector<std::u16string>& patterns,
+		OnigOptionType compileOptions, OnigEncoding encoding, OnigSyntaxType* syntax, int* failedPattern, std::string* errorMessage )
+	{
+		std::vector<regex_t*> regexes;
+		int r = 0;
+
+		*failedPattern = -1;
+
+		for( size_t i = 0; i < patterns.size( ); ++i )
+		{
+			const std::u16string& pattern = patterns[i];
+			regex_t* reg;
+
+			r = NativeCompile( &reg, pattern.c_str( ), pattern.length( ), compileOptions, encoding, syntax, errorMessage );
+
+			if( r != ONIG_NORMAL )
+			{
+				*failedPattern = (int)i;
+				break;
+			}
+
+			regexes.push_back( reg );
+		}
+
+		OnigRegSet* set = nullptr;
+
+		if( r == ONIG_NORMAL )
+		{
+			// (the set takes the ownership of regexes)
+			r = onig_regset_new( &set, (int)regexes.size( ), regexes.data( ) );
+		}
+
+		if( r != ONIG_NORMAL )
+		{
+			for( regex_t* reg : regexes ) onig_free( reg );
+
+			return r;
+		}
+
+		regSet->reset( set, &onig_regset_free );
+
+		return ONIG_NORMAL;
+	}
+
+
+	std::shared_ptr<NativeUtf8File> NativeOpenUtf8File( const char* utf8Path, std::string* error )
+	{
+		auto file = std::make_shared<NativeUtf8File>( );
+
+		if( !file->file.Open( utf8Path ) )
+		{
+			*error = file->file.GetErrorText( );
+
+			return nullptr;
+		}
+
+		file->text = file->file.Data( ) != nullptr ? file->file.Data( ) : ""; // (null for empty files)
+		file->size = file->file.Size( );
+
+		// skip BOM
+
+		if( file->size >= 3 && memcmp( file->text, "\xEF\xBB\xBF", 3 ) == 0 )
+		{
+			file->text += 3;
+			file->size -= 3;
+		}
+
+		return file;
+	}
+
+
+	void NativeGetUtf8FileText( const NativeUtf8File* file, const char** text, size_t* size )
+	{
+		*text = file->text;
+		*size = file->size;
+	}
+
+
+	bool NativeWaitScan( NativeScanTask* task, unsigned milliseconds )
+	{
+		return task->thread.Wait( milliseconds );
+	}
+
+
+	void NativeCancelScan( NativeScanTask* task )
+	{
+		task->job->cancel = true;
+
+		delete task; // (the thread keeps its reference to the job)
+	}
+
+
+	int NativeFinishScan( NativeScanTask* task, NativeScanResults* results, std::string* error )
+	{
+		std::unique_ptr<NativeScanTask> t( task );
+
+		while( !t->thread.Wait( 1000 ) );
+
+		error->clear( );
+
+		if( t->thread.GetResult( ) != NativeInfrastructure::GuardedRunResult::Completed )
+		{
+			*error = t->thread.GetErrorText( );
+
+			return 0;
+		}
+
+		*results = std::move( t->job->results );
+
+		return t->job->result;
+	}
+
+}
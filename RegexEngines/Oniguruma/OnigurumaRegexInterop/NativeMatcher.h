@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "Oniguruma-min/src/oniguruma.h"
+
+
+namespace OnigurumaRegexInterop
+{
+
+	struct NativeCapture
+	{
+		int Group;
+		int Index;
+		int Length;
+	};
+
+
+	struct NativeScanResults
+	{
+		int NumberOfGroups; // (including the whole match; 0 for RegSet, where it depends on the pattern)
+		std::vector<int> Groups; // for each match, 'NumberOfGroups' pairs of index and length, in UTF-16 units; index is -1 for failed groups
+		std::vector<int> Patterns; // (RegSet only) for each match, the index of matched pattern in the set
+		std::vector<NativeCapture> Captures; // capture history of all matches
+		std::vector<size_t> CaptureStarts; // for each match, the first item in 'Captures'
+	};
+
+
+	struct NativeScanLimits
+	{
+		unsigned long RetryLimitInMatch; // (0 -- unlimited)
+		unsigned long RetryLimitInSearch; // (0 -- unlimited)
+		unsigned int MatchStackLimit; // (0 -- unlimited)
+	};
+
+
+	// A memory-mapped UTF-8 file; opaque, since it uses the platform headers.
+	struct NativeUtf8File;
+
+
+	// The accelerator of the patterns that are alternations of literals (see "LiteralAlternation.h"): the regex
+	// is tried only at the starts of the words; opaque, since it uses the native infrastructure.
+	struct NativeLiteralPrefilter;
+
+
+	// The scan runs on a separate thread; the task is opaque, since it uses
+	// the threading primitives that are not allowed in managed code.
+	struct NativeScanTask;
+
+
+	// Starts collecting all matches; the text is copied, or converted to UTF-8 if the regex is compiled for UTF-8.
+	// The prefilter, which can be null, is used if the search options and the limits allow it.
+	NativeScanTask* NativeStartScan( const std::shared_ptr<regex_t>& regex, const std::shared_ptr<NativeLiteralPrefilter>& prefilter,
+		const char16_t* text, size_t length, OnigOptionType searchOptions, bool collectCaptureHistory, const NativeScanLimits& limits );
+
+	// Starts collecting all matches of a RegSet, which must not be used by other scans,
+	// since the set keeps the regions of the last search.
+	NativeScanTask* NativeStartRegSetScan( const std::shared_ptr<OnigRegSet>& regSet, OnigRegSetLead lead, const char16_t* text, size_t length,
+		OnigOptionType searchOptions, bool collectCaptureHistory, const NativeScanLimits& limits );
+
+	// Starts collecting all matches in a UTF-8 file, which is searched in place; the offsets are translated to UTF-16.
+	// One of 'regex' and 'regSet' is null; both must be compiled for UTF-8.
+	NativeScanTask* NativeStartFileScan( const std::shared_ptr<regex_t>& regex, const std::shared_ptr<OnigRegSet>& regSet, OnigRegSetLead lead,
+		const std::shared_ptr<NativeUtf8File>& file, OnigOptionType searchOptions, bool collectCaptureHistory, const NativeScanLimits& limits );
+
+	// Returns true if the scan is finished.
+	bool NativeWaitScan( NativeScanTask* task, unsigned milliseconds );
+
+	// Requests the cancellation and releases the task without waiting.
+	// The search stops at the next match, or at the next callout of the pattern; until then, the thread is
+	// counted by 'MaxAbandonedGuardedThreads' (see "StackGuard.h"), and too many of them make the next scans fail.
+	void NativeCancelScan( NativeScanTask* task );
+
+	// Waits for the results and releases the task.
+	// Returns the number of matches, or an error code; if the thread failed, 'error' is not empty.
+	int NativeFinishScan( NativeScanTask* task, NativeScanResults* results, std::string* error );
+
+
+	// Compiles the UTF-16 pattern for the given encoding (UTF-16LE or UTF-8).
+	// Returns 0 or an error code, which is also described in 'errorMessage'.
+	int NativeCompile( regex_t** regex, const char16_t* pattern, size_t length,
+		OnigOptionType compileOptions, OnigEncoding encoding, OnigSyntaxType* syntax, std::string* errorMessage );
+
+	// Like 'NativeCompile', but takes the pattern from the cache of compiled patterns if possible
+	// (see "CompiledPatternCache.h"); the pattern is returned to the cache when the pointer is released.
+	int NativeCompileCached( std::shared_ptr<regex_t>* regex, const char16_t* pattern, size_t length,
+		OnigOptionType compileOptions, OnigEncoding encoding, OnigSyntaxType* syntax, std::string* errorMessage );
+
+	// Returns the prefilter if the regex, compiled from the UTF-16 pattern with the syntax, is an alternation
+	// of literals that the prefilter covers, otherwise null.
+	std::shared_ptr<NativeLiteralPrefilter> NativeCreateLiteralPrefilter( regex_t* regex, const char16_t* pattern, size_t length,
+		const OnigSyntaxType* syntax );
+
+	// Compiles the patterns and makes a RegSet. Returns 0 or an error code;
+	// if a pattern cannot be compiled, 'failedPattern' is its index.
+	int NativeCreateRegSet( std::shared_ptr<OnigRegSet>* regSet, const std::vector<std::u16string>& patterns,
+		OnigOptionType compileOptions, OnigEncoding encoding, OnigSyntaxType* syntax, int* failedPattern, std::string* errorMessage );
+
+
+	// Maps the file to memory. Returns null if it fails.
+	std::shared_ptr<NativeUtf8File> NativeOpenUtf8File( const char* utf8Path, std::string* error );
+
+	// Gets the text of the file, without BOM.
+	void NativeGetUtf8FileText( const NativeUtf8File* file, const char** text, size_t* size );
+
+}
@@ -0,0 +1,15 @@
+/* RegExpress: the configuration for GCC and Clang on Linux, which is used by the CMake build
+   instead of "../config.h" (that one is for MSVC). */
+#define HAVE_STDINT_H 1
+#define HAVE_INTTYPES_H 1
+#define HAVE_SYS_TYPES_H 1
+#define HAVE_SYS_TIME_H 1
+#define HAVE_UNISTD_H 1
+#define HAVE_ALLOCA 1
+#define HAVE_ALLOCA_H 1
+#define SIZEOF_INT __SIZEOF_INT__
+#define SIZEOF_LONG __SIZEOF_LONG__
+#define SIZEOF_LONG_LONG __SIZEOF_LONG_LONG__
+#define SIZEOF_VOIDP __SIZEOF_POINTER__
+#define SIZEOF_SIZE_T __SIZEOF_SIZE_T__
+#define STDC_HEADERS 1
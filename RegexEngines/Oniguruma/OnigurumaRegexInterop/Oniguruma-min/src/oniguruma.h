@@ -29,6 +29,8 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h> /* RegExpress: for onig_memsize */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -820,6 +822,8 @@ void onig_free P_((OnigRegex));
 ONIG_EXTERN
 void onig_free_body P_((OnigRegex));
 ONIG_EXTERN
+size_t onig_memsize P_((const OnigRegexType*));
+ONIG_EXTERN
 int onig_scan(OnigRegex reg, const OnigUChar* str, const OnigUChar* end, OnigRegion* region, OnigOptionType option, int (*scan_callback)(int, int, OnigRegion*, void*), void* callback_arg);
 ONIG_EXTERN
 int onig_search P_((OnigRegex, const OnigUChar* str, const OnigUChar* end, const OnigUChar* start, const OnigUChar* range, OnigRegion* region, OnigOptionType option));
@@ -7314,6 +7314,60 @@ onig_free(regex_t* reg)
   }
 }
 
+/* RegExpress: the memory of the compiled pattern (as Onigmo's onig_memsize),
+   for the cache of compiled patterns; the table of names is not included */
+extern size_t
+onig_memsize(const regex_t* reg)
+{
+  int i;
+  size_t size;
+
+  if (IS_NULL(reg)) return 0;
+
+  size = sizeof(*reg);
+  size += (size_t )reg->ops_alloc * sizeof(Operation);
+#ifdef USE_DIRECT_THREADED_CODE
+  size += (size_t )reg->ops_alloc * sizeof(enum OpCode);
+#endif
+  size += (size_t )(reg->string_pool_end - reg->string_pool);
+  if (IS_NOT_NULL(reg->exact))
+    size += (size_t )(reg->exact_end - reg->exact);
+  size += (size_t )reg->repeat_range_alloc * sizeof(RepeatRange);
+  if (IS_NOT_NULL(reg->extp)) {
+    size += sizeof(RegexExt);
+    size += (size_t )(reg->extp->pattern_end - reg->extp->pattern);
+  }
+
+  for (i = 0; IS_NOT_NULL(reg->ops) && i < (int )reg->ops_used; i++) {
+    enum OpCode opcode;
+    Operation* op;
+
+    op = reg->ops + i;
+
+#ifdef USE_DIRECT_THREADED_CODE
+    opcode = *(reg->ocs + i);
+#else
+    opcode = op->opcode;
+#endif
+
+    switch (opcode) {
+    case OP_CCLASS_NOT: case OP_CCLASS:
+      size += sizeof(BitSet);
+      break;
+    case OP_CCLASS_MB_NOT: case OP_CCLASS_MB:
+      size += sizeof(BBuf) + ((BBuf* )op->cclass_mb.mb)->alloc;
+      break;
+    case OP_CCLASS_MIX_NOT: case OP_CCLASS_MIX:
+      size += sizeof(BitSet) + sizeof(BBuf) + ((BBuf* )op->cclass_mix.mb)->alloc;
+      break;
+    default:
+      break;
+    }
+  }
+
+  return size;
+}
+
 
 #ifdef ONIG_DEBUG_PARSE
 static void print_tree P_((FILE* f, Node* node));
@@ -210,10 +210,19 @@
 #undef ONIG_ESCAPE_UCHAR_COLLISION
 #endif
 
+#ifdef REGEX_CORE_COUNT_ALLOCATIONS
+/* RegExpress: the allocations are counted by the benchmark */
+#include "../../../../NativeInfrastructure/AllocationCounter.h"
+#define xmalloc    RegexCoreCountedMalloc
+#define xrealloc   RegexCoreCountedRealloc
+#define xcalloc    RegexCoreCountedCalloc
+#define xfree      RegexCoreCountedFree
+#else
 #define xmalloc    malloc
 #define xrealloc   realloc
 #define xcalloc    calloc
 #define xfree      free
+#endif
 
 #define st_init_table               onig_st_init_table
 #define st_init_table_with_size     onig_st_init_table_with_size
@@ -9,6 +9,11 @@
 #include "regint.h"
 #include "st.h"
 
+#ifdef REGEX_CORE_COUNT_ALLOCATIONS
+/* RegExpress: the tables are allocated by xmalloc and xcalloc, which are counted */
+#define free       xfree
+#endif
+
 
 typedef struct st_table_entry st_table_entry;
 
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Oniguruma-min/src/oniguruma.h"
+
+#include "../../NativeInfrastructure/Utf8Text.h"
+#include "NativeMatcher.h"
+#include "OnigurumaCore.h"
+
+
+using namespace NativeInfrastructure;
+using namespace OnigurumaRegexInterop;
+
+
+struct OnigurumaCoreRegex
+{
+	std::shared_ptr<regex_t> Regex;
+	std::shared_ptr<NativeLiteralPrefilter> Prefilter; // (null if the pattern is not an alternation of literals)
+	OnigSyntaxType Syntax; // (must live while the regex is used)
+	OnigOptionType SearchOptions = ONIG_OPTION_NONE;
+	NativeScanLimits Limits{ };
+	bool HasCaptureHistory = false;
+	std::vector<OnigurumaCoreNames> Names; // (one item; resolved by 'OnigurumaCoreCompile')
+};
+
+
+static void SetOnigurumaError( RegexCoreError* error, int code, const std::string& message )
+{
+	std::string text = message + "\r\n\r\n(" + std::to_string( code ) + ")";
+
+	SetRegexCoreError( error, text.c_str( ) );
+}
+
+
+// Initializes the library once for UTF-16LE and UTF-8; returns 0 or an error code.
+static int InitializeOniguruma( )
+{
+	static std::once_flag once;
+	static int result = 0;
+
+	std::call_once( once, [ ]
+		{
+			OnigEncoding use_encs[2];
+			use_encs[0] = ONIG_ENCODING_UTF16_LE;
+			use_encs[1] = ONIG_ENCODING_UTF8;
+
+			result = onig_initialize( use_encs, sizeof( use_encs ) / sizeof( use_encs[0] ) );
+		} );
+
+	return result;
+}
+
+
+namespace
+{
+	struct ForEachNameData
+	{
+		OnigurumaCoreNames* names;
+		bool isUtf8;
+	};
+}
+
+
+static int ForEachNameCallback( const OnigUChar* name, const OnigUChar* nameEnd, int numberOfGroups, int* groupNumbers, regex_t* regex, void* arg )
+{
+	(void)regex;
+
+	ForEachNameData* data = static_cast<ForEachNameData*>( arg );
+
+	std::u16string group_name;
+
+	if( data->isUtf8 )
+	{
+		AppendUtf16( &group_name, reinterpret_cast<const char*>( name ), nameEnd - name );
+	}
+	else
+	{
+		group_name.assign( reinterpret_cast<const char16_t*>( name ), reinterpret_cast<const char16_t*>( nameEnd ) );
+	}
+
+	std::vector<int32_t>& group_names = data->names->GroupNames;
+	int32_t id = static_cast<int32_t>( data->names->Names.size( ) );
+
+	data->names->Names.push_back( std::move( group_name ) );
+
+	for( int i = 0; i < numberOfGroups; ++i )
+	{
+		int group_number = groupNumbers[i];
+
+		if( group_number >= 0 && static_cast<size_t>( group_number ) < group_names.size( ) ) group_names[group_number] = id;
+	}
+
+	return 0;
+}
+
+
+void OnigurumaRegexInterop::OnigurumaCoreResolveNames( regex_t* regex, OnigurumaCoreNames* names )
+{
+	names->Names.clear( );
+	names->GroupNames.assign( onig_number_of_captures( regex ) + 1, -1 );
+	names->PatternName = -1;
+
+	ForEachNameData data{ names, onig_get_encoding( regex ) == ONIG_ENCODING_UTF8 };
+
+	onig_foreach_name( regex, &ForEachNameCallback, &data );
+}
+
+
+void OnigurumaRegexInterop::OnigurumaCoreBuildResults( const NativeScanResults& nativeResults, const std::vector<OnigurumaCoreNames>& names, RegexCoreResults* results )
+{
+	RegexCoreResultsBuilder builder;
+
+	// (the names of all patterns are added once; 'name_ids[p][i]' is the id of 'names[p].Names[i]')
+	std::vector<std::vector<int32_t>> name_ids( names.size( ) );
+	std::vector<int32_t> number_ids; // (the names by number, added on demand)
+
+	for( size_t p = 0; p < names.size( ); ++p )
+	{
+		for( const std::u16string& name : names[p].Names ) name_ids[p].push_back( builder.AddName( name.data( ), name.size( ) ) );
+	}
+
+	bool const has_capture_history = !nativeResults.CaptureStarts.empty( );
+	size_t const number_of_matches = nativeResults.Patterns.empty( ) ?
+		nativeResults.Groups.size( ) / 2 / ( nativeResults.NumberOfGroups == 0 ? 1 : nativeResults.NumberOfGroups ) :
+		nativeResults.Patterns.size( );
+
+	// (the captures of a match, bucketed by group in one pass: 'capture_starts[g]' is the first one of group 'g'
+	// in 'sorted_captures', in the order of the history)
+	std::vector<size_t> capture_starts;
+	std::vector<const NativeCapture*> sorted_captures;
+
+	const int* groups = nativeResults.Groups.data( );
+
+	for( size_t m = 0; m < number_of_matches; ++m )
+	{
+		size_t const pattern = nativeResults.Patterns.empty( ) ? 0 : nativeResults.Patterns[m];
+		const OnigurumaCoreNames& pattern_names = names.at( pattern );
+		int const number_of_groups = static_cast<int>( pattern_names.GroupNames.size( ) );
+		bool const has_pattern_group = pattern_names.PatternName >= 0;
+
+		if( has_capture_history )
+		{
+			size_t const first_capture = nativeResults.CaptureStarts[m];
+			size_t const end_capture = m + 1 < nativeResults.CaptureStarts.size( ) ? nativeResults.CaptureStarts[m + 1] : nativeResults.Captures.size( );
+
+			capture_starts.assign( number_of_groups + 1, 0 );
+
+			for( size_t k = first_capture; k < end_capture; ++k )
+			{
+				int const group = nativeResults.Captures[k].Group;
+
+				if( group >= 0 && group < number_of_groups ) ++capture_starts[group + 1];
+			}
+
+			for( int g = 0; g < number_of_groups; ++g ) capture_starts[g + 1] += capture_starts[g];
+
+			sorted_captures.resize( capture_starts[number_of_groups] );
+
+			for( size_t k = first_capture; k < end_capture; ++k )
+			{
+				const NativeCapture& c = nativeResults.Captures[k];
+
+				if( c.Group >= 0 && c.Group < number_of_groups ) sorted_captures[capture_starts[c.Group]++] = &c;
+			}
+
+			// (each start was advanced to the start of the next group)
+			for( int g = number_of_groups; g > 0; --g ) capture_starts[g] = capture_starts[g - 1];
+			capture_starts[0] = 0;
+		}
+
+		builder.BeginMatch( number_of_groups + ( has_pattern_group ? 1 : 0 ) );
+
+		for( int g = 0; g < number_of_groups; ++g, groups += 2 )
+		{
+			int32_t name = pattern_names.GroupNames[g] >= 0 ? name_ids[pattern][pattern_names.GroupNames[g]] : -1;
+
+			if( name < 0 && has_pattern_group && g > 0 )
+			{
+				// (the pattern group shifts the numbers that the results would give)
+				while( number_ids.size( ) <= static_cast<size_t>( g ) ) number_ids.push_back( -1 );
+
+				if( number_ids[g] < 0 )
+				{
+					std::string number = std::to_string( g );
+					std::u16string number16( number.begin( ), number.end( ) );
+
+					number_ids[g] = builder.AddName( number16.data( ), number16.size( ) );
+				}
+
+				name = number_ids[g];
+			}
+
+			if( groups[0] < 0 )
+			{
+				builder.AddFailedGroup( name );
+			}
+			else
+			{
+				builder.AddGroup( groups[0], groups[1], name );
+
+				if( has_capture_history )
+				{
+					for( size_t k = capture_starts[g]; k < capture_starts[g + 1]; ++k )
+					{
+						builder.AddCapture( sorted_captures[k]->Index, sorted_captures[k]->Length );
+					}
+				}
+			}
+
+			if( g == 0 && has_pattern_group )
+			{
+				// tell which of patterns matched
+				builder.AddGroup( groups[0], groups[1], name_ids[pattern][pattern_names.PatternName] );
+			}
+		}
+	}
+
+	builder.Release( results );
+}
+
+
+extern "C" OnigurumaCoreRegex* OnigurumaCoreCompile( const char16_t* pattern, size_t length, const OnigurumaCoreOptions* options, RegexCoreError* error )
+{
+	try
+	{
+		int r = InitializeOniguruma( );
+
+		if( r != ONIG_NORMAL )
+		{
+			char s[ONIG_MAX_ERROR_MESSAGE_LEN];
+			onig_error_code_to_str( (OnigUChar*)s, r );
+
+			SetOnigurumaError( error, r, s );
+
+			return nullptr;
+		}
+
+		std::unique_ptr<OnigurumaCoreRegex> regex( new OnigurumaCoreRegex );
+
+		onig_copy_syntax( &regex->Syntax, options->Syntax != nullptr ? options->Syntax : ONIG_SYNTAX_ONIGURUMA );
+
+		regex->SearchOptions = options->SearchOptions;
+		regex->Limits.RetryLimitInMatch = options->RetryLimitInMatch;
+		regex->Limits.RetryLimitInSearch = options->RetryLimitInSearch;
+		regex->Limits.MatchStackLimit = options->MatchStackLimit;
+
+		regex_t* reg;
+		std::string message;
+
+		r = NativeCompile( &reg, pattern, length, options->CompileOptions,
+			options->Encoding != nullptr ? options->Encoding : ONIG_ENCODING_UTF16_LE, &regex->Syntax, &message );
+
+		if( r != ONIG_NORMAL )
+		{
+			SetOnigurumaError( error, r, message );
+
+			return nullptr;
+		}
+
+		regex->Regex.reset( reg, &onig_free );
+		regex->Prefilter = NativeCreateLiteralPrefilter( reg, pattern, length, &regex->Syntax );
+
+		// the capture history is only available for the groups enabled by 'ONIG_SYN_OP2_ATMARK_CAPTURE_HISTORY'
+		regex->HasCaptureHistory = onig_number_of_capture_histories( reg ) > 0;
+
+		regex->Names.resize( 1 );
+		OnigurumaCoreResolveNames( reg, &regex->Names[0] );
+
+		return regex.release( );
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return nullptr;
+	}
+}
+
+
+extern "C" int32_t OnigurumaCoreScan( const OnigurumaCoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+	RegexCoreResults* results, RegexCoreError* error )
+{
+	*results = RegexCoreResults{ };
+
+	try
+	{
+		NativeScanTask* task = NativeStartScan( regex->Regex, regex->Prefilter, text, length, regex->SearchOptions, regex->HasCaptureHistory, regex->Limits );
+
+		while( !NativeWaitScan( task, 33 ) )
+		{
+			if( cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context ) )
+			{
+				NativeCancelScan( task );
+
+				return REGEX_CORE_CANCELLED;
+			}
+		}
+
+		NativeScanResults native_results;
+		std::string native_error;
+
+		int r = NativeFinishScan( task, &native_results, &native_error );
+
+		if( !native_error.empty( ) )
+		{
+			SetRegexCoreError( error, native_error.c_str( ) );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		if( r < 0 )
+		{
+			if( r == ONIG_ABORT ) return REGEX_CORE_CANCELLED; // (it is also returned if the scan was cancelled in time)
+
+			char s[ONIG_MAX_ERROR_MESSAGE_LEN];
+			onig_error_code_to_str( (OnigUChar*)s, r );
+
+			SetOnigurumaError( error, r, s );
+
+			bool const limit = r == ONIGERR_RETRY_LIMIT_IN_MATCH_OVER || r == ONIGERR_RETRY_LIMIT_IN_SEARCH_OVER || r == ONIGERR_MATCH_STACK_LIMIT_OVER;
+
+			return limit ? REGEX_CORE_LIMIT : REGEX_CORE_ERROR;
+		}
+
+		OnigurumaCoreBuildResults( native_results, regex->Names, results );
+
+		return REGEX_CORE_OK;
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return REGEX_CORE_ERROR;
+	}
+}
+
+
+extern "C" void OnigurumaCoreFree( OnigurumaCoreRegex* regex )
+{
+	delete regex;
+}
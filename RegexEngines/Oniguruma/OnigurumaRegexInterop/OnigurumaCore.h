@@ -0,0 +1,74 @@
+#pragma once
+
+// The portable core of Oniguruma interop (see "RegexCore.h"), over the scan tasks of "NativeMatcher.h".
+// It covers a single pattern in UTF-16 text; RegSet and the search in files are used by 'Matcher' directly,
+// which shares the names and the results of the core (see the C++ part below).
+
+#include "../../NativeInfrastructure/RegexCore.h"
+
+#include "Oniguruma-min/src/oniguruma.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	typedef struct OnigurumaCoreOptions
+	{
+		OnigOptionType CompileOptions;
+		OnigOptionType SearchOptions;
+		OnigEncoding Encoding; // ('ONIG_ENCODING_UTF16_LE' or 'ONIG_ENCODING_UTF8'; null -- UTF-16LE)
+		OnigSyntaxType* Syntax; // (copied; null -- 'ONIG_SYNTAX_ONIGURUMA')
+		unsigned long RetryLimitInMatch; // (0 -- unlimited)
+		unsigned long RetryLimitInSearch; // (0 -- unlimited)
+		unsigned int MatchStackLimit; // (0 -- unlimited)
+		// (when a limit is exceeded, the scan returns 'REGEX_CORE_LIMIT')
+	} OnigurumaCoreOptions;
+
+
+	typedef struct OnigurumaCoreRegex OnigurumaCoreRegex;
+
+
+	// Also initializes Oniguruma for both encodings, unless it is initialized already.
+	OnigurumaCoreRegex* OnigurumaCoreCompile( const char16_t* pattern, size_t length, const OnigurumaCoreOptions* options, RegexCoreError* error );
+
+	// The captures are the history of the groups enabled by 'ONIG_SYN_OP2_ATMARK_CAPTURE_HISTORY'.
+	int32_t OnigurumaCoreScan( const OnigurumaCoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+		RegexCoreResults* results, RegexCoreError* error );
+
+	void OnigurumaCoreFree( OnigurumaCoreRegex* regex );
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#ifdef __cplusplus
+
+#include <string>
+#include <vector>
+
+
+namespace OnigurumaRegexInterop
+{
+	struct NativeScanResults;
+
+
+	// The group names of a compiled pattern, resolved once.
+	struct OnigurumaCoreNames
+	{
+		std::vector<std::u16string> Names;
+		std::vector<int32_t> GroupNames; // (the index in 'Names', by group number; -1 -- no name)
+		int32_t PatternName = -1; // (RegSet: the index in 'Names' of the group that tells which pattern matched)
+	};
+
+
+	void OnigurumaCoreResolveNames( regex_t* regex, OnigurumaCoreNames* names );
+
+	// Converts the results of a finished scan; 'names' has an item for each pattern of RegSet, or one item.
+	// The groups without names are named by number when the pattern group shifts them.
+	void OnigurumaCoreBuildResults( const NativeScanResults& nativeResults, const std::vector<OnigurumaCoreNames>& names, RegexCoreResults* results );
+}
+
+#endif
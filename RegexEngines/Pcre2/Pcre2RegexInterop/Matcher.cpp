@@ -1,16 +1,27 @@
 #include "pch.h"
 
+#include "Pcre2Core.h"
+#include "../../NativeInfrastructure/CompiledPatternCache.h"
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/RegexCoreMatches.h"
 #include "Matcher.h"
 
 
 using namespace System::Diagnostics;
 
-using namespace msclr::interop;
+using namespace NativeInfrastructure;
 
 
 namespace Pcre2RegexInterop
 {
 
+	// (called by the cache of compiled patterns)
+	static void FreeRegex( void* regex )
+	{
+		Pcre2CoreFree( static_cast<Pcre2CoreRegex*>( regex ) );
+	}
+
+
 	static Matcher::Matcher( )
 	{
 		BuildOptions( );
@@ -18,13 +29,11 @@ namespace Pcre2RegexInterop
 
 
 	Matcher::Matcher( String^ pattern0, cli::array<String^>^ options )
-		: mData( nullptr )
+		: mRegex( nullptr )
 	{
 		try
 		{
-			marshal_context context{};
-
-			const wchar_t* pattern = context.marshal_as<const wchar_t*>( pattern0 );
+			TraceSpan options_span( "pcre2", "options" );
 
 			int compile_options = 0;
 
@@ -56,41 +65,36 @@ namespace Pcre2RegexInterop
 				}
 			}
 
-			mData = new MatcherData{};
+			Pcre2CoreOptions core_options{};
 
-			mData->mAlgorithm = Array::IndexOf( options, "DFA" ) >= 0 ? Algorithm::DFA : Algorithm::Standard;
-			mData->mMatcherOptions = matcher_options;
+			core_options.CompileOptions = compile_options;
+			core_options.ExtraCompileOptions = extra_compile_options;
+			core_options.MatchOptions = matcher_options;
+			core_options.Algorithm = Array::IndexOf( options, "DFA" ) >= 0 ? PCRE2_CORE_DFA : PCRE2_CORE_STANDARD;
 
-			mData->mCompileContext = pcre2_compile_context_create( NULL );
-			if( mData->mCompileContext == nullptr )
-			{
-				throw gcnew Exception( "Failed to create compile context." );
-			}
-
-			pcre2_set_compile_extra_options( mData->mCompileContext, extra_compile_options );
+			options_span.End( );
 
-			int errornumber;
-			PCRE2_SIZE erroroffset;
+			pin_ptr<const wchar_t> pinned_pattern = PtrToStringChars( pattern0 );
+			const char16_t* native_pattern = reinterpret_cast<const char16_t*>( pinned_pattern );
+			std::string const cache_key = MakeCompiledPatternKey( "pcre2", &core_options, sizeof( core_options ), native_pattern, pattern0->Length );
 
-			pcre2_code* re = pcre2_compile(
-				reinterpret_cast<PCRE2_SPTR16>( pattern ), /* the pattern */
-				PCRE2_ZERO_TERMINATED, /* indicates pattern is zero-terminated */
-				compile_options,       /* options */
-				&errornumber,          /* for error number */
-				&erroroffset,          /* for error offset */
-				mData->mCompileContext ); /* compile context */
+			mRegex = static_cast<Pcre2CoreRegex*>( AcquireCompiledPattern( cache_key ) );
 
-			if( re == nullptr )
+			if( mRegex == nullptr )
 			{
-				PCRE2_UCHAR buffer[256];
-				pcre2_get_error_message( errornumber, buffer, _countof( buffer ) );
+				RegexCoreError error{};
 
-				String^ message = gcnew String( reinterpret_cast<wchar_t*>( buffer ) );
+				TraceSpan compile_span( "pcre2", "compile", pattern0->Length );
+				mRegex = Pcre2CoreCompile( native_pattern, pattern0->Length, &core_options, &error );
+				compile_span.End( );
 
-				throw gcnew Exception( String::Format( "Error {0} at {1}: {2}.", errornumber, erroroffset, message ) );
-			}
+				if( mRegex == nullptr )
+				{
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
+				}
 
-			mData->mRe = re;
+				AddCompiledPattern( cache_key, mRegex, Pcre2CoreGetSize( mRegex ), &FreeRegex );
+			}
 		}
 		catch( const std::exception & exc )
 		{
@@ -117,8 +121,8 @@ namespace Pcre2RegexInterop
 
 	Matcher::!Matcher( )
 	{
-		delete mData;
-		mData = nullptr;
+		ReleaseCompiledPattern( mRegex ); // (the pattern can remain in the cache)
+		mRegex = nullptr;
 	}
 
 
@@ -128,249 +132,37 @@ namespace Pcre2RegexInterop
 	}
 
 
-	RegexMatches^ Matcher::Matches( String^ text0, ICancellable^ cnc )
+	RegexMatches^ Matcher::Matches( String^ text, ICancellable^ cnc )
 	{
 		try
 		{
-			auto matches = gcnew List<IMatch^>( );
-
-			marshal_context context{};
-
-			mData->mText = context.marshal_as<std::wstring>( text0 );
-
-			mData->mMatchContext = pcre2_match_context_create( NULL );
-			if( mData->mMatchContext == nullptr )
-			{
-				throw gcnew Exception( "Failed to create match context" );
-			}
+			mText = text;
 
-			int rc;
+			pin_ptr<const wchar_t> pinned_text = PtrToStringChars( text );
+			RegexCoreManagedCancellation cancellation( cnc );
+			RegexCoreResults results{};
+			RegexCoreError error{};
 
-			switch( mData->mAlgorithm )
-			{
-			case Algorithm::DFA:
-			{
-				mData->mDfaWorkspace.resize( 1000 ); // (see 'pcre2test.c')
-				mData->mMatchData = pcre2_match_data_create( 1000, NULL );
-
-				rc = pcre2_dfa_match(
-					mData->mRe,           /* the compiled pattern */
-					reinterpret_cast<PCRE2_SPTR16>( mData->mText.c_str( ) ),  /* the subject string */
-					PCRE2_ZERO_TERMINATED,  /* the length of the subject */
-					0,                       /* start at offset 0 in the subject */
-					mData->mMatcherOptions,  /* options */
-					mData->mMatchData,       /* block for storing the result */
-					mData->mMatchContext,    /* match context */
-					mData->mDfaWorkspace.data( ),
-					mData->mDfaWorkspace.size( )
-				);
-			}
-			break;
+			TraceSpan scan_span( "pcre2", "scan", text->Length );
+			int32_t r = Pcre2CoreScan( mRegex, reinterpret_cast<const char16_t*>( pinned_text ), text->Length, cancellation.Get( ), &results, &error );
+			scan_span.End( );
 
-			case Algorithm::Standard:
-			default:
+			try
 			{
-				mData->mMatchData = pcre2_match_data_create_from_pattern( mData->mRe, NULL );
-				rc = pcre2_match(
-					mData->mRe,           /* the compiled pattern */
-					reinterpret_cast<PCRE2_SPTR16>( mData->mText.c_str( ) ),  /* the subject string */
-					PCRE2_ZERO_TERMINATED,  /* the length of the subject */
-					0,                       /* start at offset 0 in the subject */
-					mData->mMatcherOptions,  /* options */
-					mData->mMatchData,       /* block for storing the result */
-					mData->mMatchContext     /* match context */
-				);
-			}
-			break;
-			}
-
-			if( rc < 0 )
-			{
-				switch( rc )
+				switch( r )
 				{
-				case PCRE2_ERROR_NOMATCH:
-					// no matches
+				case REGEX_CORE_OK:
+					return RegexCoreResultsToMatches( results, this, -1, "pcre2" );
+				case REGEX_CORE_CANCELLED:
 					return RegexMatches::Empty;
 				default:
-				{
-					PCRE2_UCHAR buffer[256];
-					pcre2_get_error_message( rc, buffer, _countof( buffer ) );
-
-					String^ message = gcnew String( reinterpret_cast<wchar_t*>( buffer ) );
-
-					throw gcnew Exception( String::Format( "Error {0}: {1}.", rc, message ) );
-				}
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
 				}
 			}
-
-			if( rc == 0 )
-			{
-				throw gcnew Exception( "'ovector' was not big enough for all the captured substrings" );
-			}
-
-			PCRE2_SIZE* ovector = pcre2_get_ovector_pointer( mData->mMatchData );
-
-			if( ovector[0] > ovector[1] )
+			finally
 			{
-				// TODO: show more details; see 'pcre2demo.c'
-				throw gcnew Exception( "\\K was used in an assertion to set the match start after its end." );
+				RegexCoreFreeResults( &results );
 			}
-
-			auto match = CreateMatch( mData->mRe, ovector, rc );
-			matches->Add( match );
-
-			// find next matches
-
-			{
-				const auto& re = mData->mRe;
-				const auto& match_data = mData->mMatchData;
-				const wchar_t* subject = mData->mText.c_str( );
-				auto subject_length = mData->mText.length( );
-
-
-				// their tricky stuffs; code and comments are from 'pcre2demo.c'
-
-				uint32_t option_bits;
-				uint32_t newline;
-				int crlf_is_newline;
-				int utf8;
-
-				/* Before running the loop, check for UTF-8 and whether CRLF is a valid newline
-				sequence. First, find the options with which the regex was compiled and extract
-				the UTF state. */
-
-				(void)pcre2_pattern_info( re, PCRE2_INFO_ALLOPTIONS, &option_bits );
-				utf8 = ( option_bits & PCRE2_UTF ) != 0;
-
-				/* Now find the newline convention and see whether CRLF is a valid newline
-				sequence. */
-
-				(void)pcre2_pattern_info( re, PCRE2_INFO_NEWLINE, &newline );
-				crlf_is_newline = newline == PCRE2_NEWLINE_ANY ||
-					newline == PCRE2_NEWLINE_CRLF ||
-					newline == PCRE2_NEWLINE_ANYCRLF;
-
-				/* Loop for second and subsequent matches */
-
-				for( ;;)
-				{
-					uint32_t options = 0;                   /* Normally no options */
-					PCRE2_SIZE start_offset = ovector[1];   /* Start at end of previous match */
-
-					/* If the previous match was for an empty string, we are finished if we are
-					at the end of the subject. Otherwise, arrange to run another match at the
-					same point to see if a non-empty match can be found. */
-
-					if( ovector[0] == ovector[1] )
-					{
-						if( ovector[0] == subject_length ) break;
-						options = PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
-					}
-
-					/* If the previous match was not an empty string, there is one tricky case to
-					consider. If a pattern contains \K within a lookbehind assertion at the
-					start, the end of the matched string can be at the offset where the match
-					started. Without special action, this leads to a loop that keeps on matching
-					the same substring. We must detect this case and arrange to move the start on
-					by one character. The pcre2_get_startchar() function returns the starting
-					offset that was passed to pcre2_match(). */
-
-					else
-					{
-						PCRE2_SIZE startchar = pcre2_get_startchar( match_data );
-						if( start_offset <= startchar )
-						{
-							if( startchar >= subject_length ) break;   /* Reached end of subject.   */
-							start_offset = startchar + 1;             /* Advance by one character. */
-							if( utf8 )                                 /* If UTF-8, it may be more  */
-							{                                       /*   than one code unit.     */
-								for( ; start_offset < subject_length; start_offset++ )
-									if( ( subject[start_offset] & 0xc0 ) != 0x80 ) break;
-							}
-						}
-					}
-
-					/* Run the next matching operation */
-
-					rc = pcre2_match(
-						re,                   /* the compiled pattern */
-						reinterpret_cast<PCRE2_SPTR16>( subject ),              /* the subject string */
-						subject_length,       /* the length of the subject */
-						start_offset,         /* starting offset in the subject */
-						options,              /* options */
-						match_data,           /* block for storing the result */
-						NULL );                /* use default match context */
-
-					  /* This time, a result of NOMATCH isn't an error. If the value in "options"
-					  is zero, it just means we have found all possible matches, so the loop ends.
-					  Otherwise, it means we have failed to find a non-empty-string match at a
-					  point where there was a previous empty-string match. In this case, we do what
-					  Perl does: advance the matching position by one character, and continue. We
-					  do this by setting the "end of previous match" offset, because that is picked
-					  up at the top of the loop as the point at which to start again.
-
-					  There are two complications: (a) When CRLF is a valid newline sequence, and
-					  the current position is just before it, advance by an extra byte. (b)
-					  Otherwise we must ensure that we skip an entire UTF character if we are in
-					  UTF mode. */
-
-					if( rc == PCRE2_ERROR_NOMATCH )
-					{
-						if( options == 0 ) break;                    /* All matches found */
-						ovector[1] = start_offset + 1;              /* Advance one code unit */
-						if( crlf_is_newline &&                      /* If CRLF is a newline & */
-							start_offset < subject_length - 1 &&    /* we are at CRLF, */
-							subject[start_offset] == '\r' &&
-							subject[start_offset + 1] == '\n' )
-							ovector[1] += 1;                          /* Advance by one more. */
-						else if( utf8 )                              /* Otherwise, ensure we */
-						{                                         /* advance a whole UTF-8 */
-							while( ovector[1] < subject_length )       /* character. */
-							{
-								if( ( subject[ovector[1]] & 0xc0 ) != 0x80 ) break;
-								ovector[1] += 1;
-							}
-						}
-						continue;    /* Go round the loop again */
-					}
-
-					/* Other matching errors are not recoverable. */
-
-					if( rc < 0 )
-					{
-						PCRE2_UCHAR buffer[256];
-						pcre2_get_error_message( rc, buffer, _countof( buffer ) );
-
-						String^ message = gcnew String( reinterpret_cast<wchar_t*>( buffer ) );
-
-						throw gcnew Exception( String::Format( "Error {0}: {1}.", rc, message ) );
-					}
-
-					/* Match succeded */
-
-
-					/* The match succeeded, but the output vector wasn't big enough. This
-					should not happen. */
-
-					if( rc == 0 )
-					{
-						throw gcnew Exception( "'ovector' was not big enough for all the captured substrings" );
-					}
-
-					if( ovector[0] > ovector[1] )
-					{
-						// TODO: show more details; see 'pcre2demo.c'
-						throw gcnew Exception( "\\K was used in an assertion to set the match start after its end." );
-					}
-
-					auto match = CreateMatch( mData->mRe, ovector, rc );
-					matches->Add( match );
-
-				} /* End of loop to find second and subsequent matches */
-			}
-
-
-			return gcnew RegexMatches( matches->Count, matches );
 		}
 		catch( const std::exception & exc )
 		{
@@ -391,87 +183,7 @@ namespace Pcre2RegexInterop
 
 	String^ Matcher::GetText( int index, int length )
 	{
-		return gcnew String( mData->mText.c_str( ), index, length );
-	}
-
-
-	IMatch^ Matcher::CreateMatch( pcre2_code* re, PCRE2_SIZE* ovector, int rc )
-	{
-		if( ovector[0] > ovector[1] )
-		{
-			// TODO: show more details; see 'pcre2demo.c'
-			throw gcnew Exception( "\\K was used in an assertion to set the match start after its end." );
-		}
-
-		auto match = SimpleMatch::Create( CheckedCast::ToInt32n( ovector[0] ), CheckedCast::ToInt32( ovector[1] - ovector[0] ), this );
-
-		// add all groups; the names will be put later
-		// group [0] is the whole match
-
-		for( int i = 0; i < rc; ++i )
-		{
-			auto index = CheckedCast::ToInt32n( ovector[2 * i] );
-			auto length = CheckedCast::ToInt32( ovector[2 * i + 1] - ovector[2 * i] );
-
-			match->AddGroup( index, length, index >= 0, i.ToString( System::Globalization::CultureInfo::InvariantCulture ) );
-		}
-
-		// add failed groups not included in 'rc'
-		{
-			uint32_t capturecount;
-
-			if( pcre2_pattern_info(
-				re,
-				PCRE2_INFO_CAPTURECOUNT,
-				&capturecount ) == 0 )
-			{
-				int total_captures = CheckedCast::ToInt32( capturecount );
-				for( int i = rc; i <= total_captures; ++i )
-				{
-					match->AddGroup( -1, 0, false, i.ToString( System::Globalization::CultureInfo::InvariantCulture ) );
-				}
-			}
-		}
-
-		uint32_t namecount;
-
-		(void)pcre2_pattern_info(
-			re,                   /* the compiled pattern */
-			PCRE2_INFO_NAMECOUNT, /* get the number of named substrings */
-			&namecount );         /* where to put the answer */
-
-		if( namecount > 0 )
-		{
-			PCRE2_SPTR name_table;
-			uint32_t name_entry_size;
-			PCRE2_SPTR tabptr;
-
-			(void)pcre2_pattern_info(
-				re,                       /* the compiled pattern */
-				PCRE2_INFO_NAMETABLE,     /* address of the table */
-				&name_table );            /* where to put the answer */
-
-			(void)pcre2_pattern_info(
-				re,                       /* the compiled pattern */
-				PCRE2_INFO_NAMEENTRYSIZE, /* size of each entry in the table */
-				&name_entry_size );       /* where to put the answer */
-
-			tabptr = name_table;
-			int total_names = CheckedCast::ToInt32( namecount );
-			for( int i = 0; i < total_names; i++ )
-			{
-				int n = *( (__int16*)tabptr );
-
-				String^ name = gcnew String( reinterpret_cast<const wchar_t*>( ( (__int16*)tabptr ) + 1 ), 0, name_entry_size - 2 );
-				name = name->TrimEnd( '\0' );
-
-				match->SetGroupName( n, name );
-
-				tabptr += name_entry_size;
-			}
-		}
-
-		return match;
+		return mText->Substring( index, length );
 	}
 
 
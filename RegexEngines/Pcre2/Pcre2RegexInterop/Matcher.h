@@ -29,64 +29,6 @@ namespace Pcre2RegexInterop
 	};
 
 
-	enum class Algorithm
-	{
-		Standard,
-		DFA,
-	};
-
-
-	struct MatcherData
-	{
-		Algorithm mAlgorithm;
-		std::wstring mText;
-
-		pcre2_compile_context* mCompileContext;
-		pcre2_code* mRe;
-		pcre2_match_context* mMatchContext;
-		pcre2_match_data* mMatchData;
-		int mMatcherOptions;
-		std::vector<int> mDfaWorkspace;
-
-		MatcherData( )
-		{
-			mAlgorithm = Algorithm::Standard;
-			mCompileContext = nullptr;
-			mRe = nullptr;
-			mMatchContext = nullptr;
-			mMatchData = nullptr;
-			mMatcherOptions = 0;
-		}
-
-		~MatcherData( )
-		{
-			if( mMatchContext )
-			{
-				pcre2_match_context_free( mMatchContext );
-				mMatchContext = nullptr;
-			}
-
-			if( mMatchData )
-			{
-				pcre2_match_data_free( mMatchData );
-				mMatchData = nullptr;
-			}
-
-			if( mRe )
-			{
-				pcre2_code_free( mRe );
-				mRe = nullptr;
-			}
-
-			if( mCompileContext )
-			{
-				pcre2_compile_context_free( mCompileContext );
-				mCompileContext = nullptr;
-			}
-		}
-	};
-
-
 	public ref class Matcher : IMatcher, ISimpleTextGetter
 	{
 	public:
@@ -120,13 +62,13 @@ namespace Pcre2RegexInterop
 
 	private:
 
-		MatcherData* mData;
+		Pcre2CoreRegex* mRegex;
+		String^ mText;
 
 		static List<OptionInfo^>^ mCompileOptions;
 		static List<OptionInfo^>^ mExtraCompileOptions;
 		static List<OptionInfo^>^ mMatchOptions;
 
-		IMatch^ CreateMatch( pcre2_code* re, PCRE2_SIZE* ovector, int rc );
 		static void BuildOptions( );
 	};
 
@@ -0,0 +1,446 @@
+// The portable core of PCRE2 interop. Compiled without the managed code and with "pch-pcre2.h" forced.
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pcre2.h"
+
+#include "Pcre2Core.h"
+#include "../../NativeInfrastructure/LiteralSearch.h"
+#include "../../NativeInfrastructure/Utf8Text.h"
+
+#ifdef REGEX_CORE_COUNT_ALLOCATIONS
+#	include "../../NativeInfrastructure/AllocationCounter.h"
+#endif
+
+
+using namespace NativeInfrastructure;
+
+
+struct Pcre2CoreRegex
+{
+	pcre2_general_context* GeneralContext = nullptr; // (null -- 'malloc' and 'free')
+	pcre2_compile_context* CompileContext = nullptr;
+	pcre2_match_context* MatchContext = nullptr; // (null -- the defaults)
+	pcre2_code* Code = nullptr;
+	uint32_t MatchOptions = 0;
+	int32_t Algorithm = PCRE2_CORE_STANDARD;
+
+	bool Utf = false;
+	bool CrlfIsNewline = false;
+	uint32_t CaptureCount = 0;
+	std::vector<std::pair<uint32_t, std::u16string>> Names; // (group number and name; see 'PCRE2_INFO_NAMETABLE')
+	std::unique_ptr<LiteralSearcher> Literal; // (not null -- the matches are found without PCRE2; see "LiteralSearch.h")
+
+	~Pcre2CoreRegex( )
+	{
+		if( Code ) pcre2_code_free( Code );
+		if( MatchContext ) pcre2_match_context_free( MatchContext );
+		if( CompileContext ) pcre2_compile_context_free( CompileContext );
+		if( GeneralContext ) pcre2_general_context_free( GeneralContext );
+	}
+};
+
+
+static std::string GetPcre2ErrorMessage( int errorcode )
+{
+	PCRE2_UCHAR buffer[256];
+
+	int length = pcre2_get_error_message( errorcode, buffer, sizeof( buffer ) / sizeof( buffer[0] ) );
+	if( length < 0 ) return "Unknown error";
+
+	std::string message;
+	AppendUtf8( &message, reinterpret_cast<const char16_t*>( buffer ), static_cast<size_t>( length ) );
+
+	return message;
+}
+
+
+// Sets the error text: "<prefix>: <message of PCRE2>."
+static void SetPcre2Error( RegexCoreError* error, const char* prefix, int errorcode )
+{
+	std::string text = prefix;
+
+	text += ": ";
+	text += GetPcre2ErrorMessage( errorcode );
+	text += ".";
+
+	SetRegexCoreError( error, text.c_str( ) );
+}
+
+
+// Returns the searcher if the literal search finds the same matches as PCRE2, otherwise null.
+static std::unique_ptr<LiteralSearcher> MakeLiteralSearcher( const char16_t* pattern, size_t length, const Pcre2CoreOptions* options, bool utf )
+{
+	// the options that do not change the meaning of a literal; the anchoring, the extended syntax,
+	// the extra options, the options of matching and the limits are not supported
+
+	uint32_t const neutral_options = PCRE2_LITERAL | PCRE2_CASELESS | PCRE2_MULTILINE | PCRE2_DOTALL | PCRE2_DOLLAR_ENDONLY |
+		PCRE2_UNGREEDY | PCRE2_NO_AUTO_CAPTURE | PCRE2_DUPNAMES | PCRE2_NO_AUTO_POSSESS | PCRE2_NO_DOTSTAR_ANCHOR | PCRE2_NO_START_OPTIMIZE |
+		PCRE2_UTF | PCRE2_UCP | PCRE2_NEVER_UTF | PCRE2_NEVER_UCP | PCRE2_NEVER_BACKSLASH_C | PCRE2_ALLOW_EMPTY_CLASS |
+		PCRE2_ALT_BSUX | PCRE2_ALT_CIRCUMFLEX | PCRE2_ALT_VERBNAMES | PCRE2_MATCH_UNSET_BACKREF;
+
+	if( ( options->CompileOptions & ~neutral_options ) != 0 || options->ExtraCompileOptions != 0 ||
+		options->MatchOptions != 0 || options->MatchLimit != 0 ) return nullptr;
+
+	bool const literal = ( options->CompileOptions & PCRE2_LITERAL ) != 0 ? length > 0 : IsLiteralPattern( pattern, length );
+	if( !literal ) return nullptr;
+
+	// (with UTF or UCP, the case folding is by Unicode; otherwise by the default tables, which are ASCII)
+	bool const caseless = ( options->CompileOptions & PCRE2_CASELESS ) != 0;
+	if( caseless && !IsAsciiCaseFoldable( pattern, length ) ) return nullptr;
+
+	if( utf && HasUnpairedSurrogates( pattern, length ) ) return nullptr;
+
+	return std::unique_ptr<LiteralSearcher>( new LiteralSearcher( pattern, length, caseless ) );
+}
+
+
+extern "C" Pcre2CoreRegex* Pcre2CoreCompile( const char16_t* pattern, size_t length, const Pcre2CoreOptions* options, RegexCoreError* error )
+{
+	try
+	{
+		std::unique_ptr<Pcre2CoreRegex> regex( new Pcre2CoreRegex );
+
+		regex->MatchOptions = options->MatchOptions;
+		regex->Algorithm = options->Algorithm;
+
+#ifdef REGEX_CORE_COUNT_ALLOCATIONS
+		regex->GeneralContext = pcre2_general_context_create(
+			[]( PCRE2_SIZE size, void* ) { return RegexCoreCountedMalloc( size ); },
+			[]( void* block, void* ) { RegexCoreCountedFree( block ); },
+			nullptr );
+		if( regex->GeneralContext == nullptr )
+		{
+			SetRegexCoreError( error, "Failed to create general context." );
+
+			return nullptr;
+		}
+#endif
+
+		regex->CompileContext = pcre2_compile_context_create( regex->GeneralContext );
+		if( regex->CompileContext == nullptr )
+		{
+			SetRegexCoreError( error, "Failed to create compile context." );
+
+			return nullptr;
+		}
+
+		pcre2_set_compile_extra_options( regex->CompileContext, options->ExtraCompileOptions );
+
+		// (the heap frames of 'pcre2_match' are allocated by the memory functions of the match context)
+
+		if( options->MatchLimit != 0 || regex->GeneralContext != nullptr )
+		{
+			regex->MatchContext = pcre2_match_context_create( regex->GeneralContext );
+			if( regex->MatchContext == nullptr )
+			{
+				SetRegexCoreError( error, "Failed to create match context." );
+
+				return nullptr;
+			}
+
+			if( options->MatchLimit != 0 ) pcre2_set_match_limit( regex->MatchContext, options->MatchLimit );
+		}
+
+		int errornumber;
+		PCRE2_SIZE erroroffset;
+
+		regex->Code = pcre2_compile( reinterpret_cast<PCRE2_SPTR16>( pattern ), length, options->CompileOptions,
+			&errornumber, &erroroffset, regex->CompileContext );
+
+		if( regex->Code == nullptr )
+		{
+			char prefix[64];
+			snprintf( prefix, sizeof( prefix ), "Error %d at %zu", errornumber, static_cast<size_t>( erroroffset ) );
+
+			SetPcre2Error( error, prefix, errornumber );
+
+			return nullptr;
+		}
+
+		if( regex->Algorithm == PCRE2_CORE_JIT )
+		{
+			int rc = pcre2_jit_compile( regex->Code, PCRE2_JIT_COMPLETE );
+
+			if( rc < 0 )
+			{
+				SetPcre2Error( error, "JIT compilation failed", rc );
+
+				return nullptr;
+			}
+		}
+
+		// the details that are needed by the loop of 'Pcre2CoreScan' (see 'pcre2demo.c')
+
+		uint32_t option_bits;
+		uint32_t newline;
+
+		(void)pcre2_pattern_info( regex->Code, PCRE2_INFO_ALLOPTIONS, &option_bits );
+		regex->Utf = ( option_bits & PCRE2_UTF ) != 0;
+
+		(void)pcre2_pattern_info( regex->Code, PCRE2_INFO_NEWLINE, &newline );
+		regex->CrlfIsNewline = newline == PCRE2_NEWLINE_ANY || newline == PCRE2_NEWLINE_CRLF || newline == PCRE2_NEWLINE_ANYCRLF;
+
+		(void)pcre2_pattern_info( regex->Code, PCRE2_INFO_CAPTURECOUNT, &regex->CaptureCount );
+
+		// the names of groups
+
+		uint32_t namecount;
+		(void)pcre2_pattern_info( regex->Code, PCRE2_INFO_NAMECOUNT, &namecount );
+
+		if( namecount > 0 )
+		{
+			PCRE2_SPTR name_table;
+			uint32_t name_entry_size;
+
+			(void)pcre2_pattern_info( regex->Code, PCRE2_INFO_NAMETABLE, &name_table );
+			(void)pcre2_pattern_info( regex->Code, PCRE2_INFO_NAMEENTRYSIZE, &name_entry_size );
+
+			// each entry is the group number, then the zero-terminated name, padded to 'name_entry_size' units
+
+			for( PCRE2_SPTR entry = name_table; namecount > 0; --namecount, entry += name_entry_size )
+			{
+				const char16_t* name = reinterpret_cast<const char16_t*>( entry + 1 );
+
+				regex->Names.emplace_back( entry[0], std::u16string( name, std::char_traits<char16_t>::length( name ) ) );
+			}
+		}
+
+#ifndef REGEX_CORE_NO_LITERAL_SEARCH
+		if( IsLiteralSearchEnabled( ) ) regex->Literal = MakeLiteralSearcher( pattern, length, options, regex->Utf );
+#endif
+
+		return regex.release( );
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return nullptr;
+	}
+}
+
+
+extern "C" int32_t Pcre2CoreScan( const Pcre2CoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+	RegexCoreResults* results, RegexCoreError* error )
+{
+	*results = RegexCoreResults{ };
+
+	pcre2_match_data* match_data = nullptr;
+
+	try
+	{
+		RegexCoreResultsBuilder builder;
+
+		// (in UTF mode, PCRE2 fails if the text is not valid; the error is given by PCRE2)
+
+		if( regex->Literal != nullptr && !( regex->Utf && HasUnpairedSurrogates( text, length ) ) )
+		{
+			int32_t const rc = regex->Literal->FindAll( text, length, cancellation, &builder );
+
+			if( rc == REGEX_CORE_OK ) builder.Release( results );
+
+			return rc;
+		}
+
+		// names, by group number
+
+		std::vector<int32_t> group_names( regex->CaptureCount + 1, -1 );
+
+		for( const auto& n : regex->Names )
+		{
+			if( n.first < group_names.size( ) ) group_names[n.first] = builder.AddName( n.second.data( ), n.second.size( ) );
+		}
+
+		bool const dfa = regex->Algorithm == PCRE2_CORE_DFA;
+		std::vector<int> dfa_workspace;
+
+		if( dfa )
+		{
+			dfa_workspace.resize( 1000 ); // (see 'pcre2test.c')
+			match_data = pcre2_match_data_create( 1000, regex->GeneralContext );
+		}
+		else
+		{
+			match_data = pcre2_match_data_create_from_pattern( regex->Code, regex->GeneralContext );
+		}
+
+		if( match_data == nullptr )
+		{
+			SetRegexCoreError( error, "Failed to create match data." );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		PCRE2_SPTR16 subject = reinterpret_cast<PCRE2_SPTR16>( text );
+		PCRE2_SIZE* ovector = pcre2_get_ovector_pointer( match_data );
+		PCRE2_SIZE start_offset = 0;
+		uint32_t loop_options = 0;
+		uint32_t check_options = 0;
+
+		// the loop is from 'pcre2demo.c'; the first and the subsequent matches are found by the same algorithm
+
+		for( ;;)
+		{
+			if( cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context ) )
+			{
+				pcre2_match_data_free( match_data );
+
+				return REGEX_CORE_CANCELLED;
+			}
+
+			int rc = dfa ?
+				pcre2_dfa_match( regex->Code, subject, length, start_offset, regex->MatchOptions | loop_options | check_options, match_data, regex->MatchContext,
+					dfa_workspace.data( ), dfa_workspace.size( ) ) :
+				pcre2_match( regex->Code, subject, length, start_offset, regex->MatchOptions | loop_options | check_options, match_data, regex->MatchContext );
+
+			// (the validity of UTF is checked by the first call only; otherwise each call checks the whole subject)
+			check_options = PCRE2_NO_UTF_CHECK;
+
+			if( rc == PCRE2_ERROR_NOMATCH )
+			{
+				/* If the value in "options" is zero, it just means we have found all possible matches.
+				Otherwise, we have failed to find a non-empty-string match at a point where there was
+				a previous empty-string match. In this case, we do what Perl does: advance the matching
+				position by one character, and continue. */
+
+				if( loop_options == 0 ) break;
+
+				loop_options = 0;
+				++start_offset;
+
+				if( regex->CrlfIsNewline && start_offset < length && text[start_offset - 1] == u'\r' && text[start_offset] == u'\n' )
+				{
+					++start_offset;
+				}
+				else if( regex->Utf && start_offset < length && ( text[start_offset] & 0xFC00 ) == 0xDC00 )
+				{
+					++start_offset; // (the second unit of a surrogate pair)
+				}
+
+				if( start_offset > length ) break;
+
+				continue;
+			}
+
+			if( rc < 0 )
+			{
+				char prefix[64];
+				snprintf( prefix, sizeof( prefix ), "Error %d", rc );
+
+				SetPcre2Error( error, prefix, rc );
+				pcre2_match_data_free( match_data );
+
+				bool const limit = rc == PCRE2_ERROR_MATCHLIMIT || rc == PCRE2_ERROR_DEPTHLIMIT || rc == PCRE2_ERROR_HEAPLIMIT;
+
+				return limit ? REGEX_CORE_LIMIT : REGEX_CORE_ERROR;
+			}
+
+			if( rc == 0 )
+			{
+				SetRegexCoreError( error, "'ovector' was not big enough for all the captured substrings." );
+				pcre2_match_data_free( match_data );
+
+				return REGEX_CORE_ERROR;
+			}
+
+			if( ovector[0] > ovector[1] )
+			{
+				SetRegexCoreError( error, "\\K was used in an assertion to set the match start after its end." );
+				pcre2_match_data_free( match_data );
+
+				return REGEX_CORE_ERROR;
+			}
+
+			// group [0] is the whole match; the failed groups not included in 'rc' are added too
+			// (in DFA mode, the groups are the alternative matches, the longest first)
+
+			int32_t const group_count = static_cast<int32_t>( std::max<size_t>( rc, regex->CaptureCount + 1 ) );
+
+			builder.BeginMatch( group_count );
+
+			for( int32_t i = 0; i < group_count; ++i )
+			{
+				int32_t name = static_cast<size_t>( i ) < group_names.size( ) ? group_names[i] : -1;
+
+				if( i >= rc || ovector[2 * i] == PCRE2_UNSET )
+				{
+					builder.AddFailedGroup( name );
+				}
+				else
+				{
+					builder.AddGroup( ovector[2 * i], ovector[2 * i + 1] - ovector[2 * i], name );
+				}
+			}
+
+			// the next start
+
+			start_offset = ovector[1];
+			loop_options = 0;
+
+			if( ovector[0] == ovector[1] )
+			{
+				/* If the previous match was for an empty string, we are finished if we are at the end
+				of the subject. Otherwise, arrange to run another match at the same point to see if
+				a non-empty match can be found. */
+
+				if( ovector[0] == length ) break;
+
+				loop_options = PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
+			}
+			else
+			{
+				/* If a pattern contains \K within a lookbehind assertion at the start, the end of
+				the matched string can be at the offset where the match started. We must detect
+				this case and arrange to move the start on by one character. */
+
+				PCRE2_SIZE startchar = pcre2_get_startchar( match_data );
+
+				if( start_offset <= startchar )
+				{
+					if( startchar >= length ) break;
+
+					start_offset = startchar + 1;
+
+					if( regex->Utf && start_offset < length && ( text[start_offset] & 0xFC00 ) == 0xDC00 ) ++start_offset;
+				}
+			}
+		}
+
+		pcre2_match_data_free( match_data );
+		builder.Release( results );
+
+		return REGEX_CORE_OK;
+	}
+	catch( const std::exception& exc )
+	{
+		if( match_data ) pcre2_match_data_free( match_data );
+
+		SetRegexCoreError( error, exc.what( ) );
+
+		return REGEX_CORE_ERROR;
+	}
+}
+
+
+extern "C" void Pcre2CoreFree( Pcre2CoreRegex* regex )
+{
+	delete regex;
+}
+
+
+extern "C" size_t Pcre2CoreGetSize( const Pcre2CoreRegex* regex )
+{
+	size_t size = 0;
+	size_t jit_size = 0;
+
+	(void)pcre2_pattern_info( regex->Code, PCRE2_INFO_SIZE, &size );
+	(void)pcre2_pattern_info( regex->Code, PCRE2_INFO_JITSIZE, &jit_size );
+
+	return sizeof( Pcre2CoreRegex ) + size + jit_size;
+}
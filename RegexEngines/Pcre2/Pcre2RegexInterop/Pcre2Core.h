@@ -0,0 +1,47 @@
+#pragma once
+
+// The portable core of PCRE2 interop (see "RegexCore.h"). The library is built for 16-bit code units.
+// If the match, depth or heap limit is exceeded, the scan returns 'REGEX_CORE_LIMIT'.
+
+#include "../../NativeInfrastructure/RegexCore.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	enum
+	{
+		PCRE2_CORE_STANDARD = 0, // 'pcre2_match'
+		PCRE2_CORE_DFA = 1, // 'pcre2_dfa_match'; the groups of a match are the alternative matches at the same position
+		PCRE2_CORE_JIT = 2, // 'pcre2_match' after 'pcre2_jit_compile'; the compilation fails if PCRE2 is built without JIT support
+	};
+
+
+	typedef struct Pcre2CoreOptions
+	{
+		uint32_t CompileOptions; // ('PCRE2_...' options of 'pcre2_compile')
+		uint32_t ExtraCompileOptions; // ('PCRE2_EXTRA_...')
+		uint32_t MatchOptions; // ('PCRE2_...' options of 'pcre2_match' or 'pcre2_dfa_match')
+		int32_t Algorithm; // ('PCRE2_CORE_...')
+		uint32_t MatchLimit; // (of each call of 'pcre2_match' or 'pcre2_dfa_match'; see 'pcre2_set_match_limit'; 0 -- the default of PCRE2)
+	} Pcre2CoreOptions;
+
+
+	typedef struct Pcre2CoreRegex Pcre2CoreRegex;
+
+
+	Pcre2CoreRegex* Pcre2CoreCompile( const char16_t* pattern, size_t length, const Pcre2CoreOptions* options, RegexCoreError* error );
+
+	int32_t Pcre2CoreScan( const Pcre2CoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+		RegexCoreResults* results, RegexCoreError* error );
+
+	void Pcre2CoreFree( Pcre2CoreRegex* regex );
+
+	// The size of the compiled code, including the JIT code, in bytes.
+	size_t Pcre2CoreGetSize( const Pcre2CoreRegex* regex );
+
+#ifdef __cplusplus
+}
+#endif
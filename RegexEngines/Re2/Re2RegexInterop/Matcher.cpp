@@ -1,181 +1,84 @@
 #include "pch.h"
 
+#include "Re2Core.h"
+#include "../../NativeInfrastructure/CompiledPatternCache.h"
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/RegexCoreMatches.h"
 #include "Matcher.h"
 
 
 using namespace System::Diagnostics;
 
-using namespace msclr::interop;
+using namespace NativeInfrastructure;
 
 
 namespace Re2RegexInterop
 {
 
-	static std::map<const wchar_t*, void( RE2::Options::* )( bool ) > mOptionSetters;
-
-
-	static Matcher::Matcher( )
+	// (called by the cache of compiled patterns)
+	static void FreeRegex( void* regex )
 	{
-		mEmptyEnumeration = gcnew List<IMatch^>( 0 );
-
-		BuildOptions( );
+		Re2CoreFree( static_cast<Re2CoreRegex*>( regex ) );
 	}
 
 
-	static std::vector<char> ToUtf8( String^ s )
-	{
-		const char* old_locale = setlocale( LC_ALL, NULL );
-		const char* new_locale = setlocale( LC_CTYPE, ".utf8" );
-
-		if( new_locale == nullptr )
-		{
-			throw gcnew Exception( "Failed to set locale." );
-		}
-
-		std::vector<char> utf8( s->Length );
-
-		pin_ptr<const wchar_t> pinned = PtrToStringChars( s );
-		const wchar_t* start = pinned;
-
-		auto const mb_cur_max = MB_CUR_MAX;
-		mbstate_t mbstate = { 0 };
-
-		size_t bytes_written = 0;
-
-		for( const wchar_t* p = start; *p; ++p ) // (we assume that the array is zero-terminated)
-		{
-			utf8.resize( bytes_written + mb_cur_max );
-
-			size_t size_converted = c16rtomb( utf8.data( ) + bytes_written, *p, &mbstate );
-
-			if( size_converted == (size_t)-1 )
-			{
-				auto error_code = errno;
-
-				setlocale( LC_ALL, old_locale ); // restore
+	static std::map<const wchar_t*, uint32_t> mOptionFlags;
 
-				char error_text[512];
-				std::string error_code_s = std::to_string( error_code );
-				String^ err = gcnew String( strerror_s( error_text, _countof( error_text ), error_code ) == 0 ? error_text : error_code_s.c_str( ) );
-
-				throw gcnew Exception( String::Format( "Failed to convert to UTF-8: '{0}'. Source index: {1}.", err, p - start ) );
-			}
-
-			bytes_written += size_converted;
-		}
 
-		utf8.resize( bytes_written + 1, 0 );
-		utf8.back( ) = 0; // (zero-terminated)
-
-		setlocale( LC_ALL, old_locale ); // restore
-
-		return utf8;
+	static Matcher::Matcher( )
+	{
+		BuildOptions( );
 	}
 
 
-	void ToUtf8( std::vector<char>* dest, std::vector<int>* indices, String^ s )
+	Matcher::Matcher( String^ pattern0, cli::array<String^>^ options )
+		: mRegex( nullptr )
 	{
-		const char* old_locale = setlocale( LC_ALL, NULL );
-		const char* new_locale = setlocale( LC_CTYPE, ".utf8" );
-
-		if( new_locale == nullptr )
+		try
 		{
-			throw gcnew Exception( "Failed to set locale." );
-		}
-
-		dest->reserve( s->Length + 1 );
-		indices->reserve( s->Length + 1 );
-
-		pin_ptr<const wchar_t> pinned = PtrToStringChars( s );
-		const wchar_t* start = pinned;
+			TraceSpan options_span( "re2", "options" );
 
-		auto const mb_cur_max = MB_CUR_MAX;
-		mbstate_t mbstate = { 0 };
+			Re2CoreOptions core_options{};
 
-		size_t bytes_written = 0;
-		bool is_surrogate_pair = false;
-
-		for( const wchar_t* p = start; *p; ++p ) // (we assume that the pinned array is zero-terminated)
-		{
-			indices->resize( bytes_written + 1, -1 ); // ('-1' will denote unset elements)
-			if( !is_surrogate_pair )
+			for( auto i = mOptionFlags.cbegin( ); i != mOptionFlags.cend( ); ++i )
 			{
-				( *indices )[bytes_written] = CheckedCast::ToInt32( p - start );
+				String^ o = gcnew String( i->first );
+				if( Array::IndexOf( options, o ) >= 0 ) core_options.Flags |= i->second;
 			}
-			dest->resize( bytes_written + mb_cur_max );
 
-			size_t size_converted = c16rtomb( dest->data( ) + bytes_written, *p, &mbstate );
+			core_options.Anchor = RE2_CORE_UNANCHORED;
 
-			if( size_converted == (size_t)-1 )
+			if( Array::IndexOf( options, "ANCHOR_START" ) >= 0 )
 			{
-				auto error_code = errno;
-
-				setlocale( LC_ALL, old_locale ); // restore
-
-				char error_text[512];
-				std::string error_code_s = std::to_string( error_code );
-				String^ err = gcnew String( strerror_s( error_text, _countof( error_text ), error_code ) == 0 ? error_text : error_code_s.c_str( ) );
-
-				throw gcnew Exception( String::Format( "Failed to convert to UTF-8: '{0}'. Source index: {1}.", err, p - start ) );
+				core_options.Anchor = RE2_CORE_ANCHOR_START;
 			}
-
-			Debug::Assert( !( is_surrogate_pair && size_converted == 0 ) );
-
-			is_surrogate_pair = size_converted == 0;
-
-			bytes_written += size_converted;
-		}
-
-		dest->resize( bytes_written + 1, 0 );
-		dest->back( ) = 0; // (zero-terminated)
-		indices->resize( bytes_written, -1 );
-		indices->push_back( s->Length );
-
-		setlocale( LC_ALL, old_locale ); // restore
-	}
-
-
-	Matcher::Matcher( String^ pattern0, cli::array<String^>^ options )
-		: mData( nullptr )
-	{
-		try
-		{
-			// TODO: optimise
-
-			RE2::Options re2_options{};
-
-			for( auto i = mOptionSetters.cbegin( ); i != mOptionSetters.cend( ); ++i )
+			else if( Array::IndexOf( options, "ANCHOR_BOTH" ) >= 0 )
 			{
-				String^ o = gcnew String( i->first );
-				auto f = i->second;
-				( re2_options.*f )( Array::IndexOf( options, o ) >= 0 );
+				core_options.Anchor = RE2_CORE_ANCHOR_BOTH;
 			}
 
-			std::vector<char> utf8 = ToUtf8( pattern0 );
-
-			Debug::Assert( utf8.size( ) > 0 );
+			options_span.End( );
 
-			re2::StringPiece pattern( utf8.data( ), utf8.size( ) - 1 ); // (zero-terminator excluded)
+			pin_ptr<const wchar_t> pinned_pattern = PtrToStringChars( pattern0 );
+			const char16_t* native_pattern = reinterpret_cast<const char16_t*>( pinned_pattern );
+			std::string const cache_key = MakeCompiledPatternKey( "re2", &core_options, sizeof( core_options ), native_pattern, pattern0->Length );
 
-			std::unique_ptr<RE2> re( new RE2( pattern, re2_options ) );
+			mRegex = static_cast<Re2CoreRegex*>( AcquireCompiledPattern( cache_key ) );
 
-			if( !re->ok( ) )
+			if( mRegex == nullptr )
 			{
-				throw gcnew Exception( String::Format( "Error {0}: {1}", (int)re->error_code( ), gcnew String( re->error( ).c_str( ) ) ) );
-			}
+				RegexCoreError error{};
 
-			mData = new MatcherData{};
+				TraceSpan compile_span( "re2", "compile", pattern0->Length );
+				mRegex = Re2CoreCompile( native_pattern, pattern0->Length, &core_options, &error );
+				compile_span.End( );
 
-			mData->mRe = std::move( re );
-			mData->mAnchor = RE2::Anchor::UNANCHORED;
+				if( mRegex == nullptr )
+				{
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
+				}
 
-			if( Array::IndexOf( options, "ANCHOR_START" ) >= 0 )
-			{
-				mData->mAnchor = RE2::Anchor::ANCHOR_START;
-			}
-			else if( Array::IndexOf( options, "ANCHOR_BOTH" ) >= 0 )
-			{
-				mData->mAnchor = RE2::Anchor::ANCHOR_BOTH;
+				AddCompiledPattern( cache_key, mRegex, Re2CoreGetSize( mRegex ), &FreeRegex );
 			}
 		}
 		catch( const std::exception& exc )
@@ -202,8 +105,8 @@ namespace Re2RegexInterop
 
 	Matcher::!Matcher( )
 	{
-		delete mData;
-		mData = nullptr;
+		ReleaseCompiledPattern( mRegex ); // (the pattern can remain in the cache)
+		mRegex = nullptr;
 	}
 
 
@@ -219,60 +122,31 @@ namespace Re2RegexInterop
 		{
 			OriginalText = text0;
 
-			auto matches = gcnew List<IMatch^>( );
-
-			std::vector<char> text; // (utf-8)
-			std::vector<int> indices; // 
-
-			ToUtf8( &text, &indices, text0 );
-
-			//auto utf8 = System::Text::Encoding::UTF8->GetBytes( text0 );
-
-			re2::StringPiece const full_text( text.data( ), text.size( ) - 1 ); // (excluding zero-terminator; otherwise '$' etc. does not match)
-
-			int number_of_capturing_groups = mData->mRe->NumberOfCapturingGroups( );
-
-			std::vector<re2::StringPiece> found_groups;
-			found_groups.resize( number_of_capturing_groups + 1 ); // include main match
-
-			const std::map<int, std::string>& group_names = mData->mRe->CapturingGroupNames( );
+			pin_ptr<const wchar_t> pinned_text = PtrToStringChars( text0 );
+			RegexCoreManagedCancellation cancellation( cnc );
+			RegexCoreResults results{};
+			RegexCoreError error{};
 
-			int start_pos = 0;
-			int previous_start_pos = 0;
+			TraceSpan scan_span( "re2", "scan", text0->Length );
+			int32_t r = Re2CoreScan( mRegex, reinterpret_cast<const char16_t*>( pinned_text ), text0->Length, cancellation.Get( ), &results, &error );
+			scan_span.End( );
 
-			while( mData->mRe->Match(
-				full_text,
-				start_pos,
-				full_text.size( ),
-				mData->mAnchor,
-				found_groups.data( ),
-				CheckedCast::ToInt32( found_groups.size( ) ) )
-				)
+			try
 			{
-				auto match = CreateMatch( found_groups, group_names, text, indices );
-				matches->Add( match );
-
-				const re2::StringPiece& main_group = found_groups.front( );
-
-				// advance to the end of found match
-
-				start_pos = CheckedCast::ToInt32( main_group.data( ) + main_group.size( ) - full_text.data( ) );
-
-				if( start_pos == previous_start_pos ) // was empty match
+				switch( r )
 				{
-					Debug::Assert( main_group.size( ) == 0 );
-
-					// advance by the size of current utf-8 element
-
-					do { ++start_pos; } while( start_pos < indices.size( ) && indices.at( start_pos ) < 0 );
+				case REGEX_CORE_OK:
+					return RegexCoreResultsToMatches( results, this, 0, "re2" );
+				case REGEX_CORE_CANCELLED:
+					return RegexMatches::Empty;
+				default:
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
 				}
-
-				if( start_pos > full_text.size( ) ) break; // end of matches
-
-				previous_start_pos = start_pos;
 			}
-
-			return gcnew RegexMatches( matches->Count, matches );
+			finally
+			{
+				RegexCoreFreeResults( &results );
+			}
 		}
 		catch( const std::exception& exc )
 		{
@@ -297,96 +171,25 @@ namespace Re2RegexInterop
 	}
 
 
-	IMatch^ Matcher::CreateMatch( const std::vector<re2::StringPiece>& foundGroups, const std::map<int, std::string>& groupNames,
-		const std::vector<char>& text, const std::vector<int>& indices )
-	{
-		const re2::StringPiece& main_group = foundGroups.front( );
-
-		int utf8index = CheckedCast::ToInt32( main_group.data( ) - text.data( ) );
-		int index = indices.at( utf8index );
-		if( index < 0 )
-		{
-			throw gcnew Exception( "Index error (A)." );
-		}
-
-		int next_index = indices.at( utf8index + main_group.size( ) );
-		if( next_index < 0 )
-		{
-			// for example, '\C' in pattern -- match one byte
-			// TODO: find a more appropriate error text
-			throw gcnew Exception( "Index error (B)." );
-		}
-
-		int length = next_index - index;
-
-		auto match = SimpleMatch::Create( index, length, this );
-		// default group
-		match->AddGroup( index, length, true, L"0" );
-
-		// groups
-		for( int i = 1; i < foundGroups.size( ); ++i )
-		{
-			const re2::StringPiece& g = foundGroups[i];
-
-			String^ group_name;
-			auto f = groupNames.find( i );
-			if( f != groupNames.cend( ) )
-			{
-				group_name = gcnew String( f->second.c_str( ) );
-			}
-			else
-			{
-				group_name = i.ToString( System::Globalization::CultureInfo::InvariantCulture );
-			}
-
-			if( g.data( ) == nullptr ) // failed group
-			{
-				match->AddGroup( 0, 0, false, group_name );
-			}
-			else
-			{
-				int utf8index = CheckedCast::ToInt32( g.data( ) - text.data( ) );
-				int index = indices.at( utf8index );
-				if( index < 0 )
-				{
-					// for example, '\C' in pattern -- match one byte
-					// TODO: find a more appropriate error text
-					throw gcnew Exception( "Index error (C)." );
-				}
-
-				int next_index = indices.at( utf8index + g.size( ) );
-				if( next_index < 0 )
-				{
-					throw gcnew Exception( "Index error (D)." );
-				}
-
-				match->AddGroup( index, next_index - index, true, group_name );
-			}
-		}
-
-		return match;
-	}
-
-
 	void Matcher::BuildOptions( )
 	{
 
-#define C(f, v, n) \
+#define C(f, flag, v, n) \
 	list->Add(gcnew OptionInfo( gcnew String(#f), gcnew String(n), v)); \
-	mOptionSetters[L#f] = &RE2::Options::set_##f;
+	mOptionFlags[L#f] = flag;
 
 		List<OptionInfo^>^ list = gcnew List<OptionInfo^>( );
 
-		C( posix_syntax, false, "restrict regexps to POSIX egrep syntax" );
-		C( longest_match, false, "search for longest match, not first match" );
-		C( literal, false, "interpret string as literal, not regexp" );
-		C( never_nl, false, "never match \\n, even if it is in regexp" );
-		C( dot_nl, false, "dot matches everything including new line" );
-		C( never_capture, false, "parse all parens as non-capturing" );
-		C( case_sensitive, true, "match is case-sensitive (regexp can override with (?i) unless in posix_syntax mode)" );
-		C( perl_classes, false, "allow Perl's \\d \\s \\w \\D \\S \\W" );
-		C( word_boundary, false, "allow Perl's \\b \\B (word boundary and not)" );
-		C( one_line, false, "^ and $ only match beginning and end of text" );
+		C( posix_syntax, RE2_CORE_POSIX_SYNTAX, false, "restrict regexps to POSIX egrep syntax" );
+		C( longest_match, RE2_CORE_LONGEST_MATCH, false, "search for longest match, not first match" );
+		C( literal, RE2_CORE_LITERAL, false, "interpret string as literal, not regexp" );
+		C( never_nl, RE2_CORE_NEVER_NL, false, "never match \\n, even if it is in regexp" );
+		C( dot_nl, RE2_CORE_DOT_NL, false, "dot matches everything including new line" );
+		C( never_capture, RE2_CORE_NEVER_CAPTURE, false, "parse all parens as non-capturing" );
+		C( case_sensitive, RE2_CORE_CASE_SENSITIVE, true, "match is case-sensitive (regexp can override with (?i) unless in posix_syntax mode)" );
+		C( perl_classes, RE2_CORE_PERL_CLASSES, false, "allow Perl's \\d \\s \\w \\D \\S \\W" );
+		C( word_boundary, RE2_CORE_WORD_BOUNDARY, false, "allow Perl's \\b \\B (word boundary and not)" );
+		C( one_line, RE2_CORE_ONE_LINE, false, "^ and $ only match beginning and end of text" );
 
 		mOptions = list;
 
@@ -29,22 +29,6 @@ namespace Re2RegexInterop
 	};
 
 
-	struct MatcherData
-	{
-		std::unique_ptr<RE2> mRe;
-		RE2::Anchor mAnchor;
-
-		MatcherData( )
-		{
-			mAnchor = RE2::Anchor::UNANCHORED;
-		}
-
-		~MatcherData( )
-		{
-		}
-	};
-
-
 	public ref class Matcher : IMatcher, ISimpleTextGetter
 	{
 	public:
@@ -77,14 +61,10 @@ namespace Re2RegexInterop
 	private:
 
 		String^ OriginalText;
-		MatcherData* mData;
+		Re2CoreRegex* mRegex;
 
 		static List<OptionInfo^>^ mOptions;
 
-		static IEnumerable<IMatch^>^ mEmptyEnumeration;
-
-		IMatch^ CreateMatch( const std::vector<re2::StringPiece>& foundGroups, const std::map<int, std::string>& groupNames,
-			const std::vector<char>& text, const std::vector<int>& indices );
 		static void BuildOptions( );
 	};
 }
@@ -0,0 +1,247 @@
+// The portable core of RE2 interop. Compiled without the managed code and with "pch-re2.h" forced.
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "re2/re2.h"
+
+#include "Re2Core.h"
+#include "../../NativeInfrastructure/LiteralSearch.h"
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/Utf8Text.h"
+
+
+using namespace NativeInfrastructure;
+
+
+struct Re2CoreRegex
+{
+	std::unique_ptr<RE2> Re;
+	RE2::Anchor Anchor = RE2::UNANCHORED;
+	std::unique_ptr<LiteralSearcher> Literal; // (not null -- the matches are found without RE2; see "LiteralSearch.h")
+};
+
+
+// Returns false if the offset is inside of a UTF-8 sequence (for example, after '\C', which matches one byte).
+static bool IsAtCharacter( const std::string& text, size_t offset )
+{
+	return offset >= text.size( ) || ( static_cast<unsigned char>( text[offset] ) & 0xC0 ) != 0x80;
+}
+
+
+// Returns the searcher if the literal search finds the same matches as RE2, otherwise null.
+static std::unique_ptr<LiteralSearcher> MakeLiteralSearcher( const char16_t* pattern, size_t length, const Re2CoreOptions* options )
+{
+	// ('never_nl' and the anchors are not supported; the other options do not change the meaning of a literal)
+	if( ( options->Flags & RE2_CORE_NEVER_NL ) != 0 || options->Anchor != RE2_CORE_UNANCHORED ) return nullptr;
+
+	bool const literal = ( options->Flags & RE2_CORE_LITERAL ) != 0 ? length > 0 : IsLiteralPattern( pattern, length );
+	if( !literal ) return nullptr;
+
+	// (RE2 folds the case by Unicode)
+	bool const caseless = ( options->Flags & RE2_CORE_CASE_SENSITIVE ) == 0;
+	if( caseless && !IsAsciiCaseFoldable( pattern, length ) ) return nullptr;
+
+	// (the unpaired surrogates of the text are converted to U+FFFD, which RE2 matches to the same in the pattern)
+	if( HasUnpairedSurrogates( pattern, length ) || std::char_traits<char16_t>::find( pattern, length, u'\uFFFD' ) != nullptr ) return nullptr;
+
+	return std::unique_ptr<LiteralSearcher>( new LiteralSearcher( pattern, length, caseless ) );
+}
+
+
+extern "C" Re2CoreRegex* Re2CoreCompile( const char16_t* pattern, size_t length, const Re2CoreOptions* options, RegexCoreError* error )
+{
+	try
+	{
+		RE2::Options re2_options{};
+
+		uint32_t const f = options->Flags;
+
+		re2_options.set_posix_syntax( ( f & RE2_CORE_POSIX_SYNTAX ) != 0 );
+		re2_options.set_longest_match( ( f & RE2_CORE_LONGEST_MATCH ) != 0 );
+		re2_options.set_literal( ( f & RE2_CORE_LITERAL ) != 0 );
+		re2_options.set_never_nl( ( f & RE2_CORE_NEVER_NL ) != 0 );
+		re2_options.set_dot_nl( ( f & RE2_CORE_DOT_NL ) != 0 );
+		re2_options.set_never_capture( ( f & RE2_CORE_NEVER_CAPTURE ) != 0 );
+		re2_options.set_case_sensitive( ( f & RE2_CORE_CASE_SENSITIVE ) != 0 );
+		re2_options.set_perl_classes( ( f & RE2_CORE_PERL_CLASSES ) != 0 );
+		re2_options.set_word_boundary( ( f & RE2_CORE_WORD_BOUNDARY ) != 0 );
+		re2_options.set_one_line( ( f & RE2_CORE_ONE_LINE ) != 0 );
+		re2_options.set_log_errors( false ); // (the error is returned)
+
+		TraceSpan to_utf8_span( "re2", "to_utf8", static_cast<int64_t>( length ) );
+		std::string utf8;
+		AppendUtf8( &utf8, pattern, length );
+		to_utf8_span.End( );
+
+		std::unique_ptr<RE2> re( new RE2( re2::StringPiece( utf8.data( ), utf8.size( ) ), re2_options ) );
+
+		if( !re->ok( ) )
+		{
+			std::string text = "Error " + std::to_string( static_cast<int>( re->error_code( ) ) ) + ": " + re->error( );
+
+			SetRegexCoreError( error, text.c_str( ) );
+
+			return nullptr;
+		}
+
+		std::unique_ptr<Re2CoreRegex> regex( new Re2CoreRegex );
+
+		regex->Re = std::move( re );
+
+		switch( options->Anchor )
+		{
+		case RE2_CORE_ANCHOR_START:
+			regex->Anchor = RE2::ANCHOR_START;
+			break;
+		case RE2_CORE_ANCHOR_BOTH:
+			regex->Anchor = RE2::ANCHOR_BOTH;
+			break;
+		default:
+			regex->Anchor = RE2::UNANCHORED;
+			break;
+		}
+
+#ifndef REGEX_CORE_NO_LITERAL_SEARCH
+		if( IsLiteralSearchEnabled( ) ) regex->Literal = MakeLiteralSearcher( pattern, length, options );
+#endif
+
+		return regex.release( );
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return nullptr;
+	}
+}
+
+
+extern "C" int32_t Re2CoreScan( const Re2CoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+	RegexCoreResults* results, RegexCoreError* error )
+{
+	*results = RegexCoreResults{ };
+
+	try
+	{
+		RegexCoreResultsBuilder builder;
+
+		if( regex->Literal != nullptr )
+		{
+			int32_t const rc = regex->Literal->FindAll( text, length, cancellation, &builder );
+
+			if( rc == REGEX_CORE_OK ) builder.Release( results );
+
+			return rc;
+		}
+
+		TraceSpan to_utf8_span( "re2", "to_utf8", static_cast<int64_t>( length ) );
+		std::string utf8;
+		AppendUtf8( &utf8, text, length ); // (the unpaired surrogates take one UTF-16 unit as U+FFFD; the offsets stay in sync)
+		to_utf8_span.End( );
+
+		Utf8OffsetTranslator translator( utf8.data( ), utf8.size( ) );
+
+		re2::StringPiece const full_text( utf8.data( ), utf8.size( ) );
+
+		int const number_of_capturing_groups = regex->Re->NumberOfCapturingGroups( );
+
+		// names, by group number
+
+		std::vector<int32_t> group_names( number_of_capturing_groups + 1, -1 );
+
+		for( const auto& n : regex->Re->CapturingGroupNames( ) )
+		{
+			std::u16string name;
+			AppendUtf16( &name, n.second.data( ), n.second.size( ) );
+
+			group_names.at( n.first ) = builder.AddName( name.data( ), name.size( ) );
+		}
+
+		std::vector<re2::StringPiece> found_groups( number_of_capturing_groups + 1 ); // (include main match)
+
+		size_t start_pos = 0;
+
+		while( start_pos <= full_text.size( ) )
+		{
+			if( cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context ) )
+			{
+				return REGEX_CORE_CANCELLED;
+			}
+
+			if( !regex->Re->Match( full_text, start_pos, full_text.size( ), regex->Anchor, found_groups.data( ), static_cast<int>( found_groups.size( ) ) ) )
+			{
+				break;
+			}
+
+			builder.BeginMatch( static_cast<int32_t>( found_groups.size( ) ) );
+
+			for( size_t i = 0; i < found_groups.size( ); ++i )
+			{
+				const re2::StringPiece& g = found_groups[i];
+
+				if( g.data( ) == nullptr ) // failed group
+				{
+					builder.AddFailedGroup( group_names[i] );
+
+					continue;
+				}
+
+				size_t const begin = g.data( ) - full_text.data( );
+				size_t const end = begin + g.size( );
+
+				if( !IsAtCharacter( utf8, begin ) || !IsAtCharacter( utf8, end ) )
+				{
+					// for example, '\C' in pattern -- match one byte
+					SetRegexCoreError( error, "Index error: the match does not begin or end at a character boundary." );
+
+					return REGEX_CORE_ERROR;
+				}
+
+				size_t const index = translator.ToUtf16( begin );
+
+				builder.AddGroup( index, translator.ToUtf16( end ) - index, group_names[i] );
+			}
+
+			// advance to the end of found match; after an empty match, also by the size of current UTF-8 element
+			// (otherwise the same empty match is found again)
+
+			const re2::StringPiece& main_group = found_groups.front( );
+
+			start_pos = main_group.data( ) - full_text.data( ) + main_group.size( );
+
+			if( main_group.empty( ) )
+			{
+				do { ++start_pos; } while( start_pos < utf8.size( ) && !IsAtCharacter( utf8, start_pos ) );
+			}
+		}
+
+		builder.Release( results );
+
+		return REGEX_CORE_OK;
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return REGEX_CORE_ERROR;
+	}
+}
+
+
+extern "C" void Re2CoreFree( Re2CoreRegex* regex )
+{
+	delete regex;
+}
+
+
+extern "C" size_t Re2CoreGetSize( const Re2CoreRegex* regex )
+{
+	// (about 16 bytes per instruction, with the lists of the program, for both programs;
+	// 'ReverseProgramSize' is not used, since it compiles the reverse program)
+	int const instructions = regex->Re->ProgramSize( );
+
+	return sizeof( Re2CoreRegex ) + sizeof( RE2 ) + regex->Re->pattern( ).size( ) + ( instructions > 0 ? 32 * static_cast<size_t>( instructions ) : 0 );
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// The portable core of RE2 interop (see "RegexCore.h"). The pattern and the text are converted to UTF-8;
+// the positions are reported in UTF-16 units.
+
+#include "../../NativeInfrastructure/RegexCore.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	// The options of 'RE2::Options'; the options that are not given are set to false.
+	enum
+	{
+		RE2_CORE_POSIX_SYNTAX = 1 << 0,
+		RE2_CORE_LONGEST_MATCH = 1 << 1,
+		RE2_CORE_LITERAL = 1 << 2,
+		RE2_CORE_NEVER_NL = 1 << 3,
+		RE2_CORE_DOT_NL = 1 << 4,
+		RE2_CORE_NEVER_CAPTURE = 1 << 5,
+		RE2_CORE_CASE_SENSITIVE = 1 << 6,
+		RE2_CORE_PERL_CLASSES = 1 << 7,
+		RE2_CORE_WORD_BOUNDARY = 1 << 8,
+		RE2_CORE_ONE_LINE = 1 << 9,
+	};
+
+
+	// ('RE2::Anchor')
+	enum
+	{
+		RE2_CORE_UNANCHORED = 0,
+		RE2_CORE_ANCHOR_START = 1,
+		RE2_CORE_ANCHOR_BOTH = 2,
+	};
+
+
+	typedef struct Re2CoreOptions
+	{
+		uint32_t Flags; // ('RE2_CORE_...' options)
+		int32_t Anchor; // ('RE2_CORE_UNANCHORED', ...)
+	} Re2CoreOptions;
+
+
+	typedef struct Re2CoreRegex Re2CoreRegex;
+
+
+	Re2CoreRegex* Re2CoreCompile( const char16_t* pattern, size_t length, const Re2CoreOptions* options, RegexCoreError* error );
+
+	int32_t Re2CoreScan( const Re2CoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+		RegexCoreResults* results, RegexCoreError* error );
+
+	void Re2CoreFree( Re2CoreRegex* regex );
+
+	// An estimate from the size of the program (the reverse program, which is compiled on demand, is assumed
+	// to be similar); the caches of the DFA, which grow during the scans up to the memory budget of RE2, are not included.
+	size_t Re2CoreGetSize( const Re2CoreRegex* regex );
+
+#ifdef __cplusplus
+}
+#endif
@@ -59,6 +59,7 @@ namespace StdRegexEngineNs
 					.Append( ( (ComboBoxItem)cbxGrammar.SelectedItem ).Tag.ToString( ) )
 					.Append( StdRegexInterop.Matcher.OptionPrefix_REGEX_MAX_STACK_COUNT + tbREGEX_MAX_STACK_COUNT.Text )
 					.Append( StdRegexInterop.Matcher.OptionPrefix_REGEX_MAX_COMPLEXITY_COUNT + tbREGEX_MAX_COMPLEXITY_COUNT.Text )
+					.Append( StdRegexInterop.Matcher.OptionPrefix_STACK_SIZE + tbSTACK_SIZE.Text )
 					.ToArray( );
 		}
 
@@ -101,6 +102,16 @@ namespace StdRegexEngineNs
 					tbREGEX_MAX_COMPLEXITY_COUNT.Text = mcc.Substring( StdRegexInterop.Matcher.OptionPrefix_REGEX_MAX_COMPLEXITY_COUNT.Length );
 				}
 
+				var ss = options.FirstOrDefault( o => o.StartsWith( StdRegexInterop.Matcher.OptionPrefix_STACK_SIZE ) );
+				if( ss == null )
+				{
+					tbSTACK_SIZE.Text = ""; // (default)
+				}
+				else
+				{
+					tbSTACK_SIZE.Text = ss.Substring( StdRegexInterop.Matcher.OptionPrefix_STACK_SIZE.Length );
+				}
+
 			}
 			finally
 			{
@@ -1,6 +1,11 @@
 #include "pch.h"
 
-#include "NativeMatcher.h"
+#include <regex> // (for the flags only)
+
+#include "StdCore.h"
+#include "../../NativeInfrastructure/CompiledPatternCache.h"
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/RegexCoreMatches.h"
 #include "Matcher.h"
 
 
@@ -8,37 +13,56 @@ using namespace System::Diagnostics;
 using namespace System::Globalization;
 
 using namespace std;
-using namespace msclr::interop;
+using namespace NativeInfrastructure;
 
 
 namespace StdRegexInterop
 {
 
-	long Matcher::Default_REGEX_MAX_STACK_COUNT::get( ) { return StdRegexInterop::Default_REGEX_MAX_STACK_COUNT; }
-	long Matcher::Default_REGEX_MAX_COMPLEXITY_COUNT::get( ) { return StdRegexInterop::Default_REGEX_MAX_COMPLEXITY_COUNT; }
+	// (called by the cache of compiled patterns)
+	static void FreeRegex( void* regex )
+	{
+		StdCoreFree( static_cast<StdCoreRegex*>( regex ) );
+	}
+
+
+	static StdCoreOptions GetDefaultOptions( )
+	{
+		StdCoreOptions options;
+		StdCoreGetDefaultOptions( &options );
+
+		return options;
+	}
+
+
+	long Matcher::Default_REGEX_MAX_STACK_COUNT::get( ) { return GetDefaultOptions( ).MaxStackCount; }
+	long Matcher::Default_REGEX_MAX_COMPLEXITY_COUNT::get( ) { return GetDefaultOptions( ).MaxComplexityCount; }
+	long Matcher::Default_STACK_SIZE::get( ) { return GetDefaultOptions( ).StackSizeMB; }
 
 
 	static Matcher::Matcher( )
 	{
 		ConstOptionPrefix_REGEX_MAX_STACK_COUNT = "REGEX_MAX_STACK_COUNT:";
 		ConstOptionPrefix_REGEX_MAX_COMPLEXITY_COUNT = "REGEX_MAX_COMPLEXITY_COUNT:";
+		ConstOptionPrefix_STACK_SIZE = "STACK_SIZE:";
 	}
 
 
 	Matcher::Matcher( String^ pattern0, cli::array<String^>^ options )
-		: mData( nullptr )
+		: mRegex( nullptr )
 	{
 		try
 		{
-			marshal_context context{};
+			TraceSpan options_span( "std", "options" );
 
 			wregex::flag_type regex_flags{};
 			regex_constants::match_flag_type match_flags = regex_constants::match_flag_type::match_default;
 
-			wstring pattern = context.marshal_as<wstring>( pattern0 );
+			StdCoreOptions const default_options = GetDefaultOptions( );
 
-			long lREGEX_MAX_STACK_COUNT = 600L;
-			long lREGEX_MAX_COMPLEXITY_COUNT = 10000000L;
+			long lREGEX_MAX_STACK_COUNT = default_options.MaxStackCount;
+			long lREGEX_MAX_COMPLEXITY_COUNT = default_options.MaxComplexityCount;
+			long lSTACK_SIZE = 0; // (default)
 
 			for each( String ^ o in options )
 			{
@@ -116,13 +140,59 @@ namespace StdRegexInterop
 					}
 				}
 
+				if( o->StartsWith( ConstOptionPrefix_STACK_SIZE ) )
+				{
+					String^ s = o->Substring( ConstOptionPrefix_STACK_SIZE->Length );
+					if( !String::IsNullOrWhiteSpace( s ) )
+					{
+						int v;
+						if( long::TryParse( s,
+							NumberStyles::AllowLeadingWhite | NumberStyles::AllowTrailingWhite | NumberStyles::AllowThousands,
+							CultureInfo::InvariantCulture,
+							v ) && v >= 0 && v <= 1024 )
+						{
+							lSTACK_SIZE = v;
+						}
+						else
+						{
+							throw gcnew Exception( String::Format( CultureInfo::InvariantCulture, "Invalid option: STACK_SIZE. Please enter the size of stack in megabytes (1 to 1024), or set to 0 to use the default size, which is {0:#,##0} MB.", Default_STACK_SIZE ) );
+						}
+					}
+				}
+
 			}
 
-			mData = new MatcherData{};
-			mData->mMatchFlags = match_flags;
-			mData->mREGEX_MAX_STACK_COUNT = lREGEX_MAX_STACK_COUNT;
-			mData->mREGEX_MAX_COMPLEXITY_COUNT = lREGEX_MAX_COMPLEXITY_COUNT;
-			mData->mRegex.assign( std::move( pattern ), regex_flags );
+			StdCoreOptions core_options{};
+
+			core_options.SyntaxFlags = static_cast<uint32_t>( regex_flags );
+			core_options.MatchFlags = static_cast<uint32_t>( match_flags );
+			core_options.MaxStackCount = lREGEX_MAX_STACK_COUNT;
+			core_options.MaxComplexityCount = lREGEX_MAX_COMPLEXITY_COUNT;
+			core_options.StackSizeMB = lSTACK_SIZE;
+
+			options_span.End( );
+
+			pin_ptr<const wchar_t> pinned_pattern = PtrToStringChars( pattern0 );
+			const char16_t* native_pattern = reinterpret_cast<const char16_t*>( pinned_pattern );
+			std::string const cache_key = MakeCompiledPatternKey( "std", &core_options, sizeof( core_options ), native_pattern, pattern0->Length );
+
+			mRegex = static_cast<StdCoreRegex*>( AcquireCompiledPattern( cache_key ) );
+
+			if( mRegex == nullptr )
+			{
+				RegexCoreError error{};
+
+				TraceSpan compile_span( "std", "compile", pattern0->Length );
+				mRegex = StdCoreCompile( native_pattern, pattern0->Length, &core_options, &error );
+				compile_span.End( );
+
+				if( mRegex == nullptr )
+				{
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
+				}
+
+				AddCompiledPattern( cache_key, mRegex, 0, &FreeRegex );
+			}
 		}
 		catch( const regex_error& exc )
 		{
@@ -155,8 +225,8 @@ namespace StdRegexInterop
 
 	Matcher::!Matcher( )
 	{
-		delete mData;
-		mData = nullptr;
+		ReleaseCompiledPattern( mRegex ); // (the pattern can remain in the cache)
+		mRegex = nullptr;
 	}
 
 
@@ -168,133 +238,37 @@ namespace StdRegexInterop
 	}
 
 
-	private ref struct WatchingThreadData
-	{
-		ICancellable^ cnc;
-		Threading::EventWaitHandle^ ev;
-	};
-
-
-	static void WatchCancelRequestThreadProc( Object^ args )
-	{
-		auto d = (WatchingThreadData^)args;
-
-		try
-		{
-			for( ;;)
-			{
-				if( d->cnc->IsCancellationRequested )
-				{
-					d->ev->Set( );
-
-					break;
-				}
-
-				Threading::Thread::Sleep( 222 );
-			}
-		}
-		catch( Threading::ThreadInterruptedException^ )
-		{
-			// ignore
-		}
-		catch( Threading::ThreadAbortException^ )
-		{
-			// ignore
-		}
-	}
-
-
 	RegexMatches^ Matcher::Matches( String^ text0, ICancellable^ cnc )
 	{
 		try
 		{
-			marshal_context context{};
-
-			mData->mText = context.marshal_as<wstring>( text0 );
+			mText = text0;
 
-			auto matches = gcnew List<IMatch^>( );
+			pin_ptr<const wchar_t> pinned_text = PtrToStringChars( text0 );
+			RegexCoreManagedCancellation cancellation( cnc );
+			RegexCoreResults results{};
+			RegexCoreError error{};
 
-			auto* native_text = mData->mText.c_str( );
-
-			std::string native_error_text;
-
-			std::vector<NativeMatch> native_matches;
-			native_matches.reserve( 512 );
-
-			auto cancelEvent = gcnew Threading::ManualResetEvent( false );
-			auto watchingThread = gcnew Threading::Thread( gcnew Threading::ParameterizedThreadStart( &WatchCancelRequestThreadProc ) );
-			auto data = gcnew WatchingThreadData;
-			data->cnc = cnc;
-			data->ev = cancelEvent;
-			watchingThread->IsBackground = true;
-			watchingThread->Start( data );
+			TraceSpan scan_span( "std", "scan", text0->Length );
+			int32_t r = StdCoreScan( mRegex, reinterpret_cast<const char16_t*>( pinned_text ), text0->Length, cancellation.Get( ), &results, &error );
+			scan_span.End( );
 
 			try
 			{
-				NativeMatches( &native_matches, &native_error_text, mData->mRegex, native_text, mData->mMatchFlags,
-					mData->mREGEX_MAX_STACK_COUNT, mData->mREGEX_MAX_COMPLEXITY_COUNT, (HANDLE)cancelEvent->Handle );
-			}
-			finally
-			{
-				try
+				switch( r )
 				{
-					watchingThread->Interrupt( );
-					watchingThread->Abort( );
-				}
-				catch( Exception^ )
-				{
-					Debug::Assert( false );
-					// ignore
+				case REGEX_CORE_OK:
+					return RegexCoreResultsToMatches( results, this, 0, "std" );
+				case REGEX_CORE_CANCELLED:
+					return RegexMatches::Empty;
+				default:
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
 				}
 			}
-
-			if( cnc->IsCancellationRequested )  return RegexMatches::Empty;
-
-			if( !native_error_text.empty( ) )
-			{
-				throw gcnew Exception( gcnew String( native_error_text.c_str( ) ) );
-			}
-
-			SimpleMatch^ match = nullptr;
-			int group_index = 0;
-
-			for( const NativeMatch& nm : native_matches )
+			finally
 			{
-				if( cnc->IsCancellationRequested )  return RegexMatches::Empty;
-
-				switch( nm.Type )
-				{
-				case NativeMatch::TypeEnum::M:
-					match = SimpleMatch::Create( CheckedCast::ToInt32( nm.Index ), CheckedCast::ToInt32( nm.Length ), this );
-					matches->Add( match );
-					group_index = 0;
-					break;
-
-				case NativeMatch::TypeEnum::G:
-					;
-					{
-						String^ group_name = group_index.ToString( CultureInfo::InvariantCulture );
-
-						if( nm.Index < 0 )
-						{
-							match->AddGroup( 0, 0, false, group_name );
-						}
-						else
-						{
-							match->AddGroup( CheckedCast::ToInt32( nm.Index ), CheckedCast::ToInt32( nm.Length ), true, group_name );
-						}
-
-						++group_index;
-					}
-					break;
-
-				default:
-					Debug::Assert( false );
-					break;
-				}
+				RegexCoreFreeResults( &results );
 			}
-
-			return gcnew RegexMatches( matches->Count, matches );
 		}
 		catch( const regex_error& exc )
 		{
@@ -321,7 +295,7 @@ namespace StdRegexInterop
 
 	String^ Matcher::GetText( int index, int length )
 	{
-		return gcnew String( mData->mText.c_str( ), index, length );
+		return mText->Substring( index, length );
 	}
 
 }
@@ -11,16 +11,6 @@ using namespace RegexEngineInfrastructure::Matches::Simple;
 
 namespace StdRegexInterop
 {
-	struct MatcherData
-	{
-		std::wstring mText;
-		std::wregex mRegex;
-		std::regex_constants::match_flag_type mMatchFlags;
-		long mREGEX_MAX_STACK_COUNT;
-		long mREGEX_MAX_COMPLEXITY_COUNT;
-	};
-
-
 	public ref class Matcher : IMatcher, ISimpleTextGetter
 	{
 	public:
@@ -41,8 +31,17 @@ namespace StdRegexInterop
 			}
 		}
 
+		static property String^ OptionPrefix_STACK_SIZE
+		{
+			String^ get( )
+			{
+				return ConstOptionPrefix_STACK_SIZE;
+			}
+		}
+
 		static property long Default_REGEX_MAX_STACK_COUNT { long get( ); }
 		static property long Default_REGEX_MAX_COMPLEXITY_COUNT { long get( ); }
+		static property long Default_STACK_SIZE { long get( ); } // (megabytes)
 
 
 		static Matcher( );
@@ -69,9 +68,11 @@ namespace StdRegexInterop
 
 	private:
 
-		MatcherData* mData;
+		StdCoreRegex* mRegex;
+		String^ mText;
 		static String^ ConstOptionPrefix_REGEX_MAX_STACK_COUNT;
 		static String^ ConstOptionPrefix_REGEX_MAX_COMPLEXITY_COUNT;
+		static String^ ConstOptionPrefix_STACK_SIZE;
 	};
 
 }
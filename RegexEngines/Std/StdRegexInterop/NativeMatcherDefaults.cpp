@@ -1,11 +0,0 @@
-
-#include <regex>
-
-
-namespace StdRegexInterop
-{
-
-	long Default_REGEX_MAX_STACK_COUNT = _REGEX_MAX_STACK_COUNT;
-	long Default_REGEX_MAX_COMPLEXITY_COUNT = _REGEX_MAX_COMPLEXITY_COUNT;
-
-}
\ No newline at end of file
@@ -0,0 +1,343 @@
+#ifdef _MSC_VER
+#	pragma warning( disable : 26812 )
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+
+#include "../../NativeInfrastructure/LiteralAlternation.h"
+#include "../../NativeInfrastructure/LiteralSearch.h"
+#include "../../NativeInfrastructure/StackGuard.h"
+#include "StdCore.h"
+
+
+namespace StdRegexInterop
+{
+	thread_local long Variable_REGEX_MAX_STACK_COUNT = 0;
+	thread_local long Variable_REGEX_MAX_COMPLEXITY_COUNT = 0;
+}
+
+// (the limits of Visual C++ library, set for each thread; see "StdCoreDefaults.cpp" for the default values)
+#define _REGEX_MAX_STACK_COUNT      StdRegexInterop::Variable_REGEX_MAX_STACK_COUNT
+#define _REGEX_MAX_COMPLEXITY_COUNT StdRegexInterop::Variable_REGEX_MAX_COMPLEXITY_COUNT
+#include <regex>
+
+
+using namespace NativeInfrastructure;
+
+
+// The word characters of '\b', by the traits of the regex.
+struct StdWordClass
+{
+	std::regex_traits<wchar_t> Traits;
+	std::regex_traits<wchar_t>::char_class_type Mask{ };
+};
+
+
+struct StdCoreRegex
+{
+	std::wregex Regex;
+	std::regex_constants::match_flag_type MatchFlags = std::regex_constants::match_default;
+	long MaxStackCount = 0;
+	long MaxComplexityCount = 0;
+	long StackSizeMB = 0;
+	std::unique_ptr<LiteralSearcher> Literal; // (not null -- the matches are found without the library; see "LiteralSearch.h")
+	std::unique_ptr<LiteralAlternationSearcher> Alternation; // (same, for the alternations of literals; see "LiteralAlternation.h")
+	int32_t AlternationGroups = 0;
+	StdWordClass WordClass; // (used by 'Alternation')
+};
+
+
+namespace
+{
+	// The data that is shared with the thread of matching; the thread keeps it alive when the scan is abandoned.
+	struct StdScanData
+	{
+		std::atomic_bool Stop{ false };
+
+		std::wregex Regex; // (copy)
+		std::regex_constants::match_flag_type MatchFlags = std::regex_constants::match_default;
+		std::wstring Text; // (one 'wchar_t' for each UTF-16 unit, therefore the positions are the same)
+		long MaxStackCount = 0;
+		long MaxComplexityCount = 0;
+
+		RegexCoreResultsBuilder Builder;
+		char ErrorText[256] = "";
+		bool LimitReached = false; // (the error is 'error_complexity' or 'error_stack')
+	};
+
+
+	void FindMatches( StdScanData* data )
+	{
+		StdRegexInterop::Variable_REGEX_MAX_STACK_COUNT = data->MaxStackCount;
+		StdRegexInterop::Variable_REGEX_MAX_COMPLEXITY_COUNT = data->MaxComplexityCount;
+
+		std::wcregex_iterator results_begin( data->Text.c_str( ), data->Text.c_str( ) + data->Text.length( ), data->Regex, data->MatchFlags );
+		std::wcregex_iterator results_end{};
+
+		for( auto i = results_begin; i != results_end; ++i )
+		{
+			if( data->Stop ) return;
+
+			const std::wcmatch& match = *i;
+
+			data->Builder.BeginMatch( static_cast<int32_t>( match.size( ) ) );
+
+			for( size_t j = 0; j < match.size( ); ++j )
+			{
+				if( match[j].matched )
+				{
+					data->Builder.AddGroup( match.position( j ), match.length( j ) );
+				}
+				else
+				{
+					data->Builder.AddFailedGroup( );
+				}
+			}
+		}
+	}
+
+
+	void FindMatchesProc( void* p )
+	{
+		std::unique_ptr<std::shared_ptr<StdScanData>> holder( static_cast<std::shared_ptr<StdScanData>*>( p ) );
+		StdScanData* data = holder->get( );
+
+		try
+		{
+			FindMatches( data );
+		}
+		catch( const std::regex_error& exc )
+		{
+			// (the limits of Visual C++ library; see 'MaxStackCount' and 'MaxComplexityCount')
+			data->LimitReached = exc.code( ) == std::regex_constants::error_complexity || exc.code( ) == std::regex_constants::error_stack;
+			snprintf( data->ErrorText, sizeof( data->ErrorText ), "%s", exc.what( ) );
+		}
+		catch( const std::exception& exc )
+		{
+			snprintf( data->ErrorText, sizeof( data->ErrorText ), "%s", exc.what( ) );
+		}
+		catch( ... )
+		{
+			snprintf( data->ErrorText, sizeof( data->ErrorText ), "%s", "Unknown error" );
+		}
+
+		// (in case of stack overflow and other faults, 'holder' is not released; see "StackGuard.h")
+	}
+
+
+	// Returns the searcher if the literal search finds the same matches as the library, otherwise null.
+	std::unique_ptr<LiteralSearcher> MakeLiteralSearcher( const char16_t* pattern, size_t length, const StdCoreOptions* options )
+	{
+		namespace rc = std::regex_constants;
+
+		// (the case-insensitive matching depends on the locale; in 'grep' and 'egrep', the line breaks separate
+		// the alternatives; the match flags are not supported)
+		uint32_t const neutral_syntax_flags = static_cast<uint32_t>( rc::ECMAScript | rc::basic | rc::extended | rc::awk |
+			rc::nosubs | rc::optimize | rc::collate );
+
+		if( ( options->SyntaxFlags & ~neutral_syntax_flags ) != 0 || options->MatchFlags != static_cast<uint32_t>( rc::match_default ) ) return nullptr;
+
+		if( !IsLiteralPattern( pattern, length ) ) return nullptr;
+
+		return std::unique_ptr<LiteralSearcher>( new LiteralSearcher( pattern, length, false ) );
+	}
+
+
+	bool IsStdWordCharacter( const void* context, char16_t c )
+	{
+		const StdWordClass* word_class = static_cast<const StdWordClass*>( context );
+
+		return word_class->Traits.isctype( static_cast<wchar_t>( c ), word_class->Mask );
+	}
+
+
+	// Returns the searcher if the alternation of literals finds the same matches as the library, otherwise null.
+	std::unique_ptr<LiteralAlternationSearcher> MakeAlternationSearcher( const char16_t* pattern, size_t length, const StdCoreOptions* options,
+		const std::wregex& regex, StdWordClass* wordClass )
+	{
+		namespace rc = std::regex_constants;
+
+		// (ECMAScript only, where the first matching alternative is taken; the other grammars take the longest one,
+		// and the case-insensitive matching depends on the locale)
+		uint32_t const neutral_syntax_flags = static_cast<uint32_t>( rc::ECMAScript | rc::nosubs | rc::optimize | rc::collate );
+
+		if( ( options->SyntaxFlags & ~neutral_syntax_flags ) != 0 || options->MatchFlags != static_cast<uint32_t>( rc::match_default ) ) return nullptr;
+
+		LiteralAlternation alternation;
+		if( !ParseLiteralAlternation( pattern, length, &alternation ) ) return nullptr;
+
+		wchar_t const w = L'w';
+
+		wordClass->Traits.imbue( regex.getloc( ) );
+		wordClass->Mask = wordClass->Traits.lookup_classname( &w, &w + 1 );
+
+		return LiteralAlternationSearcher::Create( alternation, LiteralAlternationSearcher::Priority::First, &IsStdWordCharacter, wordClass );
+	}
+}
+
+
+extern "C" StdCoreRegex* StdCoreCompile( const char16_t* pattern, size_t length, const StdCoreOptions* options, RegexCoreError* error )
+{
+	try
+	{
+		std::unique_ptr<StdCoreRegex> regex( new StdCoreRegex );
+
+		regex->MatchFlags = static_cast<std::regex_constants::match_flag_type>( options->MatchFlags );
+		regex->MaxStackCount = options->MaxStackCount;
+		regex->MaxComplexityCount = options->MaxComplexityCount;
+		regex->StackSizeMB = options->StackSizeMB;
+
+		if( GuardedStackSizeFromMegabytes( regex->StackSizeMB ) == 0 )
+		{
+			SetRegexCoreError( error, "Invalid stack size." );
+
+			return nullptr;
+		}
+
+		regex->Regex.assign( std::wstring( pattern, pattern + length ), static_cast<std::regex_constants::syntax_option_type>( options->SyntaxFlags ) );
+
+#ifndef REGEX_CORE_NO_LITERAL_SEARCH
+		if( IsLiteralSearchEnabled( ) )
+		{
+			regex->Literal = MakeLiteralSearcher( pattern, length, options );
+
+			if( regex->Literal == nullptr )
+			{
+				regex->Alternation = MakeAlternationSearcher( pattern, length, options, regex->Regex, &regex->WordClass );
+				regex->AlternationGroups = static_cast<int32_t>( regex->Regex.mark_count( ) ) + 1;
+			}
+		}
+#endif
+
+		return regex.release( );
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return nullptr;
+	}
+}
+
+
+extern "C" int32_t StdCoreScan( const StdCoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+	RegexCoreResults* results, RegexCoreError* error )
+{
+	*results = RegexCoreResults{ };
+
+	try
+	{
+		if( regex->Literal != nullptr )
+		{
+			RegexCoreResultsBuilder builder;
+
+			int32_t const rc = regex->Literal->FindAll( text, length, cancellation, &builder );
+
+			if( rc == REGEX_CORE_OK ) builder.Release( results );
+
+			return rc;
+		}
+
+		if( regex->Alternation != nullptr )
+		{
+			RegexCoreResultsBuilder builder;
+
+			int32_t const rc = regex->Alternation->FindAll( text, length, regex->AlternationGroups, cancellation, &builder );
+
+			if( rc == REGEX_CORE_OK ) builder.Release( results );
+
+			return rc;
+		}
+
+		std::shared_ptr<StdScanData> data = std::make_shared<StdScanData>( );
+
+		data->Regex = regex->Regex;
+		data->MatchFlags = regex->MatchFlags;
+		data->Text.assign( text, text + length );
+		data->MaxStackCount = regex->MaxStackCount;
+		data->MaxComplexityCount = regex->MaxComplexityCount;
+
+		GuardedThread thread;
+
+		std::unique_ptr<std::shared_ptr<StdScanData>> holder( new std::shared_ptr<StdScanData>( data ) );
+
+		if( !thread.Start( GuardedStackSizeFromMegabytes( regex->StackSizeMB ), &FindMatchesProc, holder.get( ) ) )
+		{
+			SetRegexCoreError( error, thread.GetErrorText( ) );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		holder.release( ); // (owned by the thread)
+
+		const auto timeout = std::chrono::seconds( 60 );
+		const auto start_time = std::chrono::steady_clock::now( );
+
+		while( !thread.Wait( 33 ) )
+		{
+			if( cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context ) )
+			{
+				// (the library cannot be interrupted: the abandoned thread stops at the next match; such threads
+				// are limited by 'MaxAbandonedGuardedThreads', see "StackGuard.h")
+				data->Stop = true;
+
+				return REGEX_CORE_CANCELLED;
+			}
+
+			if( std::chrono::steady_clock::now( ) - start_time > timeout )
+			{
+				data->Stop = true;
+				SetRegexCoreError( error, "Operation takes long time to execute." );
+
+				return REGEX_CORE_ERROR;
+			}
+		}
+
+		switch( thread.GetResult( ) )
+		{
+		case GuardedRunResult::Completed:
+			break;
+		case GuardedRunResult::StackOverflow:
+		{
+			std::string message = thread.GetErrorText( );
+			message += "\r\n(Consider increasing the STACK_SIZE option.)";
+
+			SetRegexCoreError( error, message.c_str( ) );
+
+			return REGEX_CORE_ERROR;
+		}
+		default:
+			SetRegexCoreError( error, thread.GetErrorText( ) );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		if( data->ErrorText[0] != '\0' )
+		{
+			SetRegexCoreError( error, data->ErrorText );
+
+			return data->LimitReached ? REGEX_CORE_LIMIT : REGEX_CORE_ERROR;
+		}
+
+		data->Builder.Release( results );
+
+		return REGEX_CORE_OK;
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return REGEX_CORE_ERROR;
+	}
+}
+
+
+extern "C" void StdCoreFree( StdCoreRegex* regex )
+{
+	delete regex;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// The portable core of std::regex interop (see "RegexCore.h").
+//
+// The matches are collected on a separate thread that has 'StackSizeMB' megabytes of stack (0 -- default).
+// If the scan is cancelled or takes more than a minute, the thread is abandoned; it stops after the current match.
+// The limits 'MaxStackCount' and 'MaxComplexityCount' are applied by the library of Visual C++
+// ('_REGEX_MAX_STACK_COUNT', '_REGEX_MAX_COMPLEXITY_COUNT'; 0 -- no limit) and ignored by other libraries;
+// when they are exceeded, the scan returns 'REGEX_CORE_LIMIT'.
+
+#include "../../NativeInfrastructure/RegexCore.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	typedef struct StdCoreOptions
+	{
+		uint32_t SyntaxFlags; // ('std::regex_constants::syntax_option_type')
+		uint32_t MatchFlags; // ('std::regex_constants::match_flag_type')
+		int32_t MaxStackCount;
+		int32_t MaxComplexityCount;
+		int32_t StackSizeMB;
+	} StdCoreOptions;
+
+
+	typedef struct StdCoreRegex StdCoreRegex;
+
+
+	// Fills the options with the defaults of the library: no flags, the default limits and stack size.
+	void StdCoreGetDefaultOptions( StdCoreOptions* options );
+
+	StdCoreRegex* StdCoreCompile( const char16_t* pattern, size_t length, const StdCoreOptions* options, RegexCoreError* error );
+
+	int32_t StdCoreScan( const StdCoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+		RegexCoreResults* results, RegexCoreError* error );
+
+	void StdCoreFree( StdCoreRegex* regex );
+
+#ifdef __cplusplus
+}
+#endif
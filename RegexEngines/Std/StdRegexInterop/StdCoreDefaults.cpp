@@ -0,0 +1,22 @@
+
+// (compiled separately from "StdCore.cpp", which redefines the limits)
+
+#include <regex>
+
+#include "StdCore.h"
+#include "../../NativeInfrastructure/StackGuard.h"
+
+
+extern "C" void StdCoreGetDefaultOptions( StdCoreOptions* options )
+{
+	*options = StdCoreOptions{ };
+
+#ifdef _REGEX_MAX_STACK_COUNT
+	options->MaxStackCount = _REGEX_MAX_STACK_COUNT;
+#endif
+#ifdef _REGEX_MAX_COMPLEXITY_COUNT
+	options->MaxComplexityCount = _REGEX_MAX_COMPLEXITY_COUNT;
+#endif
+
+	options->StackSizeMB = static_cast<int32_t>( NativeInfrastructure::DefaultGuardedStackSize / ( 1024 * 1024 ) );
+}
@@ -50,8 +50,13 @@ namespace SubRegRegexEngineNs
 		internal string[] GetSelectedOptions( )
 		{
 			var maximum_depth = tbxMaximumDepth.Text.Trim( );
+			var stack_size = tbxStackSize.Text.Trim( );
 
-			return new string[] { "depth:" + maximum_depth };
+			var options = new List<string> { "depth:" + maximum_depth, "stack:" + stack_size };
+
+			if( cbxAllMatches.IsChecked == true ) options.Add( "all" );
+
+			return options.ToArray( );
 		}
 
 
@@ -73,6 +78,19 @@ namespace SubRegRegexEngineNs
 					maximum_depth = maximum_depth.Substring( "depth:".Length );
 				}
 				tbxMaximumDepth.Text = maximum_depth;
+
+				var stack_size = options.FirstOrDefault( o => o.StartsWith( "stack:" ) );
+				if( stack_size == null )
+				{
+					stack_size = ""; // (default)
+				}
+				else
+				{
+					stack_size = stack_size.Substring( "stack:".Length );
+				}
+				tbxStackSize.Text = stack_size;
+
+				cbxAllMatches.IsChecked = options.Contains( "all" );
 			}
 			finally
 			{
@@ -101,5 +119,16 @@ namespace SubRegRegexEngineNs
 
 			Changed?.Invoke( null, new RegexEngineOptionsChangedArgs { PreferImmediateReaction = false } );
 		}
+
+
+		private void cbxAllMatches_CheckedChanged( object sender, RoutedEventArgs e )
+		{
+			if( !IsFullyLoaded ) return;
+			if( ChangeCounter != 0 ) return;
+
+			CachedOptions = GetSelectedOptions( );
+
+			Changed?.Invoke( null, new RegexEngineOptionsChangedArgs { PreferImmediateReaction = true } );
+		}
 	}
 }
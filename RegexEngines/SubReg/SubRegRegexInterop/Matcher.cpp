@@ -1,29 +1,34 @@
 #include "pch.h"
+#include "SubRegCore.h"
+#include "../../NativeInfrastructure/PhaseTrace.h"
+#include "../../NativeInfrastructure/RegexCoreMatches.h"
 #include "Matcher.h"
 
 
 using namespace System::Diagnostics;
 using namespace System::Runtime::InteropServices;
 using namespace System::Text;
-using namespace msclr::interop;
+using namespace NativeInfrastructure;
 
 
 namespace SubRegRegexInterop
 {
 
-	static Matcher::Matcher( )
-	{
-		AsciiEncoding = Encoding::GetEncoding( "ASCII", EncoderFallback::ExceptionFallback, DecoderFallback::ExceptionFallback );
-	}
-
-
 	Matcher::Matcher( String^ pattern, cli::array<String^>^ options )
-		: Pattern( pattern ), MaximumDepth( 4 )
+		: Pattern( pattern ), MaximumDepth( 4 ), StackSize( 0 ), AllMatches( false ), mRegex( nullptr )
 	{
+		TraceSpan options_span( "subreg", "options" );
+
 		String^ MaximumDepthPrefix = "depth:";
+		String^ StackSizePrefix = "stack:";
 
 		for each( String ^ o in options )
 		{
+			if( o == "all" )
+			{
+				AllMatches = true;
+			}
+
 			if( o->StartsWith( MaximumDepthPrefix ) )
 			{
 				String^ maximum_depth_s = o->Substring( MaximumDepthPrefix->Length );
@@ -36,6 +41,44 @@ namespace SubRegRegexInterop
 
 				MaximumDepth = maximum_depth;
 			}
+
+			if( o->StartsWith( StackSizePrefix ) )
+			{
+				String^ stack_size_s = o->Substring( StackSizePrefix->Length );
+				int stack_size = 0;
+
+				if( !String::IsNullOrWhiteSpace( stack_size_s ) )
+				{
+					if( !int32_t::TryParse( stack_size_s, stack_size ) || stack_size < 0 || stack_size > 1024 )
+					{
+						throw gcnew Exception( String::Format( "Invalid stack size: '{0}'. Enter the number of megabytes between 1 and 1024, or 0 for default", stack_size_s ) );
+					}
+				}
+
+				StackSize = stack_size;
+			}
+		}
+
+		// compile once; the errors are reported for the whole pattern
+
+		SubRegCoreOptions core_options{};
+
+		core_options.MaximumDepth = MaximumDepth;
+		core_options.AllMatches = AllMatches;
+		core_options.StackSizeMB = StackSize;
+
+		options_span.End( );
+
+		pin_ptr<const wchar_t> pinned_pattern = PtrToStringChars( Pattern );
+		RegexCoreError error{};
+
+		TraceSpan compile_span( "subreg", "compile", Pattern->Length );
+		mRegex = SubRegCoreCompile( reinterpret_cast<const char16_t*>( pinned_pattern ), Pattern->Length, &core_options, &error );
+		compile_span.End( );
+
+		if( mRegex == nullptr )
+		{
+			throw gcnew Exception( RegexCoreErrorToString( error ) );
 		}
 	}
 
@@ -48,6 +91,8 @@ namespace SubRegRegexInterop
 
 	Matcher::!Matcher( )
 	{
+		SubRegCoreFree( mRegex );
+		mRegex = nullptr;
 	}
 
 
@@ -63,80 +108,32 @@ namespace SubRegRegexInterop
 		{
 			OriginalText = text;
 
-			cli::array<unsigned char>^ pattern_bytes;
-			cli::array<unsigned char>^ text_bytes;
-			int invalid_pattern_index = -1;
-			int invalid_text_index = -1;
-			cli::array<unsigned char>^ zero_byte = { 0 };
+			// (validated and narrowed in place, without intermediate managed arrays)
+			pin_ptr<const wchar_t> pinned_text = PtrToStringChars( text );
+			RegexCoreManagedCancellation cancellation( cnc );
+			RegexCoreResults results{};
+			RegexCoreError error{};
 
-			try
-			{
-				pattern_bytes = AsciiEncoding->GetBytes( Pattern );
-				if( pattern_bytes->Length == 0 ) pattern_bytes = zero_byte;
-			}
-			catch( EncoderFallbackException^ exc )
-			{
-				invalid_pattern_index = exc->Index;
-			}
+			TraceSpan scan_span( "subreg", "scan", text->Length );
+			int32_t r = SubRegCoreScan( mRegex, reinterpret_cast<const char16_t*>( pinned_text ), text->Length, cancellation.Get( ), &results, &error );
+			scan_span.End( );
 
 			try
 			{
-				text_bytes = AsciiEncoding->GetBytes( text );
-				if( text_bytes->Length == 0 ) text_bytes = zero_byte;
-			}
-			catch( EncoderFallbackException^ exc )
-			{
-				invalid_text_index = exc->Index;
-			}
-
-			if( invalid_pattern_index >= 0 || invalid_text_index >= 0 )
-			{
-				String^ msg = "SubReg only supports ASCII character encoding.\r\n";
-				if( invalid_pattern_index >= 0 ) msg += String::Format( "Pattern contains an invalid character at position {0}.\r\n", invalid_pattern_index );
-				if( invalid_text_index >= 0 ) msg += String::Format( "Text contains an invalid character at position {0}.\r\n", invalid_text_index );
-
-				throw gcnew Exception( msg );
-			}
-
-
-			pin_ptr<unsigned char> pinned_pattern_bytes = &pattern_bytes[0];
-			pin_ptr<unsigned char> pinned_text_bytes = &text_bytes[0];
-
-			const char* native_pattern = (const char*)pinned_pattern_bytes;
-			const char* native_text = (const char*)pinned_text_bytes;
-
-			const int MAX_CAPTURES = 100;
-			std::unique_ptr<subreg_capture_t[]> captures( new subreg_capture_t[MAX_CAPTURES]( ) );
-
-			int result = subreg_match( native_pattern, native_text, captures.get( ), MAX_CAPTURES, MaximumDepth );
-
-			CheckResult( result );
-
-			auto matches = gcnew List<IMatch^>( );
-
-			if( result > 0 )
-			{
-				const subreg_capture_t& capture0 = captures[0];
-				int index0 = CheckedCast::ToInt32( capture0.start - native_text );
-				int length0 = capture0.length;
-
-				auto match = SimpleMatch::Create( index0, length0, this );
-
-				for( int i = 0; i < result; ++i )
+				switch( r )
 				{
-					// (the first is the entire input)
-					const subreg_capture_t& capture = captures[i];
-					int index = CheckedCast::ToInt32( capture.start - native_text );
-					int length = capture.length;
-
-					match->AddGroup( index, length, true, i.ToString( System::Globalization::CultureInfo::InvariantCulture ) );
+				case REGEX_CORE_OK:
+					return RegexCoreResultsToMatches( results, this, 0, "subreg" );
+				case REGEX_CORE_CANCELLED:
+					return RegexMatches::Empty;
+				default:
+					throw gcnew Exception( RegexCoreErrorToString( error ) );
 				}
-
-				matches->Add( match );
 			}
-
-			return gcnew RegexMatches( matches->Count, matches );
-
+			finally
+			{
+				RegexCoreFreeResults( &results );
+			}
 		}
 		catch( Exception^ exc )
 		{
@@ -155,40 +152,4 @@ namespace SubRegRegexInterop
 		return OriginalText->Substring( index, length );
 	}
 
-
-	void Matcher::CheckResult( int result )
-	{
-		if( result >= 1 || result == SUBREG_RESULT_NO_MATCH ) return;
-
-		const char* msg = nullptr;
-		const char* sym = nullptr;
-
-#define T(code, message) \
-	case code : msg = message; sym = #code; break;
-
-		switch( result )
-		{
-			//T( SUBREG_RESULT_NO_MATCH, "No match occurred" )
-			T( SUBREG_RESULT_INVALID_ARGUMENT, "Invalid argument passed to function." )
-				T( SUBREG_RESULT_ILLEGAL_EXPRESSION, "Syntax error found in regular expression." )
-				T( SUBREG_RESULT_MISSING_BRACKET, "A closing group bracket is missing from the regular expression." )
-				T( SUBREG_RESULT_SURPLUS_BRACKET, "A closing group bracket without a matching opening group bracket has been found." )
-				T( SUBREG_RESULT_INVALID_METACHARACTER, "The regular expression contains an invalid metacharacter (typically a malformed \\ escape sequence)" )
-				T( SUBREG_RESULT_MAX_DEPTH_EXCEEDED, "The nesting depth of groups contained within the regular expression exceeds the limit specified by max_depth." )
-				T( SUBREG_RESULT_CAPTURE_OVERFLOW, "Capture array not large enough." )
-				T( SUBREG_RESULT_INVALID_OPTION, "Invalid inline option specified." )
-
-		default:
-			throw gcnew Exception( String::Format( "Unknown result: {0}", result ) );
-			break;
-		}
-
-#undef T
-
-		if( msg != nullptr )
-		{
-			throw gcnew Exception( String::Format( "{0}\r\n\r\n({1}, {2})", gcnew String( msg ), gcnew String( sym ), result ) );
-		}
-	}
-
 }
@@ -13,8 +13,6 @@ namespace SubRegRegexInterop
 {
 	public ref class Matcher : IMatcher, ISimpleTextGetter
 	{
-		static Matcher( );
-
 	public:
 
 		Matcher( String^ pattern, cli::array<String^>^ options );
@@ -38,14 +36,12 @@ namespace SubRegRegexInterop
 
 	private:
 
-		static System::Text::Encoding^ AsciiEncoding;
-
 		int MaximumDepth;
+		int StackSize; // (megabytes; 0 -- default)
+		bool AllMatches;
 		String^ const Pattern;
 		String^ OriginalText;
-
-		void CheckResult( int result );
-
+		SubRegCoreRegex* mRegex; // (compiled once, reused by 'Matches')
 	};
 }
 
@@ -0,0 +1,217 @@
+#include <cstddef>
+#include <cstdio>
+
+#if defined( _M_X64 ) || defined( __SSE2__ )
+#	include <emmintrin.h>
+#	define SUBREG_INTEROP_SSE2
+#endif
+
+extern "C"
+{
+#	include "SubReg-min/subreg.h"
+}
+
+#include "../../NativeInfrastructure/StackGuard.h"
+#include "NativeMatcher.h"
+
+
+namespace SubRegRegexInterop
+{
+
+	struct NativeCompileArgs
+	{
+		SubRegProgram* program;
+		const char* pattern;
+		size_t length;
+		unsigned int maxDepth;
+		size_t* errorPosition;
+
+		int result;
+	};
+
+
+	struct NativeMatchArgs
+	{
+		const SubRegProgram* program;
+		const char* text;
+		size_t length;
+		bool allMatches;
+		unsigned int maxCaptures;
+		const RegexCoreCancellation* cancellation;
+		NativeMatchResults* results;
+
+		int result;
+	};
+
+
+	static void NativeCompileProc( void* p )
+	{
+		NativeCompileArgs* args = (NativeCompileArgs*)p;
+
+		args->result = args->program->Compile( args->pattern, args->length, args->maxDepth, args->errorPosition );
+	}
+
+
+	static bool IsCancelled( const RegexCoreCancellation* cancellation )
+	{
+		return cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context );
+	}
+
+
+	static void NativeMatchProc( void* p )
+	{
+		NativeMatchArgs* args = (NativeMatchArgs*)p;
+		NativeMatchResults* results = args->results;
+
+		std::vector<SubRegCapture> captures( args->maxCaptures );
+
+		if( !args->allMatches )
+		{
+			int r = args->program->Execute( args->text, args->length, 0, true, captures.data( ), args->maxCaptures );
+
+			if( r > 0 )
+			{
+				results->GroupCounts.push_back( r );
+				results->Captures.insert( results->Captures.end( ), captures.begin( ), captures.begin( ) + r );
+			}
+
+			args->result = r > 0 ? 1 : r;
+
+			return;
+		}
+
+		// (the program is reused for every start position; nothing is parsed again)
+
+		size_t last_start = args->program->IsAnchoredAtStart( ) ? 0 : args->length;
+
+		for( size_t start = 0; start <= last_start; )
+		{
+			if( IsCancelled( args->cancellation ) )
+			{
+				args->result = NativeMatchCancelled;
+
+				return;
+			}
+
+			int r = args->program->Execute( args->text, args->length, start, false, captures.data( ), args->maxCaptures );
+
+			if( r < 0 )
+			{
+				args->result = r;
+
+				return;
+			}
+
+			if( r == SUBREG_RESULT_NO_MATCH )
+			{
+				++start;
+
+				continue;
+			}
+
+			results->GroupCounts.push_back( r );
+			results->Captures.insert( results->Captures.end( ), captures.begin( ), captures.begin( ) + r );
+
+			if( IsCancelled( args->cancellation ) )
+			{
+				args->result = NativeMatchCancelled;
+
+				return;
+			}
+
+			// continue after the match; step over the empty ones
+			size_t end = captures[0].Index + captures[0].Length;
+			start = end > start ? end : start + 1;
+		}
+
+		args->result = static_cast<int>( results->GroupCounts.size( ) );
+	}
+
+
+	ptrdiff_t NativeNarrowAscii( const char16_t* text, size_t length, std::string* bytes )
+	{
+		bytes->resize( length );
+
+		char* out = &( *bytes )[0];
+		size_t i = 0;
+
+#ifdef SUBREG_INTEROP_SSE2
+		// sixteen characters at a time; the block with a non-ASCII character is left to the loop below
+
+		const __m128i non_ascii_mask = _mm_set1_epi16( static_cast<short>( 0xFF80 ) );
+		const __m128i zero = _mm_setzero_si128( );
+
+		for( ; i + 16 <= length; i += 16 )
+		{
+			__m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( text + i ) );
+			__m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( text + i + 8 ) );
+			__m128i high = _mm_and_si128( _mm_or_si128( a, b ), non_ascii_mask );
+
+			if( _mm_movemask_epi8( _mm_cmpeq_epi16( high, zero ) ) != 0xFFFF ) break;
+
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), _mm_packus_epi16( a, b ) );
+		}
+#endif
+
+		for( ; i < length; ++i )
+		{
+			if( static_cast<unsigned>( text[i] ) >= 0x80 ) return static_cast<ptrdiff_t>( i );
+
+			out[i] = static_cast<char>( text[i] );
+		}
+
+		return -1;
+	}
+
+
+	static bool GetStackSize( long stackSizeMB, size_t* stackSize, char* errorText, size_t errorTextSize )
+	{
+		*stackSize = NativeInfrastructure::GuardedStackSizeFromMegabytes( stackSizeMB );
+
+		if( *stackSize == 0 )
+		{
+			snprintf( errorText, errorTextSize, "Invalid stack size: %ld MB.", stackSizeMB );
+
+			return false;
+		}
+
+		return true;
+	}
+
+
+	int NativeCompile( SubRegProgram* program, const char* pattern, size_t length, unsigned int maxDepth, size_t* errorPosition,
+		long stackSizeMB, char* errorText, size_t errorTextSize )
+	{
+		using namespace NativeInfrastructure;
+
+		size_t stack_size;
+
+		if( !GetStackSize( stackSizeMB, &stack_size, errorText, errorTextSize ) ) return NativeMatchInterrupted;
+
+		NativeCompileArgs args{ program, pattern, length, maxDepth, errorPosition, SUBREG_RESULT_ILLEGAL_EXPRESSION };
+
+		// (the arguments remain valid, since the function waits for completion)
+		GuardedRunResult r = RunOnGuardedThread( stack_size, &NativeCompileProc, &args, errorText, errorTextSize );
+
+		return r == GuardedRunResult::Completed ? args.result : NativeMatchInterrupted;
+	}
+
+
+	int NativeMatch( const SubRegProgram* program, const char* text, size_t length, bool allMatches, unsigned int maxCaptures,
+		const RegexCoreCancellation* cancellation, NativeMatchResults* results, long stackSizeMB, char* errorText, size_t errorTextSize )
+	{
+		using namespace NativeInfrastructure;
+
+		size_t stack_size;
+
+		if( !GetStackSize( stackSizeMB, &stack_size, errorText, errorTextSize ) ) return NativeMatchInterrupted;
+
+		NativeMatchArgs args{ program, text, length, allMatches, maxCaptures, cancellation, results, SUBREG_RESULT_NO_MATCH };
+
+		// (the arguments remain valid, since the function waits for completion)
+		GuardedRunResult r = RunOnGuardedThread( stack_size, &NativeMatchProc, &args, errorText, errorTextSize );
+
+		return r == GuardedRunResult::Completed ? args.result : NativeMatchInterrupted;
+	}
+
+}
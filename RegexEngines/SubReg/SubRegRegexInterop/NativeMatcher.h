@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../../NativeInfrastructure/RegexCore.h"
+#include "SubRegProgram.h"
+
+
+namespace SubRegRegexInterop
+{
+	// Returned by 'NativeCompile' and 'NativeMatch' if the engine was interrupted (see 'errorText').
+	const int NativeMatchInterrupted = -1000;
+
+	// Returned by 'NativeMatch' if the search was cancelled.
+	const int NativeMatchCancelled = -1001;
+
+
+	struct NativeMatchResults
+	{
+		std::vector<int> GroupCounts; // (for each match; the first group is the whole match)
+		std::vector<SubRegCapture> Captures; // (the groups of all matches, one after another)
+	};
+
+
+	// Copies UTF-16 text to 'bytes' (reusing its capacity) if all of the characters are ASCII.
+	// Returns the index of the first non-ASCII character, or -1.
+	ptrdiff_t NativeNarrowAscii( const char16_t* text, size_t length, std::string* bytes );
+
+
+	// The functions below run the engine on a separate thread that has 'stackSizeMB' megabytes
+	// of stack (0 -- default), so that the deep recursion cannot crash the process.
+
+	// Returns 0 or a 'SUBREG_RESULT_...' error code and the offset of the error.
+	int NativeCompile( SubRegProgram* program, const char* pattern, size_t length, unsigned int maxDepth, size_t* errorPosition,
+		long stackSizeMB, char* errorText, size_t errorTextSize );
+
+	// Matches the whole text, or, if 'allMatches' is true, finds the successive matches from left to right.
+	// Returns the number of matches or an error code. The cancellation (can be null) is checked at each start
+	// position and after each match; a single attempt of the engine cannot be interrupted.
+	int NativeMatch( const SubRegProgram* program, const char* text, size_t length, bool allMatches, unsigned int maxCaptures,
+		const RegexCoreCancellation* cancellation, NativeMatchResults* results, long stackSizeMB, char* errorText, size_t errorTextSize );
+
+}
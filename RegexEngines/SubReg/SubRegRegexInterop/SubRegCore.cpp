@@ -0,0 +1,219 @@
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+
+extern "C"
+{
+#	include "SubReg-min/subreg.h"
+}
+
+#include "NativeMatcher.h"
+#include "SubRegCore.h"
+
+
+using namespace NativeInfrastructure;
+using namespace SubRegRegexInterop;
+
+
+struct SubRegCoreRegex
+{
+	SubRegProgram Program;
+	bool AllMatches = false;
+	long StackSizeMB = 0;
+};
+
+
+// Returns false and the description if 'result' is an error.
+static bool CheckResult( int result, std::string* message )
+{
+	if( result >= 1 || result == SUBREG_RESULT_NO_MATCH ) return true;
+
+	const char* msg = nullptr;
+	const char* sym = nullptr;
+
+#define T(code, message) \
+	case code : msg = message; sym = #code; break;
+
+	switch( result )
+	{
+		//T( SUBREG_RESULT_NO_MATCH, "No match occurred" )
+		T( SUBREG_RESULT_INVALID_ARGUMENT, "Invalid argument passed to function." )
+			T( SUBREG_RESULT_ILLEGAL_EXPRESSION, "Syntax error found in regular expression." )
+			T( SUBREG_RESULT_MISSING_BRACKET, "A closing group bracket is missing from the regular expression." )
+			T( SUBREG_RESULT_SURPLUS_BRACKET, "A closing group bracket without a matching opening group bracket has been found." )
+			T( SUBREG_RESULT_INVALID_METACHARACTER, "The regular expression contains an invalid metacharacter (typically a malformed \\ escape sequence)" )
+			T( SUBREG_RESULT_MAX_DEPTH_EXCEEDED, "The nesting depth of groups contained within the regular expression exceeds the limit specified by max_depth." )
+			T( SUBREG_RESULT_CAPTURE_OVERFLOW, "Capture array not large enough." )
+			T( SUBREG_RESULT_INVALID_OPTION, "Invalid inline option specified." )
+
+	default:
+		*message = "Unknown result: " + std::to_string( result );
+
+		return false;
+	}
+
+#undef T
+
+	*message = std::string( msg ) + "\r\n\r\n(" + sym + ", " + std::to_string( result ) + ")";
+
+	return false;
+}
+
+
+static void SetNonAsciiError( RegexCoreError* error, const char* what, ptrdiff_t index )
+{
+	char text[256];
+	snprintf( text, sizeof( text ), "SubReg only supports ASCII character encoding.\r\n%s contains an invalid character at position %td.\r\n", what, index );
+
+	SetRegexCoreError( error, text );
+}
+
+
+static void SetInterruptedError( RegexCoreError* error, const char* errorText )
+{
+	std::string message = "The engine was interrupted.\r\n\r\n";
+	message += errorText;
+
+	SetRegexCoreError( error, message.c_str( ) );
+}
+
+
+extern "C" SubRegCoreRegex* SubRegCoreCompile( const char16_t* pattern, size_t length, const SubRegCoreOptions* options, RegexCoreError* error )
+{
+	try
+	{
+		std::string pattern_bytes;
+
+		ptrdiff_t invalid_pattern_index = NativeNarrowAscii( pattern, length, &pattern_bytes );
+
+		if( invalid_pattern_index >= 0 )
+		{
+			SetNonAsciiError( error, "Pattern", invalid_pattern_index );
+
+			return nullptr;
+		}
+
+		std::unique_ptr<SubRegCoreRegex> regex( new SubRegCoreRegex );
+
+		regex->AllMatches = options->AllMatches != 0;
+		regex->StackSizeMB = options->StackSizeMB;
+
+		// compile once; the errors are reported for the whole pattern
+
+		size_t error_position = 0;
+		char error_text[256] = "";
+
+		int result = NativeCompile( &regex->Program, pattern_bytes.data( ), pattern_bytes.size( ), static_cast<unsigned>( options->MaximumDepth ),
+			&error_position, regex->StackSizeMB, error_text, sizeof( error_text ) );
+
+		if( result == NativeMatchInterrupted )
+		{
+			SetInterruptedError( error, error_text );
+
+			return nullptr;
+		}
+
+		std::string message;
+
+		if( !CheckResult( result, &message ) )
+		{
+			message += "\r\n\r\nPosition in pattern: " + std::to_string( error_position ) + ".";
+
+			SetRegexCoreError( error, message.c_str( ) );
+
+			return nullptr;
+		}
+
+		return regex.release( );
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return nullptr;
+	}
+}
+
+
+extern "C" int32_t SubRegCoreScan( const SubRegCoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+	RegexCoreResults* results, RegexCoreError* error )
+{
+	*results = RegexCoreResults{ };
+
+	try
+	{
+		std::string text_bytes; // (local, so that a regex can be scanned by several threads at once)
+
+		ptrdiff_t invalid_text_index = NativeNarrowAscii( text, length, &text_bytes );
+
+		if( invalid_text_index >= 0 )
+		{
+			SetNonAsciiError( error, "Text", invalid_text_index );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		if( cancellation != nullptr && cancellation->IsCancelled != nullptr && cancellation->IsCancelled( cancellation->Context ) )
+		{
+			return REGEX_CORE_CANCELLED;
+		}
+
+		const unsigned MAX_CAPTURES = 100;
+		NativeMatchResults native_results;
+		char error_text[256] = "";
+
+		int result = NativeMatch( &regex->Program, text_bytes.data( ), text_bytes.size( ), regex->AllMatches, MAX_CAPTURES, cancellation,
+			&native_results, regex->StackSizeMB, error_text, sizeof( error_text ) );
+
+		if( result == NativeMatchCancelled ) return REGEX_CORE_CANCELLED;
+
+		if( result == NativeMatchInterrupted )
+		{
+			SetInterruptedError( error, error_text );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		std::string message;
+
+		if( !CheckResult( result, &message ) )
+		{
+			SetRegexCoreError( error, message.c_str( ) );
+
+			return REGEX_CORE_ERROR;
+		}
+
+		RegexCoreResultsBuilder builder;
+		size_t k = 0;
+
+		for( int group_count : native_results.GroupCounts )
+		{
+			builder.BeginMatch( group_count );
+
+			// (the first is the entire match)
+			for( int i = 0; i < group_count; ++i, ++k )
+			{
+				const SubRegCapture& capture = native_results.Captures[k];
+
+				builder.AddGroup( capture.Index, capture.Length );
+			}
+		}
+
+		builder.Release( results );
+
+		return REGEX_CORE_OK;
+	}
+	catch( const std::exception& exc )
+	{
+		SetRegexCoreError( error, exc.what( ) );
+
+		return REGEX_CORE_ERROR;
+	}
+}
+
+
+extern "C" void SubRegCoreFree( SubRegCoreRegex* regex )
+{
+	delete regex;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// The portable core of SubReg interop (see "RegexCore.h"), over 'SubRegProgram' and the guarded
+// functions of "NativeMatcher.h". The pattern and the text must be ASCII.
+//
+// SubReg cannot be interrupted inside an attempt; the cancellation is checked before the search, at each
+// start position and after each match, so that the scans of long texts can be stopped.
+
+#include "../../NativeInfrastructure/RegexCore.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	typedef struct SubRegCoreOptions
+	{
+		int32_t MaximumDepth; // (of nested groups)
+		int32_t AllMatches; // (0 -- the whole text must match; otherwise the successive matches are found)
+		int32_t StackSizeMB;
+	} SubRegCoreOptions;
+
+
+	typedef struct SubRegCoreRegex SubRegCoreRegex;
+
+
+	SubRegCoreRegex* SubRegCoreCompile( const char16_t* pattern, size_t length, const SubRegCoreOptions* options, RegexCoreError* error );
+
+	int32_t SubRegCoreScan( const SubRegCoreRegex* regex, const char16_t* text, size_t length, const RegexCoreCancellation* cancellation,
+		RegexCoreResults* results, RegexCoreError* error );
+
+	void SubRegCoreFree( SubRegCoreRegex* regex );
+
+#ifdef __cplusplus
+}
+#endif
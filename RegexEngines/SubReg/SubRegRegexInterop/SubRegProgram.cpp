@@ -0,0 +1,517 @@
+#include "SubRegProgram.h"
+
+extern "C"
+{
+#	include "SubReg-min/subreg.h"
+}
+
+
+namespace SubRegRegexInterop
+{
+
+	enum : uint8_t
+	{
+		OP_SUB_EXPR,		// followed by branches; 'Next' is after the last one
+		OP_BRANCH,			// followed by items; 'Next' is the next branch or the end of sub-expression
+		OP_CHAR,			// 'Arg' is the character
+		OP_ANY,				// '.'
+		OP_CLASS,			// 'Arg' is 'd', 'h', 's', 'w', or uppercase for the inverted classes
+		OP_END_OF_TEXT,		// (the empty pattern or branch, which matches the terminating '\0' in SubReg)
+		OP_OPTION,			// 'Arg' is 'i' or 'I'
+		OP_GROUP,			// 'Arg' is the mode; followed by a sub-expression
+		OP_REPEAT,			// 'Arg' is '?', '+' or '*'; followed by one item
+	};
+
+
+	enum : uint8_t
+	{
+		MODE_CAPTURE,
+		MODE_NON_CAPTURE,
+		MODE_POS_LOOK_AHEAD,
+		MODE_NEG_LOOK_AHEAD,
+	};
+
+
+	const int RESULT_MATCH = 1; // (same as 'SUBREG_RESULT_INTERNAL_MATCH')
+
+
+	class SubRegCompiler
+	{
+	public:
+
+		SubRegCompiler( std::vector<SubRegInstruction>& code, const char* pattern, size_t length, unsigned maxDepth )
+			:
+			mCode( code ),
+			mPattern( reinterpret_cast<const unsigned char*>( pattern ) ),
+			mLength( length ),
+			mMaxDepth( maxDepth ),
+			mPos( 0 ),
+			mDepth( 0 )
+		{
+		}
+
+		size_t Position( ) const { return mPos; }
+		bool AtEnd( ) const { return mPos >= mLength; }
+		unsigned char Current( ) const { return AtEnd( ) ? 0 : mPattern[mPos]; }
+		void Advance( ) { ++mPos; }
+
+		int SubExpr( );
+
+	private:
+
+		std::vector<SubRegInstruction>& mCode;
+		const unsigned char* const mPattern;
+		const size_t mLength;
+		const unsigned mMaxDepth;
+		size_t mPos;
+		unsigned mDepth;
+
+		uint32_t Emit( uint8_t op, uint8_t arg )
+		{
+			uint32_t index = static_cast<uint32_t>( mCode.size( ) );
+
+			mCode.push_back( SubRegInstruction{ op, arg, index + 1 } );
+
+			return index;
+		}
+
+		void Close( uint32_t index ) { mCode[index].Next = static_cast<uint32_t>( mCode.size( ) ); }
+
+		int Concatenation( );
+		int Repetition( );
+		int Atom( );
+		int HexDigit( unsigned char* value );
+	};
+
+
+	int SubRegCompiler::SubExpr( )
+	{
+		uint32_t sub_expr = Emit( OP_SUB_EXPR, 0 );
+
+		for( ;;)
+		{
+			uint32_t branch = Emit( OP_BRANCH, 0 );
+
+			int r = Concatenation( );
+			if( r < 0 ) return r;
+
+			Close( branch );
+
+			if( Current( ) != '|' || AtEnd( ) ) break;
+
+			Advance( );
+		}
+
+		Close( sub_expr );
+
+		return 0;
+	}
+
+
+	int SubRegCompiler::Concatenation( )
+	{
+		// (as in 'parse_concatenation', the first item is parsed even if it is '|', '$' or the end)
+
+		for( bool first = true; ; first = false )
+		{
+			if( !AtEnd( ) && Current( ) == ')' ) break;
+			if( !first && ( AtEnd( ) || Current( ) == '|' || Current( ) == '$' ) ) break;
+
+			int r = Repetition( );
+			if( r < 0 ) return r;
+
+			if( AtEnd( ) ) break;
+		}
+
+		return 0;
+	}
+
+
+	int SubRegCompiler::Repetition( )
+	{
+		uint32_t atom = static_cast<uint32_t>( mCode.size( ) );
+
+		int r = Atom( );
+		if( r < 0 ) return r;
+
+		if( AtEnd( ) ) return 0;
+
+		unsigned char q = Current( );
+		if( q != '?' && q != '+' && q != '*' ) return 0;
+
+		Advance( );
+
+		// insert the repetition before the item
+
+		for( size_t i = atom; i < mCode.size( ); ++i ) ++mCode[i].Next;
+
+		mCode.insert( mCode.begin( ) + atom, SubRegInstruction{ OP_REPEAT, q, static_cast<uint32_t>( mCode.size( ) + 1 ) } );
+
+		return 0;
+	}
+
+
+	int SubRegCompiler::HexDigit( unsigned char* value )
+	{
+		unsigned char c = Current( );
+
+		if( AtEnd( ) ) return SUBREG_RESULT_INVALID_METACHARACTER;
+		else if( c >= '0' && c <= '9' ) *value = static_cast<unsigned char>( ( *value << 4 ) | ( c - '0' ) );
+		else if( c >= 'A' && c <= 'F' ) *value = static_cast<unsigned char>( ( *value << 4 ) | ( c - 'A' + 10 ) );
+		else if( c >= 'a' && c <= 'f' ) *value = static_cast<unsigned char>( ( *value << 4 ) | ( c - 'a' + 10 ) );
+		else return SUBREG_RESULT_INVALID_METACHARACTER;
+
+		Advance( );
+
+		return 0;
+	}
+
+
+	int SubRegCompiler::Atom( )
+	{
+		if( AtEnd( ) )
+		{
+			Emit( OP_END_OF_TEXT, 0 );
+
+			return 0;
+		}
+
+		unsigned char c = Current( );
+		Advance( );
+
+		switch( c )
+		{
+		case '(':
+		{
+			if( ++mDepth > mMaxDepth ) return SUBREG_RESULT_MAX_DEPTH_EXCEEDED;
+
+			uint8_t mode = MODE_CAPTURE;
+
+			if( Current( ) == '?' && !AtEnd( ) )
+			{
+				Advance( );
+
+				unsigned char m = Current( );
+
+				if( AtEnd( ) ) return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+				else if( m == ':' ) mode = MODE_NON_CAPTURE;
+				else if( m == '=' ) mode = MODE_POS_LOOK_AHEAD;
+				else if( m == '!' ) mode = MODE_NEG_LOOK_AHEAD;
+				else if( ( m >= 'A' && m <= 'Z' ) || ( m >= 'a' && m <= 'z' ) )
+				{
+					if( m != 'i' && m != 'I' ) return SUBREG_RESULT_INVALID_OPTION;
+
+					Advance( );
+
+					if( AtEnd( ) || Current( ) != ')' ) return SUBREG_RESULT_MISSING_BRACKET;
+
+					Advance( );
+					--mDepth;
+
+					Emit( OP_OPTION, m );
+
+					return 0;
+				}
+				else return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+
+				Advance( );
+			}
+
+			uint32_t group = Emit( OP_GROUP, mode );
+
+			int r = SubExpr( );
+			if( r < 0 ) return r;
+
+			if( AtEnd( ) || Current( ) != ')' ) return SUBREG_RESULT_MISSING_BRACKET;
+
+			Advance( );
+			--mDepth;
+
+			Close( group );
+		}
+		break;
+
+		case '\\':
+		{
+			if( AtEnd( ) ) return SUBREG_RESULT_INVALID_METACHARACTER;
+
+			unsigned char e = Current( );
+			Advance( );
+
+			switch( e )
+			{
+			case 'D': case 'H': case 'S': case 'W':
+			case 'd': case 'h': case 's': case 'w':
+				Emit( OP_CLASS, e );
+				break;
+			case 'b': Emit( OP_CHAR, '\b' ); break;
+			case 'f': Emit( OP_CHAR, '\f' ); break;
+			case 'n': Emit( OP_CHAR, '\n' ); break;
+			case 'r': Emit( OP_CHAR, '\r' ); break;
+			case 't': Emit( OP_CHAR, '\t' ); break;
+			case 'v': Emit( OP_CHAR, '\v' ); break;
+			case 'x':
+			{
+				unsigned char value = 0;
+
+				int r = HexDigit( &value );
+				if( r < 0 ) return r;
+
+				r = HexDigit( &value );
+				if( r < 0 ) return r;
+
+				Emit( OP_CHAR, value );
+			}
+			break;
+			default:
+				Emit( OP_CHAR, e );
+			}
+		}
+		break;
+
+		case '.':
+			Emit( OP_ANY, 0 );
+			break;
+
+		default:
+			Emit( OP_CHAR, c );
+		}
+
+		return 0;
+	}
+
+
+	SubRegProgram::SubRegProgram( )
+		:
+		mAnchoredAtStart( false ),
+		mAnchoredAtEnd( false )
+	{
+	}
+
+
+	int SubRegProgram::Compile( const char* pattern, size_t length, unsigned maxDepth, size_t* errorPosition )
+	{
+		mCode.clear( );
+		mAnchoredAtStart = false;
+		mAnchoredAtEnd = false;
+
+		SubRegCompiler compiler( mCode, pattern, length, maxDepth );
+
+		if( !compiler.AtEnd( ) && compiler.Current( ) == '^' )
+		{
+			mAnchoredAtStart = true;
+			compiler.Advance( );
+		}
+
+		int r = compiler.SubExpr( );
+
+		if( r == 0 && !compiler.AtEnd( ) && compiler.Current( ) == '$' )
+		{
+			mAnchoredAtEnd = true;
+			compiler.Advance( );
+		}
+
+		if( r == 0 && !compiler.AtEnd( ) )
+		{
+			r = compiler.Current( ) == ')' ? SUBREG_RESULT_SURPLUS_BRACKET : SUBREG_RESULT_ILLEGAL_EXPRESSION;
+		}
+
+		*errorPosition = r < 0 ? compiler.Position( ) : 0;
+
+		if( r < 0 ) mCode.clear( );
+
+		return r;
+	}
+
+
+	struct SubRegExecState
+	{
+		const SubRegInstruction* code;
+		const unsigned char* text;
+		size_t length;
+		size_t pos;
+		bool noCase;
+		SubRegCapture* captures;
+		unsigned maxCaptures;
+		unsigned captureIndex;
+	};
+
+
+	static bool IsInClass( unsigned char c, unsigned char cls )
+	{
+		switch( cls | 0x20 ) // (to lowercase)
+		{
+		case 'd': return c >= '0' && c <= '9';
+		case 'h': return ( c >= '0' && c <= '9' ) || ( c >= 'A' && c <= 'F' ) || ( c >= 'a' && c <= 'f' );
+		case 's': return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+		case 'w': return ( c >= '0' && c <= '9' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= 'a' && c <= 'z' ) || c == '_';
+		}
+
+		return false;
+	}
+
+
+	static unsigned char ToUpper( unsigned char c )
+	{
+		return c >= 'a' && c <= 'z' ? static_cast<unsigned char>( c - 'a' + 'A' ) : c;
+	}
+
+
+	static int ExecItem( SubRegExecState& s, uint32_t pc );
+
+
+	static int ExecSubExpr( SubRegExecState& s, uint32_t pc )
+	{
+		const uint32_t end = s.code[pc].Next;
+		const bool saved_no_case = s.noCase;
+		const size_t begin = s.pos;
+		int result = SUBREG_RESULT_NO_MATCH;
+
+		// ordered alternation; the option changes of failed branches remain until the end, as in SubReg
+
+		for( uint32_t branch = pc + 1; branch < end; branch = s.code[branch].Next )
+		{
+			s.pos = begin;
+			result = RESULT_MATCH;
+
+			for( uint32_t i = branch + 1; i < s.code[branch].Next; i = s.code[i].Next )
+			{
+				result = ExecItem( s, i );
+				if( result <= 0 ) break;
+			}
+
+			if( result != SUBREG_RESULT_NO_MATCH ) break;
+		}
+
+		s.noCase = saved_no_case;
+
+		return result;
+	}
+
+
+	static int ExecItem( SubRegExecState& s, uint32_t pc )
+	{
+		const SubRegInstruction& instr = s.code[pc];
+
+		switch( instr.Op )
+		{
+		case OP_CHAR:
+			if( s.pos < s.length && ( s.text[s.pos] == instr.Arg || ( s.noCase && ToUpper( s.text[s.pos] ) == ToUpper( instr.Arg ) ) ) )
+			{
+				++s.pos;
+				return RESULT_MATCH;
+			}
+			return SUBREG_RESULT_NO_MATCH;
+
+		case OP_ANY:
+			if( s.pos < s.length )
+			{
+				++s.pos;
+				return RESULT_MATCH;
+			}
+			return SUBREG_RESULT_NO_MATCH;
+
+		case OP_CLASS:
+			// (uppercase classes are inverted; all fail at the end of text)
+			if( s.pos < s.length && IsInClass( s.text[s.pos], instr.Arg ) == ( instr.Arg >= 'a' ) )
+			{
+				++s.pos;
+				return RESULT_MATCH;
+			}
+			return SUBREG_RESULT_NO_MATCH;
+
+		case OP_END_OF_TEXT:
+			return s.pos >= s.length ? RESULT_MATCH : SUBREG_RESULT_NO_MATCH;
+
+		case OP_OPTION:
+			s.noCase = instr.Arg == 'i';
+			return RESULT_MATCH;
+
+		case OP_GROUP:
+		{
+			size_t start = s.pos;
+
+			int result = ExecSubExpr( s, pc + 1 );
+			if( result < 0 ) return result;
+
+			switch( instr.Arg )
+			{
+			case MODE_CAPTURE:
+				if( result > 0 && s.maxCaptures > 0 )
+				{
+					if( s.captureIndex + 1 > s.maxCaptures ) return SUBREG_RESULT_CAPTURE_OVERFLOW;
+
+					s.captures[s.captureIndex++] = SubRegCapture{ start, s.pos - start };
+				}
+				break;
+			case MODE_POS_LOOK_AHEAD:
+				s.pos = start;
+				break;
+			case MODE_NEG_LOOK_AHEAD:
+				s.pos = start;
+				result = result > 0 ? SUBREG_RESULT_NO_MATCH : RESULT_MATCH;
+				break;
+			}
+
+			return result;
+		}
+
+		case OP_REPEAT:
+		{
+			size_t check_point = s.pos;
+
+			int result = ExecItem( s, pc + 1 );
+			if( result < 0 ) return result;
+
+			if( result == SUBREG_RESULT_NO_MATCH )
+			{
+				if( instr.Arg == '+' ) return SUBREG_RESULT_NO_MATCH;
+
+				s.pos = check_point;
+
+				return RESULT_MATCH;
+			}
+
+			if( instr.Arg == '?' ) return RESULT_MATCH;
+
+			// greedy, without backtracking
+
+			while( s.pos != check_point )
+			{
+				check_point = s.pos;
+
+				result = ExecItem( s, pc + 1 );
+				if( result < 0 ) return result;
+
+				if( result == SUBREG_RESULT_NO_MATCH )
+				{
+					s.pos = check_point;
+					break;
+				}
+			}
+
+			return RESULT_MATCH;
+		}
+		}
+
+		return SUBREG_RESULT_ILLEGAL_EXPRESSION; // (not expected)
+	}
+
+
+	int SubRegProgram::Execute( const char* text, size_t length, size_t start, bool toEnd, SubRegCapture captures[], unsigned maxCaptures ) const
+	{
+		if( mCode.empty( ) ) return SUBREG_RESULT_INVALID_ARGUMENT;
+
+		SubRegExecState s{ mCode.data( ), reinterpret_cast<const unsigned char*>( text ), length, start, false, captures, maxCaptures, 1 };
+
+		int result = ExecSubExpr( s, 0 );
+		if( result <= 0 ) return result;
+
+		if( ( toEnd || mAnchoredAtEnd ) && s.pos != length ) return SUBREG_RESULT_NO_MATCH;
+
+		if( maxCaptures > 0 ) captures[0] = SubRegCapture{ start, s.pos - start };
+
+		return static_cast<int>( s.captureIndex );
+	}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Compiled form of SubReg patterns.
+//
+// The pattern is parsed once into a compact array of instructions, which mirrors the
+// structure of the recursive parser in "SubReg-min/subreg.c"; the matcher walks the array
+// instead of re-parsing the pattern text at every run. The semantics follow 'subreg_match':
+// ordered alternation, greedy repetitions without backtracking, captures numbered in the order
+// in which the groups succeed, '(?i)' and '(?I)' applied dynamically until the end of the group.
+//
+// Differences from 'subreg_match':
+//  - syntax errors are reported for the whole pattern (SubReg finds only the errors on the tried path);
+//  - a repetition stops if an iteration does not advance (SubReg loops forever);
+//  - an empty branch matches the end of text without stepping over it;
+//  - the text is given by length, therefore it can contain '\0'.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace SubRegRegexInterop
+{
+
+	struct SubRegInstruction
+	{
+		uint8_t Op;
+		uint8_t Arg;
+		uint32_t Next; // (index of the next item; the items of groups and repetitions are skipped)
+	};
+
+
+	struct SubRegCapture
+	{
+		size_t Index;
+		size_t Length;
+	};
+
+
+	class SubRegProgram
+	{
+	public:
+
+		SubRegProgram( );
+
+		// Returns 0, or one of 'SUBREG_RESULT_...' error codes and the offset of the error in the pattern.
+		int Compile( const char* pattern, size_t length, unsigned maxDepth, size_t* errorPosition );
+
+		// Matches the text at 'start'. If 'toEnd' is true, the match must reach the end of text.
+		// Returns the number of captures (the first one is the whole match), 'SUBREG_RESULT_NO_MATCH',
+		// or an error code ('SUBREG_RESULT_CAPTURE_OVERFLOW').
+		int Execute( const char* text, size_t length, size_t start, bool toEnd, SubRegCapture captures[], unsigned maxCaptures ) const;
+
+		bool IsAnchoredAtStart( ) const { return mAnchoredAtStart; } // ('^')
+		bool IsAnchoredAtEnd( ) const { return mAnchoredAtEnd; } // ('$')
+
+	private:
+
+		std::vector<SubRegInstruction> mCode;
+		bool mAnchoredAtStart;
+		bool mAnchoredAtEnd;
+	};
+
+}